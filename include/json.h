@@ -33,6 +33,11 @@
 #ifndef _JSON_H
 #define _JSON_H
 
+/* percona: profile diagnostics need the position of every value */
+#ifndef JSON_TRACK_SOURCE
+   #define JSON_TRACK_SOURCE
+#endif
+
 #ifndef json_char
    #define json_char char
 #endif
@@ -288,10 +293,18 @@ void json_value_free_ex (json_settings * settings,
 #endif
 
 /* percona extensions */
+typedef struct json_slice
+{
+   const json_char * ptr;   /* borrowed from the parsed tree, null terminated */
+   unsigned int length;
+} json_slice;
+
  json_value *json_get_value_for_key(json_value * source, const char *key);
  int         json_get_int_value_for_key(json_value * source, const char *key, int *value);
  int         json_get_long_value_for_key(json_value * source, const char *key, long *value);
- char       *json_get_string_value_for_key(json_value * source, const char *key);
+ const char *json_get_string_value_for_key(json_value * source, const char *key);
+ int         json_get_slice_for_key(json_value * source, const char *key, json_slice *slice);
+ int         json_get_number_value_for_key(json_value * source, const char *key, double *value);
  int         json_get_bool_value_for_key(json_value * source, const char *key, bool *value);
  int         json_get_double_value_for_key(json_value * source, const char *key, double *value);
 
@@ -0,0 +1,118 @@
+/*-------------------------------------------------------------------------
+ *
+ * json_scan.h
+ *		Fast path json parser: SIMD structural scanner feeding a flat tape.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __JSON_SCAN_H__
+#define __JSON_SCAN_H__
+
+#include <stdint.h>
+#include "json.h"
+
+/* Containers nested deeper than this are left to the scalar parser */
+#define JSON_TAPE_MAX_DEPTH 1024
+
+/*
+ * One node per json value in document order. The children of a container
+ * follow it directly, an object stores its members as key, value pairs.
+ */
+typedef struct json_tape_node
+{
+    json_type type;
+    uint32_t length;            /* members/elements for containers, bytes for strings */
+    uint32_t next;              /* index of the node after this value and its children */
+    uint32_t source_offset;     /* where the value starts in the input */
+    union
+    {
+        int boolean;
+        json_int_t integer;
+        double dbl;
+        size_t string_offset;   /* into json_tape.strings */
+    } u;
+} json_tape_node;
+
+typedef struct json_tape
+{
+    json_tape_node *nodes;
+    uint32_t num_nodes;
+    char *strings;              /* unescaped, NUL terminated strings */
+    size_t strings_size;
+    uint32_t *line_starts;      /* offset of every line, see json_tape_index_lines() */
+    uint32_t num_lines;
+} json_tape;
+
+/*
+ * A value on a tape. Readers walk the tape with cursors instead of
+ * building a json_value tree, the strings are read in place and stay
+ * valid for as long as the tape does.
+ */
+typedef struct json_cursor
+{
+    const json_tape *tape;
+    uint32_t node;
+} json_cursor;
+
+const char *json_scan_implementation(void);
+int json_tape_parse(json_tape *tape, const json_char *json, size_t length);
+
+/*
+ * json_tape_parse() that explains a failure in error, which must hold
+ * json_error_max bytes. The message is the one json_parse_ex() gives.
+ */
+int json_tape_parse_ex(json_tape *tape, const json_char *json, size_t length, char *error);
+
+/* Remember where the lines of json start, for json_cursor_position() */
+int json_tape_index_lines(json_tape *tape, const json_char *json, size_t length);
+void json_tape_free(json_tape *tape);
+json_value *json_tape_to_value(json_tape *tape, json_settings *settings, const json_char *json);
+
+/* Cursor on the top-level value, false for an empty tape */
+bool json_tape_root(const json_tape *tape, json_cursor *root);
+const json_tape_node *json_cursor_node(const json_cursor *cursor);
+json_type json_cursor_type(const json_cursor *cursor);
+
+/*
+ * First element of an array or first key of an object. json_cursor_next()
+ * steps over a value and its children, from a key to its value and from
+ * a value to the next key or element.
+ */
+bool json_cursor_child(const json_cursor *container, json_cursor *child);
+void json_cursor_next(json_cursor *cursor);
+
+/* NULL when the value is not a string */
+const char *json_cursor_string(const json_cursor *cursor);
+
+/* Integer or double value as a double */
+bool json_cursor_number(const json_cursor *cursor, double *number);
+
+/* Line and column of the value, false when the lines were not indexed */
+bool json_cursor_position(const json_cursor *cursor, unsigned int *line, unsigned int *col);
+
+/*
+ * Member lookups, keys are matched without regard to case like the
+ * json_get_*_for_key() ones of json.h, which they return the same as.
+ */
+bool json_cursor_get(const json_cursor *object, const char *key, json_cursor *value);
+const char *json_cursor_get_string(const json_cursor *object, const char *key);
+int json_cursor_get_long(const json_cursor *object, const char *key, long *value);
+int json_cursor_get_number(const json_cursor *object, const char *key, double *value);
+int json_cursor_get_bool(const json_cursor *object, const char *key, bool *value);
+
+/*
+ * Parse using the tape and fall back to json_parse_ex() whenever the fast
+ * path can not handle the input, which also gives the exact error message.
+ */
+json_value *json_parse_fast(json_settings *settings, const json_char *json, size_t length, char *error);
+
+#endif // __JSON_SCAN_H__
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_arena.h
+ *		Bump allocator for memory that is released all at once.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_ARENA_H__
+#define __PG_ARENA_H__
+
+#include <stddef.h>
+
+#define ARENA_MIN_BLOCK_SIZE (16 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (4 * 1024 * 1024)
+
+typedef struct pg_arena_block PGArenaBlock;
+
+typedef struct pg_arena
+{
+    PGArenaBlock *blocks;       /* current block first */
+    size_t next_block_size;
+    size_t allocated;           /* bytes handed out, for reporting */
+} PGArena;
+
+PGArena *pg_arena_create(size_t initial_size);
+void *pg_arena_alloc(PGArena *arena, size_t size);
+void *pg_arena_calloc(PGArena *arena, size_t size);
+char *pg_arena_strdup(PGArena *arena, const char *str);
+char *pg_arena_strndup(PGArena *arena, const char *str, size_t len);
+char *pg_arena_sprintf(PGArena *arena, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void pg_arena_reset(PGArena *arena);
+void pg_arena_destroy(PGArena *arena);
+
+/* json_settings allocator hooks, user_data is the arena */
+void *pg_arena_json_alloc(size_t size, int zero, void *user_data);
+void pg_arena_json_free(void *ptr, void *user_data);
+
+#endif // __PG_ARENA_H__
@@ -19,6 +19,7 @@
 #define __PG_AUTO_TUNE_H__
 #include <stdbool.h>
 #include "pg_parse_pgconfig.h"
+#include "pg_arena.h"
 
 #define MAX_MESSAGE_LEN 256
 #define INVALID_DOUBLE_VAL  999999999.99
@@ -31,6 +32,25 @@ typedef enum WORKLOAD_TYPE
     UNKNOWN_WL
 } WORKLOAD_TYPE;
 
+/* DATA_SCALE is 0 up to this data size and grows by 1 with every doubling */
+#define DATA_SCALE_BASE (1024.0 * 1024 * 1024)
+
+/* Build defaults of the server, for data directories that do not tell */
+#define DEFAULT_BLOCK_SIZE 8192
+#define DEFAULT_WAL_SEGMENT_SIZE (16 * 1024 * 1024)
+
+/* Number of workload types a map entry carries a factor for */
+#define NUM_WORKLOAD_FACTORS (MIXED + 1)
+
+/* How the factors of a parameter are combined for a blend of workloads */
+typedef enum BLEND_MODE
+{
+    BLEND_LINEAR = 0,
+    BLEND_GEOMETRIC,
+    BLEND_MAX,
+    INVALID_BLEND
+} BLEND_MODE;
+
 typedef enum DISK_TYPE
 {
     MAGNETIC,
@@ -63,6 +83,31 @@ typedef struct system_info
     NODE_TYPE node_type;
     DISK_TYPE disk_type;
     WORKLOAD_TYPE workload_type;
+
+    /*
+     * Share of each workload when the host runs a blend of them, summing to
+     * 1. All zero means the host runs workload_type alone, otherwise
+     * workload_type is the dominant workload of the blend.
+     */
+    double workload_weights[NUM_WORKLOAD_FACTORS];
+
+    /* Bytes of shared buffers at the knee of the miss ratio curve, 0 when unknown */
+    long long cache_knee;
+
+    /* Shape of the data in the data directory, 0 when it is not scanned */
+    long long data_size;
+    long long largest_table;
+    long relation_count;
+
+    /* What the data directory was created with, 0 when it is not known */
+    int server_version;         /* major version as PG_VERSION_NUM, e.g. 160000 */
+    long block_size;
+    long long wal_segment_size;
+
+    /* Memory of the host, 0 when it is not measured */
+    double memory_bandwidth;    /* GB/s of the triad on every CPU at once */
+    double core_bandwidth;      /* GB/s of the triad on a single CPU */
+    double memory_latency;      /* ns of a load from memory */
 } SystemInfo;
 
 typedef enum RESOURCES
@@ -74,14 +119,25 @@ typedef enum RESOURCES
     RESOURCE_NODE_TYPE,
     RESOURCE_HOST_TYPE,
     RESOURCE_CUSTOM,
+    RESOURCE_MRC,       /* knee of the shared buffers miss ratio curve */
+    RESOURCE_DATA_SIZE,         /* bytes of relation data */
+    RESOURCE_LARGEST_TABLE,     /* bytes of the largest table */
+    RESOURCE_RELATIONS,         /* number of relations */
+    RESOURCE_DATA_SCALE,        /* doublings of the data size over DATA_SCALE_BASE */
+    RESOURCE_MEMBW,             /* CPUs the memory bandwidth feeds */
     INVALID_RESOURCE
 } RESOURCES;
 
+/* Sets of resources, e.g. the ones that changed since the last run */
+#define RESOURCE_BIT(res) (1u << (res))
+#define ALL_RESOURCES (~0u)
+
 typedef enum FORMULAS
 {
     PERCENTAGE,
     SCRIPT,
     CUSTOM,
+    CALIBRATED,         /* a planner cost measured on the host */
     INVALID_FORMULA
 }FORMULAS;
 
@@ -98,10 +154,13 @@ typedef struct pg_config_map_entry PGConfigMapEntry;
 struct pg_config_map_entry
 {
     char *param;
+    char *profile_param;    /* name in the profile while param is its replacement of another version */
     RESOURCES   resource;
     FORMULAS formula;
     PARAM_TYPE type;
     char *value;
+    double factor_value;    /* value parsed as a number */
+    char *workload_values[NUM_WORKLOAD_FACTORS];
     // union 
     // {
     //     char *char_val;
@@ -114,6 +173,13 @@ struct pg_config_map_entry
     // double    mixed_value;
     
     double    trigger_value;
+    BLEND_MODE  blend;
+
+    /* Optional bounds of a computed value, in its unit (bytes for sizes) */
+    bool has_min;
+    bool has_max;
+    double min_value;
+    double max_value;
     ENTRY_STATUS    status;
 
     /* These fields are used by processor */
@@ -140,15 +206,57 @@ typedef struct pg_map_profile_details
     char*   engine;
 }PGMapProfileDetails;
 
+/* Diagnostics of the library, the DEBUG and LOG lines of pg_auto_tune */
+typedef enum PGAT_LOG_LEVEL
+{
+    PGAT_LOG_DEBUG,
+    PGAT_LOG_INFO
+} PGAT_LOG_LEVEL;
+
+typedef void (*PGATLogHook)(PGAT_LOG_LEVEL level, const char *message, void *arg);
+
 typedef struct pg_config_map
 {
     int num_entries;
     PGConfigMapEntry *list;
 
+    /* Where loading and processing the map log, nowhere when NULL */
+    PGATLogHook log_hook;
+    void *log_arg;
+
+    /* Entries and their strings, NULL for maps loaded from a text file */
+    PGArena *arena;
+
+    /* Set when the map is loaded from a compiled profile image */
+    void *image;
+    size_t image_size;
+
 } PGConfigMap;
 
 /* located in pg_config_processor.c */
 void load_pg_config_in_map(PGConfigMap* config_map, PGConfig *pg_config);
 void process_config_map(PGConfigMap* config_map, SystemInfo *system_info);
+int process_config_map_resources(PGConfigMap* config_map, SystemInfo *system_info, unsigned int resources);
+struct log_evidence;
+void process_log_evidence(PGConfigMap *config_map, SystemInfo *system_info, PGConfig *pg_config, struct log_evidence *evidence);
+struct cache_residency;
+void process_cache_residency(PGConfigMap *config_map, SystemInfo *system_info, struct cache_residency *residency);
+struct heap_scan;
+void process_heap_scan(PGConfigMap *config_map, SystemInfo *system_info, struct heap_scan *scan);
+struct xid_rate;
+void process_xid_rate(PGConfigMap *config_map, SystemInfo *system_info, struct xid_rate *rate);
+struct wal_stream;
+void process_wal_stream(PGConfigMap *config_map, SystemInfo *system_info, PGConfig *pg_config, struct wal_stream *stream);
+struct compression_bench;
+void process_compression(PGConfigMap *config_map, SystemInfo *system_info, struct compression_bench *bench,
+                         struct wal_stream *stream);
+struct cost_calibration;
+void process_cost_calibration(PGConfigMap *config_map, SystemInfo *system_info, struct cost_calibration *calibration,
+                              struct cache_residency *residency);
+struct memory_knee;
+void process_memory_knee(PGConfigMap *config_map, SystemInfo *system_info, struct memory_knee *knee);
+void process_memory_bandwidth(PGConfigMap *config_map, SystemInfo *system_info);
+void process_server_version(PGConfigMap *config_map, SystemInfo *system_info);
+long get_block_size(SystemInfo *system_info);
 
 #endif  // __PG_AUTO_TUNE_H__
\ No newline at end of file
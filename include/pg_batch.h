@@ -0,0 +1,58 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_batch.h
+ *		Tune a fleet of hosts described by an inventory file.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_BATCH_H__
+#define __PG_BATCH_H__
+
+#include "pg_auto_tune.h"
+
+/* inventory keys, one json object per line */
+#define INVENTORY_HOST_KEY "host"
+#define INVENTORY_RAM_KEY "ram"
+#define INVENTORY_CPUS_KEY "cpus"
+#define INVENTORY_DISK_TYPE_KEY "disk_type"
+#define INVENTORY_DISK_SPEED_KEY "disk_speed"
+#define INVENTORY_WORKLOAD_KEY "workload"
+#define INVENTORY_NODE_TYPE_KEY "node_type"
+#define INVENTORY_HOST_TYPE_KEY "host_type"
+#define INVENTORY_PGCONF_KEY "postgresql_conf"
+
+#define DEFAULT_BATCH_OUTPUT "per_postgresql.jsonl"
+
+typedef enum BATCH_FORMAT
+{
+    BATCH_JSON,                 /* one json record per host in a single file */
+    BATCH_CONF                  /* one <host>.conf per host in a directory */
+} BATCH_FORMAT;
+
+typedef struct batch_options
+{
+    const char *inventory_path;
+    const char *output_path;    /* the json file or the conf directory */
+    BATCH_FORMAT format;
+    int num_workers;            /* 0 for one per CPU */
+    bool force;                 /* ignore the profile cpu and memory bounds */
+    SystemInfo defaults;        /* for whatever a host does not specify */
+} BatchOptions;
+
+/*
+ * Evaluate every host of the inventory against the loaded config map.
+ * Returns the number of hosts that could not be tuned, or -1 when the
+ * batch could not be run at all.
+ */
+int run_batch(BatchOptions *options, PGConfigMap *config_map, PGMapProfileDetails *profile);
+
+#endif // __PG_BATCH_H__
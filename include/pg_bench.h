@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_bench.h
+ *		Timing, random numbers and the optimized build of the kernels the
+ *		benchmarks of the host share.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_BENCH_H__
+#define __PG_BENCH_H__
+
+#include <stdint.h>
+#include <sys/time.h>
+
+/*
+ * The server is built optimized, so the kernels timed against it run
+ * optimized too, whatever the build of pg_auto_tune is, or a benchmark
+ * would measure the build instead of the host. The kernels go between
+ * BENCH_KERNELS_BEGIN and BENCH_KERNELS_END.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#define BENCH_KERNELS_BEGIN _Pragma("GCC push_options") _Pragma("GCC optimize(\"O2\")")
+#define BENCH_KERNELS_END _Pragma("GCC pop_options")
+#else
+#define BENCH_KERNELS_BEGIN
+#define BENCH_KERNELS_END
+#endif
+
+/* Seconds since start, taken with gettimeofday() */
+double bench_elapsed(struct timeval *start);
+
+/* xorshift64*, good enough to pick blocks and draw keys, state must not be 0 */
+uint64_t bench_random(uint64_t *state);
+
+#endif // __PG_BENCH_H__
@@ -0,0 +1,68 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_buffer_sim.h
+ *		Miss ratio curve of the shared buffers, from a replay of block accesses.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_BUFFER_SIM_H__
+#define __PG_BUFFER_SIM_H__
+
+#include "pg_auto_tune.h"
+
+#define MAX_BUFFER_TRACES 16
+#define BUFFER_BLOCK_SIZE 8192
+
+/* BM_MAX_USAGE_COUNT of the server */
+#define BUFFER_MAX_USAGE_COUNT 5
+
+/* Candidate sizes, from 16MB up in steps of sqrt(2) */
+#define MRC_MAX_POINTS 48
+#define MRC_MIN_BUFFERS 2048
+
+/* Share of the memory past which shared_buffers is not considered */
+#define MRC_MAX_RAM_PCT 40.0
+
+/* The knee is the smallest size that gets this share of the miss reduction */
+#define MRC_KNEE_SHARE 0.95
+
+/*
+ * Traces up to this size are replayed whole, longer ones through SHARDS
+ * sampling of the blocks at SHARDS_SAMPLE_RATE.
+ */
+#define SHARDS_FULL_TRACE_BYTES (64 * 1024 * 1024)
+#define SHARDS_SAMPLE_RATE 0.125
+
+typedef struct miss_ratio_curve
+{
+    int num_points;
+    long long sizes[MRC_MAX_POINTS];        /* bytes */
+    double miss_ratios[MRC_MAX_POINTS];
+    long long accesses;                     /* in the traces */
+    long long sampled;                      /* replayed through the caches */
+    double sample_rate;
+    long long working_set;                  /* bytes, -1 when it does not fit the largest size */
+    long long knee;                         /* bytes */
+} MissRatioCurve;
+
+/*
+ * Replay the block accesses of the traces, in order, through the clock
+ * sweep of every candidate size up to max_size in a single pass. A trace is
+ * either a series of pg_buffercache dumps in CSV (with a header line), each
+ * buffer counting as usagecount accesses, or an access log with one
+ * "relation block" per line. Returns false when the traces can not be read
+ * or hold no accesses, after reporting why.
+ */
+bool build_miss_ratio_curve(const char **paths, int num_paths, long long max_size, MissRatioCurve *curve);
+void print_miss_ratio_curve(MissRatioCurve *curve);
+
+#endif // __PG_BUFFER_SIM_H__
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cache_residency.h
+ *		How much of every relation of a data directory is in the page cache.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_CACHE_RESIDENCY_H__
+#define __PG_CACHE_RESIDENCY_H__
+
+#include "pg_data_dir.h"
+
+#define RESIDENCY_BLOCK_SIZE 8192
+
+#define RESIDENCY_TOP_RELATIONS 10
+
+/* shared_buffers gets the hot set plus this much room, within the bounds */
+#define RESIDENCY_HEADROOM_PCT 25.0
+#define RESIDENCY_MIN_SHARED_BUFFERS (128.0 * 1024 * 1024)
+#define RESIDENCY_MAX_SHARED_BUFFERS_PCT 40.0
+
+/* effective_cache_size is not raised past this share of the memory */
+#define RESIDENCY_MAX_CACHE_PCT 75.0
+
+typedef struct relation_residency
+{
+    unsigned int database;
+    unsigned int relfilenode;
+    RELATION_FORK fork;
+    long long size;
+    long long resident;
+} RelationResidency;
+
+typedef struct database_residency
+{
+    unsigned int database;
+    int num_relations;
+    long long size;
+    long long resident;
+} DatabaseResidency;
+
+typedef struct cache_residency
+{
+    RelationFile *files;
+    int num_files;
+    RelationResidency *relations;
+    int num_relations;
+    DatabaseResidency *databases;
+    int num_databases;
+    long long total_size;
+    long long total_resident;
+    int num_workers;
+    double elapsed;             /* seconds */
+} CacheResidency;
+
+/*
+ * Map every relation segment of base/ and global/ and ask mincore() which
+ * of its pages are in the page cache, num_workers files at a time. With
+ * keep_blocks the resident blocks are kept for write_autoprewarm_list().
+ * Returns false when the data directory can not be scanned, after
+ * reporting why.
+ */
+bool scan_cache_residency(const char *data_dir, int num_workers, bool keep_blocks, CacheResidency *residency);
+void free_cache_residency(CacheResidency *residency);
+void print_cache_residency(CacheResidency *residency, int top_relations);
+
+/* The resident blocks in the autoprewarm.blocks format of pg_prewarm */
+bool write_autoprewarm_list(CacheResidency *residency, const char *path);
+
+/* Share of a file that is in the page cache, -1 when it can not be told */
+double file_cache_residency(const char *path);
+
+#endif // __PG_CACHE_RESIDENCY_H__
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cgroup.h
+ *		Resource limits of the control group we are running in.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_CGROUP_H__
+#define __PG_CGROUP_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CGROUP_MEMORY_FILE "memory.max"
+#define CGROUP_CPU_FILE "cpu.max"
+#define CPU_ONLINE_FILE "/sys/devices/system/cpu/online"
+
+/*
+ * Path of a cgroup v2 interface file of our own cgroup, false when we are
+ * not in a cgroup v2 hierarchy.
+ */
+bool cgroup_file_path(const char *file, char *path, size_t len);
+
+/* The limits of our cgroup and its ancestors, -1 when there is none */
+long long cgroup_memory_limit(void);
+double cgroup_cpu_limit(void);
+
+#endif // __PG_CGROUP_H__
@@ -0,0 +1,110 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_compression.h
+ *		How well and how fast pglz, lz4 and zstd compress the pages of a
+ *		data directory, and which of them wal_compression and
+ *		default_toast_compression should use.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_COMPRESSION_H__
+#define __PG_COMPRESSION_H__
+
+#include "pg_auto_tune.h"
+
+/* Random pages of every kind that are compressed, and the draws to find them */
+#define COMPRESSION_SAMPLE_PAGES 1024
+#define COMPRESSION_SAMPLE_DRAWS (8 * COMPRESSION_SAMPLE_PAGES)
+
+/* Fewer TOAST pages than this are not enough to judge default_toast_compression by */
+#define COMPRESSION_MIN_TOAST_PAGES 64
+
+#define COMPRESSION_MAX_WORKERS 64
+
+/* Every worker compresses, and then decompresses, the sample for at least this long */
+#define COMPRESSION_BENCH_SECONDS 0.2
+
+/* The CPU time left to compress with is sampled for this long before the benchmark */
+#define COMPRESSION_LOAD_SECONDS 1
+
+/* Compression has to get this much more through than the disk alone to be turned on */
+#define COMPRESSION_MIN_GAIN 0.10
+
+typedef enum COMPRESSION_SOURCE
+{
+    SOURCE_HEAP,
+    SOURCE_TOAST,
+    SOURCE_WAL,
+    NUM_COMPRESSION_SOURCES
+} COMPRESSION_SOURCE;
+
+/* pglz, lz4 and zstd at levels 1, 3 and 9, zstd 3 is the level of the server */
+#define NUM_COMPRESSION_ALGORITHMS 5
+
+typedef struct compression_result
+{
+    bool available;             /* the library is installed and the sample not empty */
+    long long raw_bytes;
+    long long stored_bytes;     /* compressed, or raw when compressing did not pay */
+    double ratio;               /* raw to stored */
+    double compress_speed;      /* raw bytes a second of one core */
+    double decompress_speed;
+} CompressionResult;
+
+typedef struct compression_bench
+{
+    int num_pages[NUM_COMPRESSION_SOURCES];
+    CompressionResult results[NUM_COMPRESSION_SOURCES][NUM_COMPRESSION_ALGORITHMS];
+    int num_workers;
+    double cpu_idle;            /* share of the CPU time that was idle */
+    double free_cores;          /* cores left to compress with */
+    double elapsed;             /* seconds */
+} CompressionBench;
+
+/* What a setting should be, and the bytes a second it gets through */
+typedef struct compression_choice
+{
+    const char *value;
+    int algorithm;              /* -1 when compression is off */
+    double throughput;
+    double disk_throughput;     /* of the disk alone */
+} CompressionChoice;
+
+/*
+ * Draw random pages of the tables and TOAST tables of data_dir, the page
+ * hole left out as a full page image does, and of the WAL segments in
+ * wal_dir, and time every algorithm on them from num_workers threads at
+ * once. lz4 and zstd are loaded at run time and left out when they are
+ * not installed. Returns false when the data directory can not be read,
+ * after reporting why.
+ */
+bool benchmark_compression(const char *data_dir, const char *wal_dir, long block_size, int num_workers,
+                           CompressionBench *bench);
+void print_compression_bench(CompressionBench *bench);
+const char *get_compression_algorithm_name(int algorithm);
+
+/*
+ * The algorithm that gets the most through with the cores that are free
+ * and a disk of disk_speed MB/s, a compressed page being as fast as the
+ * slower of the CPU compressing it and the disk writing what is left.
+ * wal_compression only compresses full page images, fpi_share of the WAL,
+ * or all of it when fpi_share is negative, and stays off unless that gets
+ * COMPRESSION_MIN_GAIN more through. server_version, 0 when not known,
+ * limits the algorithms to those the server has. Returns false when the
+ * sample or the disk speed is missing.
+ */
+bool choose_wal_compression(CompressionBench *bench, int server_version, double disk_speed, double fpi_share,
+                            CompressionChoice *choice);
+bool choose_toast_compression(CompressionBench *bench, int server_version, double disk_speed,
+                              CompressionChoice *choice);
+
+#endif // __PG_COMPRESSION_H__
@@ -17,6 +17,7 @@
 #ifndef __PG_CONFIG_MAP_H__
 #define __PG_CONFIG_MAP_H__
 
+#include <stdio.h>
 #include "pg_parse_pgconfig.h"
 #include "pg_auto_tune.h"
 
@@ -27,16 +28,38 @@
 
 int load_config_map(PGConfigMap *config, char *map_file);
 void free_config_map(PGConfigMap *config);
+void config_map_log(PGConfigMap *config, PGAT_LOG_LEVEL level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
 char *get_resource_name(RESOURCES res);
+bool is_data_resource(RESOURCES res);
 char *get_formula_name(FORMULAS formula);
+char *get_blend_mode_name(BLEND_MODE blend);
 char* get_workload_type(WORKLOAD_TYPE wrk);
 
-RESOURCES identify_resource(char* token);
-FORMULAS identify_formula(char* token);
+RESOURCES identify_resource(const char* token);
+FORMULAS identify_formula(const char* token);
+BLEND_MODE identify_blend_mode(const char* token);
+WORKLOAD_TYPE identify_workload_type(const char* token);
+DISK_TYPE identify_disk_type(const char* token);
+NODE_TYPE identify_node_type(const char* token);
+HOST_TYPE identify_host_type(const char* token);
 
+bool check_profile_bounds(PGMapProfileDetails *profile, SystemInfo *system_info, char *error, size_t error_len);
 int load_json_config_map(PGConfigMap *config, PGMapProfileDetails *profile, SystemInfo *system_info, const char *file_path);
 
 void print_config_map(PGConfigMap* config, SystemInfo *sys_info, bool report);
 void create_postgresql_conf(const char *output_file_path,PGConfigMap* config, SystemInfo *sys_info);
+void write_postgresql_conf(FILE *fp, PGConfigMap* config);
+void format_config_map_value(PGConfigMapEntry *entry, char *buf, size_t len);
+bool parameter_needs_restart(const char *param);
+bool parse_workload_weights(const char *text, SystemInfo *system_info);
+bool is_workload_blend(SystemInfo *system_info);
+bool select_workload_value(PGConfigMapEntry *entry, SystemInfo *system_info, PGArena *arena);
+bool clone_config_map(PGConfigMap *source, PGConfigMap *copy, SystemInfo *system_info, PGArena *arena);
+bool parse_size_text(const char *text, long long *size);
+bool parse_timestamp_text(const char *text, double *seconds);
+double get_config_map_setting(PGConfigMap *config, const char *param, double unit_bytes, double default_value);
+double get_wal_buffers_setting(PGConfigMap *config, SystemInfo *system_info);
+long long estimate_memory_footprint(PGConfigMap *config, SystemInfo *system_info);
+void print_workload_comparison(PGConfigMap *maps, int num_maps);
 
 #endif // __PG_CONFIG_MAP_H__
\ No newline at end of file
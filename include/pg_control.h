@@ -0,0 +1,97 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_control.h
+ *		What global/pg_control and PG_VERSION tell about the server that
+ *		owns a data directory.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_CONTROL_H__
+#define __PG_CONTROL_H__
+
+#include <stdint.h>
+#include "pg_auto_tune.h"
+
+#define PG_VERSION_FILE "PG_VERSION"
+#define PG_CONTROL_FILE "global/pg_control"
+
+/* The file is padded to this size, the data sits at its start */
+#define PG_CONTROL_FILE_SIZE 8192
+
+/* The server refuses min_wal_size and max_wal_size below this many segments */
+#define MIN_WAL_SIZE_SEGMENTS 2
+
+typedef struct control_info
+{
+    int server_version;         /* major version as PG_VERSION_NUM, e.g. 160000 */
+    bool has_control;           /* the fields below were read from pg_control */
+    uint64_t system_identifier;
+    uint32_t control_version;
+    uint32_t catalog_version;
+    int state;                  /* DBState of the server */
+    uint32_t block_size;
+    uint32_t segment_blocks;    /* blocks in a relation segment file */
+    uint32_t wal_block_size;
+    uint32_t wal_segment_size;
+    uint32_t data_checksum_version; /* 0 when data checksums are off */
+    /* counters as of the latest checkpoint */
+    int64_t checkpoint_time;    /* seconds since the epoch */
+    uint64_t next_xid;          /* with the epoch in the high 32 bits */
+    uint32_t oldest_xid;        /* oldest datfrozenxid */
+    uint32_t next_multi;
+    uint32_t oldest_multi;      /* oldest datminmxid */
+} ControlInfo;
+
+/* How the value of a parameter changes when it is renamed for another version */
+typedef enum PARAM_CONVERSION
+{
+    CONVERT_NONE = 0,
+    CONVERT_SEGMENTS_TO_SIZE,
+    CONVERT_SIZE_TO_SEGMENTS
+} PARAM_CONVERSION;
+
+/*
+ * Versions a parameter exists in, from since up to but not including
+ * until (0 when it still exists), and what replaces it outside of them.
+ */
+typedef struct param_version
+{
+    const char *param;
+    int since;
+    int until;
+    const char *replacement;
+    PARAM_CONVERSION conversion;
+} ParamVersion;
+
+/*
+ * Read PG_VERSION and, when it is there, global/pg_control of a data
+ * directory. Returns false when the data directory does not have a
+ * readable PG_VERSION or its pg_control fails its CRC, after reporting why.
+ */
+bool read_control_info(const char *data_dir, ControlInfo *info);
+void print_control_info(ControlInfo *info);
+
+/* Versions of a parameter the server knows about, NULL for any other parameter */
+const ParamVersion *get_param_version(const char *param);
+
+/*
+ * CRC-32C of the server, over several pieces of data:
+ * FIN_CRC32C(comp_crc32c(comp_crc32c(INIT_CRC32C, a, len_a), b, len_b))
+ */
+#define INIT_CRC32C 0xFFFFFFFF
+#define FIN_CRC32C(crc) ((crc) ^ 0xFFFFFFFF)
+uint32_t comp_crc32c(uint32_t crc, const unsigned char *data, size_t len);
+
+/* "16", "9.6" for PG_VERSION_NUM style major versions */
+void format_server_version(int server_version, char *buf, size_t len);
+
+#endif // __PG_CONTROL_H__
@@ -0,0 +1,107 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cost_calibration.h
+ *		Planner cost constants of the host: page reads of the data
+ *		directory, tuple deforming, expression evaluation and parallel
+ *		worker starts timed against a sequential page read.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_COST_CALIBRATION_H__
+#define __PG_COST_CALIBRATION_H__
+
+#include "pg_auto_tune.h"
+
+/* Reads of each kind stop at the first of these */
+#define CALIBRATION_MAX_READS 4096
+#define CALIBRATION_IO_SECONDS 1.0
+
+/* Fewer reads than this can not tell the disk from the noise */
+#define CALIBRATION_MIN_READS 16
+
+/* Only the largest relation files are read, so they can stay open */
+#define CALIBRATION_MAX_FILES 64
+
+/* A sequential scan gets the pages of a read ahead window of the kernel at once */
+#define CALIBRATION_SEQ_READ_SIZE (128 * 1024)
+
+/* Every CPU kernel runs at least this long */
+#define CALIBRATION_CPU_SECONDS 0.2
+
+/* A parallel worker attaches to the segment the leader serialized its state into */
+#define CALIBRATION_WORKER_STARTS 16
+#define CALIBRATION_WORKER_STATE (1024 * 1024)
+
+/*
+ * Share of the random reads expected from the cache when neither the page
+ * cache nor the size of the data is known, what the random_page_cost of 4
+ * of the server assumes for reads 40 times slower than sequential ones.
+ */
+#define CALIBRATION_DEFAULT_CACHE_HIT 0.9
+
+/* Parameters a CALIBRATED entry can be measured for */
+typedef enum PLANNER_COST
+{
+    COST_SEQ_PAGE,
+    COST_RANDOM_PAGE,
+    COST_CPU_TUPLE,
+    COST_CPU_OPERATOR,
+    COST_PARALLEL_SETUP,
+    INVALID_PLANNER_COST
+} PLANNER_COST;
+
+#define CALIBRATED_PARAMETERS "seq_page_cost, random_page_cost, cpu_tuple_cost, cpu_operator_cost and parallel_setup_cost"
+
+typedef struct cost_calibration
+{
+    bool direct_io;             /* the reads went past the page cache */
+    int num_files;
+    int seq_reads;              /* pages */
+    int random_reads;
+
+    /* seconds */
+    double seq_page;            /* a page read in a sequential scan */
+    double random_page;         /* a page read on its own */
+    double cached_page;         /* a page copied from the page cache */
+    double tuple;               /* a heap tuple deformed */
+    double operator;            /* an operator of a qual evaluated */
+    double worker_start;        /* a worker started and attached to the leader */
+    double elapsed;
+} CostCalibration;
+
+/*
+ * Read the largest relation files of data_dir sequentially and at random,
+ * past the page cache when the file system allows it, and time the CPU
+ * kernels. Returns false when the data directory has too little data to
+ * read, after reporting why.
+ */
+bool calibrate_costs(const char *data_dir, long block_size, CostCalibration *calibration);
+void print_cost_calibration(CostCalibration *calibration);
+
+PLANNER_COST get_planner_cost(const char *param);
+
+/*
+ * Share of the random reads expected from the cache: what the page cache
+ * holds of the data directory when resident_share is not negative, else
+ * what cache_size, effective_cache_size, holds of data_size, else the
+ * assumption of the server.
+ */
+double expected_cache_hit(long long data_size, double cache_size, double resident_share);
+
+/*
+ * The cost in units of a sequential page read, seq_page_cost being 1.
+ * Random reads cost a read from the disk for the cache misses and a copy
+ * from the cache for the hits.
+ */
+double calibrated_cost(CostCalibration *calibration, PLANNER_COST cost, double cache_hit);
+
+#endif // __PG_COST_CALIBRATION_H__
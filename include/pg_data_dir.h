@@ -0,0 +1,123 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_data_dir.h
+ *		Relation files of a data directory and the shape of the data in them.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_DATA_DIR_H__
+#define __PG_DATA_DIR_H__
+
+#include <stdint.h>
+#include "pg_auto_tune.h"
+
+#define MAX_DATA_DIR_WORKERS 32
+#define WAL_DIRECTORY "pg_wal"
+
+/* Tablespaces of base/ and global/, as the server names them */
+#define DEFAULT_TABLESPACE_OID 1663
+#define GLOBAL_TABLESPACE_OID 1664
+
+/* Blocks in a segment file, RELSEG_SIZE of the server */
+#define RELATION_SEGMENT_BLOCKS 131072
+
+#define DATA_DIR_TOP_RELATIONS 10
+
+/* Relations by the power of ten of their size, from under 1MB to 1TB and more */
+#define NUM_SIZE_CLASSES 8
+
+typedef enum RELATION_FORK
+{
+    FORK_MAIN = 0,
+    FORK_FSM,
+    FORK_VM,
+    FORK_INIT,
+    NUM_RELATION_FORKS
+} RELATION_FORK;
+
+/* One segment file of a relation fork */
+typedef struct relation_file
+{
+    char *path;
+    unsigned int database;      /* 0 for global/ */
+    unsigned int tablespace;
+    unsigned int relfilenode;
+    RELATION_FORK fork;
+    unsigned int segment;
+    long long size;
+    /* filled by the cache residency scan */
+    long long resident;
+    uint8_t *blocks;            /* a bit per resident block, NULL unless kept */
+} RelationFile;
+
+/*
+ * Work on one file, from num_workers threads at once. *worker_state starts
+ * NULL and is freed with free() once the thread is done.
+ */
+typedef bool (*RelationFileWorker)(RelationFile *file, void *arg, void **worker_state);
+
+typedef struct relation_size
+{
+    unsigned int database;
+    unsigned int relfilenode;
+    long long size;
+} RelationSize;
+
+typedef struct data_dir_shape
+{
+    int num_files;
+    int num_databases;
+    int num_relations;
+    int num_tables;             /* relations with a visibility map */
+    int num_indexes;            /* the others, mostly indexes */
+    long long data_size;        /* every fork of every relation */
+    long long table_size;       /* main forks of the tables */
+    long long index_size;       /* main forks of the others */
+    long long fsm_size;
+    long long vm_size;
+    long long wal_size;
+    int num_wal_segments;
+    RelationSize largest_tables[DATA_DIR_TOP_RELATIONS];
+    int num_largest_tables;
+    RelationSize largest_indexes[DATA_DIR_TOP_RELATIONS];
+    int num_largest_indexes;
+    int size_classes[NUM_SIZE_CLASSES];
+    int num_workers;
+    double elapsed;             /* seconds */
+} DataDirShape;
+
+/*
+ * Every relation segment of base/ and global/, sorted by database,
+ * relation, fork and segment. Returns the number of files, -1 when the data
+ * directory can not be read, after reporting why.
+ */
+int list_relation_files(const char *data_dir, RelationFile **files);
+void free_relation_files(RelationFile *files, int num_files);
+
+/*
+ * Run worker on every file from up to num_workers threads. Returns the
+ * number of threads used, *failed is the number of files worker failed on.
+ */
+int run_relation_file_workers(RelationFile *files, int num_files, int num_workers,
+                              RelationFileWorker worker, void *arg, int *failed);
+
+const char *get_fork_suffix(RELATION_FORK fork);
+
+/*
+ * Size every relation file and WAL segment of the data directory from
+ * num_workers threads and sum them up by relation. Returns false when the
+ * data directory can not be read, after reporting why.
+ */
+bool scan_data_dir_shape(const char *data_dir, int num_workers, DataDirShape *shape);
+void print_data_dir_shape(DataDirShape *shape);
+
+#endif // __PG_DATA_DIR_H__
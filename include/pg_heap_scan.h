@@ -0,0 +1,119 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_heap_scan.h
+ *		Free space, dead space and visibility of the tables of a data
+ *		directory, read from their page headers.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_HEAP_SCAN_H__
+#define __PG_HEAP_SCAN_H__
+
+#include "pg_data_dir.h"
+
+#define HEAP_BLOCK_SIZE 8192
+
+/* Blocks read at once, large sequential reads are what the disk likes best */
+#define HEAP_SCAN_READ_BLOCKS 128
+
+#define HEAP_TOP_TABLES 10
+
+/* Tables smaller than this keep the defaults, their vacuums are cheap anyway */
+#define HEAP_MIN_TUNED_PAGES 128
+
+/*
+ * autovacuum_vacuum_scale_factor of a large table that lets about this many
+ * dead tuples pile up before a vacuum, within the bounds
+ */
+#define HEAP_TARGET_DEAD_TUPLES 200000.0
+#define HEAP_MIN_SCALE_FACTOR 0.001
+#define DEFAULT_AUTOVACUUM_SCALE_FACTOR 0.2
+
+/* Share of HOT updated tuples over which fillfactor leaves room for them */
+#define HEAP_HOT_SHARE_HIGH 0.20
+#define HEAP_HOT_SHARE_LOW 0.05
+
+/* Tables with more dead space than this want a rewrite, not a vacuum */
+#define HEAP_REWRITE_BLOAT_PCT 30.0
+
+/*
+ * The autovacuum cost budget has to get through the dirty and not all
+ * visible pages in this many seconds, at the default cost of a page and
+ * autovacuum_vacuum_cost_delay.
+ */
+#define AUTOVACUUM_CYCLE_SECONDS 3600.0
+#define VACUUM_COST_PAGE_MISS 2.0
+#define VACUUM_COST_PAGE_DIRTY 20.0
+#define AUTOVACUUM_COST_DELAY_MS 2.0
+#define MIN_AUTOVACUUM_COST_LIMIT 200.0
+#define MAX_AUTOVACUUM_COST_LIMIT 10000.0
+
+typedef struct heap_stats
+{
+    long long pages;            /* heap pages read */
+    long long empty_pages;      /* never initialized */
+    long long other_pages;      /* of indexes and sequences, or damaged */
+    long long dirty_pages;      /* pages with dead tuples or dead line pointers */
+    long long all_visible_pages;/* PD_ALL_VISIBLE set on the page */
+    long long free_bytes;
+    long long dead_bytes;
+    long long live_bytes;
+    long long live_tuples;
+    long long dead_tuples;
+    long long dead_items;       /* line pointers left by pruning */
+    long long hot_tuples;       /* HOT updated or heap only tuples */
+    long long vm_visible;       /* heap blocks all visible in the visibility map */
+    long long vm_frozen;
+    bool has_vm;
+} HeapStats;
+
+typedef struct table_heap
+{
+    unsigned int database;
+    unsigned int relfilenode;
+    HeapStats stats;
+    /* recommendations, 0 when the default is right */
+    double scale_factor;
+    int fillfactor;
+} TableHeap;
+
+typedef struct heap_scan
+{
+    TableHeap *tables;
+    int num_tables;
+    HeapStats total;
+    long long bytes_read;
+    double vacuum_cost;         /* cost of vacuuming every table once */
+    double cost_limit;          /* autovacuum_vacuum_cost_limit for that in a cycle */
+    int num_workers;
+    double elapsed;             /* seconds */
+} HeapScan;
+
+/*
+ * Read every heap segment of base/ and global/ and its visibility map,
+ * num_workers files at a time, and work out the per table settings and the
+ * autovacuum cost budget. Pages are judged by their headers and tuple hint
+ * bits only, tuples whose hint bits are not set yet count as live.
+ * Returns false when the data directory can not be scanned, after
+ * reporting why.
+ */
+bool scan_heap_pages(const char *data_dir, int num_workers, HeapScan *scan);
+void free_heap_scan(HeapScan *scan);
+void print_heap_scan(HeapScan *scan, int top_tables);
+
+/*
+ * The per table settings as a psql script, a \gexec query per table that
+ * finds it by relfilenode and only does anything in its own database.
+ */
+bool write_table_settings(HeapScan *scan, const char *path);
+
+#endif // __PG_HEAP_SCAN_H__
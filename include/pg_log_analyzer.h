@@ -0,0 +1,81 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_log_analyzer.h
+ *		Evidence of what the server actually did, read from its logs.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_LOG_ANALYZER_H__
+#define __PG_LOG_ANALYZER_H__
+
+#include "pg_auto_tune.h"
+
+#define DEFAULT_LOG_DIRECTORY "log"
+#define MAX_LOG_FILES 4096
+
+/* Fewer samples than this are not evidence of anything */
+#define MIN_LOG_EVIDENCE_SAMPLES 5
+
+/* Percentile of the temp file spills work_mem is sized to cover */
+#define LOG_SPILL_PERCENTILE 95.0
+
+/* Percentile of the checkpoint WAL rate max_wal_size is sized for */
+#define LOG_WAL_RATE_PERCENTILE 95.0
+
+/* Share of the memory all the connections together may use for work_mem */
+#define LOG_WORK_MEM_BUDGET_PCT 25.0
+
+/* Gaps longer than this between checkpoints are server downtime */
+#define MAX_CHECKPOINT_GAP (24 * 3600.0)
+
+typedef struct log_samples
+{
+    double *values;
+    size_t count;
+    size_t capacity;
+    bool sorted;
+} LogSamples;
+
+typedef struct log_evidence
+{
+    int num_files;
+    long long bytes_scanned;
+    LogSamples temp_file_sizes;             /* bytes */
+    LogSamples checkpoint_wal_rates;        /* bytes per second */
+    LogSamples checkpoint_write_times;      /* seconds */
+    LogSamples checkpoint_sync_times;       /* seconds */
+    LogSamples checkpoint_distances;        /* bytes */
+    LogSamples frequent_checkpoint_gaps;    /* seconds, from the warnings */
+    LogSamples autovacuum_times;            /* seconds */
+    int checkpoints_by_time;
+    int checkpoints_by_wal;
+} LogEvidence;
+
+/*
+ * Scan a log file, or every log file of a directory in name order, in
+ * stderr, csvlog or jsonlog format. Returns false when nothing could be
+ * read, after reporting why.
+ */
+bool analyze_logs(const char *path, LogEvidence *evidence);
+void free_log_evidence(LogEvidence *evidence);
+void print_log_evidence(LogEvidence *evidence);
+
+/* Nearest rank percentile, the samples are sorted on first use */
+double log_percentile(LogSamples *samples, double percentile);
+
+/*
+ * Duration in seconds of a time setting such as "5min", a value without a
+ * unit is in default_unit seconds. Returns false when it is not a duration.
+ */
+bool parse_duration_text(const char *text, double default_unit, double *seconds);
+
+#endif // __PG_LOG_ANALYZER_H__
@@ -0,0 +1,96 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_memory_bandwidth.h
+ *		Memory bandwidth and latency of the host, STREAM copy, scale and
+ *		triad kernels on every CPU of every NUMA node and a pointer chase
+ *		in the memory of each node.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_MEMORY_BANDWIDTH_H__
+#define __PG_MEMORY_BANDWIDTH_H__
+
+#include "pg_auto_tune.h"
+
+#define MEMBW_MAX_NODES 64
+#define MEMBW_MAX_THREADS 256
+
+/*
+ * The three arrays of all threads together, far past the last level cache
+ * as STREAM asks, within this share of the memory of the host.
+ */
+#define MEMBW_ARRAY_BYTES (768LL * 1024 * 1024)
+#define MEMBW_MEMORY_PCT 12.5
+#define MEMBW_MIN_ARRAY_BYTES (1024 * 1024)
+
+/* Every kernel runs this many times, the best run counts */
+#define MEMBW_REPEATS 5
+
+/* The pointer chase walks a cycle of cache lines over this much memory */
+#define MEMBW_CHASE_BYTES (256LL * 1024 * 1024)
+#define MEMBW_CHASE_STEPS (1 << 22)
+
+/*
+ * A host is starved of memory bandwidth when all its CPUs together pull
+ * less than this share of what each of them pulls alone.
+ */
+#define MEMBW_STARVED_SHARE 0.5
+
+typedef enum STREAM_KERNEL
+{
+    STREAM_COPY,                /* c = a */
+    STREAM_SCALE,               /* b = q * c */
+    STREAM_TRIAD,               /* a = b + q * c */
+    NUM_STREAM_KERNELS
+} STREAM_KERNEL;
+
+typedef struct memory_node
+{
+    int node;                   /* number of the NUMA node */
+    int num_threads;            /* its CPUs the kernels ran on */
+    double bandwidth[NUM_STREAM_KERNELS];   /* GB/s of its threads alone */
+    double latency;             /* ns of a load from its memory */
+} MemoryNode;
+
+typedef struct memory_bandwidth
+{
+    int num_nodes;
+    int num_threads;
+    bool pinned;                /* every thread ran on its own CPU */
+    long long array_bytes;      /* of each array of all threads together */
+    MemoryNode nodes[MEMBW_MAX_NODES];
+    double bandwidth[NUM_STREAM_KERNELS];   /* GB/s of all threads at once */
+    double core_bandwidth[NUM_STREAM_KERNELS];  /* GB/s of a thread alone */
+    double latency;             /* ns, the mean of the nodes */
+    double elapsed;             /* seconds */
+} MemoryBandwidth;
+
+/*
+ * Run the kernels on up to cpu_count CPUs of the process, spread over the
+ * NUMA nodes, with the memory of every thread on its own node, then on a
+ * single CPU and on the CPUs of every node alone, and chase pointers in
+ * the memory of every node. Returns false when the kernels can not run,
+ * after reporting why.
+ */
+bool measure_memory_bandwidth(long long total_ram, long cpu_count, MemoryBandwidth *bandwidth);
+void print_memory_bandwidth(MemoryBandwidth *bandwidth, long cpu_count);
+const char *get_stream_kernel_name(STREAM_KERNEL kernel);
+
+/*
+ * CPUs a scan keeps busy before the memory runs out of bandwidth: the
+ * triad of all threads over that of one, at most cpu_count. cpu_count
+ * when the bandwidth is not measured.
+ */
+double bandwidth_cpus(double bandwidth, double core_bandwidth, long cpu_count);
+bool is_bandwidth_starved(double bandwidth, double core_bandwidth, long cpu_count);
+
+#endif // __PG_MEMORY_BANDWIDTH_H__
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_memory_knee.h
+ *		Sizes at which in-memory sorts and hash builds fall out of the
+ *		caches of the host, the steps work_mem and hash_mem_multiplier
+ *		are sized in.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_MEMORY_KNEE_H__
+#define __PG_MEMORY_KNEE_H__
+
+#include "pg_auto_tune.h"
+
+/* The kernels run on every doubling of the memory from the smallest size to the largest */
+#define KNEE_MIN_SIZE (64 * 1024)
+#define KNEE_MAX_SIZE (1024LL * 1024 * 1024)
+#define KNEE_MAX_SIZES 15
+
+/* The largest size is kept to this share of the memory of the host */
+#define KNEE_MEMORY_PCT 12.5
+
+/* Every size is sorted and hashed again until this long is spent on it */
+#define KNEE_MIN_SECONDS 0.05
+
+/* The speed of the caches is the best of the smallest sizes */
+#define KNEE_CACHE_SIZES 3
+
+/*
+ * A size this much slower a byte than the caches is past the knee, and
+ * past it the speed has flattened to that of the memory once a doubling
+ * loses less than KNEE_FLAT of it.
+ */
+#define KNEE_SLOWDOWN 1.5
+#define KNEE_FLAT 0.10
+
+/* work_mem is not raised to the knee past this share of the memory for every connection */
+#define KNEE_WORK_MEM_BUDGET_PCT 25.0
+#define KNEE_MAX_HASH_MEM_MULTIPLIER 8.0
+
+typedef enum KNEE_KERNEL
+{
+    KNEE_SORT,                  /* quicksort of a SortTuple array */
+    KNEE_HASH,                  /* build and probe of a hash join table */
+    NUM_KNEE_KERNELS
+} KNEE_KERNEL;
+
+typedef struct memory_knee
+{
+    int num_sizes;
+    long long sizes[KNEE_MAX_SIZES];     /* bytes of memory the kernels work in */
+    long long tuples[KNEE_MAX_SIZES];
+
+    /* bytes a second, a sort counted at the comparisons a tuple of the smallest size takes */
+    double throughput[NUM_KNEE_KERNELS][KNEE_MAX_SIZES];
+
+    long long knee[NUM_KNEE_KERNELS];    /* the largest size at the speed of the caches, 0 when none */
+    long long plateau[NUM_KNEE_KERNELS]; /* the smallest size at the speed of the memory, 0 when none */
+    double slowdown[NUM_KNEE_KERNELS];   /* the largest size against the caches */
+    double elapsed;                      /* seconds */
+} MemoryKnee;
+
+/*
+ * Sort and hash tuples in memory at every size from KNEE_MIN_SIZE up to
+ * KNEE_MAX_SIZE or KNEE_MEMORY_PCT of total_ram, and find where the speed
+ * a byte falls off the caches and where it flattens again. Returns false
+ * when the memory for the kernels can not be had, after reporting why.
+ */
+bool find_memory_knee(long long total_ram, MemoryKnee *knee);
+void print_memory_knee(MemoryKnee *knee);
+const char *get_knee_kernel_name(KNEE_KERNEL kernel);
+
+#endif // __PG_MEMORY_KNEE_H__
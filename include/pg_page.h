@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_page.h
+ *		Layout of the pages and tuples of the server, what the scans of
+ *		the data directory read from relation files.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_PAGE_H__
+#define __PG_PAGE_H__
+
+/* Page layout of the server, bufpage.h and itemid.h */
+#define PAGE_HEADER_SIZE 24
+#define PAGE_LAYOUT_VERSION 4
+#define PD_ALL_VISIBLE 0x0004
+#define ITEM_ID_SIZE 4
+#define LP_UNUSED 0
+#define LP_NORMAL 1
+#define LP_REDIRECT 2
+#define LP_DEAD 3
+
+/* Tuple header of the server, htup_details.h */
+#define TUPLE_HEADER_SIZE 23
+#define TUPLE_INFOMASK2_OFFSET 18
+#define TUPLE_INFOMASK_OFFSET 20
+#define TUPLE_HOFF_OFFSET 22
+#define HEAP_HASNULL 0x0001
+#define HEAP_HASVARWIDTH 0x0002
+#define HEAP_XMAX_LOCK_ONLY 0x0080
+#define HEAP_XMIN_COMMITTED 0x0100
+#define HEAP_XMIN_INVALID 0x0200
+#define HEAP_XMAX_COMMITTED 0x0400
+#define HEAP_NATTS_MASK 0x07FF      /* of infomask2 */
+#define HEAP_HOT_UPDATED 0x4000     /* of infomask2 */
+#define HEAP_ONLY_TUPLE 0x8000      /* of infomask2 */
+
+#endif // __PG_PAGE_H__
@@ -18,6 +18,8 @@
 #ifndef __PG_PARSE_PGCONFIG_H__
 #define __PG_PARSE_PGCONFIG_H__
 
+#include <sys/types.h>
+
 typedef enum PARAM_TYPE
 {
     PTYPE_CHAR,
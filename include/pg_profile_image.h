@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_profile_image.h
+ *		Compiled (binary) representation of a tuning profile.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_PROFILE_IMAGE_H__
+#define __PG_PROFILE_IMAGE_H__
+
+#include <stdint.h>
+#include "pg_auto_tune.h"
+
+/*
+ * Image layout, all in host byte order:
+ *
+ *    ProfileImageHeader
+ *    ProfileImageEntry[num_entries]
+ *    string table (NUL terminated, de-duplicated strings)
+ *
+ * Strings are referenced by their offset in the string table. The image is
+ * mmap'ed as is at load time, so nothing here may contain pointers.
+ */
+#define PROFILE_IMAGE_MAGIC "PGATPRF"
+#define PROFILE_IMAGE_MAGIC_LEN 8
+#define PROFILE_IMAGE_VERSION 3
+#define PROFILE_IMAGE_BYTE_ORDER 0x01020304
+#define PROFILE_IMAGE_NO_STRING UINT32_MAX
+
+/* Bounds of an entry */
+#define PROFILE_IMAGE_HAS_MIN 0x01
+#define PROFILE_IMAGE_HAS_MAX 0x02
+
+typedef struct profile_image_header
+{
+    char magic[PROFILE_IMAGE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t entry_size;
+    uint32_t num_entries;
+    uint32_t num_workloads;
+    uint64_t entries_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t image_size;
+    uint64_t checksum;          /* FNV-1a of everything after the header */
+
+    /* profile details */
+    int64_t min_memory;
+    int64_t min_cpu;
+    int64_t max_memory;
+    int64_t max_cpu;
+    uint32_t name;
+    uint32_t author;
+    uint32_t description;
+    uint32_t version_info;
+    uint32_t date_created;
+    uint32_t engine;
+} ProfileImageHeader;
+
+typedef struct profile_image_entry
+{
+    uint32_t param;
+    uint32_t resource;          /* RESOURCES */
+    uint32_t formula;           /* FORMULAS */
+    uint32_t type;              /* PARAM_TYPE */
+    uint32_t value[NUM_WORKLOAD_FACTORS];
+    uint32_t blend;             /* BLEND_MODE */
+    uint32_t bounds;            /* PROFILE_IMAGE_HAS_MIN | PROFILE_IMAGE_HAS_MAX */
+    double factor[NUM_WORKLOAD_FACTORS];
+    double trigger_value;
+    double min_value;
+    double max_value;
+} ProfileImageEntry;
+
+bool is_profile_image(const char *file_path);
+int compile_profile_image(PGConfigMap *config, PGMapProfileDetails *profile, const char *output_path);
+int load_profile_image(PGConfigMap *config, PGMapProfileDetails *profile, SystemInfo *system_info, const char *file_path);
+
+#endif // __PG_PROFILE_IMAGE_H__
@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_profile_schema.h
+ *		Keys of a json tuning profile and their validation.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_PROFILE_SCHEMA_H__
+#define __PG_PROFILE_SCHEMA_H__
+
+#include "json_scan.h"
+#include "pg_auto_tune.h"
+
+/* profile keys */
+#define NAME_KEY "name"
+#define VERSION_KEY "version"
+#define DATE_CREATED_KEY "date_created"
+#define ENGINE_KEY "engine"
+#define AUTHOR_KEY "author"
+#define DESCRIPTION_KEY "description"
+#define MIN_MEMORY_KEY "min_memory"
+#define MIN_CPU_KEY "min_cpu"
+#define MAX_MEMORY_KEY "max_memory"
+#define MAX_CPU_KEY "max_cpu"
+#define EXTENDS_KEY "extends"
+
+/* map entriy keys */
+#define CONFIG_MAP_KEY "config_map"
+#define PARAMETER_KEY "parameter"
+#define RESOURCE_KEY "resource"
+#define FORMULA_KEY "formula"
+#define OLAP_FACTOR_KEY "olap_factor"
+#define OLTP_FACTOR_KEY "oltp_factor"
+#define MIXED_FACTOR_KEY "mixed_factor"
+#define TRIGGER_KEY "trigger"
+#define BLEND_KEY "blend"
+#define REMOVE_KEY "remove"
+#define MIN_KEY "min"
+#define MAX_KEY "max"
+
+/* Percentage factors are a share of the resource */
+#define MIN_PERCENTAGE_FACTOR 0.0
+#define MAX_PERCENTAGE_FACTOR 100.0
+
+/* Data directory resources are small next to the values they scale, so factors may go past 100 */
+#define MAX_DATA_PERCENTAGE_FACTOR 100000.0
+
+/*
+ * Report a profile problem as "file:line:col: message". The position is
+ * taken from value, which may be NULL when there is nothing to point at.
+ */
+void profile_error(const char *file_path, const json_cursor *value, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/*
+ * Check a single profile document: value types, unknown and duplicate keys
+ * and duplicate parameters. Everything that depends on the profiles the
+ * document extends is checked once the chain is merged.
+ * Returns the number of problems found, each of them already reported.
+ */
+int validate_profile_document(const json_cursor *root, const char *file_path);
+
+/* Does the formula know how to handle the resource */
+bool formula_accepts_resource(FORMULAS formula, RESOURCES resource);
+
+/*
+ * Numeric value of a factor, given either as a json number or as a string
+ * holding nothing but a number. Returns false for anything else.
+ */
+bool get_factor_number(const json_cursor *value, double *number);
+
+/*
+ * Numeric value of a bound, given as a json number or as a string holding
+ * a number or a size with a kB, MB, GB or TB unit. Returns false for
+ * anything else.
+ */
+bool get_bound_number(const json_cursor *value, double *number);
+
+#endif // __PG_PROFILE_SCHEMA_H__
@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_simulate.h
+ *		Evaluate a profile over a grid of hypothetical hosts.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_SIMULATE_H__
+#define __PG_SIMULATE_H__
+
+#include "pg_auto_tune.h"
+
+/* grid dimensions, e.g. ram=4G..1T:x2 cpus=2,4,8 disk=ssd,network */
+#define SIMULATE_RAM_KEY "ram"
+#define SIMULATE_CPUS_KEY "cpus"
+#define SIMULATE_DISK_KEY "disk"
+#define SIMULATE_WORKLOAD_KEY "workload"
+#define SIMULATE_NODE_KEY "node"
+#define SIMULATE_HOST_KEY "host"
+
+#define MAX_SIMULATE_DIMENSIONS 16
+#define MAX_SIMULATE_AXIS_VALUES 4096
+#define MAX_SIMULATE_POINTS 1000000
+
+typedef enum SIMULATE_FORMAT
+{
+    SIMULATE_TABLE,             /* aligned columns for people */
+    SIMULATE_CSV                /* for spreadsheets and scripts */
+} SIMULATE_FORMAT;
+
+typedef struct simulate_options
+{
+    const char *dimensions[MAX_SIMULATE_DIMENSIONS];
+    int num_dimensions;
+    const char *output_path;    /* NULL for stdout */
+    SIMULATE_FORMAT format;
+    bool force;                 /* evaluate points outside the profile bounds too */
+    SystemInfo defaults;        /* for the dimensions that are not given */
+} SimulateOptions;
+
+/*
+ * Evaluate the loaded config map for every point of the grid, nothing is
+ * probed. Returns the number of points that are unsafe or outside the
+ * profile bounds, or -1 when the grid could not be evaluated.
+ */
+int run_simulate(SimulateOptions *options, PGConfigMap *config_map, PGMapProfileDetails *profile);
+
+#endif // __PG_SIMULATE_H__
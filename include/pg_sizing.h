@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_sizing.h
+ *		Find the smallest host for which a profile meets workload targets.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_SIZING_H__
+#define __PG_SIZING_H__
+
+#include "pg_auto_tune.h"
+
+/* targets, e.g. working_set=200G connections=500 parallel=8 work_mem=64MB */
+#define SIZING_WORKING_SET_KEY "working_set"
+#define SIZING_CONNECTIONS_KEY "connections"
+#define SIZING_PARALLEL_KEY "parallel"
+#define SIZING_WORK_MEM_KEY "work_mem"
+#define SIZING_BUDGET_KEY "budget"
+
+#define MAX_SIZING_TARGETS 8
+#define MAX_SIZING_CPUS 1024
+#define MAX_SIZING_RAM (64LL << 40)
+#define SIZING_RAM_GRANULE (1LL << 30)
+#define DEFAULT_SIZING_BUDGET 90
+
+typedef struct sizing_options
+{
+    const char *targets[MAX_SIZING_TARGETS];
+    int num_targets;
+    const char *output_path;    /* postgresql.conf of the recommended host, or NULL */
+    SystemInfo defaults;        /* workload, disk, node and host type */
+} SizingOptions;
+
+/*
+ * Search for the host with the fewest CPUs, and then the least memory in
+ * whole GB, that meets the targets. Returns 0 when one is found, 1 when no
+ * host up to MAX_SIZING_CPUS and MAX_SIZING_RAM does and -1 on errors.
+ */
+int run_sizing(SizingOptions *options, PGConfigMap *config_map, PGMapProfileDetails *profile);
+
+#endif // __PG_SIZING_H__
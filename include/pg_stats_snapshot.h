@@ -0,0 +1,68 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_stats_snapshot.h
+ *		Classify the workload of a cluster from dumps of its statistics views.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_STATS_SNAPSHOT_H__
+#define __PG_STATS_SNAPSHOT_H__
+
+#include "pg_auto_tune.h"
+
+#define MAX_STATS_SNAPSHOTS 16
+#define MAX_STATS_COLUMNS 256
+
+/* Optional column with the time the dump was taken, the file time otherwise */
+#define STATS_SNAPSHOT_TIME_COLUMN "snapshot_time"
+
+typedef enum STATS_FEATURE
+{
+    FEATURE_ROWS_PER_CALL = 0,  /* pg_stat_statements rows / calls */
+    FEATURE_MEAN_EXEC_TIME,     /* pg_stat_statements ms per call */
+    FEATURE_READ_WRITE_RATIO,   /* tuples read per tuple written */
+    FEATURE_TEMP_BYTES,         /* temp bytes per transaction */
+    FEATURE_COMMIT_RATE,        /* commits per second since stats_reset */
+    FEATURE_SEQ_SCAN_SHARE,     /* share of tuples read by sequential scans */
+    FEATURE_WAL_PER_XACT,       /* WAL bytes per commit, from the WAL itself */
+    NUM_STATS_FEATURES
+} STATS_FEATURE;
+
+typedef struct workload_classification
+{
+    double features[NUM_STATS_FEATURES];
+    bool has_feature[NUM_STATS_FEATURES];
+    double olap_scores[NUM_STATS_FEATURES];    /* 0 looks like OLTP, 1 like OLAP */
+    double olap_score;          /* weighted mean of the feature scores */
+    double weights[NUM_WORKLOAD_FACTORS];
+    WORKLOAD_TYPE workload_type;
+    int num_rows;
+} WorkloadClassification;
+
+/*
+ * Read CSV (with a header line) or json (an array of objects or one object
+ * per line) dumps of pg_stat_statements, pg_stat_database and
+ * pg_stat_user_tables, in any combination, and classify their workload.
+ * Returns false when the files can not be read or hold nothing to classify
+ * on, after reporting why.
+ */
+bool classify_workload(const char **paths, int num_paths, WorkloadClassification *result);
+
+/*
+ * Add what the WAL shows to a classification, a zeroed one when there are
+ * no snapshots, and classify it again. The commit rate of the snapshots
+ * is kept when they have one. Returns false when it has no features.
+ */
+bool add_wal_features(WorkloadClassification *result, double bytes_per_commit, double commit_rate);
+void print_workload_classification(WorkloadClassification *result);
+
+#endif // __PG_STATS_SNAPSHOT_H__
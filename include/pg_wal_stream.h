@@ -0,0 +1,103 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_wal_stream.h
+ *		Write intensity, full page images and record mix of the WAL kept
+ *		in pg_wal, decoded from the segment files.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_WAL_STREAM_H__
+#define __PG_WAL_STREAM_H__
+
+#include <stdint.h>
+#include "pg_auto_tune.h"
+
+#define WAL_DIR "pg_wal"
+#define WAL_DIR_PRE_10 "pg_xlog"
+
+/* Bytes read from a segment at once */
+#define WAL_READ_SIZE (1024 * 1024)
+
+/* Resource managers the server has had so far, the others are not known */
+#define WAL_NUM_RMGRS 22
+
+/*
+ * Full page images above this share of the WAL mean checkpoints come too
+ * often, every first change of a page after one is written whole, and
+ * above the lower share are worth compressing.
+ */
+#define WAL_FPI_SHARE_HIGH 0.50
+#define WAL_FPI_SHARE_COMPRESS 0.25
+
+/* checkpoint_timeout that spreads the full page images when there are too many */
+#define WAL_FPI_CHECKPOINT_TIMEOUT 900.0
+
+/*
+ * wal_buffers holds what is written in this many seconds, several rounds
+ * of the WAL writer, up to a limit past which larger buffers do not help.
+ */
+#define WAL_BUFFER_SECONDS 1.0
+#define MAX_WAL_BUFFERS (256.0 * 1024 * 1024)
+
+typedef struct wal_stream
+{
+    int num_segments;           /* segments with valid WAL */
+    int num_skipped;            /* recycled, partial or damaged segments */
+    long long bytes_read;
+    uint32_t segment_size;
+    uint32_t block_size;
+    int server_version;         /* the WAL was read as */
+
+    long long num_records;
+    long long record_bytes;     /* xl_tot_len of every record */
+    long long fpi_bytes;        /* full page images in the records */
+    long long num_fpi;
+    long long num_compressed_fpi;
+    long long rmgr_records[WAL_NUM_RMGRS];
+    long long rmgr_bytes[WAL_NUM_RMGRS];
+    long long inserts;          /* tuples, a multi insert counts each */
+    long long updates;
+    long long hot_updates;      /* of the updates */
+    long long deletes;
+    long long commits;
+    long long aborts;
+    long long checkpoints;      /* online checkpoint records */
+
+    /* the commit records the rate is taken between */
+    uint64_t first_commit_lsn;
+    uint64_t last_commit_lsn;
+    double first_commit_time;   /* seconds since the epoch */
+    double last_commit_time;
+
+    /* rates, 0 when not known */
+    double span;                /* seconds */
+    double bytes_per_second;
+    bool rate_from_files;       /* of the segment file times, no commit times */
+    double fpi_share;           /* of the record bytes */
+    double commit_rate;         /* a second */
+    double bytes_per_commit;
+    double elapsed;             /* seconds to read the WAL */
+} WalStream;
+
+/*
+ * Decode the page and record headers of every segment in wal_dir, in
+ * segment order, and sum up the records by resource manager, their full
+ * page images and their heap changes. The bytes a second are taken
+ * between the first and the last commit record, or between the times of
+ * the segment files when there are no two. server_version, 0 when not
+ * known, tells how full page images are flagged. Returns false when the
+ * directory holds no WAL, after reporting why.
+ */
+bool analyze_wal_stream(const char *wal_dir, int server_version, WalStream *stream);
+void print_wal_stream(WalStream *stream);
+
+#endif // __PG_WAL_STREAM_H__
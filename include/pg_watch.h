@@ -0,0 +1,51 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_watch.h
+ *		Stay resident and tune again when the resources of the host change.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_WATCH_H__
+#define __PG_WATCH_H__
+
+#include <signal.h>
+
+#include "pgautotune.h"
+
+#define DEFAULT_WATCH_INTERVAL 10
+#define DEFAULT_PG_CTL "pg_ctl"
+
+typedef struct watch_options
+{
+    const char *data_dir;
+    const char *output_path;
+    int interval;               /* seconds between checks when nothing is notified */
+    bool reload;                /* reload the server when a reloadable parameter changed */
+    const char *pg_ctl;         /* pg_ctl to reload with, looked up in PATH */
+
+    /*
+     * Set by the caller, e.g. from its signal handler, to stop watching. A
+     * signal handler installed without SA_RESTART makes the wait return at
+     * once, otherwise the stop is seen within an interval.
+     */
+    volatile sig_atomic_t *stop;
+} WatchOptions;
+
+/*
+ * Check the cgroup limits, the online CPUs and the device of the data
+ * directory of an already processed context every interval, until *stop
+ * is set. Returns 0 on a clean shutdown and -1 when watching is not
+ * possible.
+ */
+int run_watch(pgat_context *ctx, WatchOptions *options);
+
+#endif // __PG_WATCH_H__
@@ -0,0 +1,94 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_xid_rate.h
+ *		How fast a server uses up transaction ids, from the counters of its
+ *		checkpoints in pg_control.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PG_XID_RATE_H__
+#define __PG_XID_RATE_H__
+
+#include "pg_control.h"
+
+/* pg_control only changes on a checkpoint, a window reads it this often */
+#define XID_SAMPLE_INTERVAL 10
+
+/* Older samples of the history are not used for the rate */
+#define XID_HISTORY_SECONDS (30 * 86400)
+#define XID_HISTORY_MAX_SAMPLES 4096
+
+#define DEFAULT_AUTOVACUUM_FREEZE_MAX_AGE 200000000.0
+#define DEFAULT_VACUUM_FREEZE_MIN_AGE 50000000.0
+#define DEFAULT_AUTOVACUUM_MAX_WORKERS 3
+
+/*
+ * autovacuum_freeze_max_age lets this long pass between the vacuums that
+ * autovacuum forces to freeze a table, up to a limit well below
+ * vacuum_failsafe_age and the 2 billion ids to wraparound.
+ */
+#define XID_FREEZE_CYCLE_SECONDS (7 * 86400.0)
+#define MAX_AUTOVACUUM_FREEZE_MAX_AGE 1200000000.0
+#define FREEZE_MAX_AGE_ROUNDING 10000000.0
+
+/* Tuples that were not changed for this long are frozen by any vacuum */
+#define XID_FREEZE_MIN_AGE_SECONDS 3600.0
+#define MIN_VACUUM_FREEZE_MIN_AGE 1000000.0
+#define FREEZE_MIN_AGE_ROUNDING 1000000.0
+
+/*
+ * When the next forced vacuum is closer than this, it gets workers of its
+ * own so the other tables still get vacuumed while it runs.
+ */
+#define XID_URGENT_SECONDS 86400.0
+#define XID_URGENT_AUTOVACUUM_WORKERS 6
+
+typedef struct xid_sample
+{
+    int64_t time;               /* of the checkpoint */
+    uint64_t next_xid;          /* with the epoch in the high 32 bits */
+    uint32_t oldest_xid;
+    uint32_t next_multi;
+    uint32_t oldest_multi;
+} XidSample;
+
+typedef struct xid_rate
+{
+    uint64_t system_identifier;
+    XidSample *samples;         /* distinct checkpoints, oldest first */
+    int num_samples;
+    int max_samples;
+    int num_recorded;           /* samples added to the history file */
+    double span;                /* seconds from the first to the last sample */
+    double xid_rate;            /* transaction ids a second, 0 when unknown */
+    double multi_rate;          /* multixact ids a second */
+    double xid_age;             /* of the oldest datfrozenxid at the last checkpoint */
+    double multi_age;
+} XidRate;
+
+/*
+ * Sample the checkpoint counters of the data directory, already read into
+ * control, together with the earlier samples of the same cluster in
+ * history_path and, for window seconds, the checkpoints that happen
+ * meanwhile, and fit the rate transaction ids are used at. New samples
+ * are appended to history_path, when it is not NULL, for the next run.
+ * The rate stays 0 with fewer than two checkpoints. Returns false when
+ * the data directory or the history can not be read, after reporting why.
+ */
+bool measure_xid_rate(const char *data_dir, ControlInfo *control, const char *history_path, int window, XidRate *rate);
+void free_xid_rate(XidRate *rate);
+void print_xid_rate(XidRate *rate, double freeze_max_age);
+
+/* Seconds until the oldest datfrozenxid is freeze_max_age old, negative when it is already */
+double seconds_to_freeze_age(XidRate *rate, double freeze_max_age);
+
+#endif // __PG_XID_RATE_H__
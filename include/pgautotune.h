@@ -0,0 +1,242 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgautotune.h
+ *		Embeddable tuning library, libpgautotune.
+ *
+ * All the state of a tuning run lives in a pgat_context. A context must
+ * not be used by two threads at the same time, but any number of contexts
+ * can be used concurrently. Nothing in the library exits the process, every
+ * entry point returns a PGAT_STATUS and pgat_error_message() tells what
+ * went wrong. The usual sequence is
+ *
+ *    ctx = pgat_create();
+ *    pgat_set_workload_type(ctx, OLTP);
+ *    pgat_probe(ctx, data_dir);
+ *    pgat_load_profile(ctx, profile_path);
+ *    pgat_process(ctx);
+ *    pgat_emit(ctx, output_path);
+ *    pgat_destroy(ctx);
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PGAUTOTUNE_H__
+#define __PGAUTOTUNE_H__
+
+#include <stdio.h>
+#include "pg_auto_tune.h"
+
+struct miss_ratio_curve;
+struct cache_residency;
+struct data_dir_shape;
+struct heap_scan;
+struct control_info;
+struct xid_rate;
+struct wal_stream;
+struct compression_bench;
+struct cost_calibration;
+struct memory_knee;
+struct memory_bandwidth;
+
+#define PGAT_MAX_ERROR_LEN 1024
+
+typedef enum PGAT_STATUS
+{
+    PGAT_OK = 0,
+    PGAT_ERROR_ARGUMENT,        /* invalid argument */
+    PGAT_ERROR_STATE,           /* called out of sequence */
+    PGAT_ERROR_PROBE,           /* system resources could not be determined */
+    PGAT_ERROR_PROFILE,         /* profile could not be loaded */
+    PGAT_ERROR_BOUNDS,          /* system is outside the bounds of the profile */
+    PGAT_ERROR_IO,              /* output could not be written */
+    PGAT_ERROR_MEMORY
+} PGAT_STATUS;
+
+typedef struct pgat_context pgat_context;
+
+pgat_context *pgat_create(void);
+void pgat_destroy(pgat_context *ctx);
+const char *pgat_error_message(const pgat_context *ctx);
+
+/* Describe the system, anything not set keeps its default */
+void pgat_set_workload_type(pgat_context *ctx, WORKLOAD_TYPE workload_type);
+void pgat_set_host_type(pgat_context *ctx, HOST_TYPE host_type);
+void pgat_set_node_type(pgat_context *ctx, NODE_TYPE node_type);
+void pgat_set_disk_type(pgat_context *ctx, DISK_TYPE disk_type);
+void pgat_set_force_profile(pgat_context *ctx, bool force);
+
+/*
+ * Hand the diagnostics of the library, what it loads and does, to hook
+ * instead of dropping them. Errors still come back as a PGAT_STATUS. Maps
+ * copied from the one of the context log through the same hook, from the
+ * worker threads of a batch too.
+ */
+void pgat_set_log_hook(pgat_context *ctx, PGATLogHook hook, void *arg);
+
+/*
+ * Run a blend of workloads, e.g. "oltp=0.7,olap=0.3", instead of a single
+ * one. The factors of every parameter are combined following its blend mode.
+ */
+PGAT_STATUS pgat_set_workload_blend(pgat_context *ctx, const char *blend);
+
+/*
+ * Resources that are known upfront, e.g. the limits of a container. A
+ * value set here is not probed, -1 leaves it to pgat_probe().
+ */
+void pgat_set_resources(pgat_context *ctx, long long total_ram, long cpu_count, double disk_speed);
+
+/*
+ * Probe the system resources that are not set yet and, when data_dir is
+ * not NULL, read its postgresql.conf, PG_VERSION and pg_control and
+ * measure its disk.
+ */
+PGAT_STATUS pgat_probe(pgat_context *ctx, const char *data_dir);
+
+/*
+ * Probe again whatever pgat_probe() probed and set the RESOURCE_BIT() of
+ * every resource that changed since in *changed. The disk is only measured
+ * again when the data directory moved to another device.
+ */
+PGAT_STATUS pgat_refresh(pgat_context *ctx, unsigned int *changed);
+
+/*
+ * Read the server logs, log_path or else the log_directory of the probed
+ * data directory, and let what they show raise work_mem and max_wal_size
+ * on every following pgat_process().
+ */
+PGAT_STATUS pgat_analyze_logs(pgat_context *ctx, const char *log_path);
+
+/*
+ * Decode the WAL segments in wal_dir, or else in pg_wal of the probed data
+ * directory, for how fast WAL is written and how much of it are full page
+ * images, and let that set max_wal_size, checkpoint_timeout,
+ * wal_compression and wal_buffers on every following pgat_process().
+ */
+PGAT_STATUS pgat_analyze_wal(pgat_context *ctx, const char *wal_dir);
+
+/*
+ * Replay block access traces through a model of the shared buffers and set
+ * the knee of their miss ratio curve as the MRC resource. The curve is
+ * copied to *curve unless it is NULL.
+ */
+PGAT_STATUS pgat_analyze_buffer_trace(pgat_context *ctx, const char **paths, int num_paths, struct miss_ratio_curve *curve);
+
+/*
+ * Measure how much of every relation of the probed data directory is in
+ * the page cache, and let the hot set size shared_buffers and
+ * effective_cache_size on every following pgat_process(). keep_blocks
+ * keeps the resident blocks for an autoprewarm list.
+ */
+PGAT_STATUS pgat_scan_cache_residency(pgat_context *ctx, bool keep_blocks);
+
+/*
+ * Size the relations and WAL of the probed data directory. Its data size,
+ * largest table and number of relations become the DATA_SIZE,
+ * LARGEST_TABLE, RELATIONS and DATA_SCALE resources of the profile.
+ */
+PGAT_STATUS pgat_scan_data_dir(pgat_context *ctx);
+
+/*
+ * Read the heap pages of every table of the probed data directory for
+ * their free and dead space. The cost of vacuuming them raises
+ * autovacuum_vacuum_cost_limit on every following pgat_process().
+ */
+PGAT_STATUS pgat_scan_heap(pgat_context *ctx);
+
+/*
+ * Sample the transaction ids of the checkpoints of the probed data
+ * directory, the earlier ones kept in history_path and, for window
+ * seconds, the ones that happen meanwhile. Their rate sets the freeze ages
+ * and the autovacuum workers and cost limit on every following
+ * pgat_process(). New samples are added to history_path unless it is NULL.
+ */
+PGAT_STATUS pgat_measure_xid_rate(pgat_context *ctx, const char *history_path, int window);
+
+/*
+ * Compress random pages of the tables, TOAST tables and WAL of the probed
+ * data directory with pglz, lz4 and zstd from every core. Their ratio and
+ * speed against the CPU left and the measured disk speed set
+ * wal_compression and default_toast_compression on every following
+ * pgat_process().
+ */
+PGAT_STATUS pgat_benchmark_compression(pgat_context *ctx);
+
+/*
+ * Time sequential and random page reads of the largest relations of the
+ * probed data directory, past the page cache when the file system allows
+ * it, and tuple deforming, expression evaluation and worker start kernels
+ * against them. CALIBRATED entries get the measured planner costs on
+ * every following pgat_process().
+ */
+PGAT_STATUS pgat_calibrate_costs(pgat_context *ctx);
+
+/*
+ * Sort and hash tuples in memory at sizes from 64kB up to 1GB, within an
+ * eighth of the memory of the host, and find where they fall out of the
+ * caches. work_mem and hash_mem_multiplier are counted in those sizes on
+ * every following pgat_process().
+ */
+PGAT_STATUS pgat_find_memory_knee(pgat_context *ctx);
+
+/*
+ * Run STREAM copy, scale and triad kernels on a thread pinned to every
+ * CPU, spread over the NUMA nodes, and chase pointers in the memory of
+ * every node. The system info gets the GB/s and ns, the MEMBW resource,
+ * and max_parallel_workers_per_gather is capped at what the memory feeds
+ * on every following pgat_process().
+ */
+PGAT_STATUS pgat_measure_memory_bandwidth(pgat_context *ctx);
+
+/* Load a json profile or a compiled profile image */
+PGAT_STATUS pgat_load_profile(pgat_context *ctx, const char *file_path);
+
+/* Check the profile bounds and compute the value of every parameter */
+PGAT_STATUS pgat_process(pgat_context *ctx);
+
+/*
+ * Process a copy of the map for every workload type at once, to compare
+ * them without probing and parsing again for each.
+ */
+PGAT_STATUS pgat_process_all_workloads(pgat_context *ctx);
+
+/*
+ * After a pgat_refresh(), compute again only the parameters that depend on
+ * the given set of resources.
+ */
+PGAT_STATUS pgat_reprocess(pgat_context *ctx, unsigned int resources);
+
+/*
+ * Write the tuned parameters as postgresql.conf lines. The file is replaced
+ * atomically, readers see either the old or the new configuration.
+ */
+PGAT_STATUS pgat_emit(pgat_context *ctx, const char *output_path);
+PGAT_STATUS pgat_emit_stream(pgat_context *ctx, FILE *fp);
+PGAT_STATUS pgat_emit_workload(pgat_context *ctx, WORKLOAD_TYPE workload, const char *output_path);
+
+/* Access to the state of the context, owned by the context */
+SystemInfo *pgat_get_system_info(pgat_context *ctx);
+PGMapProfileDetails *pgat_get_profile(pgat_context *ctx);
+PGConfigMap *pgat_get_config_map(pgat_context *ctx);
+PGConfigMap *pgat_get_workload_config_map(pgat_context *ctx, WORKLOAD_TYPE workload);
+struct log_evidence *pgat_get_log_evidence(pgat_context *ctx);
+struct cache_residency *pgat_get_cache_residency(pgat_context *ctx);
+struct data_dir_shape *pgat_get_data_dir_shape(pgat_context *ctx);
+struct heap_scan *pgat_get_heap_scan(pgat_context *ctx);
+/* pg_control and PG_VERSION of the probed data directory, NULL when not read */
+struct control_info *pgat_get_control_info(pgat_context *ctx);
+struct xid_rate *pgat_get_xid_rate(pgat_context *ctx);
+struct wal_stream *pgat_get_wal_stream(pgat_context *ctx);
+struct compression_bench *pgat_get_compression_bench(pgat_context *ctx);
+struct cost_calibration *pgat_get_cost_calibration(pgat_context *ctx);
+struct memory_knee *pgat_get_memory_knee(pgat_context *ctx);
+struct memory_bandwidth *pgat_get_memory_bandwidth(pgat_context *ctx);
+
+#endif // __PGAUTOTUNE_H__
@@ -314,11 +314,15 @@ json_value *json_parse_ex(json_settings *settings,
       flags = flag_seek_value;
 
       state.cur_line = 1;
+      state.cur_col = 0;
 
       for (state.ptr = json;; ++state.ptr)
       {
          json_char b = (state.ptr == end ? 0 : *state.ptr);
 
+         /* percona: the column was never advanced, errors always said 0 */
+         ++state.cur_col;
+
          if (flags & flag_string)
          {
             if (!b)
@@ -503,6 +507,7 @@ json_value *json_parse_ex(json_settings *settings,
                   {
                      flags &= ~flag_line_comment;
                      --state.ptr; /* so null can be reproc'd */
+                     --state.cur_col;
                   }
 
                   continue;
@@ -672,6 +677,8 @@ json_value *json_parse_ex(json_settings *settings,
 
                   top->u.boolean = 1;
 
+                  /* percona: the letters skipped above are columns too */
+                  state.cur_col += 3;
                   flags |= flag_next;
                   break;
 
@@ -687,6 +694,7 @@ json_value *json_parse_ex(json_settings *settings,
                   if (!new_value(&state, &top, &root, &alloc, json_boolean))
                      goto e_alloc_failure;
 
+                  state.cur_col += 4;
                   flags |= flag_next;
                   break;
 
@@ -701,6 +709,7 @@ json_value *json_parse_ex(json_settings *settings,
                   if (!new_value(&state, &top, &root, &alloc, json_null))
                      goto e_alloc_failure;
 
+                  state.cur_col += 3;
                   flags |= flag_next;
                   break;
 
@@ -831,6 +840,7 @@ json_value *json_parse_ex(json_settings *settings,
                         json_int_t integer = top->u.integer;
                         --num_digits;
                         --state.ptr;
+                        --state.cur_col;
                         top->type = json_double;
                         top->u.dbl = (double)integer;
                         continue;
@@ -939,6 +949,7 @@ json_value *json_parse_ex(json_settings *settings,
          {
             flags &= ~flag_reproc;
             --state.ptr;
+            --state.cur_col;
          }
 
          if (flags & flag_next)
@@ -1180,37 +1191,49 @@ int json_get_double_value_for_key(json_value *source, const char *key, double *v
    return 0;
 }
 
-char *
+/*
+ * percona extension:
+ * string values are returned as borrowed pointers into the parsed tree,
+ * they stay valid for as long as the tree does. Returns NULL when the key
+ * is not found or its value is not a string.
+ */
+const char *
 json_get_string_value_for_key(json_value *source, const char *key)
 {
    json_value *jNode;
 
    jNode = json_get_value_for_key(source, key);
-   if (jNode == NULL)
+   if (jNode == NULL || jNode->type != json_string)
       return NULL;
 
+   return jNode->u.string.ptr;
+}
+
+int json_get_slice_for_key(json_value *source, const char *key, json_slice *slice)
+{
+   json_value *jNode;
+
+   jNode = json_get_value_for_key(source, key);
+   if (jNode == NULL || jNode->type != json_string)
+      return -1;
+   slice->ptr = jNode->u.string.ptr;
+   slice->length = jNode->u.string.length;
+   return 0;
+}
+
+/* Integer or double value as a double */
+int json_get_number_value_for_key(json_value *source, const char *key, double *value)
+{
+   json_value *jNode;
+
+   jNode = json_get_value_for_key(source, key);
+   if (jNode == NULL)
+      return -1;
    if (jNode->type == json_integer)
-   {
-      char *int_val = NULL;
-      int num_len = (int)((ceil(log10(jNode->u.integer)) + 1) * sizeof(char));
-      int_val = calloc(num_len, sizeof *int_val);
-      sprintf(int_val, "%ld", jNode->u.integer);
-      return int_val;
-   }
+      *value = (double)jNode->u.integer;
    else if (jNode->type == json_double)
-   {
-      char *dbl_val = NULL;
-      dbl_val = calloc(512, sizeof *dbl_val);
-      sprintf(dbl_val, "%f", jNode->u.dbl);
-      return dbl_val;
-   }
-   else if (jNode->type == json_string)
-   {
-      char *str_val = NULL;
-      str_val = calloc(strlen(jNode->u.string.ptr), sizeof *str_val);
-      memcpy(str_val, jNode->u.string.ptr, strlen(jNode->u.string.ptr));
-      return str_val;
-   }
-
-   return NULL;
+      *value = jNode->u.dbl;
+   else
+      return -1;
+   return 0;
 }
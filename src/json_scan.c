@@ -0,0 +1,1365 @@
+/*-------------------------------------------------------------------------
+ *
+ * json_scan.c
+ *		Fast path json parser: SIMD structural scanner feeding a flat tape.
+ *
+ * Parsing happens in two stages, the same way simdjson does it.
+ *
+ * Stage 1 classifies the input 64 bytes at a time into bitmaps of quotes,
+ * backslashes, structural characters and whitespace, using AVX2 or SSE2
+ * when available and a scalar loop otherwise. Escaped quotes and the inside
+ * of strings are masked out with carry-less bit tricks, which leaves the
+ * positions of every structural character and of the start of every
+ * string and scalar.
+ *
+ * Stage 2 walks those positions, validates the grammar and writes a flat
+ * tape of values in document order. Readers walk the tape with a json_cursor
+ * and read the strings in place. The tape can also be converted into the
+ * regular json_value tree in a single pass with exact sized allocations.
+ *
+ * Anything the fast path does not handle (comments, invalid documents,
+ * very deep nesting) is handed over to the scalar json_parse_ex().
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JSON_SCAN_X86 1
+#endif
+
+#include "json_scan.h"
+
+#define BLOCK_SIZE 64
+#define EVEN_BITS 0x5555555555555555ULL
+#define ODD_BITS (~EVEN_BITS)
+
+/* Character class bitmaps of one 64 byte block */
+typedef struct block_masks
+{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;            /* { } [ ] : , */
+    uint64_t whitespace;
+} block_masks;
+
+/* State carried from one block to the next */
+typedef struct scan_state
+{
+    uint64_t prev_odd_backslash;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
+} scan_state;
+
+typedef void (*classify_fn) (const unsigned char *block, block_masks *masks);
+
+typedef struct tape_builder
+{
+    const unsigned char *json;
+    size_t length;
+    const uint32_t *index;
+    uint32_t num_index;
+    uint32_t pos;
+    json_tape *tape;
+    char *string_end;
+} tape_builder;
+
+/* Picked once per process, contexts on other threads may be parsing too */
+static pthread_once_t classify_once = PTHREAD_ONCE_INIT;
+static classify_fn classify_block = NULL;
+static const char *classify_name = NULL;
+
+static void classify_block_scalar(const unsigned char *block, block_masks *masks);
+static uint32_t *find_structurals(const unsigned char *json, size_t length, uint32_t *num_index);
+static int parse_value(tape_builder *builder, int depth);
+static int parse_string(tape_builder *builder, uint32_t start, bool is_key);
+static int parse_number(tape_builder *builder, uint32_t start, json_tape_node *node);
+static int parse_literal(tape_builder *builder, uint32_t start, json_tape_node *node);
+static json_value *build_value(json_tape *tape, uint32_t node_index, json_value *parent,
+                               json_settings *settings, bool *failed);
+
+#ifdef JSON_SCAN_X86
+static void
+classify_block_sse2(const unsigned char *block, block_masks *masks)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i open_bracket = _mm_set1_epi8('[');
+    const __m128i close_bracket = _mm_set1_epi8(']');
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    int i;
+
+    memset(masks, 0x00, sizeof *masks);
+    for (i = 0; i < BLOCK_SIZE; i += 16)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)(block + i));
+        __m128i ws, op;
+
+        ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(in, space), _mm_cmpeq_epi8(in, tab)),
+                          _mm_or_si128(_mm_cmpeq_epi8(in, nl), _mm_cmpeq_epi8(in, cr)));
+        op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(in, comma), _mm_cmpeq_epi8(in, colon)),
+                          _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(in, open_bracket), _mm_cmpeq_epi8(in, close_bracket)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(in, open_brace), _mm_cmpeq_epi8(in, close_brace))));
+
+        masks->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(in, quote)) << i;
+        masks->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(in, backslash)) << i;
+        masks->whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << i;
+        masks->op |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << i;
+    }
+}
+
+__attribute__((target("avx2")))
+static void
+classify_block_avx2(const unsigned char *block, block_masks *masks)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i open_bracket = _mm256_set1_epi8('[');
+    const __m256i close_bracket = _mm256_set1_epi8(']');
+    const __m256i open_brace = _mm256_set1_epi8('{');
+    const __m256i close_brace = _mm256_set1_epi8('}');
+    int i;
+
+    memset(masks, 0x00, sizeof *masks);
+    for (i = 0; i < BLOCK_SIZE; i += 32)
+    {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(block + i));
+        __m256i ws, op;
+
+        ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(in, space), _mm256_cmpeq_epi8(in, tab)),
+                             _mm256_or_si256(_mm256_cmpeq_epi8(in, nl), _mm256_cmpeq_epi8(in, cr)));
+        op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(in, comma), _mm256_cmpeq_epi8(in, colon)),
+                             _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(in, open_bracket), _mm256_cmpeq_epi8(in, close_bracket)),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(in, open_brace), _mm256_cmpeq_epi8(in, close_brace))));
+
+        masks->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, quote)) << i;
+        masks->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, backslash)) << i;
+        masks->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << i;
+        masks->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << i;
+    }
+}
+#endif
+
+static void
+classify_block_scalar(const unsigned char *block, block_masks *masks)
+{
+    int i;
+
+    memset(masks, 0x00, sizeof *masks);
+    for (i = 0; i < BLOCK_SIZE; i++)
+    {
+        uint64_t bit = 1ULL << i;
+
+        switch (block[i])
+        {
+        case '"':
+            masks->quote |= bit;
+            break;
+        case '\\':
+            masks->backslash |= bit;
+            break;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            masks->whitespace |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            masks->op |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void
+select_implementation_once(void)
+{
+#ifdef JSON_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        classify_name = "avx2";
+        classify_block = classify_block_avx2;
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        classify_name = "sse2";
+        classify_block = classify_block_sse2;
+        return;
+    }
+#endif
+    classify_name = "scalar";
+    classify_block = classify_block_scalar;
+}
+
+static void
+select_implementation(void)
+{
+    pthread_once(&classify_once, select_implementation_once);
+}
+
+const char *
+json_scan_implementation(void)
+{
+    select_implementation();
+    return classify_name;
+}
+
+/*
+ * Characters escaped by an odd length run of backslashes, carrying runs
+ * that cross the block boundary over in state->prev_odd_backslash.
+ */
+static inline uint64_t
+find_escaped(uint64_t backslash, scan_state *state)
+{
+    uint64_t start_edges = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = EVEN_BITS ^ state->prev_odd_backslash;
+    uint64_t even_starts = start_edges & even_start_mask;
+    uint64_t odd_starts = start_edges & ~even_start_mask;
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries;
+    bool ends_odd_backslash;
+
+    ends_odd_backslash = __builtin_add_overflow(backslash, odd_starts, &odd_carries);
+    odd_carries |= state->prev_odd_backslash;
+    state->prev_odd_backslash = ends_odd_backslash ? 1ULL : 0ULL;
+
+    return ((even_carries & ~backslash) & ODD_BITS) | ((odd_carries & ~backslash) & EVEN_BITS);
+}
+
+static inline uint64_t
+prefix_xor(uint64_t bits)
+{
+#if defined(JSON_SCAN_X86) && defined(__PCLMUL__)
+    __m128i all_ones = _mm_set1_epi8((char)0xFF);
+    __m128i result = _mm_clmulepi64_si128(_mm_set_epi64x(0ULL, bits), all_ones, 0);
+    return (uint64_t)_mm_cvtsi128_si64(result);
+#else
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+#endif
+}
+
+/* Structural positions of one block */
+static inline uint64_t
+scan_block(const block_masks *masks, scan_state *state)
+{
+    uint64_t escaped = find_escaped(masks->backslash, state);
+    uint64_t quote = masks->quote & ~escaped;
+    uint64_t in_string = prefix_xor(quote) ^ state->prev_in_string;
+    uint64_t string_open = quote & in_string;
+    uint64_t outside = ~in_string & ~quote;
+    uint64_t op = masks->op & outside;
+    uint64_t scalar = outside & ~masks->whitespace & ~masks->op;
+    uint64_t scalar_start = scalar & ~((scalar << 1) | state->prev_scalar);
+
+    state->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+    state->prev_scalar = scalar >> 63;
+
+    return op | string_open | scalar_start;
+}
+
+/*
+ * Stage 1: returns the offsets of all structural characters and value
+ * starts, or NULL when the input ends inside a string.
+ */
+static uint32_t *
+find_structurals(const unsigned char *json, size_t length, uint32_t *num_index)
+{
+    unsigned char tail[BLOCK_SIZE];
+    scan_state state;
+    uint32_t *index;
+    size_t capacity;
+    size_t count = 0;
+    size_t offset;
+
+    memset(&state, 0x00, sizeof state);
+    capacity = length / 4 + BLOCK_SIZE;
+    index = malloc(capacity * sizeof *index);
+    if (index == NULL)
+        return NULL;
+
+    for (offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        const unsigned char *block = json + offset;
+        block_masks masks;
+        uint64_t bits;
+
+        /* Never read past the end of the input, pad the last block */
+        if (length - offset < BLOCK_SIZE)
+        {
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, json + offset, length - offset);
+            block = tail;
+        }
+        classify_block(block, &masks);
+        bits = scan_block(&masks, &state);
+
+        if (count + BLOCK_SIZE > capacity)
+        {
+            uint32_t *grown;
+
+            capacity = capacity * 2 + BLOCK_SIZE;
+            grown = realloc(index, capacity * sizeof *index);
+            if (grown == NULL)
+            {
+                free(index);
+                return NULL;
+            }
+            index = grown;
+        }
+        while (bits)
+        {
+            index[count++] = (uint32_t)(offset + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    if (state.prev_in_string)
+    {
+        free(index);
+        return NULL;
+    }
+    *num_index = (uint32_t)count;
+    return index;
+}
+
+static inline json_tape_node *
+new_node(tape_builder *builder, json_type type, uint32_t source_offset)
+{
+    json_tape_node *node = &builder->tape->nodes[builder->tape->num_nodes++];
+
+    memset(node, 0x00, sizeof *node);
+    node->type = type;
+    node->source_offset = source_offset;
+    return node;
+}
+
+static inline int
+next_char(tape_builder *builder, uint32_t *offset)
+{
+    if (builder->pos >= builder->num_index)
+        return -1;
+    *offset = builder->index[builder->pos++];
+    return builder->json[*offset];
+}
+
+/* Stage 2: recursive descent over the structural positions */
+static int
+parse_value(tape_builder *builder, int depth)
+{
+    uint32_t offset;
+    uint32_t node_index = builder->tape->num_nodes;
+    json_tape_node *node;
+    int c;
+
+    if (depth > JSON_TAPE_MAX_DEPTH)
+        return -1;
+
+    c = next_char(builder, &offset);
+    switch (c)
+    {
+    case '{':
+        node = new_node(builder, json_object, offset);
+        if (builder->pos < builder->num_index && builder->json[builder->index[builder->pos]] == '}')
+        {
+            builder->pos++;
+            break;
+        }
+        while (true)
+        {
+            if (next_char(builder, &offset) != '"' || parse_string(builder, offset, true) < 0)
+                return -1;
+            if (next_char(builder, &offset) != ':')
+                return -1;
+            if (parse_value(builder, depth + 1) < 0)
+                return -1;
+            builder->tape->nodes[node_index].length++;
+            c = next_char(builder, &offset);
+            if (c == '}')
+                break;
+            if (c != ',')
+                return -1;
+        }
+        break;
+
+    case '[':
+        node = new_node(builder, json_array, offset);
+        if (builder->pos < builder->num_index && builder->json[builder->index[builder->pos]] == ']')
+        {
+            builder->pos++;
+            break;
+        }
+        while (true)
+        {
+            if (parse_value(builder, depth + 1) < 0)
+                return -1;
+            builder->tape->nodes[node_index].length++;
+            c = next_char(builder, &offset);
+            if (c == ']')
+                break;
+            if (c != ',')
+                return -1;
+        }
+        break;
+
+    case '"':
+        if (parse_string(builder, offset, false) < 0)
+            return -1;
+        break;
+
+    case 't':
+    case 'f':
+    case 'n':
+        node = new_node(builder, json_none, offset);
+        if (parse_literal(builder, offset, node) < 0)
+            return -1;
+        break;
+
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        node = new_node(builder, json_integer, offset);
+        if (parse_number(builder, offset, node) < 0)
+            return -1;
+        break;
+
+    default:
+        return -1;
+    }
+    builder->tape->nodes[node_index].next = builder->tape->num_nodes;
+    return 0;
+}
+
+static inline int
+hex_digit(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static int
+read_hex4(const unsigned char *ptr, const unsigned char *end, unsigned int *value)
+{
+    int i;
+
+    if (end - ptr < 4)
+        return -1;
+    *value = 0;
+    for (i = 0; i < 4; i++)
+    {
+        int digit = hex_digit(ptr[i]);
+
+        if (digit < 0)
+            return -1;
+        *value = (*value << 4) | digit;
+    }
+    return 0;
+}
+
+/*
+ * Unescape the string starting at the quote at start into the string
+ * buffer. The closing quote is not a structural, so it is found here.
+ */
+static int
+parse_string(tape_builder *builder, uint32_t start, bool is_key)
+{
+    const unsigned char *ptr = builder->json + start + 1;
+    const unsigned char *end = builder->json + builder->length;
+    json_tape_node *node = new_node(builder, json_string, start);
+    char *out = builder->string_end;
+
+    node->u.string_offset = out - builder->tape->strings;
+    while (true)
+    {
+        const unsigned char *run = ptr;
+        unsigned int code;
+
+        while (ptr < end && *ptr != '"' && *ptr != '\\' && *ptr >= 0x20)
+            ptr++;
+        memcpy(out, run, ptr - run);
+        out += ptr - run;
+
+        if (ptr >= end || *ptr < 0x20)
+            return -1;
+        if (*ptr == '"')
+            break;
+
+        /* backslash */
+        if (++ptr >= end)
+            return -1;
+        switch (*ptr++)
+        {
+        case '"':  *out++ = '"'; break;
+        case '\\': *out++ = '\\'; break;
+        case '/':  *out++ = '/'; break;
+        case 'b':  *out++ = '\b'; break;
+        case 'f':  *out++ = '\f'; break;
+        case 'n':  *out++ = '\n'; break;
+        case 'r':  *out++ = '\r'; break;
+        case 't':  *out++ = '\t'; break;
+        case 'u':
+            if (read_hex4(ptr, end, &code) < 0)
+                return -1;
+            ptr += 4;
+            if (code >= 0xD800 && code <= 0xDBFF)
+            {
+                unsigned int low;
+
+                if (end - ptr < 6 || ptr[0] != '\\' || ptr[1] != 'u' ||
+                    read_hex4(ptr + 2, end, &low) < 0 || low < 0xDC00 || low > 0xDFFF)
+                    return -1;
+                ptr += 6;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if (code >= 0xDC00 && code <= 0xDFFF)
+                return -1;
+
+            if (code < 0x80)
+                *out++ = (char)code;
+            else if (code < 0x800)
+            {
+                *out++ = (char)(0xC0 | (code >> 6));
+                *out++ = (char)(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000)
+            {
+                *out++ = (char)(0xE0 | (code >> 12));
+                *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                *out++ = (char)(0xF0 | (code >> 18));
+                *out++ = (char)(0x80 | ((code >> 12) & 0x3F));
+                *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (code & 0x3F));
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+    node->length = (uint32_t)(out - (builder->tape->strings + node->u.string_offset));
+    *out++ = '\0';
+    builder->string_end = out;
+    node->next = builder->tape->num_nodes;
+
+    /* Nothing but structurals or whitespace may follow the closing quote */
+    ptr++;
+    if (builder->pos < builder->num_index)
+    {
+        const unsigned char *next = builder->json + builder->index[builder->pos];
+
+        while (ptr < next)
+        {
+            if (*ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r')
+                return -1;
+            ptr++;
+        }
+    }
+    (void)is_key;
+    return 0;
+}
+
+static inline bool
+is_delimiter(tape_builder *builder, size_t offset)
+{
+    unsigned char c;
+
+    if (offset >= builder->length)
+        return true;
+    c = builder->json[offset];
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+        c == ',' || c == ':' || c == ']' || c == '}';
+}
+
+static int
+parse_literal(tape_builder *builder, uint32_t start, json_tape_node *node)
+{
+    const char *ptr = (const char *)builder->json + start;
+    size_t left = builder->length - start;
+
+    if (left >= 4 && memcmp(ptr, "true", 4) == 0 && is_delimiter(builder, start + 4))
+    {
+        node->type = json_boolean;
+        node->u.boolean = 1;
+    }
+    else if (left >= 5 && memcmp(ptr, "false", 5) == 0 && is_delimiter(builder, start + 5))
+    {
+        node->type = json_boolean;
+        node->u.boolean = 0;
+    }
+    else if (left >= 4 && memcmp(ptr, "null", 4) == 0 && is_delimiter(builder, start + 4))
+        node->type = json_null;
+    else
+        return -1;
+    return 0;
+}
+
+static int
+parse_number(tape_builder *builder, uint32_t start, json_tape_node *node)
+{
+    const unsigned char *json = builder->json;
+    size_t offset = start;
+    bool negative = false;
+    bool is_double = false;
+    bool overflow = false;
+    uint64_t integer = 0;
+
+    if (json[offset] == '-')
+    {
+        negative = true;
+        offset++;
+    }
+    if (offset >= builder->length || json[offset] < '0' || json[offset] > '9')
+        return -1;
+    if (json[offset] == '0')
+    {
+        offset++;
+        if (offset < builder->length && json[offset] >= '0' && json[offset] <= '9')
+            return -1;
+    }
+    else
+    {
+        while (offset < builder->length && json[offset] >= '0' && json[offset] <= '9')
+        {
+            unsigned digit = json[offset++] - '0';
+
+            if (integer > (UINT64_MAX - digit) / 10)
+                overflow = true;
+            else
+                integer = integer * 10 + digit;
+        }
+    }
+    if (offset < builder->length && json[offset] == '.')
+    {
+        is_double = true;
+        offset++;
+        if (offset >= builder->length || json[offset] < '0' || json[offset] > '9')
+            return -1;
+        while (offset < builder->length && json[offset] >= '0' && json[offset] <= '9')
+            offset++;
+    }
+    if (offset < builder->length && (json[offset] == 'e' || json[offset] == 'E'))
+    {
+        is_double = true;
+        offset++;
+        if (offset < builder->length && (json[offset] == '+' || json[offset] == '-'))
+            offset++;
+        if (offset >= builder->length || json[offset] < '0' || json[offset] > '9')
+            return -1;
+        while (offset < builder->length && json[offset] >= '0' && json[offset] <= '9')
+            offset++;
+    }
+    if (!is_delimiter(builder, offset))
+        return -1;
+
+    /* json_parse_ex() makes a double of anything past INT64_MAX either way, INT64_MIN too */
+    if (!is_double && !overflow && integer <= (uint64_t)INT64_MAX)
+    {
+        node->type = json_integer;
+        node->u.integer = negative ? -(json_int_t)integer : (json_int_t)integer;
+    }
+    else
+    {
+        char buffer[128];
+        char *number = buffer;
+        size_t len = offset - start;
+
+        /* strtod needs a terminated copy, the input is not */
+        if (len >= sizeof buffer && (number = malloc(len + 1)) == NULL)
+            return -1;
+        memcpy(number, json + start, len);
+        number[len] = '\0';
+        node->type = json_double;
+        node->u.dbl = strtod(number, NULL);
+        if (number != buffer)
+            free(number);
+    }
+    return 0;
+}
+
+/* Offsets on the tape are relative to the input after a UTF-8 BOM */
+static void
+skip_bom(const json_char **json, size_t *length)
+{
+    if (*length >= 3 && (unsigned char)(*json)[0] == 0xEF &&
+        (unsigned char)(*json)[1] == 0xBB && (unsigned char)(*json)[2] == 0xBF)
+    {
+        *json += 3;
+        *length -= 3;
+    }
+}
+
+int
+json_tape_parse(json_tape *tape, const json_char *json, size_t length)
+{
+    tape_builder builder;
+    uint32_t num_index = 0;
+    uint32_t *index;
+
+    memset(tape, 0x00, sizeof *tape);
+    select_implementation();
+
+    skip_bom(&json, &length);
+    if (length == 0 || length >= UINT32_MAX)
+        return -1;
+
+    index = find_structurals((const unsigned char *)json, length, &num_index);
+    if (index == NULL)
+        return -1;
+    if (num_index == 0)
+    {
+        free(index);
+        return -1;
+    }
+
+    tape->nodes = malloc(((size_t)num_index + 1) * sizeof *tape->nodes);
+    tape->strings = malloc(length + num_index + 1);
+    if (tape->nodes == NULL || tape->strings == NULL)
+    {
+        free(index);
+        json_tape_free(tape);
+        return -1;
+    }
+
+    memset(&builder, 0x00, sizeof builder);
+    builder.json = (const unsigned char *)json;
+    builder.length = length;
+    builder.index = index;
+    builder.num_index = num_index;
+    builder.tape = tape;
+    builder.string_end = tape->strings;
+
+    /* One value and nothing after it */
+    if (parse_value(&builder, 0) < 0 || builder.pos != num_index)
+    {
+        free(index);
+        json_tape_free(tape);
+        return -1;
+    }
+    tape->strings_size = builder.string_end - tape->strings;
+    free(index);
+    return 0;
+}
+
+/* Nodes and string bytes a json_value tree takes on a tape */
+static bool
+measure_value(json_value *value, int depth, uint32_t *num_nodes, size_t *strings_size)
+{
+    unsigned int i;
+
+    if (depth > JSON_TAPE_MAX_DEPTH)
+        return false;
+    (*num_nodes)++;
+    switch (value->type)
+    {
+    case json_object:
+        for (i = 0; i < value->u.object.length; i++)
+        {
+            (*num_nodes)++;
+            *strings_size += value->u.object.values[i].name_length + 1;
+            if (!measure_value(value->u.object.values[i].value, depth + 1, num_nodes, strings_size))
+                return false;
+        }
+        break;
+    case json_array:
+        for (i = 0; i < value->u.array.length; i++)
+        {
+            if (!measure_value(value->u.array.values[i], depth + 1, num_nodes, strings_size))
+                return false;
+        }
+        break;
+    case json_string:
+        *strings_size += value->u.string.length + 1;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+static void
+add_tape_string(json_tape *tape, uint32_t source_offset, const char *str, uint32_t length)
+{
+    json_tape_node *node = &tape->nodes[tape->num_nodes++];
+
+    memset(node, 0x00, sizeof *node);
+    node->type = json_string;
+    node->length = length;
+    node->source_offset = source_offset;
+    node->u.string_offset = tape->strings_size;
+    memcpy(tape->strings + tape->strings_size, str, length);
+    tape->strings[tape->strings_size + length] = '\0';
+    tape->strings_size += length + 1;
+    node->next = tape->num_nodes;
+}
+
+/*
+ * Write a json_value tree on a tape measured for it, the line index of the
+ * tape turns its positions back into offsets. The tree has no position for
+ * the keys of an object, they get the one of their value.
+ */
+static void
+flatten_value(json_tape *tape, json_value *value)
+{
+    uint32_t node_index = tape->num_nodes;
+    uint32_t source_offset = 0;
+    json_tape_node *node;
+    unsigned int i;
+
+    if (value->line >= 1 && value->line <= tape->num_lines && value->col >= 1)
+        source_offset = tape->line_starts[value->line - 1] + value->col - 1;
+    if (value->type == json_string)
+    {
+        add_tape_string(tape, source_offset, value->u.string.ptr, value->u.string.length);
+        return;
+    }
+
+    node = &tape->nodes[tape->num_nodes++];
+    memset(node, 0x00, sizeof *node);
+    node->type = value->type;
+    node->source_offset = source_offset;
+    switch (value->type)
+    {
+    case json_object:
+        node->length = value->u.object.length;
+        for (i = 0; i < value->u.object.length; i++)
+        {
+            json_object_entry *entry = &value->u.object.values[i];
+            uint32_t key_offset = 0;
+
+            if (entry->value->line >= 1 && entry->value->line <= tape->num_lines && entry->value->col >= 1)
+                key_offset = tape->line_starts[entry->value->line - 1] + entry->value->col - 1;
+            add_tape_string(tape, key_offset, entry->name, entry->name_length);
+            flatten_value(tape, entry->value);
+        }
+        break;
+    case json_array:
+        node->length = value->u.array.length;
+        for (i = 0; i < value->u.array.length; i++)
+            flatten_value(tape, value->u.array.values[i]);
+        break;
+    case json_integer:
+        node->u.integer = value->u.integer;
+        break;
+    case json_double:
+        node->u.dbl = value->u.dbl;
+        break;
+    case json_boolean:
+        node->u.boolean = value->u.boolean;
+        break;
+    default:
+        break;
+    }
+    tape->nodes[node_index].next = tape->num_nodes;
+}
+
+int
+json_tape_parse_ex(json_tape *tape, const json_char *json, size_t length, char *error)
+{
+    json_settings settings;
+    json_value *value;
+    uint32_t num_nodes = 0;
+    size_t strings_size = 0;
+
+    if (json_tape_parse(tape, json, length) == 0)
+        return 0;
+    if (length >= UINT32_MAX)
+    {
+        snprintf(error, json_error_max, "document larger than 4GB");
+        return -1;
+    }
+
+    /*
+     * The scalar parser knows what is wrong with the document. It also takes
+     * what the fast path is too strict for, trailing commas, unknown escapes
+     * and control characters in strings, and its tree then goes on the tape.
+     */
+    memset(&settings, 0x00, sizeof settings);
+    error[0] = '\0';
+    value = json_parse_ex(&settings, json, length, error);
+    if (value == NULL)
+    {
+        if (error[0] == '\0')
+            snprintf(error, json_error_max, "out of memory");
+        return -1;
+    }
+    if (!measure_value(value, 0, &num_nodes, &strings_size))
+    {
+        json_value_free(value);
+        snprintf(error, json_error_max, "document nested deeper than %d levels", JSON_TAPE_MAX_DEPTH);
+        return -1;
+    }
+
+    tape->nodes = malloc((size_t)num_nodes * sizeof *tape->nodes);
+    tape->strings = malloc(strings_size + 1);
+    if (tape->nodes == NULL || tape->strings == NULL || json_tape_index_lines(tape, json, length) != 0)
+    {
+        json_value_free(value);
+        json_tape_free(tape);
+        snprintf(error, json_error_max, "out of memory");
+        return -1;
+    }
+    flatten_value(tape, value);
+    json_value_free(value);
+    return 0;
+}
+
+int
+json_tape_index_lines(json_tape *tape, const json_char *json, size_t length)
+{
+    const json_char *ptr;
+    const json_char *end;
+    uint32_t num_lines = 1;
+
+    skip_bom(&json, &length);
+    end = json + length;
+    for (ptr = json; (ptr = memchr(ptr, '\n', end - ptr)) != NULL; ptr++)
+        num_lines++;
+
+    free(tape->line_starts);
+    tape->line_starts = malloc(num_lines * sizeof *tape->line_starts);
+    if (tape->line_starts == NULL)
+    {
+        tape->num_lines = 0;
+        return -1;
+    }
+    tape->line_starts[0] = 0;
+    tape->num_lines = 1;
+    for (ptr = json; (ptr = memchr(ptr, '\n', end - ptr)) != NULL; ptr++)
+        tape->line_starts[tape->num_lines++] = (uint32_t)(ptr + 1 - json);
+    return 0;
+}
+
+void
+json_tape_free(json_tape *tape)
+{
+    free(tape->nodes);
+    free(tape->strings);
+    free(tape->line_starts);
+    memset(tape, 0x00, sizeof *tape);
+}
+
+/*
+ * Allocate a json_value the way json_parse_ex() lays it out, so the tree
+ * can be released with json_value_free_ex() like any other.
+ */
+static json_value *
+build_value(json_tape *tape, uint32_t node_index, json_value *parent,
+            json_settings *settings, bool *failed)
+{
+    json_tape_node *node = &tape->nodes[node_index];
+    json_value *value;
+    uint32_t i, child;
+
+    value = settings->mem_alloc(sizeof(json_value) + settings->value_extra, 1, settings->user_data);
+    if (value == NULL)
+    {
+        *failed = true;
+        return NULL;
+    }
+    value->parent = parent;
+    value->type = node->type;
+#ifdef JSON_TRACK_SOURCE
+    /* the caller fills in the source position, it needs the input text */
+    value->line = node->source_offset;
+#endif
+
+    switch (node->type)
+    {
+    case json_object:
+    {
+        size_t names_size = 0;
+        char *names;
+
+        if (node->length == 0)
+            break;
+        for (i = 0, child = node_index + 1; i < node->length; i++)
+        {
+            names_size += tape->nodes[child].length + 1;
+            child = tape->nodes[child + 1].next;
+        }
+        value->u.object.values = settings->mem_alloc(node->length * sizeof(json_object_entry) + names_size,
+                                                     0, settings->user_data);
+        if (value->u.object.values == NULL)
+        {
+            *failed = true;
+            return value;
+        }
+        names = (char *)(value->u.object.values + node->length);
+        for (i = 0, child = node_index + 1; i < node->length; i++)
+        {
+            json_tape_node *key = &tape->nodes[child];
+            json_object_entry *entry = &value->u.object.values[i];
+
+            memcpy(names, tape->strings + key->u.string_offset, key->length + 1);
+            entry->name = names;
+            entry->name_length = key->length;
+            names += key->length + 1;
+            entry->value = build_value(tape, child + 1, value, settings, failed);
+            value->u.object.length = i + 1;
+            if (*failed)
+                return value;
+            child = tape->nodes[child + 1].next;
+        }
+        break;
+    }
+
+    case json_array:
+        if (node->length == 0)
+            break;
+        value->u.array.values = settings->mem_alloc(node->length * sizeof(json_value *), 0, settings->user_data);
+        if (value->u.array.values == NULL)
+        {
+            *failed = true;
+            return value;
+        }
+        for (i = 0, child = node_index + 1; i < node->length; i++)
+        {
+            value->u.array.values[i] = build_value(tape, child, value, settings, failed);
+            value->u.array.length = i + 1;
+            if (*failed)
+                return value;
+            child = tape->nodes[child].next;
+        }
+        break;
+
+    case json_string:
+        value->u.string.ptr = settings->mem_alloc(node->length + 1, 0, settings->user_data);
+        if (value->u.string.ptr == NULL)
+        {
+            value->type = json_null;
+            *failed = true;
+            return value;
+        }
+        memcpy(value->u.string.ptr, tape->strings + node->u.string_offset, node->length + 1);
+        value->u.string.length = node->length;
+        break;
+
+    case json_integer:
+        value->u.integer = node->u.integer;
+        break;
+
+    case json_double:
+        value->u.dbl = node->u.dbl;
+        break;
+
+    case json_boolean:
+        value->u.boolean = node->u.boolean;
+        break;
+
+    default:
+        break;
+    }
+    return value;
+}
+
+#ifdef JSON_TRACK_SOURCE
+/* Turn the source offsets stashed in line into line and column numbers */
+static void
+set_source_positions(json_value *value, const json_char *json, size_t *offset,
+                     unsigned int *line, unsigned int *line_start)
+{
+    unsigned int i;
+    size_t target = value->line;
+
+    while (*offset < target)
+    {
+        if (json[(*offset)++] == '\n')
+        {
+            (*line)++;
+            *line_start = *offset;
+        }
+    }
+    value->line = *line;
+    value->col = (unsigned int)(target - *line_start) + 1;
+
+    if (value->type == json_object)
+    {
+        for (i = 0; i < value->u.object.length; i++)
+            set_source_positions(value->u.object.values[i].value, json, offset, line, line_start);
+    }
+    else if (value->type == json_array)
+    {
+        for (i = 0; i < value->u.array.length; i++)
+            set_source_positions(value->u.array.values[i], json, offset, line, line_start);
+    }
+}
+#endif
+
+static void *
+scan_default_alloc(size_t size, int zero, void *user_data)
+{
+    (void)user_data;
+    return zero ? calloc(1, size) : malloc(size);
+}
+
+static void
+scan_default_free(void *ptr, void *user_data)
+{
+    (void)user_data;
+    free(ptr);
+}
+
+json_value *
+json_tape_to_value(json_tape *tape, json_settings *settings, const json_char *json)
+{
+    json_settings local_settings;
+    json_value *root;
+    bool failed = false;
+
+    memcpy(&local_settings, settings, sizeof local_settings);
+    if (!local_settings.mem_alloc)
+        local_settings.mem_alloc = scan_default_alloc;
+    if (!local_settings.mem_free)
+        local_settings.mem_free = scan_default_free;
+
+    if (tape->num_nodes == 0)
+        return NULL;
+    root = build_value(tape, 0, NULL, &local_settings, &failed);
+    if (failed)
+    {
+        if (root)
+            json_value_free_ex(&local_settings, root);
+        return NULL;
+    }
+#ifdef JSON_TRACK_SOURCE
+    {
+        size_t offset = 0;
+        unsigned int line = 1;
+        unsigned int line_start = 0;
+
+        /* offsets are relative to the input after an optional BOM */
+        if ((unsigned char)json[0] == 0xEF && (unsigned char)json[1] == 0xBB && (unsigned char)json[2] == 0xBF)
+            json += 3;
+        set_source_positions(root, json, &offset, &line, &line_start);
+    }
+#else
+    (void)json;
+#endif
+    return root;
+}
+
+json_value *
+json_parse_fast(json_settings *settings, const json_char *json, size_t length, char *error)
+{
+    json_tape tape;
+    json_value *value = NULL;
+
+    /* Comments are only understood by the scalar parser */
+    if (!(settings->settings & json_enable_comments) && json_tape_parse(&tape, json, length) == 0)
+    {
+        value = json_tape_to_value(&tape, settings, json);
+        json_tape_free(&tape);
+        if (value)
+            return value;
+    }
+    return json_parse_ex(settings, json, length, error);
+}
+
+bool
+json_tape_root(const json_tape *tape, json_cursor *root)
+{
+    root->tape = tape;
+    root->node = 0;
+    return tape->num_nodes > 0;
+}
+
+const json_tape_node *
+json_cursor_node(const json_cursor *cursor)
+{
+    return &cursor->tape->nodes[cursor->node];
+}
+
+json_type
+json_cursor_type(const json_cursor *cursor)
+{
+    return cursor->tape->nodes[cursor->node].type;
+}
+
+bool
+json_cursor_child(const json_cursor *container, json_cursor *child)
+{
+    const json_tape_node *node = &container->tape->nodes[container->node];
+
+    if ((node->type != json_object && node->type != json_array) || node->length == 0)
+        return false;
+    child->tape = container->tape;
+    child->node = container->node + 1;
+    return true;
+}
+
+void
+json_cursor_next(json_cursor *cursor)
+{
+    cursor->node = cursor->tape->nodes[cursor->node].next;
+}
+
+const char *
+json_cursor_string(const json_cursor *cursor)
+{
+    const json_tape_node *node = &cursor->tape->nodes[cursor->node];
+
+    if (node->type != json_string)
+        return NULL;
+    return cursor->tape->strings + node->u.string_offset;
+}
+
+bool
+json_cursor_number(const json_cursor *cursor, double *number)
+{
+    const json_tape_node *node = &cursor->tape->nodes[cursor->node];
+
+    if (node->type == json_integer)
+        *number = (double)node->u.integer;
+    else if (node->type == json_double)
+        *number = node->u.dbl;
+    else
+        return false;
+    return true;
+}
+
+bool
+json_cursor_position(const json_cursor *cursor, unsigned int *line, unsigned int *col)
+{
+    const json_tape *tape = cursor->tape;
+    uint32_t offset = tape->nodes[cursor->node].source_offset;
+    uint32_t low = 0;
+    uint32_t high = tape->num_lines;
+
+    if (tape->num_lines == 0)
+        return false;
+    /* the last line starting at or before the value */
+    while (high - low > 1)
+    {
+        uint32_t middle = low + (high - low) / 2;
+
+        if (tape->line_starts[middle] <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    *line = low + 1;
+    *col = offset - tape->line_starts[low] + 1;
+    return true;
+}
+
+bool
+json_cursor_get(const json_cursor *object, const char *key, json_cursor *value)
+{
+    json_cursor member;
+    uint32_t i;
+
+    if (json_cursor_type(object) != json_object || !json_cursor_child(object, &member))
+        return false;
+    for (i = 0; i < json_cursor_node(object)->length; i++)
+    {
+        bool found = strcasecmp(json_cursor_string(&member), key) == 0;
+
+        json_cursor_next(&member);
+        if (found)
+        {
+            *value = member;
+            return true;
+        }
+        json_cursor_next(&member);
+    }
+    return false;
+}
+
+const char *
+json_cursor_get_string(const json_cursor *object, const char *key)
+{
+    json_cursor value;
+
+    if (!json_cursor_get(object, key, &value))
+        return NULL;
+    return json_cursor_string(&value);
+}
+
+int
+json_cursor_get_long(const json_cursor *object, const char *key, long *value)
+{
+    json_cursor member;
+
+    if (!json_cursor_get(object, key, &member) || json_cursor_type(&member) != json_integer)
+        return -1;
+    *value = json_cursor_node(&member)->u.integer;
+    return 0;
+}
+
+int
+json_cursor_get_number(const json_cursor *object, const char *key, double *value)
+{
+    json_cursor member;
+
+    if (!json_cursor_get(object, key, &member) || !json_cursor_number(&member, value))
+        return -1;
+    return 0;
+}
+
+/* Integers are taken as booleans too, like json_get_bool_value_for_key() */
+int
+json_cursor_get_bool(const json_cursor *object, const char *key, bool *value)
+{
+    json_cursor member;
+    const json_tape_node *node;
+
+    if (!json_cursor_get(object, key, &member))
+        return -1;
+    node = json_cursor_node(&member);
+    if (node->type == json_boolean)
+        *value = node->u.boolean ? true : false;
+    else if (node->type == json_integer)
+        *value = node->u.integer ? true : false;
+    else
+        return -1;
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_arena.c
+ *		Bump allocator for memory that is released all at once.
+ *
+ * Allocations are carved out of large blocks and are never freed one by
+ * one, pg_arena_destroy() releases everything. Block sizes double up to
+ * ARENA_MAX_BLOCK_SIZE, requests larger than that get a block of their own.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "pg_arena.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_ALIGN_UP(len) (((len) + (ARENA_ALIGN - 1)) & ~((size_t)(ARENA_ALIGN - 1)))
+
+struct pg_arena_block
+{
+    PGArenaBlock *next;
+    size_t size;
+    size_t used;
+    /* data follows, aligned to ARENA_ALIGN */
+};
+
+#define BLOCK_HEADER_SIZE ARENA_ALIGN_UP(sizeof(PGArenaBlock))
+#define BLOCK_DATA(block) ((char *)(block) + BLOCK_HEADER_SIZE)
+
+static PGArenaBlock *
+new_block(size_t size)
+{
+    PGArenaBlock *block = malloc(BLOCK_HEADER_SIZE + size);
+
+    if (block == NULL)
+        return NULL;
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+PGArena *
+pg_arena_create(size_t initial_size)
+{
+    PGArena *arena = calloc(1, sizeof *arena);
+
+    if (arena == NULL)
+    {
+        perror("Not possible to allocate memory for the arena");
+        return NULL;
+    }
+    if (initial_size < ARENA_MIN_BLOCK_SIZE)
+        initial_size = ARENA_MIN_BLOCK_SIZE;
+    if (initial_size > ARENA_MAX_BLOCK_SIZE)
+        initial_size = ARENA_MAX_BLOCK_SIZE;
+    arena->next_block_size = initial_size;
+    return arena;
+}
+
+void *
+pg_arena_alloc(PGArena *arena, size_t size)
+{
+    PGArenaBlock *block = arena->blocks;
+    void *ptr;
+
+    size = ARENA_ALIGN_UP(size ? size : 1);
+    if (block == NULL || block->size - block->used < size)
+    {
+        if (size > arena->next_block_size / 2)
+        {
+            /* Too big to share a block, keep the current block in front */
+            block = new_block(size);
+            if (block == NULL)
+                return NULL;
+            block->used = size;
+            if (arena->blocks)
+            {
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+            }
+            else
+                arena->blocks = block;
+            arena->allocated += size;
+            return BLOCK_DATA(block);
+        }
+
+        block = new_block(arena->next_block_size);
+        if (block == NULL)
+            return NULL;
+        block->next = arena->blocks;
+        arena->blocks = block;
+        if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE)
+            arena->next_block_size *= 2;
+    }
+    ptr = BLOCK_DATA(block) + block->used;
+    block->used += size;
+    arena->allocated += size;
+    return ptr;
+}
+
+void *
+pg_arena_calloc(PGArena *arena, size_t size)
+{
+    void *ptr = pg_arena_alloc(arena, size);
+
+    if (ptr)
+        memset(ptr, 0x00, size);
+    return ptr;
+}
+
+char *
+pg_arena_strndup(PGArena *arena, const char *str, size_t len)
+{
+    char *copy;
+
+    if (str == NULL)
+        return NULL;
+    copy = pg_arena_alloc(arena, len + 1);
+    if (copy)
+    {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+char *
+pg_arena_strdup(PGArena *arena, const char *str)
+{
+    return str ? pg_arena_strndup(arena, str, strlen(str)) : NULL;
+}
+
+char *
+pg_arena_sprintf(PGArena *arena, const char *fmt, ...)
+{
+    va_list args;
+    char *str;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (len < 0)
+        return NULL;
+
+    str = pg_arena_alloc(arena, len + 1);
+    if (str == NULL)
+        return NULL;
+    va_start(args, fmt);
+    vsnprintf(str, len + 1, fmt, args);
+    va_end(args);
+    return str;
+}
+
+/*
+ * Release everything allocated so far but keep the current block around,
+ * so an arena reused for one item after another settles on a single block.
+ */
+void
+pg_arena_reset(PGArena *arena)
+{
+    PGArenaBlock *block;
+
+    if (arena == NULL || arena->blocks == NULL)
+        return;
+    block = arena->blocks->next;
+    while (block)
+    {
+        PGArenaBlock *next = block->next;
+
+        free(block);
+        block = next;
+    }
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+    arena->allocated = 0;
+}
+
+void
+pg_arena_destroy(PGArena *arena)
+{
+    PGArenaBlock *block;
+
+    if (arena == NULL)
+        return;
+    block = arena->blocks;
+    while (block)
+    {
+        PGArenaBlock *next = block->next;
+
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void *
+pg_arena_json_alloc(size_t size, int zero, void *user_data)
+{
+    PGArena *arena = user_data;
+
+    return zero ? pg_arena_calloc(arena, size) : pg_arena_alloc(arena, size);
+}
+
+void
+pg_arena_json_free(void *ptr, void *user_data)
+{
+    /* released with the arena */
+    (void)ptr;
+    (void)user_data;
+}
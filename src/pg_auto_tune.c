@@ -18,57 +18,106 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <sys/sysinfo.h>
-#include <sys/time.h>
 #include <errno.h>
 #include <getopt.h>
-#include <fcntl.h>
+#include <ctype.h>
+#include <limits.h>
+#include <signal.h>
 
-#include "pg_auto_tune.h"
+#include "pgautotune.h"
 #include "pg_config_map.h"
+#include "pg_profile_image.h"
+#include "pg_batch.h"
+#include "pg_watch.h"
+#include "pg_simulate.h"
+#include "pg_sizing.h"
+#include "pg_stats_snapshot.h"
+#include "pg_log_analyzer.h"
+#include "pg_buffer_sim.h"
+#include "pg_cache_residency.h"
+#include "pg_data_dir.h"
+#include "pg_heap_scan.h"
+#include "pg_control.h"
+#include "pg_xid_rate.h"
+#include "pg_wal_stream.h"
+#include "pg_compression.h"
+#include "pg_cost_calibration.h"
+#include "pg_memory_knee.h"
+#include "pg_memory_bandwidth.h"
+
+/* Command line options, the tuning itself keeps its state in a pgat_context */
+typedef struct cli_options
+{
+    bool verbose;
+    bool force_profile;
+    char *data_dir;
+    char *map_file;
+    char *output_file_path;
+    char *compile_profile_path;
+    char *batch_inventory_path;
+    BATCH_FORMAT batch_format;
+    int batch_workers;
+    bool watch;
+    bool reload;
+    int watch_interval;
+    char *pg_ctl;
+    SimulateOptions simulate;
+    bool simulate_requested;
+    SizingOptions sizing;
+    bool sizing_requested;
+    bool all_workloads;
+    bool workload_given;
+    const char *stats_snapshots[MAX_STATS_SNAPSHOTS];
+    int num_stats_snapshots;
+    bool analyze_logs;
+    char *log_path;
+    bool analyze_wal;
+    char *wal_dir;
+    const char *buffer_traces[MAX_BUFFER_TRACES];
+    int num_buffer_traces;
+    bool cache_residency;
+    char *prewarm_list_path;
+    bool heap_scan;
+    char *table_settings_path;
+    bool xid_rate;
+    char *xid_history_path;
+    int xid_window;
+    bool compression;
+    bool calibrate_costs;
+    bool memory_knee;
+    bool memory_bandwidth;
+} CliOptions;
+
+static const char *progname = "pg_auto_tune";
+static const char *description = "Auto tuning for PostgreSQL by Percona";
+static const char *package = "Percona";
+static const char *version = "1.0";
+static const char *output_conf_file = "per_postgresql.conf";
+// static const char *map_file_name = "ConfigParams.map";
+static const char *map_file_name = "ConfigMap.json";
+
+static volatile sig_atomic_t stop_watching = 0;
 
-#define MAX_FILE_PATH_SIZE 1024
-
-/* globalse */
-int verbose_output = 0;
-bool force_invalid_profile = false;
-char *data_dir = NULL;
-char *map_file = NULL;
-char *output_file_path = NULL;
-const char *progname = "pg_auto_tune";
-const char *description = "Auto tuning for PostgreSQL by Percona";
-const char *package = "Percona";
-const char *version = "1.0";
-const char *speed_test_file = "base/1/1255";
-const char *output_conf_file = "per_postgresql.conf";
-// const char *map_file_name = "ConfigParams.map";
-const char *map_file_name = "ConfigMap.json";
-
-static long long get_ram_size(void);
-static int get_CPU_count(void);
-static double get_disk_speed(const char *filePath);
 static void usage(void);
-static void validate_map_profile(PGMapProfileDetails* profile, SystemInfo *system_info, bool force);
-static void validate_system_inof(SystemInfo *system_info);
+static void handle_stop_signal(int signo);
+static void print_log_message(PGAT_LOG_LEVEL level, const char *message, void *arg);
+static void print_map_profile(PGMapProfileDetails* profile);
+static void print_system_info(SystemInfo *system_info);
+static void use_classification(CliOptions *options, SystemInfo *system_info, WorkloadClassification *classification);
+static void workload_output_path(const char *output_path, WORKLOAD_TYPE workload, char *path, size_t len);
 int main(int argc, char **argv)
 {
     int ch;
     int optindex;
-    char test_file_path[MAX_FILE_PATH_SIZE];
-    char pgconf_file_path[MAX_FILE_PATH_SIZE];
-    const char *allowed_options = "h:n:d:w:D:m:o:vVF";
-    PGConfig *pg_config;
-    PGConfigMap config_map;
-    PGMapProfileDetails map_profile;
-
-    SystemInfo system_info = {
-        .total_ram = -1,
-        .cpu_count = -1,
-        .disk_speed = -1,
-        .host_type = UNKNOWN_HOST,
-        .node_type = UNKNOWN_NT,
-        .disk_type = UNKNOWN_DT,
-        .workload_type = MIXED};
+    const char *allowed_options = "h:n:d:w:D:m:o:C:B:b:j:i:P:S:f:Z:T:L::G::M:RA:HQ:X:x:ckKevVFWr";
+    CliOptions options = {
+        .batch_format = BATCH_JSON,
+        .watch_interval = DEFAULT_WATCH_INTERVAL};
+    pgat_context *ctx;
+    SystemInfo *system_info;
+    WorkloadClassification classification = {0};
+    const char *map_file;
+
     static struct option long_options[] = {
         {"help", no_argument, NULL, '?'},
         {"version", no_argument, NULL, 'V'},
@@ -81,6 +130,31 @@ int main(int argc, char **argv)
         {"data-dir", required_argument, NULL, 'D'},
         {"map-file", required_argument, NULL, 'm'},
         {"out-file", required_argument, NULL, 'o'},
+        {"compile-profile", required_argument, NULL, 'C'},
+        {"batch", required_argument, NULL, 'B'},
+        {"batch-format", required_argument, NULL, 'b'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"watch", no_argument, NULL, 'W'},
+        {"interval", required_argument, NULL, 'i'},
+        {"reload", no_argument, NULL, 'r'},
+        {"pg-ctl", required_argument, NULL, 'P'},
+        {"simulate", required_argument, NULL, 'S'},
+        {"format", required_argument, NULL, 'f'},
+        {"size-for", required_argument, NULL, 'Z'},
+        {"stats-snapshot", required_argument, NULL, 'T'},
+        {"logs", optional_argument, NULL, 'L'},
+        {"wal", optional_argument, NULL, 'G'},
+        {"buffer-trace", required_argument, NULL, 'M'},
+        {"cache-residency", no_argument, NULL, 'R'},
+        {"prewarm-list", required_argument, NULL, 'A'},
+        {"heap-scan", no_argument, NULL, 'H'},
+        {"table-settings", required_argument, NULL, 'Q'},
+        {"xid-history", required_argument, NULL, 'X'},
+        {"xid-window", required_argument, NULL, 'x'},
+        {"compression", no_argument, NULL, 'c'},
+        {"calibrate-costs", no_argument, NULL, 'k'},
+        {"memory-knee", no_argument, NULL, 'K'},
+        {"memory-bandwidth", no_argument, NULL, 'e'},
         {NULL, 0, NULL, 0}};
 
     if (argc > 1)
@@ -97,18 +171,22 @@ int main(int argc, char **argv)
         }
     }
 
+    ctx = pgat_create();
+    if (ctx == NULL)
+    {
+        perror("Not possible to allocate memory for the tuning context");
+        exit(1);
+    }
+    pgat_set_log_hook(ctx, print_log_message, &options.verbose);
+    system_info = pgat_get_system_info(ctx);
+
     while ((ch = getopt_long(argc, argv, allowed_options, long_options, &optindex)) != -1)
     {
         switch (ch)
         {
         case 'h': /*Host type*/
-            if (strcmp(optarg, "p") == 0 || strcasecmp(optarg, "pod") == 0)
-                system_info.host_type = POD;
-            else if (strcmp(optarg, "s") == 0 || strcasecmp(optarg, "standard") == 0)
-                system_info.host_type = STANDARD;
-            else if (strcmp(optarg, "c") == 0 || strcasecmp(optarg, "cloud") == 0)
-                system_info.host_type = CLOUD;
-            else
+            system_info->host_type = identify_host_type(optarg);
+            if (system_info->host_type == UNKNOWN_HOST)
             {
                 fprintf(stderr, "%s: Invalid host type \"%s\", must be either \"pod\", \"standard\" or \"cloud\" \n", progname, optarg);
                 exit(1);
@@ -116,11 +194,8 @@ int main(int argc, char **argv)
             break;
 
         case 'n': /*Node type*/
-            if (strcmp(optarg, "p") == 0 || strcasecmp(optarg, "primary") == 0)
-                system_info.node_type = PRIMARY;
-            else if (strcmp(optarg, "s") == 0 || strcasecmp(optarg, "standby") == 0)
-                system_info.node_type = STANDBY;
-            else
+            system_info->node_type = identify_node_type(optarg);
+            if (system_info->node_type == UNKNOWN_NT)
             {
                 fprintf(stderr, "%s: Invalid node type \"%s\", must be either \"primary\" or \"standby\" \n", progname, optarg);
                 exit(1);
@@ -128,13 +203,8 @@ int main(int argc, char **argv)
             break;
 
         case 'd': /*Disk type*/
-            if (strcmp(optarg, "m") == 0 || strcasecmp(optarg, "magnetic") == 0)
-                system_info.disk_type = MAGNETIC;
-            else if (strcmp(optarg, "s") == 0 || strcasecmp(optarg, "ssd") == 0)
-                system_info.disk_type = SSD;
-            else if (strcmp(optarg, "n") == 0 || strcasecmp(optarg, "network") == 0)
-                system_info.disk_type = NETWORK;
-            else
+            system_info->disk_type = identify_disk_type(optarg);
+            if (system_info->disk_type == UNKNOWN_DT)
             {
                 fprintf(stderr, "%s: Invalid disk type \"%s\", must be either \"magnetic\", \"network\" or \"ssd\" \n", progname, optarg);
                 exit(1);
@@ -142,38 +212,210 @@ int main(int argc, char **argv)
             break;
 
         case 'w': /*Workload */
-            if (strcmp(optarg, "l") == 0 || strcasecmp(optarg, "olap") == 0)
-                system_info.workload_type = OLAP;
-            else if (strcmp(optarg, "t") == 0 || strcasecmp(optarg, "oltp") == 0)
-                system_info.workload_type = OLTP;
-            else if (strcmp(optarg, "m") == 0 || strcasecmp(optarg, "mixed") == 0)
-                system_info.workload_type = MIXED;
-            else
+            options.workload_given = true;
+            if (strcasecmp(optarg, "all") == 0)
+            {
+                options.all_workloads = true;
+                break;
+            }
+            if (strchr(optarg, '='))
+            {
+                if (pgat_set_workload_blend(ctx, optarg) != PGAT_OK)
+                {
+                    fprintf(stderr, "%s: Invalid workload blend \"%s\", must be a list of weights like \"oltp=0.7,olap=0.3\" \n", progname, optarg);
+                    exit(1);
+                }
+                break;
+            }
+            if (identify_workload_type(optarg) == UNKNOWN_WL)
             {
-                fprintf(stderr, "%s: Invalid workload type \"%s\", must be either \"olap\", \"oltp\" or \"mixed\" \n", progname, optarg);
+                fprintf(stderr, "%s: Invalid workload type \"%s\", must be either \"olap\", \"oltp\", \"mixed\" or \"all\" \n", progname, optarg);
                 exit(1);
             }
+            pgat_set_workload_type(ctx, identify_workload_type(optarg));
             break;
 
         case 'v':
-            verbose_output = 1;
+            options.verbose = true;
             break;
 
         case 'm':
-            map_file = strdup(optarg);
+            options.map_file = strdup(optarg);
             break;
 
         case 'o':
-            output_file_path = strdup(optarg);
+            options.output_file_path = strdup(optarg);
             break;
 
         case 'D':
-            data_dir = strdup(optarg);
+            options.data_dir = strdup(optarg);
             break;
 
         case 'F':
-            force_invalid_profile = true;
+            options.force_profile = true;
+            break;
+
+        case 'C':
+            options.compile_profile_path = strdup(optarg);
+            break;
+
+        case 'B':
+            options.batch_inventory_path = strdup(optarg);
+            break;
+
+        case 'b':
+            if (strcasecmp(optarg, "json") == 0)
+                options.batch_format = BATCH_JSON;
+            else if (strcasecmp(optarg, "conf") == 0)
+                options.batch_format = BATCH_CONF;
+            else
+            {
+                fprintf(stderr, "%s: Invalid batch format \"%s\", must be either \"json\" or \"conf\" \n", progname, optarg);
+                exit(1);
+            }
+            break;
+
+        case 'j':
+            options.batch_workers = atoi(optarg);
+            if (options.batch_workers <= 0)
+            {
+                fprintf(stderr, "%s: Invalid number of jobs \"%s\"\n", progname, optarg);
+                exit(1);
+            }
+            break;
+
+        case 'W':
+            options.watch = true;
+            break;
+
+        case 'i':
+            options.watch_interval = atoi(optarg);
+            if (options.watch_interval <= 0)
+            {
+                fprintf(stderr, "%s: Invalid watch interval \"%s\"\n", progname, optarg);
+                exit(1);
+            }
+            break;
+
+        case 'r':
+            options.reload = true;
+            break;
+
+        case 'P':
+            options.pg_ctl = strdup(optarg);
+            break;
+
+        case 'S':
+            options.simulate_requested = true;
+            if (options.simulate.num_dimensions >= MAX_SIMULATE_DIMENSIONS)
+            {
+                fprintf(stderr, "%s: too many simulation dimensions\n", progname);
+                exit(1);
+            }
+            options.simulate.dimensions[options.simulate.num_dimensions++] = optarg;
+            break;
+
+        case 'Z':
+            options.sizing_requested = true;
+            if (options.sizing.num_targets >= MAX_SIZING_TARGETS)
+            {
+                fprintf(stderr, "%s: too many sizing targets\n", progname);
+                exit(1);
+            }
+            options.sizing.targets[options.sizing.num_targets++] = optarg;
+            break;
+
+        case 'T':
+            if (options.num_stats_snapshots >= MAX_STATS_SNAPSHOTS)
+            {
+                fprintf(stderr, "%s: too many statistics snapshots\n", progname);
+                exit(1);
+            }
+            options.stats_snapshots[options.num_stats_snapshots++] = optarg;
+            break;
+
+        case 'L':
+            options.analyze_logs = true;
+            if (optarg)
+                options.log_path = strdup(optarg);
+            break;
+
+        case 'G':
+            options.analyze_wal = true;
+            if (optarg)
+                options.wal_dir = strdup(optarg);
+            break;
+
+        case 'M':
+            if (options.num_buffer_traces >= MAX_BUFFER_TRACES)
+            {
+                fprintf(stderr, "%s: too many buffer traces\n", progname);
+                exit(1);
+            }
+            options.buffer_traces[options.num_buffer_traces++] = optarg;
+            break;
+
+        case 'R':
+            options.cache_residency = true;
+            break;
+
+        case 'A':
+            options.cache_residency = true;
+            options.prewarm_list_path = strdup(optarg);
+            break;
+
+        case 'H':
+            options.heap_scan = true;
+            break;
+
+        case 'Q':
+            options.heap_scan = true;
+            options.table_settings_path = strdup(optarg);
+            break;
+
+        case 'X':
+            options.xid_rate = true;
+            options.xid_history_path = strdup(optarg);
+            break;
+
+        case 'x':
+            options.xid_rate = true;
+            options.xid_window = atoi(optarg);
+            if (options.xid_window <= 0)
+            {
+                fprintf(stderr, "%s: Invalid sampling window \"%s\"\n", progname, optarg);
+                exit(1);
+            }
+            break;
+
+        case 'c':
+            options.compression = true;
+            break;
+
+        case 'k':
+            options.calibrate_costs = true;
+            break;
+
+        case 'K':
+            options.memory_knee = true;
+            break;
+
+        case 'e':
+            options.memory_bandwidth = true;
+            break;
+
+        case 'f':
+            if (strcasecmp(optarg, "table") == 0)
+                options.simulate.format = SIMULATE_TABLE;
+            else if (strcasecmp(optarg, "csv") == 0)
+                options.simulate.format = SIMULATE_CSV;
+            else
+            {
+                fprintf(stderr, "%s: Invalid format \"%s\", must be either \"table\" or \"csv\" \n", progname, optarg);
+                exit(1);
+            }
             break;
+
         case '?':
         default:
 
@@ -189,9 +431,29 @@ int main(int argc, char **argv)
      */
     while (argc - optind >= 1)
     {
-        if (data_dir == NULL)
+        /* the dimensions of a simulation after the first one */
+        if (options.simulate_requested && strchr(argv[optind], '='))
         {
-            data_dir = strdup(argv[optind]);
+            if (options.simulate.num_dimensions >= MAX_SIMULATE_DIMENSIONS)
+            {
+                fprintf(stderr, "%s: too many simulation dimensions\n", progname);
+                exit(1);
+            }
+            options.simulate.dimensions[options.simulate.num_dimensions++] = argv[optind];
+        }
+        /* and the targets of a sizing */
+        else if (options.sizing_requested && strchr(argv[optind], '='))
+        {
+            if (options.sizing.num_targets >= MAX_SIZING_TARGETS)
+            {
+                fprintf(stderr, "%s: too many sizing targets\n", progname);
+                exit(1);
+            }
+            options.sizing.targets[options.sizing.num_targets++] = argv[optind];
+        }
+        else if (options.data_dir == NULL)
+        {
+            options.data_dir = strdup(argv[optind]);
         }
         else
             fprintf(stderr, "%s: Warning: extra command-line argument \"%s\" ignored\n",
@@ -199,230 +461,442 @@ int main(int argc, char **argv)
 
         optind++;
     }
+    map_file = options.map_file ? options.map_file : map_file_name;
+    pgat_set_force_profile(ctx, options.force_profile);
 
-    if (data_dir == NULL)
+    /* Compiling a profile does not need anything from the system */
+    if (options.compile_profile_path)
     {
-        fprintf(stderr, "%s: missing data-dir\n", progname);
-        fprintf(stderr, "Try \"%s --help\" for more information.\n\n", progname);
-        exit(1);
+        if (pgat_load_profile(ctx, map_file) != PGAT_OK)
+        {
+            fprintf(stderr, "%s: %s\n", progname, pgat_error_message(ctx));
+            exit(1);
+        }
+        if (compile_profile_image(pgat_get_config_map(ctx), pgat_get_profile(ctx), options.compile_profile_path) < 0)
+        {
+            fprintf(stderr, "%s: failed to compile profile into \"%s\"\n", progname, options.compile_profile_path);
+            exit(1);
+        }
+        pgat_destroy(ctx);
+        return 0;
     }
 
-    /* Ok, Done with trivial stuff, Get on with the real work */
-    /* First gather all system info that we can */
-
-    system_info.total_ram = get_ram_size();
-    system_info.cpu_count = get_CPU_count();
-
-    snprintf(test_file_path, MAX_FILE_PATH_SIZE, "%s/%s", data_dir, speed_test_file);
-    system_info.disk_speed = get_disk_speed(test_file_path);
-
-    snprintf(pgconf_file_path, MAX_FILE_PATH_SIZE, "%s/%s", data_dir, "postgresql.conf");
-
-    validate_system_inof(&system_info);
-    /* Load configuration parameters from postgresql.conf */
-    pg_config = PGConfig_parse(pgconf_file_path);
-
-    /* Load the map file */
-    if (load_json_config_map(&config_map, &map_profile, &system_info, map_file ? map_file : map_file_name) < 0)
+    /* What the cluster runs is the workload of everything below */
+    if (options.num_stats_snapshots > 0)
     {
-        fprintf(stderr, "%s: failed to load configuration map file\n", progname);
-        return -1;
+        if (!classify_workload(options.stats_snapshots, options.num_stats_snapshots, &classification))
+            exit(1);
+        use_classification(&options, system_info, &classification);
     }
 
-    validate_map_profile(&map_profile, &system_info, force_invalid_profile);
+    /* A simulation makes up its hosts, nothing is probed either */
+    if (options.simulate_requested)
+    {
+        int flagged;
 
-    if (verbose_output)
-        print_config_map(&config_map, &system_info, false);
+        options.simulate.output_path = options.output_file_path;
+        options.simulate.force = options.force_profile;
+        options.simulate.defaults = *system_info;
+        if (pgat_load_profile(ctx, map_file) != PGAT_OK)
+        {
+            fprintf(stderr, "%s: %s\n", progname, pgat_error_message(ctx));
+            exit(1);
+        }
+        flagged = run_simulate(&options.simulate, pgat_get_config_map(ctx), pgat_get_profile(ctx));
+        pgat_destroy(ctx);
+        return flagged < 0 ? 1 : 0;
+    }
 
+    /* Sizing searches for its host */
+    if (options.sizing_requested)
+    {
+        int rc;
 
-    load_pg_config_in_map(&config_map, pg_config);
-    process_config_map(&config_map, &system_info);
+        options.sizing.output_path = options.output_file_path;
+        options.sizing.defaults = *system_info;
+        if (pgat_load_profile(ctx, map_file) != PGAT_OK)
+        {
+            fprintf(stderr, "%s: %s\n", progname, pgat_error_message(ctx));
+            exit(1);
+        }
+        rc = run_sizing(&options.sizing, pgat_get_config_map(ctx), pgat_get_profile(ctx));
+        pgat_destroy(ctx);
+        return rc == 0 ? 0 : 1;
+    }
 
-    print_config_map(&config_map, &system_info, true);
+    /* A batch describes its hosts in the inventory, nothing is read from this one */
+    if (options.batch_inventory_path)
+    {
+        BatchOptions batch_options = {
+            .inventory_path = options.batch_inventory_path,
+            .format = options.batch_format,
+            .num_workers = options.batch_workers,
+            .force = options.force_profile,
+            .defaults = *system_info};
+        int failed;
+
+        if (options.output_file_path)
+            batch_options.output_path = options.output_file_path;
+        else
+            batch_options.output_path = options.batch_format == BATCH_CONF ? "." : DEFAULT_BATCH_OUTPUT;
 
-    /* Enough with gathering info. create a meaningfull config */
-    create_postgresql_conf(output_file_path?output_file_path:output_conf_file,&config_map, &system_info);
-    return 0;
-}
+        if (pgat_load_profile(ctx, map_file) != PGAT_OK)
+        {
+            fprintf(stderr, "%s: %s\n", progname, pgat_error_message(ctx));
+            exit(1);
+        }
+        failed = run_batch(&batch_options, pgat_get_config_map(ctx), pgat_get_profile(ctx));
+        pgat_destroy(ctx);
+        return failed == 0 ? 0 : 1;
+    }
 
-static void
-validate_system_inof(SystemInfo *system_info)
-{
-    if (verbose_output)
+    if (options.data_dir == NULL)
     {
-        printf("\n************** System Info **************\n");
-        printf("WorkLoad type   : %s\n",get_workload_type(system_info->workload_type));
-        printf("Installed RAM   : %lld\n",system_info->total_ram);
-        printf("Installed CPU   : %ld\n",system_info->cpu_count);
-        printf("Disk read speed : %.2f MB/s\n",system_info->disk_speed);
-        printf("**********************************************\n");
+        fprintf(stderr, "%s: missing data-dir\n", progname);
+        fprintf(stderr, "Try \"%s --help\" for more information.\n\n", progname);
+        exit(1);
     }
-    if (system_info->total_ram <= 0)
+
+    /* Ok, Done with trivial stuff, Get on with the real work */
+    /* First gather all system info that we can */
+    if (pgat_probe(ctx, options.data_dir) != PGAT_OK)
     {
-        fprintf(stderr, "ERROR: Failed to get installed RAM size\n");
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
         exit(1);
     }
-    if (system_info->cpu_count <= 0)
+
+    /* Sizes of the data are only needed by profiles that scale with them */
+    if (pgat_scan_data_dir(ctx) != PGAT_OK)
+        fprintf(stderr, "WARNING: %s, the size of the data is not known\n", pgat_error_message(ctx));
+    else if (options.verbose)
+        print_data_dir_shape(pgat_get_data_dir_shape(ctx));
+    if (options.verbose && pgat_get_control_info(ctx))
+        print_control_info(pgat_get_control_info(ctx));
+    if (options.verbose)
+        print_system_info(system_info);
+
+    /* What the server did is evidence for the processors */
+    if (options.analyze_logs)
     {
-        fprintf(stderr, "ERROR: Failed to get installed CPU count from system\n");
-        exit(1);
+        if (pgat_analyze_logs(ctx, options.log_path) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_log_evidence(pgat_get_log_evidence(ctx));
     }
-    if (system_info->disk_speed <= 0)
+
+    /* What the page cache holds is the hot set */
+    if (options.cache_residency)
     {
-        fprintf(stderr, "WARNING: Failed to get installed CPU count from system\n");
+        if (pgat_scan_cache_residency(ctx, options.prewarm_list_path != NULL) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_cache_residency(pgat_get_cache_residency(ctx), RESIDENCY_TOP_RELATIONS);
+        if (options.prewarm_list_path &&
+            !write_autoprewarm_list(pgat_get_cache_residency(ctx), options.prewarm_list_path))
+            exit(1);
     }
-}
 
-static void
-validate_map_profile(PGMapProfileDetails* profile, SystemInfo *system_info, bool force)
-{
-    if (verbose_output)
+    /* What the heap pages hold is the work left for autovacuum */
+    if (options.heap_scan)
     {
-        printf("\n************** Map File Details **************\n");
-        printf("Profile Name             : %s\n",profile->name);
-        printf("Description              : %s\n",profile->description);
-        printf("Profile Version          : %s\n",profile->version);
-        printf("Engine                   : %s\n",profile->engine);
-        printf("Created on               : %s\n",profile->date_created);
-
-        if (profile->max_cpu < 0)
-            printf("Valid for Max CPU(s)     : %s\n","*");
-        else
-            printf("Valid for Max CPU(s)     : %ld\n",profile->max_cpu);
+        if (pgat_scan_heap(ctx) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_heap_scan(pgat_get_heap_scan(ctx), HEAP_TOP_TABLES);
+        if (options.table_settings_path &&
+            !write_table_settings(pgat_get_heap_scan(ctx), options.table_settings_path))
+            exit(1);
+    }
 
-        if (profile->min_cpu < 0)
-            printf("Valid for Min CPU(s)     : %s\n","*");
-        else
-            printf("Valid for Min CPU(s)     : %ld\n",profile->min_cpu);
+    /* What the WAL holds is the write side of the workload */
+    if (options.analyze_wal)
+    {
+        WalStream *stream;
 
-        if (profile->max_memory < 0)
-            printf("Valid for Max Memory of  : %s Bytes\n","*");
-        else
-            printf("Valid for Max Memory of  : %ldBytes\n",profile->max_memory);
+        if (pgat_analyze_wal(ctx, options.wal_dir) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        stream = pgat_get_wal_stream(ctx);
+        print_wal_stream(stream);
+        if (add_wal_features(&classification, stream->bytes_per_commit, stream->commit_rate))
+            use_classification(&options, system_info, &classification);
+    }
 
-        if (profile->min_memory < 0)
-            printf("Valid for Min Memory of  : %s Bytes\n","*");
-        else
-            printf("Valid for Min Memory of  : %ldBytes\n",profile->min_memory);
+    /* How the pages compress against what the CPU and the disk have left */
+    if (options.compression)
+    {
+        if (pgat_benchmark_compression(ctx) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_compression_bench(pgat_get_compression_bench(ctx));
+    }
 
-        printf("**********************************************\n");
+    /* What a page read, a tuple and an operator take on this host are the planner costs */
+    if (options.calibrate_costs)
+    {
+        if (pgat_calibrate_costs(ctx) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_cost_calibration(pgat_get_cost_calibration(ctx));
     }
-    /* Validate CPU count */
-    if (profile->max_cpu <  profile->min_cpu)
+
+    /* Sorts and hash tables slow down once they fall out of the caches */
+    if (options.memory_knee)
     {
-        fprintf(stderr, "WARNING: Invalid CPU bounds for profile. max_cpu (%ld) is less than min_cpu(%ld) count\n",
-                profile->max_cpu, profile->min_cpu);
-        fprintf(stderr, "Ignoring CPU bounds ....\n");
+        if (pgat_find_memory_knee(ctx) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_memory_knee(pgat_get_memory_knee(ctx));
     }
-    else
+
+    /* Parallel scans stop scaling once the memory runs out of bandwidth */
+    if (options.memory_bandwidth)
     {
-        if (profile->max_cpu > 0 && profile->max_cpu < system_info->cpu_count)
+        if (pgat_measure_memory_bandwidth(ctx) != PGAT_OK)
         {
-            fprintf(stderr, "ERROR: Invalid CPU bounds for profile. Allowed value for max_cpu (%ld) is less than system cpu (%ld) count\n",
-                profile->max_cpu, system_info->cpu_count);
-            if (force)
-                fprintf(stderr, "Ignoring CPU bounds because of force option ....\n");
-            else
-                exit(1);
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
         }
-        if (profile->min_cpu > 0 &&profile->min_cpu > system_info->cpu_count)
+        print_memory_bandwidth(pgat_get_memory_bandwidth(ctx), system_info->cpu_count);
+    }
+
+    /* The transaction ids the checkpoints used are the freezing work ahead */
+    if (options.xid_rate)
+    {
+        if (options.xid_window > 0)
+            printf("LOG: reading the checkpoints of %s for %d seconds\n", options.data_dir, options.xid_window);
+        if (pgat_measure_xid_rate(ctx, options.xid_history_path, options.xid_window) != PGAT_OK)
         {
-            fprintf(stderr, "ERROR: Invalid CPU bounds for profile. Allowed value for min_cpu (%ld) is greater than system cpu (%ld) count\n",
-                profile->min_cpu, system_info->cpu_count);
-            if (force)
-                fprintf(stderr, "Ignoring CPU bounds because of force option ....\n");
-            else
-                exit(1);
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
         }
+        print_xid_rate(pgat_get_xid_rate(ctx), DEFAULT_AUTOVACUUM_FREEZE_MAX_AGE);
     }
-    /* Now the Memory */
-    if (profile->max_memory <  profile->min_memory)
+
+    /* The knee of the miss ratio curve is the MRC resource of the profile */
+    if (options.num_buffer_traces > 0)
     {
-        fprintf(stderr, "WARNING: Invalid memory bounds for profile. max_memory (%ld) is less than min_memory(%ld) bytes\n",
-                profile->max_cpu, profile->min_memory);
-        fprintf(stderr, "Ignoring memory bounds ....\n");
+        MissRatioCurve curve;
+
+        if (pgat_analyze_buffer_trace(ctx, options.buffer_traces, options.num_buffer_traces, &curve) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
+        }
+        print_miss_ratio_curve(&curve);
     }
-    else
+
+    if (pgat_load_profile(ctx, map_file) != PGAT_OK)
     {
-        if (profile->max_memory > 0 && profile->max_memory < system_info->total_ram)
+        fprintf(stderr, "%s: failed to load configuration map file\n", progname);
+        return -1;
+    }
+    if (options.verbose)
+    {
+        print_map_profile(pgat_get_profile(ctx));
+        print_config_map(pgat_get_config_map(ctx), system_info, false);
+    }
+
+    /* Compare the workloads instead of tuning for one */
+    if (options.all_workloads)
+    {
+        const char *output_path = options.output_file_path ? options.output_file_path : output_conf_file;
+        int workload;
+
+        if (pgat_process_all_workloads(ctx) != PGAT_OK)
         {
-            fprintf(stderr, "ERROR: Invalid memory bounds for profile. Allowed value for max_memory (%ld) is less than system memory (%lld) bytes\n",
-                profile->max_memory, system_info->total_ram);
-            if (force)
-                fprintf(stderr, "Ignoring memory bounds because of force option ....\n");
-            else
-                exit(1);
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            exit(1);
         }
-        if (profile->min_memory > 0 && profile->min_memory > system_info->total_ram)
+        print_workload_comparison(pgat_get_workload_config_map(ctx, 0), NUM_WORKLOAD_FACTORS);
+        for (workload = 0; workload < NUM_WORKLOAD_FACTORS; workload++)
         {
-            fprintf(stderr, "ERROR: Invalid memory bounds for profile. Allowed value for min_memory (%ld) is greater than system memory (%lld) bytes\n",
-                profile->min_memory, system_info->total_ram);
-            if (force)
-                fprintf(stderr, "Ignoring memory bounds because of force option ....\n");
-            else
+            char path[PATH_MAX];
+
+            workload_output_path(output_path, workload, path, sizeof path);
+            if (pgat_emit_workload(ctx, workload, path) != PGAT_OK)
+            {
+                fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
                 exit(1);
+            }
+            printf("LOG: configuration file \"%s\" generated\n", path);
         }
+        pgat_destroy(ctx);
+        return 0;
+    }
+
+    if (pgat_process(ctx) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        exit(1);
     }
+    print_config_map(pgat_get_config_map(ctx), system_info, true);
+
+    /* Enough with gathering info. create a meaningfull config */
+    if (pgat_emit(ctx, options.output_file_path ? options.output_file_path : output_conf_file) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        exit(1);
+    }
+    printf("\nLOG: configuration file \"%s\" generated\n", options.output_file_path ? options.output_file_path : output_conf_file);
+
+    if (options.watch)
+    {
+        WatchOptions watch_options = {
+            .data_dir = options.data_dir,
+            .output_path = options.output_file_path ? options.output_file_path : output_conf_file,
+            .interval = options.watch_interval,
+            .reload = options.reload,
+            .pg_ctl = options.pg_ctl ? options.pg_ctl : DEFAULT_PG_CTL,
+            .stop = &stop_watching};
+        struct sigaction action;
+
+        /* no SA_RESTART, the wait has to return when we are told to stop */
+        memset(&action, 0, sizeof action);
+        action.sa_handler = handle_stop_signal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+
+        /* our log is usually a pipe or a file */
+        setvbuf(stdout, NULL, _IOLBF, 0);
+
+        if (run_watch(ctx, &watch_options) != 0)
+            exit(1);
+    }
+    pgat_destroy(ctx);
+    return 0;
 }
 
-static long long
-get_ram_size(void)
+static void
+handle_stop_signal(int signo)
 {
-    struct sysinfo info;
+    stop_watching = 1;
+}
 
-    if (sysinfo(&info) != 0)
+/* The DEBUG lines of the library only with --verbose */
+static void
+print_log_message(PGAT_LOG_LEVEL level, const char *message, void *arg)
+{
+    bool verbose = *(bool *)arg;
+
+    if (level == PGAT_LOG_DEBUG)
     {
-        fprintf(stderr, "Failed to retrieve system information %s:\n", strerror(errno));
-        return -1;
+        if (verbose)
+            printf("DEBUG: %s\n", message);
     }
-    return info.totalram;
+    else
+        printf("LOG: %s\n", message);
 }
 
-static int
-get_CPU_count(void)
+/* per_postgresql.conf becomes per_postgresql.oltp.conf and so on */
+static void
+use_classification(CliOptions *options, SystemInfo *system_info, WorkloadClassification *classification)
 {
-    long count = sysconf(_SC_NPROCESSORS_ONLN);
-    if (count < 1)
+    print_workload_classification(classification);
+    if (options->workload_given)
+        printf("LOG: the workload type is given, the classification is not used\n");
+    else
     {
-        fprintf(stderr, "Failed to retrieve CPU core count %s:\n", strerror(errno));
-        return -1;
+        memcpy(system_info->workload_weights, classification->weights, sizeof system_info->workload_weights);
+        system_info->workload_type = classification->workload_type;
     }
-
-    return count;
 }
 
-static double
-get_disk_speed(const char *filePath)
+static void
+workload_output_path(const char *output_path, WORKLOAD_TYPE workload, char *path, size_t len)
 {
-    int fd;
-    struct timeval start, end;
+    const char *extension = strrchr(output_path, '.');
+    const char *name = get_workload_type(workload);
+    char lower[16];
+    int i;
+
+    for (i = 0; name[i] && i < (int)sizeof lower - 1; i++)
+        lower[i] = tolower((unsigned char)name[i]);
+    lower[i] = '\0';
 
-#define BUFFER_SIZE (1024 * 8)
-    char buffer[BUFFER_SIZE];
+    if (extension == NULL || strchr(extension, '/'))
+        snprintf(path, len, "%s.%s", output_path, lower);
+    else
+        snprintf(path, len, "%.*s.%s%s", (int)(extension - output_path), output_path, lower, extension);
+}
 
-    fd = open(filePath, O_RDONLY);
-    if (fd == -1)
+static void
+print_system_info(SystemInfo *system_info)
+{
+    printf("\n************** System Info **************\n");
+    printf("WorkLoad type   : %s",get_workload_type(system_info->workload_type));
+    if (is_workload_blend(system_info))
     {
-        fprintf(stderr, "Failed to open file %s:\n", strerror(errno));
-        return -1.0;
-    }
+        int workload;
 
-    gettimeofday(&start, NULL);
+        printf(" (blend");
+        for (workload = 0; workload < NUM_WORKLOAD_FACTORS; workload++)
+        {
+            if (system_info->workload_weights[workload] > 0)
+                printf(" %s=%.2f", get_workload_type(workload), system_info->workload_weights[workload]);
+        }
+        printf(")");
+    }
+    printf("\n");
+    printf("Installed RAM   : %lld\n",system_info->total_ram);
+    printf("Installed CPU   : %ld\n",system_info->cpu_count);
+    printf("Disk read speed : %.2f MB/s\n",system_info->disk_speed);
+    if (system_info->data_size > 0)
+    {
+        printf("Data size       : %.1f MB\n",system_info->data_size / (1024.0 * 1024.0));
+        printf("Relations       : %ld\n",system_info->relation_count);
+    }
+    printf("**********************************************\n");
+}
 
-    while (read(fd, buffer, BUFFER_SIZE) > 0)
-        ;
+static void
+print_map_profile(PGMapProfileDetails* profile)
+{
+    printf("\n************** Map File Details **************\n");
+    printf("Profile Name             : %s\n",profile->name);
+    printf("Description              : %s\n",profile->description);
+    printf("Profile Version          : %s\n",profile->version);
+    printf("Engine                   : %s\n",profile->engine);
+    printf("Created on               : %s\n",profile->date_created);
+
+    if (profile->max_cpu < 0)
+        printf("Valid for Max CPU(s)     : %s\n","*");
+    else
+        printf("Valid for Max CPU(s)     : %ld\n",profile->max_cpu);
 
-    gettimeofday(&end, NULL);
+    if (profile->min_cpu < 0)
+        printf("Valid for Min CPU(s)     : %s\n","*");
+    else
+        printf("Valid for Min CPU(s)     : %ld\n",profile->min_cpu);
 
-    close(fd);
+    if (profile->max_memory < 0)
+        printf("Valid for Max Memory of  : %s Bytes\n","*");
+    else
+        printf("Valid for Max Memory of  : %ldBytes\n",profile->max_memory);
 
-    double duration = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0;
-    double speed = (double)BUFFER_SIZE / (1024.0 * 1024.0 * duration);
+    if (profile->min_memory < 0)
+        printf("Valid for Min Memory of  : %s Bytes\n","*");
+    else
+        printf("Valid for Min Memory of  : %ldBytes\n",profile->min_memory);
 
-    return speed;
+    printf("**********************************************\n");
 }
 
-
 static void
 usage(void)
 {
@@ -438,11 +912,54 @@ usage(void)
     fprintf(stderr, "  -h, --host-type=TYPE        TYPE can be \"pod\", \"standard\", or \"cloud\"\n");
     fprintf(stderr, "  -n, --node-type=TYPE        TYPE can be \"primary\", or \"standby\"\n");
     fprintf(stderr, "  -d, --disk-type=TYPE        TYPE can be \"magnetic\", \"ssd\", or \"network\"\n");
-    fprintf(stderr, "  -w, --workload-type=TYPE    TYPE can be \"olap\", \"oltp\", or \"mixed\" DEFAULE=[MIXED]\n");
+    fprintf(stderr, "  -w, --workload-type=TYPE    TYPE can be \"olap\", \"oltp\", \"mixed\" or \"all\" DEFAULE=[MIXED]\n");
+    fprintf(stderr, "                              or a blend of them, e.g. \"oltp=0.7,olap=0.3\"\n");
 
     fprintf(stderr, "  -m, --file=file-path        path of config map file. DEFAULT:\"%s\"\n",map_file_name);
     fprintf(stderr, "  -o, --file=file-path        output conf file path. DEFAULT:\"%s\"\n",output_conf_file);
+    fprintf(stderr, "  -C, --compile-profile=FILE  compile the map file into a binary profile image and exit\n");
     fprintf(stderr, "  -D, --data-dir=DIR          location of the PostgreSQL data directory\n");
+    fprintf(stderr, "  -B, --batch=FILE            tune every host of a json lines inventory instead of a data directory\n");
+    fprintf(stderr, "  -b, --batch-format=FORMAT   FORMAT can be \"json\" (one record per host in the -o file)\n");
+    fprintf(stderr, "                              or \"conf\" (one HOST.conf per host in the -o directory) DEFAULT=[json]\n");
+    fprintf(stderr, "  -j, --jobs=N                number of batch workers. DEFAULT=[one per CPU]\n");
+    fprintf(stderr, "  -S, --simulate=DIMENSION... evaluate the map file over a grid of hosts and exit, e.g.\n");
+    fprintf(stderr, "                              --simulate ram=4G..1T:x2 cpus=2..128:x2 disk=ssd,network workload=oltp,olap\n");
+    fprintf(stderr, "  -f, --format=FORMAT         FORMAT of the simulation, \"table\" or \"csv\" DEFAULT=[table]\n");
+    fprintf(stderr, "  -Z, --size-for=TARGET...    find the smallest host the map file meets the targets on and exit, e.g.\n");
+    fprintf(stderr, "                              --size-for working_set=200G connections=500 parallel=8 work_mem=64MB budget=90\n");
+    fprintf(stderr, "  -T, --stats-snapshot=FILE   classify the workload from a CSV or json dump of pg_stat_statements,\n");
+    fprintf(stderr, "                              pg_stat_database or pg_stat_user_tables, may be given more than once\n");
+    fprintf(stderr, "  -L, --logs[=PATH]           size work_mem and max_wal_size from the server logs too, PATH is a\n");
+    fprintf(stderr, "                              log file or directory. DEFAULT=[log_directory of the data-dir]\n");
+    fprintf(stderr, "  -G, --wal[=DIR]             size max_wal_size, checkpoint_timeout, wal_compression and wal_buffers\n");
+    fprintf(stderr, "                              from the WAL segments in DIR and classify the workload by them too.\n");
+    fprintf(stderr, "                              DEFAULT=[pg_wal of the data-dir]\n");
+    fprintf(stderr, "  -M, --buffer-trace=FILE     replay a pg_buffercache dump series or block access log through the\n");
+    fprintf(stderr, "                              clock sweep to size MRC resources, may be given more than once\n");
+    fprintf(stderr, "  -R, --cache-residency       size shared_buffers and effective_cache_size from what the page cache\n");
+    fprintf(stderr, "                              holds of the data-dir\n");
+    fprintf(stderr, "  -A, --prewarm-list=FILE     write the resident blocks as an autoprewarm.blocks list, implies -R\n");
+    fprintf(stderr, "  -H, --heap-scan             read the heap pages of the data-dir for their free and dead space and\n");
+    fprintf(stderr, "                              size autovacuum_vacuum_cost_limit from it\n");
+    fprintf(stderr, "  -Q, --table-settings=FILE   write per table autovacuum_vacuum_scale_factor and fillfactor as a\n");
+    fprintf(stderr, "                              psql script, implies -H\n");
+    fprintf(stderr, "  -X, --xid-history=FILE      add the transaction ids of the last checkpoint to FILE and size the\n");
+    fprintf(stderr, "                              freeze ages and autovacuum from their rate over the earlier runs\n");
+    fprintf(stderr, "  -x, --xid-window=SECONDS    read the checkpoints for SECONDS for the transaction id rate\n");
+    fprintf(stderr, "  -c, --compression           compress sampled heap, TOAST and WAL pages with pglz, lz4 and zstd and\n");
+    fprintf(stderr, "                              set wal_compression and default_toast_compression by the CPU left\n");
+    fprintf(stderr, "                              and the disk speed\n");
+    fprintf(stderr, "  -k, --calibrate-costs       time page reads of the data-dir, tuple deforming, expression evaluation\n");
+    fprintf(stderr, "                              and worker starts for the calibrated planner costs of the profile\n");
+    fprintf(stderr, "  -K, --memory-knee           sort and hash tuples in memory from 64kB to 1GB and count work_mem and\n");
+    fprintf(stderr, "                              hash_mem_multiplier in the sizes they fall out of the caches at\n");
+    fprintf(stderr, "  -e, --memory-bandwidth      run STREAM kernels on every CPU of every NUMA node and a pointer chase\n");
+    fprintf(stderr, "                              for the MEMBW resource and cap the parallel workers of a scan with it\n");
+    fprintf(stderr, "  -W, --watch                 stay resident and tune again when memory or CPU limits change\n");
+    fprintf(stderr, "  -i, --interval=SECONDS      check for changes at least every SECONDS. DEFAULT=[%d]\n", DEFAULT_WATCH_INTERVAL);
+    fprintf(stderr, "  -r, --reload                run \"pg_ctl reload\" after a reloadable parameter changed\n");
+    fprintf(stderr, "  -P, --pg-ctl=PATH           pg_ctl used to reload. DEFAULT=[pg_ctl in PATH]\n");
 
     fprintf(stderr, "  -F, --force-profile         Force apply invalid profiles. DEFAULT=[FALSE]\n");
     fprintf(stderr, "  -v, --verbose               output verbose messages\n");
@@ -0,0 +1,535 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_batch.c
+ *		Tune a fleet of hosts described by an inventory file.
+ *
+ * The inventory has one json object per line describing a host. The
+ * profile is loaded once by the caller, every host is then evaluated on a
+ * pool of worker threads against a private copy of the config map, and the
+ * results are written either as one json record per host or as one conf
+ * file per host.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "json.h"
+#include "json_scan.h"
+#include "pg_arena.h"
+#include "pg_config_map.h"
+#include "pg_batch.h"
+
+#define MAX_BATCH_WORKERS 256
+#define MAX_HOST_ERROR_LEN (PATH_MAX + 256)
+
+typedef struct batch_host
+{
+    const char *line;           /* points into the mapped inventory */
+    size_t length;
+    unsigned int line_number;
+    char *record;               /* json record, or NULL in conf format */
+    bool failed;
+} BatchHost;
+
+typedef struct batch_state
+{
+    BatchOptions *options;
+    PGConfigMap *config_map;
+    PGMapProfileDetails *profile;
+    BatchHost *hosts;
+    int num_hosts;
+    int next_host;              /* next host to hand out, atomic */
+} BatchState;
+
+static int split_inventory(BatchState *state, const char *inventory, size_t size);
+static void *batch_worker(void *arg);
+static void tune_host(BatchState *state, BatchHost *host, PGArena *arena);
+static bool read_host(const json_cursor *root, SystemInfo *system_info, const char **name,
+                      const char **pgconf_path, char *error, size_t error_len);
+static bool parse_size(const json_cursor *value, long long *size);
+static char *host_record(PGConfigMap *config_map, SystemInfo *system_info, const char *name,
+                         BatchHost *host, const char *error);
+static void write_json_string(FILE *fp, const char *str);
+
+int
+run_batch(BatchOptions *options, PGConfigMap *config_map, PGMapProfileDetails *profile)
+{
+    BatchState state;
+    pthread_t workers[MAX_BATCH_WORKERS];
+    struct timeval start, end;
+    struct stat st;
+    void *inventory;
+    FILE *out = NULL;
+    int num_workers;
+    int failed = 0;
+    int started;
+    int fd;
+    int i;
+
+    memset(&state, 0x00, sizeof state);
+    state.options = options;
+    state.config_map = config_map;
+    state.profile = profile;
+
+    fd = open(options->inventory_path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to read file %s reason:%s\n", options->inventory_path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "Inventory %s is empty\n", options->inventory_path);
+        close(fd);
+        return -1;
+    }
+    inventory = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (inventory == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map file %s reason:%s\n", options->inventory_path, strerror(errno));
+        return -1;
+    }
+    madvise(inventory, st.st_size, MADV_SEQUENTIAL);
+
+    if (split_inventory(&state, inventory, st.st_size) < 0)
+    {
+        munmap(inventory, st.st_size);
+        return -1;
+    }
+
+    if (options->format == BATCH_JSON)
+    {
+        out = fopen(options->output_path, "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Failed to create batch output %s reason:%s\n", options->output_path, strerror(errno));
+            free(state.hosts);
+            munmap(inventory, st.st_size);
+            return -1;
+        }
+    }
+
+    num_workers = options->num_workers;
+    if (num_workers <= 0)
+        num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers > state.num_hosts)
+        num_workers = state.num_hosts;
+    if (num_workers > MAX_BATCH_WORKERS)
+        num_workers = MAX_BATCH_WORKERS;
+    if (num_workers < 1)
+        num_workers = 1;
+
+    printf("LOG: tuning %d hosts from %s with %d workers\n", state.num_hosts, options->inventory_path, num_workers);
+    gettimeofday(&start, NULL);
+
+    for (started = 0; started < num_workers; started++)
+    {
+        int rc = pthread_create(&workers[started], NULL, batch_worker, &state);
+
+        if (rc != 0)
+        {
+            fprintf(stderr, "Failed to start batch worker reason:%s\n", strerror(rc));
+            break;
+        }
+    }
+    /* With no worker at all the hosts are tuned right here */
+    if (started == 0)
+        batch_worker(&state);
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    gettimeofday(&end, NULL);
+
+    /* Records go out in inventory order, whatever order they finished in */
+    for (i = 0; i < state.num_hosts; i++)
+    {
+        BatchHost *host = &state.hosts[i];
+
+        if (host->failed)
+            failed++;
+        if (out && host->record)
+            fputs(host->record, out);
+        free(host->record);
+    }
+    if (out && fclose(out) != 0)
+    {
+        fprintf(stderr, "Failed to write batch output %s reason:%s\n", options->output_path, strerror(errno));
+        failed = -1;
+    }
+
+    printf("LOG: tuned %d of %d hosts in %.3f seconds, output written to \"%s\"\n",
+           state.num_hosts - (failed > 0 ? failed : 0), state.num_hosts,
+           (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0,
+           options->output_path);
+
+    free(state.hosts);
+    munmap(inventory, st.st_size);
+    return failed;
+}
+
+/*
+ * Find the host lines of the inventory. Empty lines and lines starting
+ * with '#' are skipped.
+ */
+static int
+split_inventory(BatchState *state, const char *inventory, size_t size)
+{
+    const char *ptr = inventory;
+    const char *end = inventory + size;
+    unsigned int line_number = 0;
+    int capacity = 0;
+
+    while (ptr < end)
+    {
+        const char *eol = memchr(ptr, '\n', end - ptr);
+        const char *line = ptr;
+        size_t length;
+
+        if (eol == NULL)
+            eol = end;
+        ptr = eol + 1;
+        line_number++;
+
+        while (line < eol && (*line == ' ' || *line == '\t' || *line == '\r'))
+            line++;
+        if (line == eol || *line == '#')
+            continue;
+        length = eol - line;
+
+        if (state->num_hosts == capacity)
+        {
+            BatchHost *hosts;
+
+            capacity = capacity ? capacity * 2 : 256;
+            hosts = realloc(state->hosts, capacity * sizeof *hosts);
+            if (hosts == NULL)
+            {
+                perror("Not possible to allocate memory for the inventory");
+                free(state->hosts);
+                state->hosts = NULL;
+                return -1;
+            }
+            state->hosts = hosts;
+        }
+        memset(&state->hosts[state->num_hosts], 0x00, sizeof(BatchHost));
+        state->hosts[state->num_hosts].line = line;
+        state->hosts[state->num_hosts].length = length;
+        state->hosts[state->num_hosts].line_number = line_number;
+        state->num_hosts++;
+    }
+    if (state->num_hosts == 0)
+    {
+        fprintf(stderr, "Inventory %s does not describe any host\n", state->options->inventory_path);
+        return -1;
+    }
+    return state->num_hosts;
+}
+
+static void *
+batch_worker(void *arg)
+{
+    BatchState *state = arg;
+    PGArena *arena;
+    int i;
+
+    /* Everything a host needs comes from here and is dropped right after */
+    arena = pg_arena_create(ARENA_MIN_BLOCK_SIZE);
+    if (arena == NULL)
+        return NULL;
+
+    while ((i = __atomic_fetch_add(&state->next_host, 1, __ATOMIC_RELAXED)) < state->num_hosts)
+    {
+        tune_host(state, &state->hosts[i], arena);
+        pg_arena_reset(arena);
+    }
+    pg_arena_destroy(arena);
+    return NULL;
+}
+
+static void
+tune_host(BatchState *state, BatchHost *host, PGArena *arena)
+{
+    BatchOptions *options = state->options;
+    SystemInfo system_info = options->defaults;
+    PGConfigMap host_map;
+    PGConfig *pg_config = NULL;
+    json_tape tape;
+    json_cursor root;
+    const char *name = NULL;
+    const char *pgconf_path = NULL;
+    char error[MAX_HOST_ERROR_LEN];
+
+    /* name and pgconf_path are read from the tape, it lives until we are done */
+    error[0] = '\0';
+    if (json_tape_parse_ex(&tape, host->line, host->length, error) != 0)
+        goto HOST_FAILED;
+    json_tape_root(&tape, &root);
+    if (!read_host(&root, &system_info, &name, &pgconf_path, error, sizeof error))
+        goto HOST_FAILED;
+    if (!options->force && !check_profile_bounds(state->profile, &system_info, error, sizeof error))
+        goto HOST_FAILED;
+    if (!clone_config_map(state->config_map, &host_map, &system_info, arena))
+    {
+        snprintf(error, sizeof error, "out of memory");
+        goto HOST_FAILED;
+    }
+
+    if (pgconf_path)
+    {
+        if (access(pgconf_path, R_OK) != 0)
+        {
+            snprintf(error, sizeof error, "can not read %s: %s", pgconf_path, strerror(errno));
+            goto HOST_FAILED;
+        }
+        pg_config = PGConfig_parse((char *)pgconf_path);
+        if (pg_config)
+            load_pg_config_in_map(&host_map, pg_config);
+    }
+    process_config_map(&host_map, &system_info);
+
+    if (options->format == BATCH_CONF)
+    {
+        char conf_path[PATH_MAX];
+        FILE *fp;
+
+        snprintf(conf_path, sizeof conf_path, "%s/%s.conf", options->output_path, name);
+        fp = fopen(conf_path, "w");
+        if (fp == NULL)
+        {
+            snprintf(error, sizeof error, "can not create %s: %s", conf_path, strerror(errno));
+            PGConfig_destroy(pg_config);
+            goto HOST_FAILED;
+        }
+        write_postgresql_conf(fp, &host_map);
+        if (fclose(fp) != 0)
+        {
+            snprintf(error, sizeof error, "can not write %s: %s", conf_path, strerror(errno));
+            PGConfig_destroy(pg_config);
+            goto HOST_FAILED;
+        }
+    }
+    else
+        host->record = host_record(&host_map, &system_info, name, host, NULL);
+
+    PGConfig_destroy(pg_config);
+    json_tape_free(&tape);
+    return;
+
+HOST_FAILED:
+    host->failed = true;
+    fprintf(stderr, "ERROR: %s:%u: host %s: %s\n", options->inventory_path, host->line_number,
+            name ? name : "?", error);
+    if (options->format == BATCH_JSON)
+        host->record = host_record(NULL, &system_info, name, host, error);
+    json_tape_free(&tape);
+}
+
+/*
+ * Fill in the system info of a host from its inventory line. Anything the
+ * line does not specify keeps the batch default.
+ */
+static bool
+read_host(const json_cursor *root, SystemInfo *system_info, const char **name,
+          const char **pgconf_path, char *error, size_t error_len)
+{
+    json_cursor value;
+    const char *ptr;
+
+    if (json_cursor_type(root) != json_object)
+    {
+        snprintf(error, error_len, "host must be described by a json object");
+        return false;
+    }
+
+    *name = json_cursor_get_string(root, INVENTORY_HOST_KEY);
+    if (*name == NULL || **name == '\0' || strchr(*name, '/') || **name == '.')
+    {
+        *name = NULL;
+        snprintf(error, error_len, "\"%s\" must be a host name", INVENTORY_HOST_KEY);
+        return false;
+    }
+
+    if (!json_cursor_get(root, INVENTORY_RAM_KEY, &value) || !parse_size(&value, &system_info->total_ram) ||
+        system_info->total_ram <= 0)
+    {
+        snprintf(error, error_len, "\"%s\" must be a size in bytes or with a kB, MB, GB or TB unit", INVENTORY_RAM_KEY);
+        return false;
+    }
+
+    if (!json_cursor_get(root, INVENTORY_CPUS_KEY, &value) || json_cursor_type(&value) != json_integer ||
+        json_cursor_node(&value)->u.integer <= 0)
+    {
+        snprintf(error, error_len, "\"%s\" must be a positive integer", INVENTORY_CPUS_KEY);
+        return false;
+    }
+    system_info->cpu_count = json_cursor_node(&value)->u.integer;
+
+    if (json_cursor_get(root, INVENTORY_DISK_SPEED_KEY, &value) &&
+        !json_cursor_number(&value, &system_info->disk_speed))
+    {
+        snprintf(error, error_len, "\"%s\" must be a number of MB/s", INVENTORY_DISK_SPEED_KEY);
+        return false;
+    }
+
+    if ((ptr = json_cursor_get_string(root, INVENTORY_WORKLOAD_KEY)) != NULL)
+    {
+        /* either a single workload or a blend, "oltp=0.7,olap=0.3" */
+        memset(system_info->workload_weights, 0x00, sizeof system_info->workload_weights);
+        if (strchr(ptr, '='))
+        {
+            if (!parse_workload_weights(ptr, system_info))
+            {
+                snprintf(error, error_len, "invalid %s \"%s\"", INVENTORY_WORKLOAD_KEY, ptr);
+                return false;
+            }
+        }
+        else if ((system_info->workload_type = identify_workload_type(ptr)) == UNKNOWN_WL)
+        {
+            snprintf(error, error_len, "invalid %s \"%s\"", INVENTORY_WORKLOAD_KEY, ptr);
+            return false;
+        }
+    }
+    if ((ptr = json_cursor_get_string(root, INVENTORY_DISK_TYPE_KEY)) != NULL)
+    {
+        system_info->disk_type = identify_disk_type(ptr);
+        if (system_info->disk_type == UNKNOWN_DT)
+        {
+            snprintf(error, error_len, "invalid %s \"%s\"", INVENTORY_DISK_TYPE_KEY, ptr);
+            return false;
+        }
+    }
+    if ((ptr = json_cursor_get_string(root, INVENTORY_NODE_TYPE_KEY)) != NULL)
+    {
+        system_info->node_type = identify_node_type(ptr);
+        if (system_info->node_type == UNKNOWN_NT)
+        {
+            snprintf(error, error_len, "invalid %s \"%s\"", INVENTORY_NODE_TYPE_KEY, ptr);
+            return false;
+        }
+    }
+    if ((ptr = json_cursor_get_string(root, INVENTORY_HOST_TYPE_KEY)) != NULL)
+    {
+        system_info->host_type = identify_host_type(ptr);
+        if (system_info->host_type == UNKNOWN_HOST)
+        {
+            snprintf(error, error_len, "invalid %s \"%s\"", INVENTORY_HOST_TYPE_KEY, ptr);
+            return false;
+        }
+    }
+
+    *pgconf_path = json_cursor_get_string(root, INVENTORY_PGCONF_KEY);
+    return true;
+}
+
+/* A size is a number of bytes or a string with a kB, MB, GB or TB unit */
+static bool
+parse_size(const json_cursor *value, long long *size)
+{
+    const char *text = json_cursor_string(value);
+
+    if (json_cursor_type(value) == json_integer)
+    {
+        *size = json_cursor_node(value)->u.integer;
+        return true;
+    }
+    return text && parse_size_text(text, size);
+}
+
+/* One line of json describing the outcome for a host, malloc'ed */
+static char *
+host_record(PGConfigMap *config_map, SystemInfo *system_info, const char *name,
+            BatchHost *host, const char *error)
+{
+    PGConfigMapEntry *entry;
+    char *record = NULL;
+    size_t record_len = 0;
+    bool first;
+    FILE *fp;
+
+    fp = open_memstream(&record, &record_len);
+    if (fp == NULL)
+        return NULL;
+
+    fprintf(fp, "{\"host\":");
+    write_json_string(fp, name ? name : "");
+    fprintf(fp, ",\"line\":%u", host->line_number);
+    if (error)
+    {
+        fprintf(fp, ",\"status\":\"error\",\"error\":");
+        write_json_string(fp, error);
+        fprintf(fp, "}\n");
+        fclose(fp);
+        return record;
+    }
+
+    fprintf(fp, ",\"status\":\"ok\",\"workload\":\"%s\",\"ram\":%lld,\"cpus\":%ld,\"settings\":{",
+            get_workload_type(system_info->workload_type), system_info->total_ram, system_info->cpu_count);
+    first = true;
+    for (entry = config_map->list; entry; entry = entry->next)
+    {
+        char value[MAX_TOKEN_LEN];
+
+        if (entry->status != ENTRY_PROCESSED_SUCCESS)
+            continue;
+        format_config_map_value(entry, value, sizeof value);
+        if (!first)
+            fputc(',', fp);
+        write_json_string(fp, entry->param);
+        fputc(':', fp);
+        write_json_string(fp, value);
+        first = false;
+    }
+    fprintf(fp, "},\"warnings\":[");
+    first = true;
+    for (entry = config_map->list; entry; entry = entry->next)
+    {
+        if (entry->status != ENTRY_PROCESSED_ERROR)
+            continue;
+        if (!first)
+            fputc(',', fp);
+        write_json_string(fp, entry->message);
+        first = false;
+    }
+    fprintf(fp, "]}\n");
+    fclose(fp);
+    return record;
+}
+
+static void
+write_json_string(FILE *fp, const char *str)
+{
+    const unsigned char *ptr;
+
+    fputc('"', fp);
+    for (ptr = (const unsigned char *)str; *ptr; ptr++)
+    {
+        if (*ptr == '"' || *ptr == '\\')
+            fprintf(fp, "\\%c", *ptr);
+        else if (*ptr < 0x20)
+            fprintf(fp, "\\u%04x", *ptr);
+        else
+            fputc(*ptr, fp);
+    }
+    fputc('"', fp);
+}
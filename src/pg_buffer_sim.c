@@ -0,0 +1,608 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_buffer_sim.c
+ *		Replay block accesses through the clock sweep of the shared buffers.
+ *
+ * The clock sweep is not a stack algorithm, a smaller cache does not hold a
+ * subset of what a larger one holds, so the miss ratio of every candidate
+ * size comes from a cache of its own. All of them are fed in the same pass
+ * over the traces, and long traces are sampled the SHARDS way: only the
+ * blocks whose hash falls below a threshold are replayed, through caches
+ * scaled down by the same rate, which keeps the miss ratios unbiased.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pg_buffer_sim.h"
+
+#define MAX_TRACE_COLUMNS 32
+
+/* The sampling decision uses the top bits of a tag, the hash table the low ones */
+#define SHARDS_HASH_BITS 24
+
+typedef struct clock_cache
+{
+    uint32_t num_buffers;
+    uint32_t used;              /* buffers handed out from the free list */
+    uint32_t capacity;          /* buffers allocated so far */
+    uint32_t hand;
+    uint64_t *tags;
+    uint8_t *usage_counts;
+    uint32_t *slots;            /* buffer + 1 of a tag, 0 when free */
+    uint32_t slot_mask;
+    long long misses;
+} ClockCache;
+
+typedef struct buffer_sim
+{
+    int num_caches;
+    ClockCache caches[MRC_MAX_POINTS];
+    uint64_t sample_threshold;
+    long long accesses;
+    long long sampled;
+} BufferSim;
+
+typedef struct trace_field
+{
+    const char *ptr;
+    size_t len;
+} TraceField;
+
+/* Columns of a pg_buffercache dump that make up a buffer tag */
+typedef struct buffercache_columns
+{
+    int relfilenode;
+    int reldatabase;
+    int relforknumber;
+    int relblocknumber;
+    int usagecount;
+} BuffercacheColumns;
+
+static bool replay_trace_file(BufferSim *sim, const char *path);
+static bool replay_buffercache(BufferSim *sim, const char *data, const char *end, const char *header_end);
+static bool replay_access_log(BufferSim *sim, const char *data, const char *end);
+static bool replay_access(BufferSim *sim, uint64_t tag, long long count);
+static bool cache_access(ClockCache *cache, uint64_t tag);
+static bool grow_cache(ClockCache *cache);
+static uint32_t find_slot(ClockCache *cache, uint64_t tag);
+static void remove_slot(ClockCache *cache, uint32_t slot);
+static void free_caches(BufferSim *sim);
+static int split_fields(const char *line, const char *end, const char *separators, TraceField *fields, int max_fields);
+static bool field_integer(TraceField *field, unsigned long long *value);
+static int find_column(TraceField *fields, int num_fields, const char *name);
+static uint64_t hash_bytes(uint64_t hash, const char *data, size_t len);
+static uint64_t buffer_tag(uint64_t relation, unsigned long long block);
+static void find_knee(MissRatioCurve *curve);
+
+bool
+build_miss_ratio_curve(const char **paths, int num_paths, long long max_size, MissRatioCurve *curve)
+{
+    BufferSim sim;
+    long long trace_bytes = 0;
+    ClockCache *largest;
+    bool ok = true;
+    int i;
+
+    memset(&sim, 0x00, sizeof sim);
+    memset(curve, 0x00, sizeof *curve);
+    if ((long long)MRC_MIN_BUFFERS * BUFFER_BLOCK_SIZE > max_size)
+    {
+        fprintf(stderr, "ERROR: %lld bytes is too little memory to build a miss ratio curve for\n", max_size);
+        return false;
+    }
+
+    for (i = 0; i < num_paths; i++)
+    {
+        struct stat st;
+
+        if (stat(paths[i], &st) != 0)
+        {
+            fprintf(stderr, "Failed to read file %s reason:%s\n", paths[i], strerror(errno));
+            return false;
+        }
+        trace_bytes += st.st_size;
+    }
+    curve->sample_rate = trace_bytes <= SHARDS_FULL_TRACE_BYTES ? 1.0 : SHARDS_SAMPLE_RATE;
+    sim.sample_threshold = (uint64_t)(curve->sample_rate * (1ULL << SHARDS_HASH_BITS));
+
+    for (i = 0; i < MRC_MAX_POINTS; i++)
+    {
+        long long buffers = llround(MRC_MIN_BUFFERS * pow(2.0, i / 2.0));
+        long long scaled = llround(buffers * curve->sample_rate);
+
+        if (buffers * BUFFER_BLOCK_SIZE > max_size)
+            break;
+        curve->sizes[i] = buffers * BUFFER_BLOCK_SIZE;
+        sim.caches[i].num_buffers = scaled > 1 ? scaled : 1;
+    }
+    curve->num_points = sim.num_caches = i;
+
+    for (i = 0; i < num_paths && ok; i++)
+        ok = replay_trace_file(&sim, paths[i]);
+    if (ok && sim.sampled == 0)
+    {
+        fprintf(stderr, "ERROR: the buffer traces hold no block accesses\n");
+        ok = false;
+    }
+    if (!ok)
+    {
+        free_caches(&sim);
+        return false;
+    }
+
+    curve->accesses = sim.accesses;
+    curve->sampled = sim.sampled;
+    for (i = 0; i < curve->num_points; i++)
+        curve->miss_ratios[i] = (double)sim.caches[i].misses / sim.sampled;
+    largest = &sim.caches[curve->num_points - 1];
+    if (largest->used < largest->num_buffers)
+        curve->working_set = llround(largest->used / curve->sample_rate) * BUFFER_BLOCK_SIZE;
+    else
+        curve->working_set = -1;
+    find_knee(curve);
+    free_caches(&sim);
+    return true;
+}
+
+void
+print_miss_ratio_curve(MissRatioCurve *curve)
+{
+    int i;
+
+    printf("LOG: replayed %lld of %lld block accesses (sample rate %.3f)\n",
+           curve->sampled, curve->accesses, curve->sample_rate);
+    if (curve->working_set >= 0)
+        printf("LOG:   working set            : %lldMB\n", curve->working_set / (1024 * 1024));
+    else
+        printf("LOG:   working set            : larger than %lldMB\n", curve->sizes[curve->num_points - 1] / (1024 * 1024));
+    for (i = 0; i < curve->num_points; i++)
+        printf("LOG:   %8lldMB  miss ratio %.4f%s\n", curve->sizes[i] / (1024 * 1024), curve->miss_ratios[i],
+               curve->sizes[i] == curve->knee ? "  <- knee" : "");
+}
+
+static bool
+replay_trace_file(BufferSim *sim, const char *path)
+{
+    struct stat st;
+    const char *data;
+    const char *end;
+    const char *line;
+    const char *header_end;
+    TraceField fields[MAX_TRACE_COLUMNS];
+    int num_fields;
+    bool ok;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to read file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+    end = data + st.st_size;
+
+    /* A pg_buffercache dump starts with its header line */
+    for (line = data; line < end && (*line == '\n' || *line == '\r'); line++)
+        ;
+    header_end = memchr(line, '\n', end - line);
+    if (header_end == NULL)
+        header_end = end;
+    num_fields = split_fields(line, header_end, ",", fields, MAX_TRACE_COLUMNS);
+    if (find_column(fields, num_fields, "relblocknumber") >= 0)
+        ok = replay_buffercache(sim, line, end, header_end);
+    else
+        ok = replay_access_log(sim, data, end);
+    munmap((void *)data, st.st_size);
+    if (!ok)
+        perror("Not possible to allocate memory for the buffer simulation");
+    return ok;
+}
+
+/*
+ * A series of pg_buffercache dumps, each buffer in use counts as usagecount
+ * accesses of its block. Header lines repeated between the dumps are skipped.
+ */
+static bool
+replay_buffercache(BufferSim *sim, const char *data, const char *end, const char *header_end)
+{
+    TraceField fields[MAX_TRACE_COLUMNS];
+    BuffercacheColumns columns;
+    const char *line;
+    int num_fields;
+
+    num_fields = split_fields(data, header_end, ",", fields, MAX_TRACE_COLUMNS);
+    columns.relfilenode = find_column(fields, num_fields, "relfilenode");
+    columns.reldatabase = find_column(fields, num_fields, "reldatabase");
+    columns.relforknumber = find_column(fields, num_fields, "relforknumber");
+    columns.relblocknumber = find_column(fields, num_fields, "relblocknumber");
+    columns.usagecount = find_column(fields, num_fields, "usagecount");
+
+    for (line = header_end; line < end; line++)
+    {
+        const char *line_end = memchr(line, '\n', end - line);
+        unsigned long long block;
+        unsigned long long usage = 1;
+        uint64_t relation = 0;
+
+        if (line_end == NULL)
+            line_end = end;
+        num_fields = split_fields(line, line_end, ",", fields, MAX_TRACE_COLUMNS);
+        line = line_end;
+
+        /* unused buffers have no relation */
+        if (num_fields <= columns.relblocknumber || !field_integer(&fields[columns.relblocknumber], &block))
+            continue;
+        if (columns.relfilenode >= 0 && columns.relfilenode < num_fields)
+            relation = hash_bytes(relation, fields[columns.relfilenode].ptr, fields[columns.relfilenode].len);
+        if (columns.reldatabase >= 0 && columns.reldatabase < num_fields)
+            relation = hash_bytes(relation, fields[columns.reldatabase].ptr, fields[columns.reldatabase].len);
+        if (columns.relforknumber >= 0 && columns.relforknumber < num_fields)
+            relation = hash_bytes(relation, fields[columns.relforknumber].ptr, fields[columns.relforknumber].len);
+        if (columns.usagecount >= 0 && columns.usagecount < num_fields &&
+            field_integer(&fields[columns.usagecount], &usage) && usage == 0)
+            usage = 1;
+        if (!replay_access(sim, buffer_tag(relation, block), usage > BUFFER_MAX_USAGE_COUNT ? BUFFER_MAX_USAGE_COUNT : usage))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * One access per line, the block number last and everything before it the
+ * relation, e.g. "16384 0 1234" or "public.orders,1234". Lines that do not
+ * end in a block number, comments and headers, are skipped.
+ */
+static bool
+replay_access_log(BufferSim *sim, const char *data, const char *end)
+{
+    const char *line;
+
+    for (line = data; line < end; line++)
+    {
+        const char *line_end = memchr(line, '\n', end - line);
+        const char *relation_end;
+        TraceField block_field;
+        unsigned long long block;
+
+        if (line_end == NULL)
+            line_end = end;
+        if (*line == '#')
+        {
+            line = line_end;
+            continue;
+        }
+
+        block_field.ptr = line_end;
+        while (block_field.ptr > line && strchr(" \t\r", block_field.ptr[-1]))
+            block_field.ptr--;
+        relation_end = block_field.ptr;
+        while (block_field.ptr > line && !strchr(" \t,", block_field.ptr[-1]))
+            block_field.ptr--;
+        block_field.len = relation_end - block_field.ptr;
+        relation_end = block_field.ptr;
+        while (relation_end > line && strchr(" \t,", relation_end[-1]))
+            relation_end--;
+
+        if (field_integer(&block_field, &block) &&
+            !replay_access(sim, buffer_tag(hash_bytes(0, line, relation_end - line), block), 1))
+            return false;
+        line = line_end;
+    }
+    return true;
+}
+
+static bool
+replay_access(BufferSim *sim, uint64_t tag, long long count)
+{
+    int i;
+
+    sim->accesses += count;
+    if ((tag >> (64 - SHARDS_HASH_BITS)) >= sim->sample_threshold)
+        return true;
+    sim->sampled += count;
+    for (i = 0; i < sim->num_caches; i++)
+    {
+        long long n;
+
+        for (n = 0; n < count; n++)
+        {
+            if (!cache_access(&sim->caches[i], tag))
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * A hit bumps the usage count up to BUFFER_MAX_USAGE_COUNT, a miss takes a
+ * buffer from the free list while there is one, and then from the clock
+ * sweep: the hand decrements the usage count of every buffer it passes and
+ * stops at the first one that is already at zero, like StrategyGetBuffer().
+ */
+static bool
+cache_access(ClockCache *cache, uint64_t tag)
+{
+    uint32_t slot = find_slot(cache, tag);
+    uint32_t buffer;
+
+    if (cache->slots && cache->slots[slot])
+    {
+        buffer = cache->slots[slot] - 1;
+        if (cache->usage_counts[buffer] < BUFFER_MAX_USAGE_COUNT)
+            cache->usage_counts[buffer]++;
+        return true;
+    }
+
+    cache->misses++;
+    if (cache->used < cache->num_buffers)
+    {
+        if (cache->used == cache->capacity)
+        {
+            if (!grow_cache(cache))
+                return false;
+            slot = find_slot(cache, tag);
+        }
+        buffer = cache->used++;
+    }
+    else
+    {
+        for (;;)
+        {
+            buffer = cache->hand;
+            if (++cache->hand == cache->num_buffers)
+                cache->hand = 0;
+            if (cache->usage_counts[buffer] == 0)
+                break;
+            cache->usage_counts[buffer]--;
+        }
+        remove_slot(cache, find_slot(cache, cache->tags[buffer]));
+        slot = find_slot(cache, tag);
+    }
+    cache->tags[buffer] = tag;
+    cache->usage_counts[buffer] = 1;
+    cache->slots[slot] = buffer + 1;
+    return true;
+}
+
+/*
+ * The buffers are allocated as they are first used, so a large candidate
+ * size costs no more memory than the blocks the traces touch.
+ */
+static bool
+grow_cache(ClockCache *cache)
+{
+    uint32_t capacity = cache->capacity ? cache->capacity * 2 : 1024;
+    uint32_t num_slots = 1;
+    uint64_t *tags;
+    uint8_t *usage_counts;
+    uint32_t *slots;
+    uint32_t i;
+
+    if (capacity > cache->num_buffers)
+        capacity = cache->num_buffers;
+    while (num_slots < capacity * 2)
+        num_slots <<= 1;
+
+    tags = realloc(cache->tags, capacity * sizeof *tags);
+    if (tags == NULL)
+        return false;
+    cache->tags = tags;
+    usage_counts = realloc(cache->usage_counts, capacity * sizeof *usage_counts);
+    if (usage_counts == NULL)
+        return false;
+    cache->usage_counts = usage_counts;
+    slots = calloc(num_slots, sizeof *slots);
+    if (slots == NULL)
+        return false;
+
+    free(cache->slots);
+    cache->slots = slots;
+    cache->slot_mask = num_slots - 1;
+    cache->capacity = capacity;
+    for (i = 0; i < cache->used; i++)
+        cache->slots[find_slot(cache, cache->tags[i])] = i + 1;
+    return true;
+}
+
+/* Slot of the tag in the open addressing table, or the free slot it goes in */
+static uint32_t
+find_slot(ClockCache *cache, uint64_t tag)
+{
+    uint32_t slot;
+
+    if (cache->slots == NULL)
+        return 0;
+    slot = tag & cache->slot_mask;
+    while (cache->slots[slot] && cache->tags[cache->slots[slot] - 1] != tag)
+        slot = (slot + 1) & cache->slot_mask;
+    return slot;
+}
+
+/* Linear probing deletion, later entries of the chain are shifted back into the hole */
+static void
+remove_slot(ClockCache *cache, uint32_t slot)
+{
+    uint32_t mask = cache->slot_mask;
+    uint32_t hole = slot;
+    uint32_t next = (slot + 1) & mask;
+
+    while (cache->slots[next])
+    {
+        uint32_t home = cache->tags[cache->slots[next] - 1] & mask;
+
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            cache->slots[hole] = cache->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    cache->slots[hole] = 0;
+}
+
+static void
+free_caches(BufferSim *sim)
+{
+    int i;
+
+    for (i = 0; i < sim->num_caches; i++)
+    {
+        free(sim->caches[i].tags);
+        free(sim->caches[i].usage_counts);
+        free(sim->caches[i].slots);
+    }
+}
+
+static int
+split_fields(const char *line, const char *end, const char *separators, TraceField *fields, int max_fields)
+{
+    int num_fields = 0;
+
+    while (num_fields < max_fields)
+    {
+        const char *field_end = line;
+
+        while (field_end < end && !strchr(separators, *field_end))
+            field_end++;
+        fields[num_fields].ptr = line;
+        fields[num_fields].len = field_end - line;
+        num_fields++;
+        if (field_end >= end)
+            break;
+        line = field_end + 1;
+    }
+    return num_fields;
+}
+
+/* Whole non-negative number, blanks and quotes around it are allowed */
+static bool
+field_integer(TraceField *field, unsigned long long *value)
+{
+    const char *pos = field->ptr;
+    const char *end = field->ptr + field->len;
+    unsigned long long number = 0;
+    bool digits = false;
+
+    while (pos < end && strchr(" \t\r\"", *pos))
+        pos++;
+    while (end > pos && strchr(" \t\r\"", end[-1]))
+        end--;
+    for (; pos < end; pos++)
+    {
+        if (*pos < '0' || *pos > '9')
+            return false;
+        number = number * 10 + (*pos - '0');
+        digits = true;
+    }
+    *value = number;
+    return digits;
+}
+
+static int
+find_column(TraceField *fields, int num_fields, const char *name)
+{
+    size_t len = strlen(name);
+    int i;
+
+    for (i = 0; i < num_fields; i++)
+    {
+        const char *ptr = fields[i].ptr;
+        size_t field_len = fields[i].len;
+
+        while (field_len > 0 && strchr(" \t\r\"", ptr[field_len - 1]))
+            field_len--;
+        while (field_len > 0 && strchr(" \t\"", *ptr))
+        {
+            ptr++;
+            field_len--;
+        }
+        if (field_len == len && strncasecmp(ptr, name, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/* FNV-1a, chained so several fields make up one relation */
+static uint64_t
+hash_bytes(uint64_t hash, const char *data, size_t len)
+{
+    size_t i;
+
+    if (hash == 0)
+        hash = 0xcbf29ce484222325ULL;
+    for (i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* The splitmix64 finalizer, every bit of the tag depends on the whole block */
+static uint64_t
+buffer_tag(uint64_t relation, unsigned long long block)
+{
+    uint64_t tag = relation ^ (block * 0x9e3779b97f4a7c15ULL);
+
+    tag = (tag ^ (tag >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    tag = (tag ^ (tag >> 27)) * 0x94d049bb133111ebULL;
+    return tag ^ (tag >> 31);
+}
+
+/*
+ * Past the knee more memory buys little, it is the smallest size that gets
+ * MRC_KNEE_SHARE of the miss reduction of the largest candidate.
+ */
+static void
+find_knee(MissRatioCurve *curve)
+{
+    double lowest = curve->miss_ratios[0];
+    double target;
+    int i;
+
+    for (i = 1; i < curve->num_points; i++)
+    {
+        if (curve->miss_ratios[i] < lowest)
+            lowest = curve->miss_ratios[i];
+    }
+    target = lowest + (1.0 - MRC_KNEE_SHARE) * (curve->miss_ratios[0] - lowest);
+    for (i = 0; i < curve->num_points; i++)
+    {
+        if (curve->miss_ratios[i] <= target)
+            break;
+    }
+    curve->knee = curve->sizes[i < curve->num_points ? i : curve->num_points - 1];
+}
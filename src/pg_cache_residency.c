@@ -0,0 +1,353 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cache_residency.c
+ *		Page cache residency of the relations of a data directory.
+ *
+ * Mapping a file does not read it, and mincore() only reports which of the
+ * mapped pages the kernel already holds, so the scan neither warms nor
+ * evicts anything. What is resident is what the workload keeps hot, the
+ * part of the data worth holding in shared_buffers and worth loading back
+ * after a restart.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "pg_cache_residency.h"
+
+typedef struct residency_scan
+{
+    bool keep_blocks;
+    long page_size;
+} ResidencyScan;
+
+/* mincore() vector of a worker, grown to the largest file it maps */
+typedef struct residency_vector
+{
+    size_t len;
+    unsigned char vec[];
+} ResidencyVector;
+
+static bool scan_file(RelationFile *file, void *arg, void **worker_state);
+static bool summarize_residency(CacheResidency *residency);
+static int compare_resident(const void *a, const void *b);
+
+bool
+scan_cache_residency(const char *data_dir, int num_workers, bool keep_blocks, CacheResidency *residency)
+{
+    struct timeval start, end;
+    ResidencyScan scan;
+    int failed;
+
+    memset(residency, 0x00, sizeof *residency);
+    scan.keep_blocks = keep_blocks;
+    scan.page_size = sysconf(_SC_PAGESIZE);
+    gettimeofday(&start, NULL);
+
+    /* Relation and block order, the order autoprewarm loads in */
+    residency->num_files = list_relation_files(data_dir, &residency->files);
+    if (residency->num_files < 0)
+    {
+        residency->num_files = 0;
+        return false;
+    }
+    if (residency->num_files == 0)
+    {
+        fprintf(stderr, "ERROR: no relation files in %s, is it a data directory?\n", data_dir);
+        free_cache_residency(residency);
+        return false;
+    }
+
+    residency->num_workers = run_relation_file_workers(residency->files, residency->num_files, num_workers,
+                                                       scan_file, &scan, &failed);
+    if (failed > 0)
+        fprintf(stderr, "WARNING: %d relation files could not be scanned\n", failed);
+    if (!summarize_residency(residency))
+    {
+        perror("Not possible to allocate memory for the cache residency");
+        free_cache_residency(residency);
+        return false;
+    }
+    gettimeofday(&end, NULL);
+    residency->elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+    return true;
+}
+
+void
+free_cache_residency(CacheResidency *residency)
+{
+    free_relation_files(residency->files, residency->num_files);
+    free(residency->relations);
+    free(residency->databases);
+    memset(residency, 0x00, sizeof *residency);
+}
+
+void
+print_cache_residency(CacheResidency *residency, int top_relations)
+{
+    RelationResidency **hottest;
+    int i;
+
+    printf("LOG: scanned %d relation files, %.1f MB, in %.3f seconds with %d workers\n", residency->num_files,
+           residency->total_size / (1024.0 * 1024.0), residency->elapsed, residency->num_workers);
+    printf("LOG:   resident in page cache : %.1f MB (%.1f%%)\n", residency->total_resident / (1024.0 * 1024.0),
+           residency->total_size > 0 ? 100.0 * residency->total_resident / residency->total_size : 0);
+    for (i = 0; i < residency->num_databases; i++)
+    {
+        DatabaseResidency *database = &residency->databases[i];
+
+        printf("LOG:   %s %-10u : %.1f of %.1f MB resident, %d relations\n",
+               database->database == 0 ? "global  " : "database", database->database,
+               database->resident / (1024.0 * 1024.0), database->size / (1024.0 * 1024.0), database->num_relations);
+    }
+
+    hottest = malloc(residency->num_relations * sizeof *hottest);
+    if (hottest == NULL)
+        return;
+    for (i = 0; i < residency->num_relations; i++)
+        hottest[i] = &residency->relations[i];
+    qsort(hottest, residency->num_relations, sizeof *hottest, compare_resident);
+    printf("LOG:   hottest relations (database/relfilenode):\n");
+    for (i = 0; i < residency->num_relations && i < top_relations && hottest[i]->resident > 0; i++)
+    {
+        char name[64];
+
+        snprintf(name, sizeof name, "%u/%u%s", hottest[i]->database, hottest[i]->relfilenode, get_fork_suffix(hottest[i]->fork));
+        printf("LOG:     %-20s : %.1f of %.1f MB resident (%.0f%%)\n", name, hottest[i]->resident / (1024.0 * 1024.0),
+               hottest[i]->size / (1024.0 * 1024.0), 100.0 * hottest[i]->resident / hottest[i]->size);
+    }
+    free(hottest);
+}
+
+/*
+ * A "<<count>>" line and then one "database,tablespace,relfilenode,fork,block"
+ * line per block, sorted, the way autoprewarm dumps its autoprewarm.blocks.
+ */
+bool
+write_autoprewarm_list(CacheResidency *residency, const char *path)
+{
+    long long count = 0;
+    FILE *fp;
+    int i;
+
+    for (i = 0; i < residency->num_files; i++)
+    {
+        RelationFile *file = &residency->files[i];
+        long long num_blocks = (file->size + RESIDENCY_BLOCK_SIZE - 1) / RESIDENCY_BLOCK_SIZE;
+        long long block;
+
+        if (file->blocks == NULL)
+            continue;
+        for (block = 0; block < num_blocks; block++)
+            count += (file->blocks[block / 8] >> (block % 8)) & 1;
+    }
+
+    fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to create prewarm list %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    fprintf(fp, "<<%lld>>\n", count);
+    for (i = 0; i < residency->num_files; i++)
+    {
+        RelationFile *file = &residency->files[i];
+        long long num_blocks = (file->size + RESIDENCY_BLOCK_SIZE - 1) / RESIDENCY_BLOCK_SIZE;
+        long long block;
+
+        if (file->blocks == NULL)
+            continue;
+        for (block = 0; block < num_blocks; block++)
+        {
+            if ((file->blocks[block / 8] >> (block % 8)) & 1)
+                fprintf(fp, "%u,%u,%u,%d,%lld\n", file->database, file->tablespace, file->relfilenode, file->fork,
+                        (long long)file->segment * RELATION_SEGMENT_BLOCKS + block);
+        }
+    }
+    if (fclose(fp) != 0)
+    {
+        fprintf(stderr, "Failed to write prewarm list %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    printf("LOG: %lld resident blocks written to the prewarm list \"%s\"\n", count, path);
+    return true;
+}
+
+double
+file_cache_residency(const char *path)
+{
+    ResidencyScan scan;
+    RelationFile file;
+    void *vector = NULL;
+    bool ok;
+
+    memset(&file, 0x00, sizeof file);
+    scan.keep_blocks = false;
+    scan.page_size = sysconf(_SC_PAGESIZE);
+    file.path = (char *)path;
+    ok = scan_file(&file, &scan, &vector);
+    free(vector);
+    if (!ok || file.size <= 0)
+        return -1;
+    return (double)file.resident / file.size;
+}
+
+/*
+ * A block is resident when all of its pages are. Files dropped since they
+ * were listed are empty, not a failure.
+ */
+static bool
+scan_file(RelationFile *file, void *arg, void **worker_state)
+{
+    ResidencyScan *scan = arg;
+    ResidencyVector *vector = *worker_state;
+    unsigned char *vec;
+    size_t num_pages;
+    long long num_blocks;
+    long long block;
+    struct stat st;
+    void *data;
+    size_t page;
+    int fd;
+
+    fd = open(file->path, O_RDONLY);
+    if (fd == -1)
+        return errno == ENOENT;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    file->size = st.st_size;
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    num_pages = (st.st_size + scan->page_size - 1) / scan->page_size;
+    if (vector == NULL || num_pages > vector->len)
+    {
+        ResidencyVector *new_vector = realloc(vector, sizeof *vector + num_pages);
+
+        if (new_vector == NULL)
+        {
+            munmap(data, st.st_size);
+            return false;
+        }
+        vector = *worker_state = new_vector;
+        vector->len = num_pages;
+    }
+    vec = vector->vec;
+    if (mincore(data, st.st_size, vec) != 0)
+    {
+        munmap(data, st.st_size);
+        return false;
+    }
+    munmap(data, st.st_size);
+
+    for (page = 0; page < num_pages; page++)
+    {
+        if (vec[page] & 1)
+            file->resident += scan->page_size;
+    }
+    if (file->resident > file->size)
+        file->resident = file->size;
+
+    if (!scan->keep_blocks)
+        return true;
+    num_blocks = (file->size + RESIDENCY_BLOCK_SIZE - 1) / RESIDENCY_BLOCK_SIZE;
+    file->blocks = calloc((num_blocks + 7) / 8, 1);
+    if (file->blocks == NULL)
+        return false;
+    for (block = 0; block < num_blocks; block++)
+    {
+        size_t first = block * RESIDENCY_BLOCK_SIZE / scan->page_size;
+        size_t last = ((block + 1) * RESIDENCY_BLOCK_SIZE - 1) / scan->page_size;
+        bool resident = true;
+
+        if (last >= num_pages)
+            last = num_pages - 1;
+        for (page = first; page <= last && resident; page++)
+            resident = vec[page] & 1;
+        if (resident)
+            file->blocks[block / 8] |= 1 << (block % 8);
+    }
+    return true;
+}
+
+/* The files are sorted, the segments of a relation and the relations of a database are next to each other */
+static bool
+summarize_residency(CacheResidency *residency)
+{
+    int i;
+
+    residency->relations = malloc(residency->num_files * sizeof *residency->relations);
+    residency->databases = malloc(residency->num_files * sizeof *residency->databases);
+    if (residency->relations == NULL || residency->databases == NULL)
+        return false;
+
+    for (i = 0; i < residency->num_files; i++)
+    {
+        RelationFile *file = &residency->files[i];
+        RelationResidency *relation = residency->num_relations > 0 ? &residency->relations[residency->num_relations - 1] : NULL;
+        DatabaseResidency *database = residency->num_databases > 0 ? &residency->databases[residency->num_databases - 1] : NULL;
+
+        if (database == NULL || database->database != file->database)
+        {
+            database = &residency->databases[residency->num_databases++];
+            memset(database, 0x00, sizeof *database);
+            database->database = file->database;
+        }
+        if (relation == NULL || relation->database != file->database ||
+            relation->relfilenode != file->relfilenode || relation->fork != file->fork)
+        {
+            relation = &residency->relations[residency->num_relations++];
+            memset(relation, 0x00, sizeof *relation);
+            relation->database = file->database;
+            relation->relfilenode = file->relfilenode;
+            relation->fork = file->fork;
+            database->num_relations++;
+        }
+        relation->size += file->size;
+        relation->resident += file->resident;
+        database->size += file->size;
+        database->resident += file->resident;
+        residency->total_size += file->size;
+        residency->total_resident += file->resident;
+    }
+    return true;
+}
+
+static int
+compare_resident(const void *a, const void *b)
+{
+    const RelationResidency *ra = *(RelationResidency * const *) a;
+    const RelationResidency *rb = *(RelationResidency * const *) b;
+
+    if (ra->resident != rb->resident)
+        return ra->resident > rb->resident ? -1 : 1;
+    return 0;
+}
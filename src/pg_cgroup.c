@@ -0,0 +1,195 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cgroup.c
+ *		Resource limits of the control group we are running in.
+ *
+ * A pod sees all the memory and CPUs of its node, what it may really use
+ * is the limit of its cgroup. Both cgroup v2 and the v1 memory and cpu
+ * controllers are understood, for v2 the tightest limit of the cgroup and
+ * all its ancestors counts.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "pg_cgroup.h"
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+#define CGROUP_V1_MEMORY_LIMIT CGROUP_ROOT "/memory/memory.limit_in_bytes"
+#define CGROUP_V1_CPU_QUOTA CGROUP_ROOT "/cpu/cpu.cfs_quota_us"
+#define CGROUP_V1_CPU_PERIOD CGROUP_ROOT "/cpu/cpu.cfs_period_us"
+
+/* v1 reports no memory limit as the largest page aligned long */
+#define CGROUP_V1_NO_LIMIT (LLONG_MAX - 4095)
+
+static bool get_cgroup_dir(char *dir, size_t len);
+static bool read_first_line(const char *path, char *buf, size_t len);
+
+bool
+cgroup_file_path(const char *file, char *path, size_t len)
+{
+    char dir[PATH_MAX];
+
+    if (!get_cgroup_dir(dir, sizeof dir))
+        return false;
+    return snprintf(path, len, "%s/%s", dir, file) < (int)len;
+}
+
+long long
+cgroup_memory_limit(void)
+{
+    char dir[PATH_MAX];
+    char path[PATH_MAX + 32];
+    char buf[64];
+    long long limit = -1;
+
+    if (get_cgroup_dir(dir, sizeof dir))
+    {
+        /* walk up to the root, the parents may be tighter */
+        for (;;)
+        {
+            char *slash;
+
+            snprintf(path, sizeof path, "%s/%s", dir, CGROUP_MEMORY_FILE);
+            if (read_first_line(path, buf, sizeof buf) && strcmp(buf, "max") != 0)
+            {
+                long long value = strtoll(buf, NULL, 10);
+
+                if (value > 0 && (limit < 0 || value < limit))
+                    limit = value;
+            }
+            if (strcmp(dir, CGROUP_ROOT) == 0 || (slash = strrchr(dir, '/')) == NULL)
+                break;
+            *slash = '\0';
+        }
+        return limit;
+    }
+
+    if (read_first_line(CGROUP_V1_MEMORY_LIMIT, buf, sizeof buf))
+    {
+        long long value = strtoll(buf, NULL, 10);
+
+        if (value > 0 && value < CGROUP_V1_NO_LIMIT)
+            limit = value;
+    }
+    return limit;
+}
+
+double
+cgroup_cpu_limit(void)
+{
+    char dir[PATH_MAX];
+    char path[PATH_MAX + 32];
+    char buf[64];
+    double limit = -1;
+
+    if (get_cgroup_dir(dir, sizeof dir))
+    {
+        for (;;)
+        {
+            char quota[32];
+            long long period;
+            char *slash;
+
+            /* "max 100000" or "<quota> <period>" */
+            snprintf(path, sizeof path, "%s/%s", dir, CGROUP_CPU_FILE);
+            if (read_first_line(path, buf, sizeof buf) &&
+                sscanf(buf, "%31s %lld", quota, &period) == 2 &&
+                strcmp(quota, "max") != 0 && period > 0)
+            {
+                double value = (double)strtoll(quota, NULL, 10) / period;
+
+                if (value > 0 && (limit < 0 || value < limit))
+                    limit = value;
+            }
+            if (strcmp(dir, CGROUP_ROOT) == 0 || (slash = strrchr(dir, '/')) == NULL)
+                break;
+            *slash = '\0';
+        }
+        return limit;
+    }
+
+    if (read_first_line(CGROUP_V1_CPU_QUOTA, buf, sizeof buf))
+    {
+        long long quota = strtoll(buf, NULL, 10);
+
+        if (quota > 0 && read_first_line(CGROUP_V1_CPU_PERIOD, buf, sizeof buf))
+        {
+            long long period = strtoll(buf, NULL, 10);
+
+            if (period > 0)
+                limit = (double)quota / period;
+        }
+    }
+    return limit;
+}
+
+/*
+ * Directory of our cgroup v2, from the "0::<path>" line of
+ * /proc/self/cgroup. Inside a cgroup namespace the path is "/".
+ */
+static bool
+get_cgroup_dir(char *dir, size_t len)
+{
+    FILE *fp;
+    char line[PATH_MAX + 16];
+    bool found = false;
+
+    fp = fopen("/proc/self/cgroup", "r");
+    if (fp == NULL)
+        return false;
+    while (fgets(line, sizeof line, fp))
+    {
+        if (strncmp(line, "0::", 3) == 0)
+        {
+            char *cgroup = line + 3;
+            char check[PATH_MAX + 32];
+            FILE *controllers;
+
+            cgroup[strcspn(cgroup, "\n")] = '\0';
+            if (strcmp(cgroup, "/") == 0)
+                cgroup[0] = '\0';
+            if (snprintf(dir, len, "%s%s", CGROUP_ROOT, cgroup) >= (int)len)
+                break;
+
+            /* a hybrid v1 setup has the line too, but no v2 interface files */
+            snprintf(check, sizeof check, "%s/cgroup.controllers", dir);
+            controllers = fopen(check, "r");
+            if (controllers)
+            {
+                fclose(controllers);
+                found = true;
+            }
+            break;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+static bool
+read_first_line(const char *path, char *buf, size_t len)
+{
+    FILE *fp = fopen(path, "r");
+    bool ok;
+
+    if (fp == NULL)
+        return false;
+    ok = fgets(buf, len, fp) != NULL;
+    fclose(fp);
+    if (ok)
+        buf[strcspn(buf, "\n")] = '\0';
+    return ok;
+}
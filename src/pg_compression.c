@@ -0,0 +1,1225 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_compression.c
+ *		How well and how fast pglz, lz4 and zstd compress the pages of a
+ *		data directory, and which of them wal_compression and
+ *		default_toast_compression should use.
+ *
+ * Compressing saves I/O and costs CPU, which of the two is scarcer
+ * depends on the host and on the data. Random pages of the tables, of
+ * the TOAST tables and of the WAL are compressed with every algorithm the
+ * server knows, from every core at once, for the ratio and the speed on
+ * the data itself. pglz is built in, it follows pg_lzcompress.c of the
+ * server, lz4 and zstd are the libraries installed on the host, loaded
+ * when they are there.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "pg_compression.h"
+#include "pg_data_dir.h"
+#include "pg_page.h"
+#include "pg_bench.h"
+
+/* A TOAST chunk is a tuple of chunk_id, chunk_seq and chunk_data without nulls */
+#define TOAST_CHUNK_ATTS 3
+#define TOAST_CHUNK_HOFF 24
+#define TOAST_CHUNK_DATA_OFFSET 8
+
+/* XLOG_BLCKSZ of nearly every build, and the magic of a WAL page header */
+#define WAL_PAGE_SIZE 8192
+#define XLP_MAGIC_MASK 0xFE00
+#define XLP_MAGIC_BASE 0xD000
+
+#define PROC_STAT_FILE "/proc/stat"
+
+/* Same pages on every run over the same data */
+#define COMPRESSION_RANDOM_SEED 0x9E3779B97F4A7C15ULL
+
+/* Room for what lz4 and zstd make of a page that does not compress */
+#define COMPRESS_BOUND(len) ((len) + (len) / 128 + 64)
+
+/* pg_lzcompress.c, and PGLZ_strategy_default that TOAST and WAL use */
+#define PGLZ_MAX_HISTORY_LISTS 8192
+#define PGLZ_HISTORY_SIZE 4096
+#define PGLZ_MAX_MATCH 273
+#define PGLZ_MAX_OFFSET 0x0fff
+#define PGLZ_MIN_INPUT_SIZE 32
+#define PGLZ_MIN_COMP_RATE 25
+#define PGLZ_FIRST_SUCCESS_BY 1024
+#define PGLZ_MATCH_SIZE_GOOD 128
+#define PGLZ_MATCH_SIZE_DROP 10
+
+typedef enum COMPRESSION_METHOD
+{
+    METHOD_PGLZ,
+    METHOD_LZ4,
+    METHOD_ZSTD
+} COMPRESSION_METHOD;
+
+typedef struct compression_algorithm
+{
+    const char *name;
+    COMPRESSION_METHOD method;
+    int level;
+    const char *wal_value;      /* wal_compression from 15 on, NULL when the server can not */
+    const char *toast_value;    /* default_toast_compression, NULL when the server can not */
+} CompressionAlgorithm;
+
+static const CompressionAlgorithm algorithms[NUM_COMPRESSION_ALGORITHMS] = {
+    {"pglz", METHOD_PGLZ, 0, "pglz", "pglz"},
+    {"lz4", METHOD_LZ4, 0, "lz4", "lz4"},
+    {"zstd level 1", METHOD_ZSTD, 1, NULL, NULL},
+    {"zstd level 3", METHOD_ZSTD, 3, "zstd", NULL},
+    {"zstd level 9", METHOD_ZSTD, 9, NULL, NULL}
+};
+
+static const char *source_names[NUM_COMPRESSION_SOURCES] = {"heap pages", "TOAST pages", "WAL pages"};
+
+/* The functions of liblz4 and libzstd the server calls, NULL when not installed */
+typedef struct compression_libraries
+{
+    int (*lz4_compress)(const char *src, char *dst, int src_size, int dst_capacity);
+    int (*lz4_decompress)(const char *src, char *dst, int compressed_size, int dst_capacity);
+    size_t (*zstd_compress)(void *dst, size_t dst_capacity, const void *src, size_t src_size, int level);
+    size_t (*zstd_decompress)(void *dst, size_t dst_capacity, const void *src, size_t compressed_size);
+    unsigned (*zstd_is_error)(size_t code);
+} CompressionLibraries;
+
+typedef struct pglz_entry
+{
+    struct pglz_entry *next;
+    struct pglz_entry *prev;
+    int hindex;
+    const char *pos;
+} PglzEntry;
+
+/* The history of pglz, static in the server, one per thread here */
+typedef struct pglz_state
+{
+    int16_t hist_start[PGLZ_MAX_HISTORY_LISTS];
+    PglzEntry hist_entries[PGLZ_HISTORY_SIZE + 1];
+} PglzState;
+
+typedef struct pglz_output
+{
+    unsigned char *bp;
+    unsigned char *ctrlp;
+    unsigned char ctrlb;
+    unsigned char ctrl;
+} PglzOutput;
+
+/* Sampled pages one after the other */
+typedef struct page_sample
+{
+    unsigned char *data;
+    int *offsets;
+    int *lengths;
+    int num_pages;
+    int page_size;
+    long long bytes;
+} PageSample;
+
+/* What an algorithm made of the sample, 0 for the pages stored raw */
+typedef struct compressed_sample
+{
+    unsigned char *data;
+    int *lengths;
+    int page_bound;
+} CompressedSample;
+
+typedef struct bench_task
+{
+    const CompressionAlgorithm *algorithm;
+    PageSample *sample;
+    CompressedSample *compressed;
+    bool decompress;
+    double speed;               /* raw bytes a second */
+    long long checksum;         /* of the lengths, so no work is optimized away */
+    bool failed;
+} BenchTask;
+
+static CompressionLibraries libraries;
+static pthread_once_t libraries_once = PTHREAD_ONCE_INIT;
+
+static void load_libraries(void);
+static void *load_library(const char **names);
+static bool algorithm_available(const CompressionAlgorithm *algorithm);
+static bool init_sample(PageSample *sample, int page_size);
+static void free_sample(PageSample *sample);
+static void add_page(PageSample *sample, const unsigned char *page, int lower, int upper);
+static bool sample_relation_pages(const char *data_dir, long block_size, PageSample *heap, PageSample *toast,
+                                  uint64_t *random);
+static bool sample_wal_pages(const char *wal_dir, PageSample *wal, uint64_t *random);
+static bool read_random_page(char **paths, long long *ends, int num_files, int page_size, unsigned char *page,
+                             uint64_t *random);
+static COMPRESSION_SOURCE classify_page(const unsigned char *page, long block_size, int *lower, int *upper);
+static bool is_toast_chunk(const unsigned char *tuple, unsigned int len);
+static double measure_cpu_idle(void);
+static bool read_cpu_times(unsigned long long *idle, unsigned long long *total);
+static bool bench_algorithm(PageSample *sample, const CompressionAlgorithm *algorithm, int num_workers,
+                            CompressionResult *result);
+static bool compress_sample(PageSample *sample, const CompressionAlgorithm *algorithm, CompressedSample *compressed,
+                            CompressionResult *result);
+static double run_bench_workers(BenchTask *task, int num_workers);
+static void *bench_worker(void *arg);
+static int compress_page(const CompressionAlgorithm *algorithm, const unsigned char *src, int len,
+                         unsigned char *dst, int capacity, PglzState *state);
+static int decompress_page(const CompressionAlgorithm *algorithm, const unsigned char *src, int len,
+                           unsigned char *dst, int raw_len);
+static int pglz_compress(PglzState *state, const char *source, int slen, char *dest);
+static int pglz_decompress(const char *source, int slen, char *dest, int rawsize);
+
+bool
+benchmark_compression(const char *data_dir, const char *wal_dir, long block_size, int num_workers,
+                      CompressionBench *bench)
+{
+    PageSample samples[NUM_COMPRESSION_SOURCES];
+    struct timeval start;
+    uint64_t random = COMPRESSION_RANDOM_SEED;
+    int source, i;
+
+    memset(bench, 0x00, sizeof *bench);
+    memset(samples, 0x00, sizeof samples);
+    gettimeofday(&start, NULL);
+    if (block_size <= 0)
+        block_size = DEFAULT_BLOCK_SIZE;
+    if (num_workers < 1)
+        num_workers = 1;
+    if (num_workers > COMPRESSION_MAX_WORKERS)
+        num_workers = COMPRESSION_MAX_WORKERS;
+    bench->num_workers = num_workers;
+
+    if (!init_sample(&samples[SOURCE_HEAP], block_size) || !init_sample(&samples[SOURCE_TOAST], block_size) ||
+        !init_sample(&samples[SOURCE_WAL], WAL_PAGE_SIZE))
+    {
+        perror("Not possible to allocate memory for the compression sample");
+        for (source = 0; source < NUM_COMPRESSION_SOURCES; source++)
+            free_sample(&samples[source]);
+        return false;
+    }
+    if (!sample_relation_pages(data_dir, block_size, &samples[SOURCE_HEAP], &samples[SOURCE_TOAST], &random) ||
+        !sample_wal_pages(wal_dir, &samples[SOURCE_WAL], &random))
+    {
+        for (source = 0; source < NUM_COMPRESSION_SOURCES; source++)
+            free_sample(&samples[source]);
+        return false;
+    }
+
+    /* What the host does already is measured before the benchmark adds to it */
+    bench->cpu_idle = measure_cpu_idle();
+    bench->free_cores = bench->cpu_idle * num_workers;
+
+    pthread_once(&libraries_once, load_libraries);
+    for (source = 0; source < NUM_COMPRESSION_SOURCES; source++)
+    {
+        bench->num_pages[source] = samples[source].num_pages;
+        for (i = 0; i < NUM_COMPRESSION_ALGORITHMS; i++)
+        {
+            if (samples[source].num_pages == 0 || !algorithm_available(&algorithms[i]))
+                continue;
+            if (!bench_algorithm(&samples[source], &algorithms[i], num_workers, &bench->results[source][i]))
+            {
+                for (source = 0; source < NUM_COMPRESSION_SOURCES; source++)
+                    free_sample(&samples[source]);
+                return false;
+            }
+        }
+    }
+    for (source = 0; source < NUM_COMPRESSION_SOURCES; source++)
+        free_sample(&samples[source]);
+
+    bench->elapsed = bench_elapsed(&start);
+    return true;
+}
+
+void
+print_compression_bench(CompressionBench *bench)
+{
+    int source, i;
+
+    printf("LOG: compressed %d heap, %d TOAST and %d WAL pages on %d workers in %.3f seconds\n",
+           bench->num_pages[SOURCE_HEAP], bench->num_pages[SOURCE_TOAST], bench->num_pages[SOURCE_WAL],
+           bench->num_workers, bench->elapsed);
+    printf("LOG:   CPU idle               : %.1f%%, %.1f cores free\n", 100.0 * bench->cpu_idle, bench->free_cores);
+    for (source = 0; source < NUM_COMPRESSION_SOURCES; source++)
+    {
+        if (bench->num_pages[source] == 0)
+            continue;
+        printf("LOG:   %s:\n", source_names[source]);
+        for (i = 0; i < NUM_COMPRESSION_ALGORITHMS; i++)
+        {
+            CompressionResult *result = &bench->results[source][i];
+
+            if (!result->available)
+            {
+                printf("LOG:     %-20s : not installed\n", algorithms[i].name);
+                continue;
+            }
+            printf("LOG:     %-20s : ratio %.2f, compress %.1f MB/s, decompress %.1f MB/s a core\n", algorithms[i].name,
+                   result->ratio, result->compress_speed / (1024.0 * 1024.0), result->decompress_speed / (1024.0 * 1024.0));
+        }
+    }
+}
+
+const char *
+get_compression_algorithm_name(int algorithm)
+{
+    return algorithm >= 0 && algorithm < NUM_COMPRESSION_ALGORITHMS ? algorithms[algorithm].name : "none";
+}
+
+bool
+choose_wal_compression(CompressionBench *bench, int server_version, double disk_speed, double fpi_share,
+                       CompressionChoice *choice)
+{
+    double disk = disk_speed * 1024.0 * 1024.0;
+    double share = fpi_share < 0 ? 1.0 : fpi_share;
+    bool pre_15 = server_version > 0 && server_version < 150000;
+    int i;
+
+    if (disk <= 0 || bench->num_pages[SOURCE_HEAP] == 0)
+        return false;
+    choice->value = "off";
+    choice->algorithm = -1;
+    choice->throughput = choice->disk_throughput = disk;
+    if (share <= 0)
+        return true;
+
+    for (i = 0; i < NUM_COMPRESSION_ALGORITHMS; i++)
+    {
+        CompressionResult *result = &bench->results[SOURCE_HEAP][i];
+        double ratio, throughput;
+
+        if (!result->available || algorithms[i].wal_value == NULL || (pre_15 && algorithms[i].method != METHOD_PGLZ))
+            continue;
+        /* Only the full page images shrink, and only they cost CPU */
+        ratio = 1.0 / (1.0 - share + share / result->ratio);
+        throughput = fmin(result->compress_speed * bench->free_cores / share, disk * ratio);
+        if (throughput > choice->throughput)
+        {
+            choice->throughput = throughput;
+            choice->algorithm = i;
+            choice->value = pre_15 ? "on" : algorithms[i].wal_value;
+        }
+    }
+    if (choice->algorithm >= 0 && choice->throughput < disk * (1.0 + COMPRESSION_MIN_GAIN))
+    {
+        choice->value = "off";
+        choice->algorithm = -1;
+        choice->throughput = disk;
+    }
+    return true;
+}
+
+bool
+choose_toast_compression(CompressionBench *bench, int server_version, double disk_speed, CompressionChoice *choice)
+{
+    COMPRESSION_SOURCE source = bench->num_pages[SOURCE_TOAST] >= COMPRESSION_MIN_TOAST_PAGES ? SOURCE_TOAST : SOURCE_HEAP;
+    double disk = disk_speed * 1024.0 * 1024.0;
+    int i;
+
+    if (disk <= 0 || bench->num_pages[source] == 0 || (server_version > 0 && server_version < 140000))
+        return false;
+    choice->value = NULL;
+    choice->algorithm = -1;
+    choice->throughput = 0;
+    choice->disk_throughput = disk;
+
+    /* TOAST values are read back more than WAL, writing and reading count the same */
+    for (i = 0; i < NUM_COMPRESSION_ALGORITHMS; i++)
+    {
+        CompressionResult *result = &bench->results[source][i];
+        double write, read;
+
+        if (!result->available || algorithms[i].toast_value == NULL)
+            continue;
+        write = fmin(result->compress_speed * bench->free_cores, disk * result->ratio);
+        read = fmin(result->decompress_speed * bench->free_cores, disk * result->ratio);
+        if ((write + read) / 2 > choice->throughput)
+        {
+            choice->throughput = (write + read) / 2;
+            choice->algorithm = i;
+            choice->value = algorithms[i].toast_value;
+        }
+    }
+    return choice->value != NULL;
+}
+
+static void
+load_libraries(void)
+{
+    static const char *lz4_names[] = {"liblz4.so.1", "liblz4.so", NULL};
+    static const char *zstd_names[] = {"libzstd.so.1", "libzstd.so", NULL};
+    void *lz4 = load_library(lz4_names);
+    void *zstd = load_library(zstd_names);
+
+    if (lz4)
+    {
+        *(void **)&libraries.lz4_compress = dlsym(lz4, "LZ4_compress_default");
+        *(void **)&libraries.lz4_decompress = dlsym(lz4, "LZ4_decompress_safe");
+    }
+    if (zstd)
+    {
+        *(void **)&libraries.zstd_compress = dlsym(zstd, "ZSTD_compress");
+        *(void **)&libraries.zstd_decompress = dlsym(zstd, "ZSTD_decompress");
+        *(void **)&libraries.zstd_is_error = dlsym(zstd, "ZSTD_isError");
+    }
+}
+
+/* The libraries stay loaded for the life of the process */
+static void *
+load_library(const char **names)
+{
+    void *handle = NULL;
+
+    for (; *names && handle == NULL; names++)
+        handle = dlopen(*names, RTLD_NOW | RTLD_LOCAL);
+    return handle;
+}
+
+static bool
+algorithm_available(const CompressionAlgorithm *algorithm)
+{
+    switch (algorithm->method)
+    {
+    case METHOD_PGLZ:
+        return true;
+    case METHOD_LZ4:
+        return libraries.lz4_compress && libraries.lz4_decompress;
+    case METHOD_ZSTD:
+        return libraries.zstd_compress && libraries.zstd_decompress && libraries.zstd_is_error;
+    }
+    return false;
+}
+
+static bool
+init_sample(PageSample *sample, int page_size)
+{
+    sample->page_size = page_size;
+    sample->data = malloc((size_t)COMPRESSION_SAMPLE_PAGES * page_size);
+    sample->offsets = malloc(COMPRESSION_SAMPLE_PAGES * sizeof *sample->offsets);
+    sample->lengths = malloc(COMPRESSION_SAMPLE_PAGES * sizeof *sample->lengths);
+    return sample->data && sample->offsets && sample->lengths;
+}
+
+static void
+free_sample(PageSample *sample)
+{
+    free(sample->data);
+    free(sample->offsets);
+    free(sample->lengths);
+    memset(sample, 0x00, sizeof *sample);
+}
+
+/* The free space between lower and upper is left out, as the server does for a full page image */
+static void
+add_page(PageSample *sample, const unsigned char *page, int lower, int upper)
+{
+    unsigned char *to = sample->data + sample->bytes;
+    int length = sample->page_size - (upper - lower);
+
+    memcpy(to, page, lower);
+    memcpy(to + lower, page + upper, sample->page_size - upper);
+    sample->offsets[sample->num_pages] = sample->bytes;
+    sample->lengths[sample->num_pages] = length;
+    sample->num_pages++;
+    sample->bytes += length;
+}
+
+/*
+ * Main fork blocks drawn at random over all of them, so that larger
+ * tables give more pages. Index, sequence and empty pages are skipped.
+ */
+static bool
+sample_relation_pages(const char *data_dir, long block_size, PageSample *heap, PageSample *toast, uint64_t *random)
+{
+    RelationFile *files;
+    char **paths;
+    long long *ends;
+    long long total = 0;
+    unsigned char *page;
+    int num_files, num_main = 0;
+    int draw, i;
+
+    num_files = list_relation_files(data_dir, &files);
+    if (num_files < 0)
+        return false;
+    paths = malloc((num_files + 1) * sizeof *paths);
+    ends = malloc((num_files + 1) * sizeof *ends);
+    page = malloc(block_size);
+    if (paths == NULL || ends == NULL || page == NULL)
+    {
+        perror("Not possible to allocate memory for the compression sample");
+        free(paths);
+        free(ends);
+        free(page);
+        free_relation_files(files, num_files);
+        return false;
+    }
+    for (i = 0; i < num_files; i++)
+    {
+        struct stat st;
+
+        if (files[i].fork != FORK_MAIN || stat(files[i].path, &st) != 0 || st.st_size < block_size)
+            continue;
+        total += st.st_size / block_size;
+        paths[num_main] = files[i].path;
+        ends[num_main++] = total;
+    }
+
+    for (draw = 0; draw < COMPRESSION_SAMPLE_DRAWS && total > 0 &&
+                   (heap->num_pages < COMPRESSION_SAMPLE_PAGES || toast->num_pages < COMPRESSION_SAMPLE_PAGES); draw++)
+    {
+        PageSample *sample;
+        int lower, upper;
+
+        if (!read_random_page(paths, ends, num_main, block_size, page, random))
+            continue;
+        switch (classify_page(page, block_size, &lower, &upper))
+        {
+        case SOURCE_HEAP:
+            sample = heap;
+            break;
+        case SOURCE_TOAST:
+            sample = toast;
+            break;
+        default:
+            continue;
+        }
+        if (sample->num_pages < COMPRESSION_SAMPLE_PAGES)
+            add_page(sample, page, lower, upper);
+    }
+    free(paths);
+    free(ends);
+    free(page);
+    free_relation_files(files, num_files);
+    return true;
+}
+
+/* Pages of the segments that hold WAL, a directory without any is not an error */
+static bool
+sample_wal_pages(const char *wal_dir, PageSample *wal, uint64_t *random)
+{
+    char **paths = NULL;
+    long long *ends = NULL;
+    long long total = 0;
+    unsigned char page[WAL_PAGE_SIZE];
+    struct dirent *entry;
+    int num_files = 0, capacity = 0;
+    int draw, i;
+    DIR *dir;
+
+    dir = opendir(wal_dir);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "WARNING: no WAL pages are sampled, %s could not be opened reason:%s\n", wal_dir, strerror(errno));
+        return true;
+    }
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char path[PATH_MAX];
+        struct stat st;
+
+        if (strlen(entry->d_name) != 24 || strspn(entry->d_name, "0123456789ABCDEF") != 24)
+            continue;
+        snprintf(path, sizeof path, "%s/%s", wal_dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < WAL_PAGE_SIZE)
+            continue;
+        if (num_files == capacity)
+        {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            char **new_paths = realloc(paths, new_capacity * sizeof *paths);
+            long long *new_ends = new_paths ? realloc(ends, new_capacity * sizeof *ends) : NULL;
+
+            if (new_paths)
+                paths = new_paths;
+            if (new_ends == NULL)
+            {
+                perror("Not possible to allocate memory for the compression sample");
+                closedir(dir);
+                for (i = 0; i < num_files; i++)
+                    free(paths[i]);
+                free(paths);
+                free(ends);
+                return false;
+            }
+            ends = new_ends;
+            capacity = new_capacity;
+        }
+        paths[num_files] = strdup(path);
+        if (paths[num_files] == NULL)
+            continue;
+        total += st.st_size / WAL_PAGE_SIZE;
+        ends[num_files++] = total;
+    }
+    closedir(dir);
+
+    for (draw = 0; draw < COMPRESSION_SAMPLE_DRAWS && total > 0 && wal->num_pages < COMPRESSION_SAMPLE_PAGES; draw++)
+    {
+        uint16_t magic;
+
+        if (!read_random_page(paths, ends, num_files, WAL_PAGE_SIZE, page, random))
+            continue;
+        /* Pages past the end of the WAL are zeros */
+        memcpy(&magic, page, sizeof magic);
+        if ((magic & XLP_MAGIC_MASK) == XLP_MAGIC_BASE)
+            add_page(wal, page, WAL_PAGE_SIZE, WAL_PAGE_SIZE);
+    }
+    for (i = 0; i < num_files; i++)
+        free(paths[i]);
+    free(paths);
+    free(ends);
+    return true;
+}
+
+/* ends[i] is the number of pages in the files up to and with paths[i] */
+static bool
+read_random_page(char **paths, long long *ends, int num_files, int page_size, unsigned char *page, uint64_t *random)
+{
+    long long block = bench_random(random) % ends[num_files - 1];
+    int low = 0, high = num_files - 1;
+    long long first;
+    ssize_t len;
+    int fd;
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+
+        if (ends[middle] > block)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    first = low > 0 ? ends[low - 1] : 0;
+    fd = open(paths[low], O_RDONLY);
+    if (fd == -1)
+        return false;
+    len = pread(fd, page, page_size, (off_t)(block - first) * page_size);
+    close(fd);
+    return len == page_size;
+}
+
+/* SOURCE_WAL stands for a page that is not sampled */
+static COMPRESSION_SOURCE
+classify_page(const unsigned char *page, long block_size, int *lower, int *upper)
+{
+    uint16_t pd_lower, pd_upper, special, pagesize_version;
+    int num_items, num_chunks = 0;
+    int i;
+
+    memcpy(&pd_lower, page + 12, sizeof pd_lower);
+    memcpy(&pd_upper, page + 14, sizeof pd_upper);
+    memcpy(&special, page + 16, sizeof special);
+    memcpy(&pagesize_version, page + 18, sizeof pagesize_version);
+    if (pd_upper == 0 || pagesize_version != (block_size | PAGE_LAYOUT_VERSION) || special != block_size ||
+        pd_lower < PAGE_HEADER_SIZE || pd_lower > pd_upper || pd_upper > special)
+        return SOURCE_WAL;
+    *lower = pd_lower;
+    *upper = pd_upper;
+
+    num_items = (pd_lower - PAGE_HEADER_SIZE) / ITEM_ID_SIZE;
+    for (i = 0; i < num_items; i++)
+    {
+        uint32_t item;
+        unsigned int item_offset, item_len;
+
+        memcpy(&item, page + PAGE_HEADER_SIZE + i * ITEM_ID_SIZE, sizeof item);
+        item_offset = item & 0x7FFF;
+        item_len = item >> 17;
+        if (((item >> 15) & 0x03) != LP_NORMAL)
+            continue;
+        if (item_offset < pd_upper || item_offset + item_len > special || !is_toast_chunk(page + item_offset, item_len))
+            return SOURCE_HEAP;
+        num_chunks++;
+    }
+    return num_chunks > 0 ? SOURCE_TOAST : SOURCE_HEAP;
+}
+
+/* chunk_data is a plain bytea that fills the rest of the tuple */
+static bool
+is_toast_chunk(const unsigned char *tuple, unsigned int len)
+{
+    const unsigned char *data = tuple + TOAST_CHUNK_HOFF + TOAST_CHUNK_DATA_OFFSET;
+    uint16_t infomask, infomask2;
+    uint32_t header;
+    unsigned int data_len;
+
+    if (len <= TOAST_CHUNK_HOFF + TOAST_CHUNK_DATA_OFFSET)
+        return false;
+    memcpy(&infomask2, tuple + TUPLE_INFOMASK2_OFFSET, sizeof infomask2);
+    memcpy(&infomask, tuple + TUPLE_INFOMASK_OFFSET, sizeof infomask);
+    if ((infomask2 & HEAP_NATTS_MASK) != TOAST_CHUNK_ATTS || (infomask & HEAP_HASNULL) ||
+        tuple[TUPLE_HOFF_OFFSET] != TOAST_CHUNK_HOFF)
+        return false;
+
+    /* A one byte varlena header keeps the length in its upper bits, a four byte one too */
+    if (data[0] & 0x01)
+        data_len = data[0] >> 1;
+    else
+    {
+        if (len < TOAST_CHUNK_HOFF + TOAST_CHUNK_DATA_OFFSET + sizeof header)
+            return false;
+        memcpy(&header, data, sizeof header);
+        if (header & 0x02)
+            return false;
+        data_len = header >> 2;
+    }
+    return data_len > 1 && TOAST_CHUNK_HOFF + TOAST_CHUNK_DATA_OFFSET + data_len == len;
+}
+
+/* Share of the CPU time of the host that was idle, 1 when it can not be read */
+static double
+measure_cpu_idle(void)
+{
+    unsigned long long idle_before, total_before, idle_after, total_after;
+
+    if (!read_cpu_times(&idle_before, &total_before))
+    {
+        fprintf(stderr, "WARNING: %s could not be read, all CPUs count as idle\n", PROC_STAT_FILE);
+        return 1.0;
+    }
+    sleep(COMPRESSION_LOAD_SECONDS);
+    if (!read_cpu_times(&idle_after, &total_after) || total_after <= total_before)
+        return 1.0;
+    return (double)(idle_after - idle_before) / (total_after - total_before);
+}
+
+/* The cpu line of /proc/stat, idle counts the time waiting for I/O as well */
+static bool
+read_cpu_times(unsigned long long *idle, unsigned long long *total)
+{
+    unsigned long long times[8] = {0};
+    FILE *fp = fopen(PROC_STAT_FILE, "r");
+    int fields, i;
+
+    if (fp == NULL)
+        return false;
+    fields = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &times[0], &times[1], &times[2], &times[3],
+                    &times[4], &times[5], &times[6], &times[7]);
+    fclose(fp);
+    if (fields < 4)
+        return false;
+    *idle = times[3] + times[4];
+    *total = 0;
+    for (i = 0; i < 8; i++)
+        *total += times[i];
+    return true;
+}
+
+static bool
+bench_algorithm(PageSample *sample, const CompressionAlgorithm *algorithm, int num_workers, CompressionResult *result)
+{
+    CompressedSample compressed;
+    BenchTask task;
+
+    memset(&task, 0x00, sizeof task);
+    compressed.page_bound = COMPRESS_BOUND(sample->page_size);
+    compressed.data = malloc((size_t)sample->num_pages * compressed.page_bound);
+    compressed.lengths = malloc(sample->num_pages * sizeof *compressed.lengths);
+    if (compressed.data == NULL || compressed.lengths == NULL)
+    {
+        perror("Not possible to allocate memory for the compression benchmark");
+        free(compressed.data);
+        free(compressed.lengths);
+        return false;
+    }
+    if (!compress_sample(sample, algorithm, &compressed, result))
+    {
+        free(compressed.data);
+        free(compressed.lengths);
+        return false;
+    }
+    if (!result->available)
+    {
+        free(compressed.data);
+        free(compressed.lengths);
+        return true;
+    }
+
+    task.algorithm = algorithm;
+    task.sample = sample;
+    task.compressed = &compressed;
+    result->compress_speed = run_bench_workers(&task, num_workers);
+    task.decompress = true;
+    result->decompress_speed = run_bench_workers(&task, num_workers);
+    free(compressed.data);
+    free(compressed.lengths);
+    return result->compress_speed >= 0 && result->decompress_speed >= 0;
+}
+
+/*
+ * Compress every page once for the ratio and check that it decompresses
+ * to what it was, the algorithm is not available when it does not. A page
+ * is stored raw when compressing does not make it smaller, or pglz gives
+ * up on it, as the server does. Returns false when out of memory.
+ */
+static bool
+compress_sample(PageSample *sample, const CompressionAlgorithm *algorithm, CompressedSample *compressed,
+                CompressionResult *result)
+{
+    PglzState *state = algorithm->method == METHOD_PGLZ ? malloc(sizeof *state) : NULL;
+    unsigned char *check = malloc(sample->page_size);
+    int i;
+
+    if (check == NULL || (algorithm->method == METHOD_PGLZ && state == NULL))
+    {
+        perror("Not possible to allocate memory for the compression benchmark");
+        free(state);
+        free(check);
+        return false;
+    }
+    result->raw_bytes = sample->bytes;
+    result->stored_bytes = 0;
+    for (i = 0; i < sample->num_pages; i++)
+    {
+        const unsigned char *page = sample->data + sample->offsets[i];
+        unsigned char *to = compressed->data + (size_t)i * compressed->page_bound;
+        int len = compress_page(algorithm, page, sample->lengths[i], to, compressed->page_bound, state);
+
+        if (len > 0 && (decompress_page(algorithm, to, len, check, sample->lengths[i]) != sample->lengths[i] ||
+                        memcmp(check, page, sample->lengths[i]) != 0))
+        {
+            fprintf(stderr, "WARNING: %s does not decompress a page to what it was, left out\n", algorithm->name);
+            free(state);
+            free(check);
+            result->available = false;
+            return true;
+        }
+        compressed->lengths[i] = len > 0 ? len : 0;
+        result->stored_bytes += len > 0 ? len : sample->lengths[i];
+    }
+    free(state);
+    free(check);
+    result->available = true;
+    result->ratio = result->stored_bytes > 0 ? (double)result->raw_bytes / result->stored_bytes : 1.0;
+    return true;
+}
+
+/* Raw bytes a second of one core, from every worker at once, -1 when a worker failed */
+static double
+run_bench_workers(BenchTask *task, int num_workers)
+{
+    pthread_t workers[COMPRESSION_MAX_WORKERS];
+    BenchTask tasks[COMPRESSION_MAX_WORKERS];
+    double speed = 0;
+    int started;
+    int i;
+
+    for (started = 0; started < num_workers; started++)
+    {
+        int rc;
+
+        tasks[started] = *task;
+        rc = pthread_create(&workers[started], NULL, bench_worker, &tasks[started]);
+        if (rc != 0)
+        {
+            fprintf(stderr, "Failed to start compression worker reason:%s\n", strerror(rc));
+            break;
+        }
+    }
+    /* With no worker at all the benchmark runs right here */
+    if (started == 0)
+    {
+        tasks[0] = *task;
+        bench_worker(&tasks[0]);
+        return tasks[0].failed ? -1 : tasks[0].speed;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    for (i = 0; i < started; i++)
+    {
+        if (tasks[i].failed)
+            return -1;
+        speed += tasks[i].speed / started;
+    }
+    return speed;
+}
+
+/* Pages stored raw are copied when decompressing, as the server does */
+static void *
+bench_worker(void *arg)
+{
+    BenchTask *task = arg;
+    PageSample *sample = task->sample;
+    CompressedSample *compressed = task->compressed;
+    PglzState *state = NULL;
+    unsigned char *buffer = malloc(compressed->page_bound);
+    struct timeval start;
+    long long bytes = 0;
+    double elapsed;
+
+    if (task->algorithm->method == METHOD_PGLZ && !task->decompress)
+        state = malloc(sizeof *state);
+    if (buffer == NULL || (task->algorithm->method == METHOD_PGLZ && !task->decompress && state == NULL))
+    {
+        free(buffer);
+        free(state);
+        task->failed = true;
+        return NULL;
+    }
+    gettimeofday(&start, NULL);
+    do
+    {
+        int i;
+
+        for (i = 0; i < sample->num_pages; i++)
+        {
+            const unsigned char *page = sample->data + sample->offsets[i];
+            const unsigned char *from = compressed->data + (size_t)i * compressed->page_bound;
+
+            if (!task->decompress)
+                task->checksum += compress_page(task->algorithm, page, sample->lengths[i], buffer, compressed->page_bound, state);
+            else if (compressed->lengths[i] > 0)
+                task->checksum += decompress_page(task->algorithm, from, compressed->lengths[i], buffer, sample->lengths[i]);
+            else
+            {
+                memcpy(buffer, page, sample->lengths[i]);
+                task->checksum += buffer[0];
+            }
+        }
+        bytes += sample->bytes;
+        elapsed = bench_elapsed(&start);
+    } while (elapsed < COMPRESSION_BENCH_SECONDS);
+    task->speed = bytes / elapsed;
+    free(buffer);
+    free(state);
+    return NULL;
+}
+
+/* Bytes of the compressed page, -1 when it is better stored raw */
+static int
+compress_page(const CompressionAlgorithm *algorithm, const unsigned char *src, int len, unsigned char *dst,
+              int capacity, PglzState *state)
+{
+    int compressed = -1;
+
+    switch (algorithm->method)
+    {
+    case METHOD_PGLZ:
+        compressed = pglz_compress(state, (const char *)src, len, (char *)dst);
+        break;
+    case METHOD_LZ4:
+        compressed = libraries.lz4_compress((const char *)src, (char *)dst, len, capacity);
+        if (compressed == 0)
+            compressed = -1;
+        break;
+    case METHOD_ZSTD:
+    {
+        size_t result = libraries.zstd_compress(dst, capacity, src, len, algorithm->level);
+
+        compressed = libraries.zstd_is_error(result) ? -1 : (int)result;
+        break;
+    }
+    }
+    return compressed < len ? compressed : -1;
+}
+
+/* Bytes decompressed, -1 when the data is damaged */
+static int
+decompress_page(const CompressionAlgorithm *algorithm, const unsigned char *src, int len, unsigned char *dst,
+                int raw_len)
+{
+    switch (algorithm->method)
+    {
+    case METHOD_PGLZ:
+        return pglz_decompress((const char *)src, len, (char *)dst, raw_len);
+    case METHOD_LZ4:
+        return libraries.lz4_decompress((const char *)src, (char *)dst, len, raw_len);
+    case METHOD_ZSTD:
+    {
+        size_t result = libraries.zstd_decompress(dst, raw_len, src, len);
+
+        return libraries.zstd_is_error(result) ? -1 : (int)result;
+    }
+    }
+    return -1;
+}
+
+/*
+ * pglz as pg_lzcompress.c of the server has it, with the history in the
+ * state instead of static. The server builds it optimized, and so does
+ * the benchmark, or lz4 and zstd would win by the build alone.
+ */
+BENCH_KERNELS_BEGIN
+
+static inline int
+pglz_hist_idx(const char *s, const char *end, int mask)
+{
+    if (end - s < 4)
+        return (int)s[0] & mask;
+    /* The bytes are signed as in the server, shifted as unsigned for the same bits */
+    return (int)(((unsigned int)s[0] << 6) ^ ((unsigned int)s[1] << 4) ^ ((unsigned int)s[2] << 2) ^
+                  (unsigned int)s[3]) & mask;
+}
+
+static inline void
+pglz_hist_add(PglzState *state, int *hist_next, bool *recycle, const char *s, const char *end, int mask)
+{
+    int hindex = pglz_hist_idx(s, end, mask);
+    int16_t *hsp = &state->hist_start[hindex];
+    PglzEntry *entry = &state->hist_entries[*hist_next];
+
+    if (*recycle)
+    {
+        if (entry->prev == NULL)
+            state->hist_start[entry->hindex] = entry->next - state->hist_entries;
+        else
+            entry->prev->next = entry->next;
+        if (entry->next != NULL)
+            entry->next->prev = entry->prev;
+    }
+    entry->next = &state->hist_entries[*hsp];
+    entry->prev = NULL;
+    entry->hindex = hindex;
+    entry->pos = s;
+    /* Entry 0 is never used, linking it when the list was empty is harmless */
+    state->hist_entries[*hsp].prev = entry;
+    *hsp = *hist_next;
+    if (++*hist_next >= PGLZ_HISTORY_SIZE + 1)
+    {
+        *hist_next = 1;
+        *recycle = true;
+    }
+}
+
+static inline void
+pglz_out_ctrl(PglzOutput *out)
+{
+    if ((out->ctrl & 0xff) == 0)
+    {
+        *out->ctrlp = out->ctrlb;
+        out->ctrlp = out->bp++;
+        out->ctrlb = 0;
+        out->ctrl = 1;
+    }
+}
+
+static inline void
+pglz_out_literal(PglzOutput *out, char byte)
+{
+    pglz_out_ctrl(out);
+    *out->bp++ = (unsigned char)byte;
+    out->ctrl <<= 1;
+}
+
+static inline void
+pglz_out_tag(PglzOutput *out, int len, int off)
+{
+    pglz_out_ctrl(out);
+    out->ctrlb |= out->ctrl;
+    out->ctrl <<= 1;
+    if (len > 17)
+    {
+        out->bp[0] = (unsigned char)(((off & 0xf00) >> 4) | 0x0f);
+        out->bp[1] = (unsigned char)(off & 0xff);
+        out->bp[2] = (unsigned char)(len - 18);
+        out->bp += 3;
+    }
+    else
+    {
+        out->bp[0] = (unsigned char)(((off & 0xf00) >> 4) | (len - 3));
+        out->bp[1] = (unsigned char)(off & 0xff);
+        out->bp += 2;
+    }
+}
+
+static inline bool
+pglz_find_match(PglzState *state, const char *input, const char *end, int *lenp, int *offp, int good_match,
+                int good_drop, int mask)
+{
+    PglzEntry *invalid = &state->hist_entries[0];
+    PglzEntry *entry = &state->hist_entries[state->hist_start[pglz_hist_idx(input, end, mask)]];
+    int len = 0;
+    int off = 0;
+
+    while (entry != invalid)
+    {
+        const char *ip = input;
+        const char *hp = entry->pos;
+        int thisoff = ip - hp;
+        int thislen = 0;
+
+        if (thisoff >= PGLZ_MAX_OFFSET)
+            break;
+        /* A match as long as the best one so far is checked at once */
+        if (len >= 16)
+        {
+            if (memcmp(ip, hp, len) == 0)
+            {
+                thislen = len;
+                ip += len;
+                hp += len;
+                while (ip < end && *ip == *hp && thislen < PGLZ_MAX_MATCH)
+                {
+                    thislen++;
+                    ip++;
+                    hp++;
+                }
+            }
+        }
+        else
+        {
+            while (ip < end && *ip == *hp && thislen < PGLZ_MAX_MATCH)
+            {
+                thislen++;
+                ip++;
+                hp++;
+            }
+        }
+        if (thislen > len)
+        {
+            len = thislen;
+            off = thisoff;
+        }
+        entry = entry->next;
+        /* The further back, the shorter a match is good enough */
+        if (entry != invalid)
+        {
+            if (len >= good_match)
+                break;
+            good_match -= (good_match * good_drop) / 100;
+        }
+    }
+    if (len > 2)
+    {
+        *lenp = len;
+        *offp = off;
+        return true;
+    }
+    return false;
+}
+
+static int
+pglz_compress(PglzState *state, const char *source, int slen, char *dest)
+{
+    const char *dp = source;
+    const char *dend = source + slen;
+    unsigned char ctrl_dummy = 0;
+    unsigned char *bstart = (unsigned char *)dest;
+    PglzOutput out = {bstart, &ctrl_dummy, 0, 0};
+    int hist_next = 1;
+    bool hist_recycle = false;
+    bool found_match = false;
+    int match_len, match_off;
+    int result_max, hashsz, mask;
+
+    if (slen < PGLZ_MIN_INPUT_SIZE)
+        return -1;
+    result_max = (slen * (100 - PGLZ_MIN_COMP_RATE)) / 100;
+    if (slen < 128)
+        hashsz = 512;
+    else if (slen < 256)
+        hashsz = 1024;
+    else if (slen < 512)
+        hashsz = 2048;
+    else if (slen < 1024)
+        hashsz = 4096;
+    else
+        hashsz = 8192;
+    mask = hashsz - 1;
+    memset(state->hist_start, 0, hashsz * sizeof *state->hist_start);
+
+    while (dp < dend)
+    {
+        /* Give up when the output gets too large, or nothing matched early on */
+        if (out.bp - bstart >= result_max)
+            return -1;
+        if (!found_match && out.bp - bstart >= PGLZ_FIRST_SUCCESS_BY)
+            return -1;
+        if (pglz_find_match(state, dp, dend, &match_len, &match_off, PGLZ_MATCH_SIZE_GOOD, PGLZ_MATCH_SIZE_DROP, mask))
+        {
+            pglz_out_tag(&out, match_len, match_off);
+            while (match_len--)
+            {
+                pglz_hist_add(state, &hist_next, &hist_recycle, dp, dend, mask);
+                dp++;
+            }
+            found_match = true;
+        }
+        else
+        {
+            pglz_out_literal(&out, *dp);
+            pglz_hist_add(state, &hist_next, &hist_recycle, dp, dend, mask);
+            dp++;
+        }
+    }
+    *out.ctrlp = out.ctrlb;
+    if (out.bp - bstart >= result_max)
+        return -1;
+    return out.bp - bstart;
+}
+
+static int
+pglz_decompress(const char *source, int slen, char *dest, int rawsize)
+{
+    const unsigned char *sp = (const unsigned char *)source;
+    const unsigned char *srcend = sp + slen;
+    unsigned char *dp = (unsigned char *)dest;
+    unsigned char *destend = dp + rawsize;
+
+    while (sp < srcend && dp < destend)
+    {
+        unsigned char ctrl = *sp++;
+        int ctrlc;
+
+        for (ctrlc = 0; ctrlc < 8 && sp < srcend && dp < destend; ctrlc++)
+        {
+            if (ctrl & 1)
+            {
+                int len = (sp[0] & 0x0f) + 3;
+                int off = ((sp[0] & 0xf0) << 4) | sp[1];
+
+                sp += 2;
+                if (len == 18)
+                    len += *sp++;
+                if (sp > srcend || off == 0 || off > dp - (unsigned char *)dest)
+                    return -1;
+                if (len > destend - dp)
+                    len = destend - dp;
+                /* The match may overlap what it writes, copy it in growing pieces */
+                while (off < len)
+                {
+                    memcpy(dp, dp - off, off);
+                    len -= off;
+                    dp += off;
+                    off += off;
+                }
+                memcpy(dp, dp - off, len);
+                dp += len;
+            }
+            else
+                *dp++ = *sp++;
+            ctrl >>= 1;
+        }
+    }
+    if (dp != destend || sp != srcend)
+        return -1;
+    return (char *)dp - dest;
+}
+
+BENCH_KERNELS_END
@@ -3,6 +3,11 @@
 #include<errno.h>
 #include<string.h>
 #include <ctype.h>
+#include <strings.h>
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/mman.h>
 
 #include "pg_config_map.h"
 
@@ -16,6 +21,9 @@ load_config_map(PGConfigMap* config, char *map_file)
 
     config->list = NULL;
     config->num_entries = 0;
+    config->arena = NULL;
+    config->image = NULL;
+    config->image_size = 0;
 
     file = fopen(map_file, "r");
     if (!file)
@@ -119,7 +127,7 @@ load_config_map(PGConfigMap* config, char *map_file)
 }
 
 RESOURCES
-identify_resource(char* token)
+identify_resource(const char* token)
 {
     if (!token)
         return INVALID_RESOURCE;
@@ -137,13 +145,25 @@ identify_resource(char* token)
         return RESOURCE_HOST_TYPE;
     if (!strcasecmp("CUSTOM",token))
         return RESOURCE_CUSTOM;
+    if (!strcasecmp("MRC",token))
+        return RESOURCE_MRC;
+    if (!strcasecmp("DATA_SIZE",token))
+        return RESOURCE_DATA_SIZE;
+    if (!strcasecmp("LARGEST_TABLE",token))
+        return RESOURCE_LARGEST_TABLE;
+    if (!strcasecmp("RELATIONS",token))
+        return RESOURCE_RELATIONS;
+    if (!strcasecmp("DATA_SCALE",token))
+        return RESOURCE_DATA_SCALE;
+    if (!strcasecmp("MEMBW",token))
+        return RESOURCE_MEMBW;
 
     return INVALID_RESOURCE;
 }
 
 
 FORMULAS
-identify_formula(char* token)
+identify_formula(const char* token)
 {
     if (!token)
         return INVALID_FORMULA;
@@ -153,9 +173,80 @@ identify_formula(char* token)
         return SCRIPT;
     if (!strcasecmp("CUSTOM",token))
         return CUSTOM;
+    if (!strcasecmp("CALIBRATED",token))
+        return CALIBRATED;
     return INVALID_FORMULA;
 }
 
+BLEND_MODE
+identify_blend_mode(const char* token)
+{
+    if (!token)
+        return INVALID_BLEND;
+    if (!strcasecmp("LINEAR",token))
+        return BLEND_LINEAR;
+    if (!strcasecmp("GEOMETRIC",token))
+        return BLEND_GEOMETRIC;
+    if (!strcasecmp("MAX",token))
+        return BLEND_MAX;
+    return INVALID_BLEND;
+}
+
+/* The host description values accept their name or its first letter */
+WORKLOAD_TYPE
+identify_workload_type(const char* token)
+{
+    if (!token)
+        return UNKNOWN_WL;
+    if (!strcmp("l",token) || !strcasecmp("OLAP",token))
+        return OLAP;
+    if (!strcmp("t",token) || !strcasecmp("OLTP",token))
+        return OLTP;
+    if (!strcmp("m",token) || !strcasecmp("MIXED",token))
+        return MIXED;
+    return UNKNOWN_WL;
+}
+
+DISK_TYPE
+identify_disk_type(const char* token)
+{
+    if (!token)
+        return UNKNOWN_DT;
+    if (!strcmp("m",token) || !strcasecmp("MAGNETIC",token))
+        return MAGNETIC;
+    if (!strcmp("s",token) || !strcasecmp("SSD",token))
+        return SSD;
+    if (!strcmp("n",token) || !strcasecmp("NETWORK",token))
+        return NETWORK;
+    return UNKNOWN_DT;
+}
+
+NODE_TYPE
+identify_node_type(const char* token)
+{
+    if (!token)
+        return UNKNOWN_NT;
+    if (!strcmp("p",token) || !strcasecmp("PRIMARY",token))
+        return PRIMARY;
+    if (!strcmp("s",token) || !strcasecmp("STANDBY",token))
+        return STANDBY;
+    return UNKNOWN_NT;
+}
+
+HOST_TYPE
+identify_host_type(const char* token)
+{
+    if (!token)
+        return UNKNOWN_HOST;
+    if (!strcmp("p",token) || !strcasecmp("POD",token))
+        return POD;
+    if (!strcmp("s",token) || !strcasecmp("STANDARD",token))
+        return STANDARD;
+    if (!strcmp("c",token) || !strcasecmp("CLOUD",token))
+        return CLOUD;
+    return UNKNOWN_HOST;
+}
+
 char*
 get_workload_type(WORKLOAD_TYPE wrk)
 {
@@ -175,6 +266,14 @@ get_workload_type(WORKLOAD_TYPE wrk)
         break;
     }
 }
+/* Resources measured on the data directory rather than on the host */
+bool
+is_data_resource(RESOURCES res)
+{
+    return res == RESOURCE_DATA_SIZE || res == RESOURCE_LARGEST_TABLE ||
+        res == RESOURCE_RELATIONS || res == RESOURCE_DATA_SCALE;
+}
+
 char*
 get_resource_name(RESOURCES res)
 {
@@ -201,6 +300,24 @@ get_resource_name(RESOURCES res)
         case RESOURCE_CUSTOM:
             return "CUSTOM_RESOURCE";
             break;
+        case RESOURCE_MRC:
+            return "MRC";
+            break;
+        case RESOURCE_DATA_SIZE:
+            return "DATA_SIZE";
+            break;
+        case RESOURCE_LARGEST_TABLE:
+            return "LARGEST_TABLE";
+            break;
+        case RESOURCE_RELATIONS:
+            return "RELATIONS";
+            break;
+        case RESOURCE_DATA_SCALE:
+            return "DATA_SCALE";
+            break;
+        case RESOURCE_MEMBW:
+            return "MEMBW";
+            break;
         default:
             return "INVALID_RESOURCE";
             break;
@@ -221,12 +338,31 @@ get_formula_name(FORMULAS formula)
         case CUSTOM:
            return "CUSTOM";
         break;
+        case CALIBRATED:
+           return "CALIBRATED";
+        break;
         default:
             return "INVALID_FORMULA";
         break;
     }
 }
 
+char*
+get_blend_mode_name(BLEND_MODE blend)
+{
+    switch (blend)
+    {
+        case BLEND_LINEAR:
+            return "LINEAR";
+        case BLEND_GEOMETRIC:
+            return "GEOMETRIC";
+        case BLEND_MAX:
+            return "MAX";
+        default:
+            return "INVALID_BLEND";
+    }
+}
+
 static char *
 get_next_token(char *buf, char *token, int max_token_len, int *token_len)
 {       
@@ -270,8 +406,17 @@ free_config_map(PGConfigMap* config)
 {
     PGConfigMapEntry *entry;
     if (!config)
+        return;
+    /* Entries come from the arena and may point into a profile image */
+    if (config->arena)
     {
-        printf("LOG: Config Map is NULL\n");
+        pg_arena_destroy(config->arena);
+        if (config->image)
+            munmap(config->image, config->image_size);
+        config->list = NULL;
+        config->arena = NULL;
+        config->image = NULL;
+        config->num_entries = 0;
         return;
     }
     entry = config->list;
@@ -284,7 +429,23 @@ free_config_map(PGConfigMap* config)
         entry = entry->next;
         free(tmp);
     }
+    config->list = NULL;
+    config->num_entries = 0;
+}
 
+/* Hand a message to the log hook of the map, if it has one */
+void
+config_map_log(PGConfigMap *config, PGAT_LOG_LEVEL level, const char *fmt, ...)
+{
+    char message[MAX_LINE];
+    va_list args;
+
+    if (config == NULL || config->log_hook == NULL)
+        return;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof message, fmt, args);
+    va_end(args);
+    config->log_hook(level, message, config->log_arg);
 }
 
 
@@ -363,32 +524,569 @@ void
 create_postgresql_conf(const char *output_file_path,PGConfigMap* config, SystemInfo *sys_info)
 {
     FILE *fp;
-    PGConfigMapEntry *entry;
     if (!config)
     {
-        printf("LOG: Config Map is NULL\n");
+        fprintf(stderr, "ERROR: Config Map is NULL\n");
         return;
     }
-    entry = config->list;
     fp = fopen(output_file_path, "w+");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to create configuration file %s reason:%s\n", output_file_path, strerror(errno));
+        return;
+    }
+    write_postgresql_conf(fp, config);
+    fclose(fp);
+    printf("\nLOG: configuration file \"%s\" generated\n",output_file_path);
+}
 
-    while(entry)
+/* Write the successfully processed entries as postgresql.conf lines */
+void
+write_postgresql_conf(FILE *fp, PGConfigMap* config)
+{
+    PGConfigMapEntry *entry;
+
+    for (entry = config->list; entry; entry = entry->next)
     {
         if (entry->status == ENTRY_PROCESSED_SUCCESS)
         {
-            fprintf(fp, "%s = ", entry->param);
-            if (entry->resource == RESOURCE_MEMORY)
-                fprintf(fp, "%lldkB\n",(long long) (entry->optimised_value/1024));
-            else if (entry->resource == RESOURCE_CPU)
-                fprintf(fp, "%lld\n",(long long) entry->optimised_value);
+            char value[MAX_TOKEN_LEN];
+
+            format_config_map_value(entry, value, sizeof value);
+            fprintf(fp, "%s = %s\n", entry->param, value);
+        }
+    }
+}
+
+/*
+ * Is the host within the cpu and memory bounds of the profile. Bounds that
+ * contradict each other are ignored. On failure error says why.
+ */
+bool
+check_profile_bounds(PGMapProfileDetails *profile, SystemInfo *system_info, char *error, size_t error_len)
+{
+    if (profile->max_cpu >= profile->min_cpu)
+    {
+        if (profile->max_cpu > 0 && profile->max_cpu < system_info->cpu_count)
+        {
+            snprintf(error, error_len, "profile allows at most %ld CPUs, host has %ld", profile->max_cpu, system_info->cpu_count);
+            return false;
+        }
+        if (profile->min_cpu > 0 && profile->min_cpu > system_info->cpu_count)
+        {
+            snprintf(error, error_len, "profile needs at least %ld CPUs, host has %ld", profile->min_cpu, system_info->cpu_count);
+            return false;
+        }
+    }
+    if (profile->max_memory >= profile->min_memory)
+    {
+        if (profile->max_memory > 0 && profile->max_memory < system_info->total_ram)
+        {
+            snprintf(error, error_len, "profile allows at most %ld bytes of memory, host has %lld",
+                     profile->max_memory, system_info->total_ram);
+            return false;
+        }
+        if (profile->min_memory > 0 && profile->min_memory > system_info->total_ram)
+        {
+            snprintf(error, error_len, "profile needs at least %ld bytes of memory, host has %lld",
+                     profile->min_memory, system_info->total_ram);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The value of a processed entry the way it goes into postgresql.conf */
+void
+format_config_map_value(PGConfigMapEntry *entry, char *buf, size_t len)
+{
+    if (entry->resource == RESOURCE_MEMORY || entry->resource == RESOURCE_MRC ||
+        entry->resource == RESOURCE_DATA_SIZE || entry->resource == RESOURCE_LARGEST_TABLE)
+        snprintf(buf, len, "%lldkB", (long long)(entry->optimised_value/1024));
+    else if (entry->resource == RESOURCE_CPU || entry->resource == RESOURCE_RELATIONS || entry->resource == RESOURCE_DATA_SCALE ||
+             entry->resource == RESOURCE_MEMBW)
+        snprintf(buf, len, "%lld", (long long)entry->optimised_value);
+    else
+        if(entry->formula == CUSTOM)
+            snprintf(buf, len, "%s", entry->value);
+        else if (entry->formula == CALIBRATED && entry->optimised_value >= 1000)
+            snprintf(buf, len, "%.0f", entry->optimised_value);
+        else if (entry->formula == CALIBRATED)
+            snprintf(buf, len, "%.4g", entry->optimised_value);
+        else
+            snprintf(buf, len, "%.2f", entry->optimised_value);
+}
+
+/*
+ * Parameters PostgreSQL only reads at server start, everything else is
+ * picked up by a reload.
+ */
+static const char *restart_parameters[] = {
+    "archive_mode",
+    "autovacuum_max_workers",
+    "dynamic_shared_memory_type",
+    "hot_standby",
+    "huge_pages",
+    "listen_addresses",
+    "max_connections",
+    "max_files_per_process",
+    "max_locks_per_transaction",
+    "max_logical_replication_workers",
+    "max_pred_locks_per_transaction",
+    "max_prepared_transactions",
+    "max_replication_slots",
+    "max_wal_senders",
+    "max_worker_processes",
+    "min_dynamic_shared_memory",
+    "port",
+    "shared_buffers",
+    "shared_memory_type",
+    "shared_preload_libraries",
+    "superuser_reserved_connections",
+    "track_activity_query_size",
+    "wal_buffers",
+    "wal_level",
+    "wal_log_hints",
+    NULL
+};
+
+bool
+parameter_needs_restart(const char *param)
+{
+    const char **name;
+
+    for (name = restart_parameters; *name; name++)
+    {
+        if (strcasecmp(*name, param) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Parse a workload blend such as "oltp=0.7,olap=0.3". The weights are
+ * normalized to sum to 1 and the heaviest workload becomes the workload_type
+ * of the host. Returns false when the text is not a valid blend.
+ */
+bool
+parse_workload_weights(const char *text, SystemInfo *system_info)
+{
+    double weights[NUM_WORKLOAD_FACTORS] = {0};
+    bool seen[NUM_WORKLOAD_FACTORS] = {false};
+    const char *item = text;
+    double total = 0;
+    int dominant = 0;
+    int w;
+
+    while (*item)
+    {
+        const char *equal = strchr(item, '=');
+        const char *comma = strchr(item, ',');
+        char name[MAX_TOKEN_LEN];
+        WORKLOAD_TYPE workload;
+        double weight;
+        char *end;
+
+        if (comma == NULL)
+            comma = item + strlen(item);
+        if (equal == NULL || equal > comma || equal == item || equal - item >= MAX_TOKEN_LEN)
+            return false;
+        snprintf(name, sizeof name, "%.*s", (int)(equal - item), item);
+        workload = identify_workload_type(name);
+        if (workload == UNKNOWN_WL || seen[workload])
+            return false;
+        weight = strtod(equal + 1, &end);
+        if (end == equal + 1 || end != comma || !isfinite(weight) || weight < 0)
+            return false;
+        seen[workload] = true;
+        weights[workload] = weight;
+        total += weight;
+        item = *comma ? comma + 1 : comma;
+    }
+    if (total <= 0)
+        return false;
+
+    for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+    {
+        system_info->workload_weights[w] = weights[w] / total;
+        if (weights[w] > weights[dominant])
+            dominant = w;
+    }
+    system_info->workload_type = dominant;
+    return true;
+}
+
+bool
+is_workload_blend(SystemInfo *system_info)
+{
+    int w;
+
+    for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+    {
+        if (system_info->workload_weights[w] > 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Factor of a workload as a number. A value with a memory unit is a size in
+ * bytes, it only blends with other sizes.
+ */
+static bool
+get_blend_number(const char *text, double *number, bool *is_size)
+{
+    long long size;
+    char *end;
+
+    if (text == NULL)
+        return false;
+    *number = strtod(text, &end);
+    if (end != text)
+    {
+        while (*end == ' ')
+            end++;
+        if (*end == '\0')
+        {
+            *is_size = false;
+            return true;
+        }
+    }
+    if (!parse_size_text(text, &size))
+        return false;
+    *number = (double)size;
+    *is_size = true;
+    return true;
+}
+
+/*
+ * Set the value of an entry for the workload of the host. For a blend of
+ * workloads the factors of the blended workloads are combined following the
+ * blend mode of the entry: a weighted mean (linear), a weighted geometric
+ * mean, for factors that scale multiplicatively, or the largest factor (max),
+ * for limits that have to fit every workload. Values that are not numbers,
+ * e.g. "on", can not be blended and follow the dominant workload. The
+ * blended text is allocated in arena, without one custom values are not
+ * blended. Returns false when out of memory.
+ */
+bool
+select_workload_value(PGConfigMapEntry *entry, SystemInfo *system_info, PGArena *arena)
+{
+    WORKLOAD_TYPE workload = system_info->workload_type;
+    double *weights = system_info->workload_weights;
+    char *previous = entry->value;
+    bool size_unit = false;
+    bool first = true;
+    bool integral = true;
+    bool positive = true;
+    double blended = 0;
+    double log_sum = 0;
+    double max = -INFINITY;
+    char buf[64];
+    int w;
+
+    if (workload < 0 || workload >= NUM_WORKLOAD_FACTORS || entry->workload_values[workload] == NULL)
+        return true;
+    entry->value = entry->workload_values[workload];
+    entry->factor_value = strtod(entry->value, NULL);
+    if (!is_workload_blend(system_info))
+        return true;
+    if (entry->formula != PERCENTAGE && entry->formula != CALIBRATED && (entry->formula != CUSTOM || arena == NULL))
+        return true;
+
+    for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+    {
+        double number;
+        bool is_size;
+
+        if (weights[w] <= 0)
+            continue;
+        if (!get_blend_number(entry->workload_values[w], &number, &is_size))
+            return true;
+        if (!first && is_size != size_unit)
+            return true;
+        size_unit = is_size;
+        first = false;
+        integral = integral && number == floor(number);
+        positive = positive && number > 0;
+        blended += weights[w] * number;
+        log_sum += positive ? weights[w] * log(number) : 0;
+        if (number > max)
+            max = number;
+    }
+
+    if (entry->blend == BLEND_GEOMETRIC && positive)
+        blended = exp(log_sum);
+    else if (entry->blend == BLEND_MAX)
+        blended = max;
+
+    if (entry->formula == PERCENTAGE || entry->formula == CALIBRATED)
+    {
+        entry->factor_value = blended;
+        snprintf(buf, sizeof buf, "%f", blended);
+    }
+    else if (size_unit)
+        snprintf(buf, sizeof buf, "%.0fkB", blended / 1024.0);
+    else if (integral)
+        snprintf(buf, sizeof buf, "%.0f", blended);
+    else
+        snprintf(buf, sizeof buf, "%f", blended);
+
+    /* Processing again needs no new copy when the blend did not change */
+    if (previous && strcmp(previous, buf) == 0)
+        entry->value = previous;
+    else if (arena)
+    {
+        char *value = pg_arena_strdup(arena, buf);
+
+        if (value == NULL)
+            return false;
+        entry->value = value;
+    }
+    if (entry->formula == CUSTOM)
+        entry->factor_value = strtod(entry->value, NULL);
+    return true;
+}
+
+/*
+ * Copy the entries of the shared map so processing a host does not touch
+ * it. Strings are shared, they are never written by the processors.
+ */
+bool
+clone_config_map(PGConfigMap *source, PGConfigMap *copy, SystemInfo *system_info, PGArena *arena)
+{
+    PGConfigMapEntry *entry;
+    PGConfigMapEntry **tail = &copy->list;
+
+    memset(copy, 0x00, sizeof *copy);
+    copy->log_hook = source->log_hook;
+    copy->log_arg = source->log_arg;
+    for (entry = source->list; entry; entry = entry->next)
+    {
+        PGConfigMapEntry *clone = pg_arena_alloc(arena, sizeof *clone);
+
+        if (clone == NULL)
+            return false;
+        memcpy(clone, entry, sizeof *clone);
+        if (clone->profile_param)
+        {
+            clone->param = clone->profile_param;
+            clone->profile_param = NULL;
+        }
+        if (!select_workload_value(clone, system_info, arena))
+            return false;
+        clone->status = ENTRY_LOADED;
+        clone->optimised_value = 0;
+        clone->message[0] = '\0';
+        clone->conf_ref = NULL;
+        clone->next = NULL;
+        *tail = clone;
+        tail = &clone->next;
+        copy->num_entries++;
+    }
+    return true;
+}
+
+/*
+ * A size is a number of bytes, optionally with a kB, MB, GB or TB unit. The
+ * B of the unit may be left out, "4G" is 4GB.
+ */
+bool
+parse_size_text(const char *text, long long *size)
+{
+    double number;
+    char *unit;
+
+    number = strtod(text, &unit);
+    if (unit == text || number < 0)
+        return false;
+    while (*unit == ' ')
+        unit++;
+    if (*unit == '\0' || strcasecmp(unit, "B") == 0)
+        ;
+    else if (strcasecmp(unit, "kB") == 0 || strcasecmp(unit, "k") == 0)
+        number *= 1024.0;
+    else if (strcasecmp(unit, "MB") == 0 || strcasecmp(unit, "M") == 0)
+        number *= 1024.0 * 1024.0;
+    else if (strcasecmp(unit, "GB") == 0 || strcasecmp(unit, "G") == 0)
+        number *= 1024.0 * 1024.0 * 1024.0;
+    else if (strcasecmp(unit, "TB") == 0 || strcasecmp(unit, "T") == 0)
+        number *= 1024.0 * 1024.0 * 1024.0 * 1024.0;
+    else
+        return false;
+    *size = (long long)number;
+    return true;
+}
+
+/*
+ * Seconds since the epoch of a timestamp with time zone as PostgreSQL
+ * prints it, "2024-05-01 10:00:00.123+02" or with a T as json has it.
+ * Without a zone, or with the name of one as log_line_prefix writes it,
+ * the time is taken as UTC.
+ */
+bool
+parse_timestamp_text(const char *text, double *seconds)
+{
+    struct tm tm;
+    const char *p;
+    char separator;
+    double fraction = 0;
+    int offset_hours = 0;
+    int offset_minutes = 0;
+    int consumed = 0;
+    int sign;
+
+    memset(&tm, 0x00, sizeof tm);
+    if (sscanf(text, "%4d-%2d-%2d%c%2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &separator,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 7 ||
+        (separator != ' ' && separator != 'T'))
+        return false;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    p = text + consumed;
+    if (*p == '.')
+        fraction = strtod(p, (char **)&p);
+    if (*p == '+' || *p == '-')
+    {
+        sign = *p == '-' ? -1 : 1;
+        if (sscanf(p + 1, "%2d:%2d", &offset_hours, &offset_minutes) < 1)
+            return false;
+        *seconds = (double)timegm(&tm) + fraction - sign * (offset_hours * 3600.0 + offset_minutes * 60.0);
+        return true;
+    }
+    *seconds = (double)timegm(&tm) + fraction;
+    return true;
+}
+
+/*
+ * Value of a processed parameter, in bytes for memory parameters. A custom
+ * value without a unit is in the unit of the parameter, e.g. 8kB blocks for
+ * shared_buffers. Returns default_value when the map does not set it.
+ */
+double
+get_config_map_setting(PGConfigMap *config, const char *param, double unit_bytes, double default_value)
+{
+    PGConfigMapEntry *entry;
+
+    for (entry = config->list; entry; entry = entry->next)
+    {
+        if (entry->status != ENTRY_PROCESSED_SUCCESS || strcasecmp(entry->param, param) != 0)
+            continue;
+
+        if (entry->resource == RESOURCE_MEMORY || entry->resource == RESOURCE_CPU || entry->resource == RESOURCE_MRC ||
+            entry->resource == RESOURCE_MEMBW || is_data_resource(entry->resource))
+            return entry->optimised_value;
+        if (entry->formula == CUSTOM && entry->value)
+        {
+            long long size;
+            char *end;
+            double number = strtod(entry->value, &end);
+
+            if (end != entry->value && *end == '\0')
+                return number * unit_bytes;
+            if (parse_size_text(entry->value, &size))
+                return (double)size;
+            return default_value;
+        }
+        return entry->optimised_value * unit_bytes;
+    }
+    return default_value;
+}
+
+/*
+ * wal_buffers of the processed map in bytes, -1 as the server sizes it: a
+ * 32nd of shared_buffers, between 64kB and one WAL segment.
+ */
+double
+get_wal_buffers_setting(PGConfigMap *config, SystemInfo *system_info)
+{
+    double block_size = get_block_size(system_info);
+    double segment_size = system_info->wal_segment_size > 0 ? system_info->wal_segment_size : DEFAULT_WAL_SEGMENT_SIZE;
+    double wal_buffers = get_config_map_setting(config, "wal_buffers", block_size, -1);
+
+    if (wal_buffers > 0)
+        return wal_buffers;
+    wal_buffers = get_config_map_setting(config, "shared_buffers", block_size, 128.0 * 1024 * 1024) / 32;
+    if (wal_buffers < 64.0 * 1024)
+        wal_buffers = 64.0 * 1024;
+    if (wal_buffers > segment_size)
+        wal_buffers = segment_size;
+    return wal_buffers;
+}
+
+/*
+ * Worst case memory use of a server running with the processed map: the
+ * shared buffers and WAL buffers, one work_mem for every connection and a
+ * maintenance_work_mem for every autovacuum worker. Whatever the map does
+ * not set counts with its PostgreSQL default.
+ */
+long long
+estimate_memory_footprint(PGConfigMap *config, SystemInfo *system_info)
+{
+    double shared_buffers = get_config_map_setting(config, "shared_buffers", get_block_size(system_info), 128.0 * 1024 * 1024);
+    double wal_buffers = get_wal_buffers_setting(config, system_info);
+    double work_mem = get_config_map_setting(config, "work_mem", 1024, 4.0 * 1024 * 1024);
+    double maintenance_work_mem = get_config_map_setting(config, "maintenance_work_mem", 1024, 64.0 * 1024 * 1024);
+    double autovacuum_work_mem = get_config_map_setting(config, "autovacuum_work_mem", 1024, -1);
+    double max_connections = get_config_map_setting(config, "max_connections", 1, 100);
+    double autovacuum_max_workers = get_config_map_setting(config, "autovacuum_max_workers", 1, 3);
+
+    if (autovacuum_work_mem < 0)
+        autovacuum_work_mem = maintenance_work_mem;
+
+    return (long long)(shared_buffers + wal_buffers + max_connections * work_mem +
+                       autovacuum_max_workers * autovacuum_work_mem);
+}
+
+/*
+ * Print the values of the same map processed for different workloads side
+ * by side, marking the parameters that differ. The maps are clones of one
+ * map, so their entries are in the same order.
+ */
+void
+print_workload_comparison(PGConfigMap *maps, int num_maps)
+{
+    PGConfigMapEntry *entries[NUM_WORKLOAD_FACTORS];
+    int param_width = strlen("parameter");
+    int i;
+
+    if (num_maps > NUM_WORKLOAD_FACTORS)
+        num_maps = NUM_WORKLOAD_FACTORS;
+    for (entries[0] = maps[0].list; entries[0]; entries[0] = entries[0]->next)
+    {
+        if ((int)strlen(entries[0]->param) > param_width)
+            param_width = strlen(entries[0]->param);
+    }
+
+    printf("\n%-*s  %-14s", param_width, "parameter", "current");
+    for (i = 0; i < num_maps; i++)
+        printf("  %-14s", get_workload_type(i));
+    printf("\n");
+
+    for (i = 0; i < num_maps; i++)
+        entries[i] = maps[i].list;
+    while (entries[0])
+    {
+        char values[NUM_WORKLOAD_FACTORS][MAX_TOKEN_LEN];
+        bool differ = false;
+
+        for (i = 0; i < num_maps; i++)
+        {
+            if (entries[i]->status == ENTRY_PROCESSED_SUCCESS)
+                format_config_map_value(entries[i], values[i], MAX_TOKEN_LEN);
             else
-                if(entry->formula == CUSTOM)
-                    fprintf(fp, "%s\n", entry->value);
-                else
-                    fprintf(fp, "%.2f\n", entry->optimised_value);
+                snprintf(values[i], MAX_TOKEN_LEN, "error");
+            if (i > 0 && strcmp(values[i], values[0]) != 0)
+                differ = true;
         }
-        entry = entry->next;
+        printf("%-*s  %-14s", param_width, entries[0]->param,
+               entries[0]->conf_ref && entries[0]->conf_ref->value ? entries[0]->conf_ref->value : "-");
+        for (i = 0; i < num_maps; i++)
+            printf("  %-14s", values[i]);
+        printf("%s\n", differ ? "  *" : "");
+
+        for (i = 0; i < num_maps; i++)
+            entries[i] = entries[i]->next;
     }
-    fclose(fp);
-    printf("\nLOG: configuration file \"%s\" generated\n",output_file_path);
+    printf("\n(*) differs between workloads\n");
 }
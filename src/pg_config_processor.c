@@ -16,18 +16,71 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
 
 #include "pg_config_map.h"
+#include "pg_log_analyzer.h"
+#include "pg_cache_residency.h"
+#include "pg_heap_scan.h"
+#include "pg_control.h"
+#include "pg_xid_rate.h"
+#include "pg_wal_stream.h"
+#include "pg_compression.h"
+#include "pg_cost_calibration.h"
+#include "pg_memory_knee.h"
+#include "pg_memory_bandwidth.h"
+
+/* PostgreSQL defaults for the settings the log evidence is read against */
+#define DEFAULT_CHECKPOINT_TIMEOUT 300.0
+#define DEFAULT_CHECKPOINT_COMPLETION_TARGET 0.9
+#define DEFAULT_MAX_WAL_SIZE (1024.0 * 1024 * 1024)
+#define DEFAULT_MAX_CONNECTIONS 100.0
+#define EVIDENCE_GRANULE (1024.0 * 1024)
 
 static int percentage_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info);
+static void bound_value(PGConfigMapEntry *map_entry);
+static double data_resource_value(RESOURCES resource, SystemInfo *system_info);
 static int custom_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info);
+static int calibrated_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info);
+static void work_mem_evidence_processor(PGConfigMap *config_map, SystemInfo *system_info, LogEvidence *evidence);
+static void max_wal_size_evidence_processor(PGConfigMap *config_map, PGConfig *pg_config, LogEvidence *evidence);
+static void shared_buffers_residency_processor(PGConfigMap *config_map, SystemInfo *system_info, CacheResidency *residency);
+static void effective_cache_size_residency_processor(PGConfigMap *config_map, SystemInfo *system_info, CacheResidency *residency);
+static void autovacuum_cost_limit_heap_processor(PGConfigMap *config_map, HeapScan *scan);
+static double freeze_max_age_xid_processor(PGConfigMap *config_map, XidRate *rate);
+static void freeze_min_age_xid_processor(PGConfigMap *config_map, XidRate *rate, double freeze_max_age);
+static void autovacuum_cost_limit_xid_processor(PGConfigMap *config_map, SystemInfo *system_info, XidRate *rate,
+                                                double freeze_max_age);
+static void autovacuum_workers_xid_processor(PGConfigMap *config_map, XidRate *rate, double freeze_max_age);
+static void checkpoint_timeout_wal_processor(PGConfigMap *config_map, PGConfig *pg_config, WalStream *stream);
+static void max_wal_size_wal_processor(PGConfigMap *config_map, PGConfig *pg_config, WalStream *stream);
+static void wal_compression_wal_processor(PGConfigMap *config_map, WalStream *stream);
+static void wal_buffers_wal_processor(PGConfigMap *config_map, SystemInfo *system_info, WalStream *stream);
+static void wal_compression_bench_processor(PGConfigMap *config_map, SystemInfo *system_info, CompressionBench *bench,
+                                            WalStream *stream);
+static void toast_compression_bench_processor(PGConfigMap *config_map, SystemInfo *system_info, CompressionBench *bench);
+static void calibrated_cost_processor(PGConfigMapEntry *map_entry, CostCalibration *calibration, double cache_hit);
+static void work_mem_knee_processor(PGConfigMap *config_map, SystemInfo *system_info, MemoryKnee *knee);
+static void hash_mem_multiplier_knee_processor(PGConfigMap *config_map, SystemInfo *system_info, MemoryKnee *knee);
+static const char *knee_size_text(double bytes, char *buf, size_t len);
+static void parallel_workers_bandwidth_processor(PGConfigMap *config_map, SystemInfo *system_info);
+static bool set_custom_text(PGConfigMapEntry *map_entry, const char *text, PGArena *arena);
+static void param_version_processor(PGConfigMap *config_map, PGConfigMapEntry *map_entry, SystemInfo *system_info);
+static void wal_size_segment_processor(PGConfigMap *config_map, SystemInfo *system_info, const char *param);
+static bool param_exists_in(const ParamVersion *version, int server_version);
+static PGConfigMapEntry *find_processed_entry(PGConfigMap *config_map, const char *param);
+static bool set_evidence_value(PGConfigMapEntry *map_entry, double bytes, PGArena *arena);
+static bool set_evidence_count(PGConfigMapEntry *map_entry, double count, PGArena *arena);
+static double get_duration_setting(PGConfigMap *config_map, PGConfig *pg_config, char *param, double default_value);
 
 void load_pg_config_in_map(PGConfigMap *config_map, PGConfig *pg_config)
 {
     PGConfigMapEntry *map_entry;
     if (!config_map || !pg_config)
     {
-        printf("LOG: Config Map or PG config is NULL\n");
+        fprintf(stderr, "ERROR: Config Map or PG config is NULL\n");
         return;
     }
     map_entry = config_map->list;
@@ -39,16 +92,34 @@ void load_pg_config_in_map(PGConfigMap *config_map, PGConfig *pg_config)
 }
 
 void process_config_map(PGConfigMap *config_map, SystemInfo *system_info)
+{
+    process_config_map_resources(config_map, system_info, ALL_RESOURCES);
+}
+
+/*
+ * Process only the entries that depend on one of the resources in the mask,
+ * so a change of e.g. the memory limit leaves everything else alone.
+ * Returns the number of entries processed.
+ */
+int process_config_map_resources(PGConfigMap *config_map, SystemInfo *system_info, unsigned int resources)
 {
     PGConfigMapEntry *map_entry;
+    int processed = 0;
+
     if (!config_map || !system_info)
     {
-        printf("LOG: Failed to process config map: Config Map or System Info is missing\n");
-        return;
+        fprintf(stderr, "ERROR: Failed to process config map: Config Map or System Info is missing\n");
+        return 0;
     }
     map_entry = config_map->list;
     while (map_entry)
     {
+        if (!(resources & RESOURCE_BIT(map_entry->resource)))
+        {
+            map_entry = map_entry->next;
+            continue;
+        }
+        processed++;
         switch (map_entry->formula)
         {
         case PERCENTAGE:
@@ -59,6 +130,10 @@ void process_config_map(PGConfigMap *config_map, SystemInfo *system_info)
             custom_processor(map_entry, system_info);
             break;
 
+        case CALIBRATED:
+            calibrated_processor(map_entry, system_info);
+            break;
+
         default:
             map_entry->status = ENTRY_PROCESSED_ERROR;
             snprintf(map_entry->message, MAX_MESSAGE_LEN, "Unsupported specified formula for parameter: \"%s\"",
@@ -68,6 +143,161 @@ void process_config_map(PGConfigMap *config_map, SystemInfo *system_info)
         }
         map_entry = map_entry->next;
     }
+    return processed;
+}
+
+/*
+ * Evidence from the server logs raises what the percentage model computed
+ * where the server showed it was too low. Nothing is lowered, the logs only
+ * tell when a setting was too small.
+ */
+void process_log_evidence(PGConfigMap *config_map, SystemInfo *system_info, PGConfig *pg_config, LogEvidence *evidence)
+{
+    if (!config_map || !system_info || !evidence)
+        return;
+    work_mem_evidence_processor(config_map, system_info, evidence);
+    max_wal_size_evidence_processor(config_map, pg_config, evidence);
+}
+
+/*
+ * What the page cache holds of the data directory splits the memory between
+ * shared_buffers, sized for the hot set, and the rest of the cache that
+ * effective_cache_size tells the planner about.
+ */
+void process_cache_residency(PGConfigMap *config_map, SystemInfo *system_info, CacheResidency *residency)
+{
+    if (!config_map || !system_info || !residency)
+        return;
+    shared_buffers_residency_processor(config_map, system_info, residency);
+    effective_cache_size_residency_processor(config_map, system_info, residency);
+}
+
+void process_heap_scan(PGConfigMap *config_map, SystemInfo *system_info, HeapScan *scan)
+{
+    if (!config_map || !system_info || !scan)
+        return;
+    autovacuum_cost_limit_heap_processor(config_map, scan);
+}
+
+/*
+ * The rate transaction ids are used at sets how often autovacuum has to
+ * force a vacuum to freeze the oldest tables, and how much it has to get
+ * through in between, so that the forced vacuums are rare and do not
+ * pile up on a busy server.
+ */
+void process_xid_rate(PGConfigMap *config_map, SystemInfo *system_info, XidRate *rate)
+{
+    double freeze_max_age;
+
+    if (!config_map || !system_info || !rate || rate->xid_rate <= 0)
+        return;
+    freeze_max_age = freeze_max_age_xid_processor(config_map, rate);
+    freeze_min_age_xid_processor(config_map, rate, freeze_max_age);
+    autovacuum_cost_limit_xid_processor(config_map, system_info, rate, freeze_max_age);
+    autovacuum_workers_xid_processor(config_map, rate, freeze_max_age);
+}
+
+/*
+ * The WAL the server wrote shows how fast it writes and how much of it
+ * are full page images, written whole on the first change of a page after
+ * every checkpoint. Nothing is lowered.
+ */
+void process_wal_stream(PGConfigMap *config_map, SystemInfo *system_info, PGConfig *pg_config, WalStream *stream)
+{
+    if (!config_map || !system_info || !stream)
+        return;
+    checkpoint_timeout_wal_processor(config_map, pg_config, stream);
+    max_wal_size_wal_processor(config_map, pg_config, stream);
+    wal_compression_wal_processor(config_map, stream);
+    wal_buffers_wal_processor(config_map, system_info, stream);
+}
+
+/*
+ * Compressing pays when the CPU left on the host gets more through than
+ * the disk does alone, measured on the pages of the data directory. The
+ * full page image share of the decoded WAL, when there is one, tells how
+ * much of the WAL wal_compression applies to.
+ */
+void process_compression(PGConfigMap *config_map, SystemInfo *system_info, CompressionBench *bench, WalStream *stream)
+{
+    if (!config_map || !system_info || !bench)
+        return;
+    wal_compression_bench_processor(config_map, system_info, bench, stream);
+    toast_compression_bench_processor(config_map, system_info, bench);
+}
+
+/*
+ * Calibrated entries get the cost measured on the host in place of the
+ * value of the profile. The random reads expected from the cache are what
+ * the page cache holds of the data directory when it is scanned, else
+ * what effective_cache_size holds of the data.
+ */
+void process_cost_calibration(PGConfigMap *config_map, SystemInfo *system_info, CostCalibration *calibration,
+                              CacheResidency *residency)
+{
+    PGConfigMapEntry *map_entry;
+    double resident_share = -1;
+    double cache_hit;
+
+    if (!config_map || !system_info || !calibration)
+        return;
+    if (residency && residency->total_size > 0)
+        resident_share = (double)residency->total_resident / residency->total_size;
+    cache_hit = expected_cache_hit(system_info->data_size,
+                                   get_config_map_setting(config_map, "effective_cache_size", get_block_size(system_info), -1),
+                                   resident_share);
+    for (map_entry = config_map->list; map_entry; map_entry = map_entry->next)
+    {
+        if (map_entry->status == ENTRY_PROCESSED_SUCCESS && map_entry->formula == CALIBRATED)
+            calibrated_cost_processor(map_entry, calibration, cache_hit);
+    }
+}
+
+/*
+ * Sorts and hash tables run at the speed of the caches up to the knee of
+ * their kernel and slow down past it, so work_mem is counted in whole
+ * knees of the sort and the hash memory, work_mem times
+ * hash_mem_multiplier, in whole knees of the hash build.
+ */
+void process_memory_knee(PGConfigMap *config_map, SystemInfo *system_info, MemoryKnee *knee)
+{
+    if (!config_map || !system_info || !knee || knee->num_sizes == 0)
+        return;
+    work_mem_knee_processor(config_map, system_info, knee);
+    hash_mem_multiplier_knee_processor(config_map, system_info, knee);
+}
+
+/*
+ * A parallel scan stops getting faster once its processes pull all the
+ * bandwidth of the memory, however many CPUs are left, so the workers a
+ * Gather gets from the CPU count are capped at what the memory feeds.
+ */
+void process_memory_bandwidth(PGConfigMap *config_map, SystemInfo *system_info)
+{
+    if (!config_map || !system_info || system_info->memory_bandwidth <= 0)
+        return;
+    parallel_workers_bandwidth_processor(config_map, system_info);
+}
+
+/*
+ * Make the processed map fit the server version of the data directory:
+ * parameters it does not know are renamed to their equivalent or left
+ * out, since the server refuses to start with them, and WAL sizes are
+ * counted in whole segments.
+ */
+void process_server_version(PGConfigMap *config_map, SystemInfo *system_info)
+{
+    PGConfigMapEntry *map_entry;
+
+    if (!config_map || !system_info || system_info->server_version <= 0)
+        return;
+    for (map_entry = config_map->list; map_entry; map_entry = map_entry->next)
+    {
+        if (map_entry->status == ENTRY_PROCESSED_SUCCESS)
+            param_version_processor(config_map, map_entry, system_info);
+    }
+    wal_size_segment_processor(config_map, system_info, "min_wal_size");
+    wal_size_segment_processor(config_map, system_info, "max_wal_size");
 }
 
 static int
@@ -87,11 +317,12 @@ percentage_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
             ref_value = (double)map_entry->conf_ref->dec_val;
     }
 
-    factor_value = strtod(map_entry->value, NULL);
+    factor_value = map_entry->factor_value;
 
     if (map_entry->resource == RESOURCE_MEMORY)
     {
         map_entry->optimised_value = (system_info->total_ram * factor_value) / 100;
+        bound_value(map_entry);
         map_entry->status = ENTRY_PROCESSED_SUCCESS;
         if (ref_value == map_entry->optimised_value)
             snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is already optimum (%lld) based on system memory = %lld bytes",
@@ -108,6 +339,7 @@ percentage_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
     else if (map_entry->resource == RESOURCE_CPU)
     {
         map_entry->optimised_value = (system_info->cpu_count * factor_value) / 100;
+        bound_value(map_entry);
         map_entry->status = ENTRY_PROCESSED_SUCCESS;
 
         if (ref_value == map_entry->optimised_value)
@@ -121,6 +353,83 @@ percentage_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
                      map_entry->param, (long long)map_entry->optimised_value, system_info->cpu_count);
         return 0;
     }
+    else if (map_entry->resource == RESOURCE_MRC)
+    {
+        if (system_info->cache_knee <= 0)
+        {
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "No miss ratio curve for parameter: \"%s\", replay a buffer trace with --buffer-trace",
+                     map_entry->param);
+            map_entry->status = ENTRY_PROCESSED_ERROR;
+            return -2;
+        }
+        map_entry->optimised_value = (system_info->cache_knee * factor_value) / 100;
+        bound_value(map_entry);
+        map_entry->status = ENTRY_PROCESSED_SUCCESS;
+
+        if (ref_value == map_entry->optimised_value)
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is already optimum (%lld) based on miss ratio curve knee = %lld bytes",
+                     map_entry->param, (long long)map_entry->optimised_value, system_info->cache_knee);
+        else if (ref_value != INVALID_DOUBLE_VAL)
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is changed from %lld to %lld based on miss ratio curve knee = %lld bytes",
+                     map_entry->param, (long long)ref_value, (long long)map_entry->optimised_value, system_info->cache_knee);
+        else
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is %lld based on miss ratio curve knee = %lld bytes",
+                     map_entry->param, (long long)map_entry->optimised_value, system_info->cache_knee);
+        return 0;
+    }
+    else if (map_entry->resource == RESOURCE_MEMBW)
+    {
+        double cpus;
+
+        if (system_info->memory_bandwidth <= 0)
+        {
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "No memory bandwidth for parameter: \"%s\", measure it with --memory-bandwidth",
+                     map_entry->param);
+            map_entry->status = ENTRY_PROCESSED_ERROR;
+            return -2;
+        }
+        cpus = bandwidth_cpus(system_info->memory_bandwidth, system_info->core_bandwidth, system_info->cpu_count);
+        map_entry->optimised_value = (cpus * factor_value) / 100;
+        bound_value(map_entry);
+        map_entry->status = ENTRY_PROCESSED_SUCCESS;
+
+        if (ref_value == map_entry->optimised_value)
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is already optimum (%lld) based on memory bandwidth = %.1f GB/s feeding %.1f CPUs",
+                     map_entry->param, (long long)map_entry->optimised_value, system_info->memory_bandwidth, cpus);
+        else if (ref_value != INVALID_DOUBLE_VAL)
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is changed from %lld to %lld based on memory bandwidth = %.1f GB/s feeding %.1f CPUs",
+                     map_entry->param, (long long)ref_value, (long long)map_entry->optimised_value, system_info->memory_bandwidth, cpus);
+        else
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is %lld based on memory bandwidth = %.1f GB/s feeding %.1f CPUs",
+                     map_entry->param, (long long)map_entry->optimised_value, system_info->memory_bandwidth, cpus);
+        return 0;
+    }
+    else if (is_data_resource(map_entry->resource))
+    {
+        double data_value = data_resource_value(map_entry->resource, system_info);
+
+        if (data_value < 0)
+        {
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "No data directory shape for parameter: \"%s\", pass the data directory with --data-dir",
+                     map_entry->param);
+            map_entry->status = ENTRY_PROCESSED_ERROR;
+            return -2;
+        }
+        map_entry->optimised_value = (data_value * factor_value) / 100;
+        bound_value(map_entry);
+        map_entry->status = ENTRY_PROCESSED_SUCCESS;
+
+        if (ref_value == map_entry->optimised_value)
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is already optimum (%lld) based on %s = %.0f",
+                     map_entry->param, (long long)map_entry->optimised_value, get_resource_name(map_entry->resource), data_value);
+        else if (ref_value != INVALID_DOUBLE_VAL)
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is changed from %lld to %lld based on %s = %.0f",
+                     map_entry->param, (long long)ref_value, (long long)map_entry->optimised_value, get_resource_name(map_entry->resource), data_value);
+        else
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is %lld based on %s = %.0f",
+                     map_entry->param, (long long)map_entry->optimised_value, get_resource_name(map_entry->resource), data_value);
+        return 0;
+    }
     else
     {
         snprintf(map_entry->message, MAX_MESSAGE_LEN, "Invalid Resource type: %s for parameter: %s. Only CPU and MEMOEY resources allowd for percentage processor",
@@ -131,6 +440,39 @@ percentage_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
     return -2;
 }
 
+/* Clamp a computed value into the min and max of its entry */
+static void
+bound_value(PGConfigMapEntry *map_entry)
+{
+    if (map_entry->has_min && map_entry->optimised_value < map_entry->min_value)
+        map_entry->optimised_value = map_entry->min_value;
+    if (map_entry->has_max && map_entry->optimised_value > map_entry->max_value)
+        map_entry->optimised_value = map_entry->max_value;
+}
+
+/* The value of a data directory resource, -1 when the data directory is not scanned */
+static double
+data_resource_value(RESOURCES resource, SystemInfo *system_info)
+{
+    if (system_info->data_size <= 0)
+        return -1;
+    switch (resource)
+    {
+    case RESOURCE_DATA_SIZE:
+        return (double)system_info->data_size;
+    case RESOURCE_LARGEST_TABLE:
+        return (double)system_info->largest_table;
+    case RESOURCE_RELATIONS:
+        return (double)system_info->relation_count;
+    case RESOURCE_DATA_SCALE:
+        if (system_info->data_size <= DATA_SCALE_BASE)
+            return 0;
+        return floor(log2(system_info->data_size / DATA_SCALE_BASE));
+    default:
+        return -1;
+    }
+}
+
 static int
 custom_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
 {
@@ -177,4 +519,740 @@ custom_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
 
     return -2;
     /* */
-}
\ No newline at end of file
+}
+
+/* The value of the profile stands until the cost is calibrated on the host */
+static int
+calibrated_processor(PGConfigMapEntry *map_entry, SystemInfo *system_info)
+{
+    char value[64];
+
+    if (!map_entry)
+        return -1;
+
+    if (map_entry->resource == RESOURCE_DISK)
+    {
+        map_entry->optimised_value = map_entry->factor_value;
+        bound_value(map_entry);
+        map_entry->status = ENTRY_PROCESSED_SUCCESS;
+        format_config_map_value(map_entry, value, sizeof value);
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s until it is calibrated with --calibrate-costs",
+                 map_entry->param, value);
+        return 0;
+    }
+    else
+    {
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Invalid Resource type: %s for parameter: %s. Only DISK resource is allowed for CALIBRATED processor",
+                 get_resource_name(map_entry->resource), map_entry->param);
+        map_entry->status = ENTRY_PROCESSED_ERROR;
+    }
+
+    return -2;
+}
+
+/*
+ * work_mem large enough for the p95 temp file spill, as long as one for
+ * every connection stays within LOG_WORK_MEM_BUDGET_PCT of the memory.
+ */
+static void
+work_mem_evidence_processor(PGConfigMap *config_map, SystemInfo *system_info, LogEvidence *evidence)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "work_mem");
+    double current;
+    double spill;
+    double budget;
+    double wanted;
+
+    if (map_entry == NULL || evidence->temp_file_sizes.count < MIN_LOG_EVIDENCE_SAMPLES)
+        return;
+
+    current = get_config_map_setting(config_map, "work_mem", 1024, 0);
+    spill = log_percentile(&evidence->temp_file_sizes, LOG_SPILL_PERCENTILE);
+    budget = system_info->total_ram * LOG_WORK_MEM_BUDGET_PCT / 100 /
+        get_config_map_setting(config_map, "max_connections", 1, DEFAULT_MAX_CONNECTIONS);
+    wanted = ceil((spill < budget ? spill : budget) / EVIDENCE_GRANULE) * EVIDENCE_GRANULE;
+    if (wanted <= current || !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %lld to cover the p%.0f temp file spill of %lld bytes seen in %zu spills%s",
+             map_entry->param, (long long)wanted, LOG_SPILL_PERCENTILE, (long long)spill, evidence->temp_file_sizes.count,
+             spill > budget ? ", limited by the memory of all connections" : "");
+}
+
+/*
+ * max_wal_size that lets the p95 WAL rate run for a whole checkpoint_timeout
+ * before a checkpoint is forced. A checkpoint is requested once the WAL
+ * since the previous one reaches max_wal_size / (1 + checkpoint_completion_target).
+ * The rate comes from the checkpoint distances and times or, without
+ * log_checkpoints, from the "checkpoints are occurring too frequently"
+ * warnings and the max_wal_size the server ran with.
+ */
+static void
+max_wal_size_evidence_processor(PGConfigMap *config_map, PGConfig *pg_config, LogEvidence *evidence)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "max_wal_size");
+    double timeout = get_duration_setting(config_map, pg_config, "checkpoint_timeout", DEFAULT_CHECKPOINT_TIMEOUT);
+    double target = get_config_map_setting(config_map, "checkpoint_completion_target", 1, DEFAULT_CHECKPOINT_COMPLETION_TARGET);
+    double current;
+    double rate;
+    double wanted;
+    const char *source;
+
+    if (map_entry == NULL)
+        return;
+
+    if (evidence->checkpoint_wal_rates.count >= MIN_LOG_EVIDENCE_SAMPLES)
+    {
+        rate = log_percentile(&evidence->checkpoint_wal_rates, LOG_WAL_RATE_PERCENTILE);
+        source = "checkpoint WAL rate";
+    }
+    else if (evidence->frequent_checkpoint_gaps.count >= MIN_LOG_EVIDENCE_SAMPLES)
+    {
+        double running = DEFAULT_MAX_WAL_SIZE;
+        double gap = log_percentile(&evidence->frequent_checkpoint_gaps, 100 - LOG_WAL_RATE_PERCENTILE);
+        PGConfigKeyVal *conf = pg_config ? PGConfig_get_param_by_name(pg_config, "max_wal_size") : NULL;
+        long long size;
+
+        if (conf && conf->value)
+        {
+            /* a max_wal_size without a unit is in MB */
+            if (conf->type == PTYPE_INT && strspn(conf->value, "0123456789") == strlen(conf->value))
+                running = conf->int_val * 1024.0 * 1024.0;
+            else if (parse_size_text(conf->value, &size))
+                running = (double)size;
+        }
+        if (gap <= 0)
+            gap = 1;
+        rate = running / (1 + target) / gap;
+        source = "rate of the too frequent checkpoints";
+    }
+    else
+        return;
+
+    current = get_config_map_setting(config_map, "max_wal_size", 1024 * 1024, 0);
+    wanted = ceil(rate * timeout * (1 + target) / EVIDENCE_GRANULE) * EVIDENCE_GRANULE;
+    if (wanted <= current || !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %lld for checkpoints every %.0f s at the p%.0f %s of %.0f bytes/s",
+             map_entry->param, (long long)wanted, timeout, LOG_WAL_RATE_PERCENTILE, source, rate);
+}
+
+/*
+ * shared_buffers for the hot set with RESIDENCY_HEADROOM_PCT to grow, both
+ * up and down. A size from the miss ratio curve of a buffer trace is
+ * better evidence and is left alone.
+ */
+static void
+shared_buffers_residency_processor(PGConfigMap *config_map, SystemInfo *system_info, CacheResidency *residency)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "shared_buffers");
+    double upper = system_info->total_ram * RESIDENCY_MAX_SHARED_BUFFERS_PCT / 100;
+    double wanted;
+
+    if (map_entry == NULL || map_entry->resource == RESOURCE_MRC)
+        return;
+
+    wanted = residency->total_resident * (1 + RESIDENCY_HEADROOM_PCT / 100);
+    if (wanted > upper)
+        wanted = upper;
+    if (wanted < RESIDENCY_MIN_SHARED_BUFFERS)
+        wanted = RESIDENCY_MIN_SHARED_BUFFERS;
+    wanted = ceil(wanted / EVIDENCE_GRANULE) * EVIDENCE_GRANULE;
+    if (wanted == get_config_map_setting(config_map, "shared_buffers", get_block_size(system_info), 0) ||
+        !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %lld for the hot set of %lld bytes resident in the page cache",
+             map_entry->param, (long long)wanted, residency->total_resident);
+}
+
+/* At least shared_buffers and the resident data, the planner can count on both */
+static void
+effective_cache_size_residency_processor(PGConfigMap *config_map, SystemInfo *system_info, CacheResidency *residency)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "effective_cache_size");
+    double upper = system_info->total_ram * RESIDENCY_MAX_CACHE_PCT / 100;
+    double wanted;
+
+    if (map_entry == NULL)
+        return;
+
+    wanted = get_config_map_setting(config_map, "shared_buffers", get_block_size(system_info), 0) + residency->total_resident;
+    if (wanted > upper)
+        wanted = upper;
+    wanted = ceil(wanted / EVIDENCE_GRANULE) * EVIDENCE_GRANULE;
+    if (wanted <= get_config_map_setting(config_map, "effective_cache_size", get_block_size(system_info), 0) ||
+        !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %lld for shared_buffers and the %lld bytes resident in the page cache",
+             map_entry->param, (long long)wanted, residency->total_resident);
+}
+
+/*
+ * A cost limit that lets autovacuum get through the dead and not all
+ * visible pages of every table in AUTOVACUUM_CYCLE_SECONDS. Only ever
+ * raised, a lower limit in the profile is no reason to vacuum slower.
+ */
+static void
+autovacuum_cost_limit_heap_processor(PGConfigMap *config_map, HeapScan *scan)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "autovacuum_vacuum_cost_limit");
+
+    if (map_entry == NULL ||
+        scan->cost_limit <= get_config_map_setting(config_map, "autovacuum_vacuum_cost_limit", 1, MIN_AUTOVACUUM_COST_LIMIT) ||
+        !set_evidence_count(map_entry, scan->cost_limit, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %.0f to vacuum the %lld pages that are not all visible, %lld of them with dead tuples, every %.0f seconds",
+             map_entry->param, scan->cost_limit, scan->total.pages - scan->total.vm_visible, scan->total.dirty_pages,
+             AUTOVACUUM_CYCLE_SECONDS);
+}
+
+/*
+ * An autovacuum_freeze_max_age the server takes XID_FREEZE_CYCLE_SECONDS
+ * to use up at the measured rate. Only ever raised, and not beyond
+ * MAX_AUTOVACUUM_FREEZE_MAX_AGE, the margin to wraparound is worth more
+ * than fewer forced vacuums. Returns the value that applies.
+ */
+static double
+freeze_max_age_xid_processor(PGConfigMap *config_map, XidRate *rate)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "autovacuum_freeze_max_age");
+    double current = get_config_map_setting(config_map, "autovacuum_freeze_max_age", 1, DEFAULT_AUTOVACUUM_FREEZE_MAX_AGE);
+    double wanted = ceil(rate->xid_rate * XID_FREEZE_CYCLE_SECONDS / FREEZE_MAX_AGE_ROUNDING) * FREEZE_MAX_AGE_ROUNDING;
+
+    if (wanted > MAX_AUTOVACUUM_FREEZE_MAX_AGE)
+        wanted = MAX_AUTOVACUUM_FREEZE_MAX_AGE;
+    if (map_entry == NULL || wanted <= current || !set_evidence_count(map_entry, wanted, config_map->arena))
+        return current;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %.0f so that vacuums to prevent wraparound are forced every %.1f days instead of every %.1f days at %.1f transaction ids a second",
+             map_entry->param, wanted, wanted / rate->xid_rate / 86400.0, current / rate->xid_rate / 86400.0, rate->xid_rate);
+    return wanted;
+}
+
+/*
+ * Any vacuum freezes the tuples last changed XID_FREEZE_MIN_AGE_SECONDS
+ * ago, so that most of the freezing is done by the vacuums that run anyway
+ * and not left to the forced ones. The server uses at most half of
+ * autovacuum_freeze_max_age.
+ */
+static void
+freeze_min_age_xid_processor(PGConfigMap *config_map, XidRate *rate, double freeze_max_age)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "vacuum_freeze_min_age");
+    double wanted = round(rate->xid_rate * XID_FREEZE_MIN_AGE_SECONDS / FREEZE_MIN_AGE_ROUNDING) * FREEZE_MIN_AGE_ROUNDING;
+
+    if (wanted < MIN_VACUUM_FREEZE_MIN_AGE)
+        wanted = MIN_VACUUM_FREEZE_MIN_AGE;
+    if (wanted > freeze_max_age / 2)
+        wanted = freeze_max_age / 2;
+    if (map_entry == NULL ||
+        wanted == get_config_map_setting(config_map, "vacuum_freeze_min_age", 1, DEFAULT_VACUUM_FREEZE_MIN_AGE) ||
+        !set_evidence_count(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is %.0f to freeze the tuples not changed for %.0f minutes at %.1f transaction ids a second",
+             map_entry->param, wanted, wanted / rate->xid_rate / 60.0, rate->xid_rate);
+}
+
+/*
+ * A forced vacuum reads, and freezing dirties, every page of the data in
+ * the worst case. A cost limit that gets through that once between two
+ * forced vacuums keeps up with the freezing. Only ever raised.
+ */
+static void
+autovacuum_cost_limit_xid_processor(PGConfigMap *config_map, SystemInfo *system_info, XidRate *rate, double freeze_max_age)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "autovacuum_vacuum_cost_limit");
+    double pages, seconds, wanted;
+
+    if (map_entry == NULL || system_info->data_size <= 0)
+        return;
+    pages = (double)system_info->data_size / get_block_size(system_info);
+    seconds = freeze_max_age / rate->xid_rate;
+    wanted = ceil(pages * (VACUUM_COST_PAGE_MISS + VACUUM_COST_PAGE_DIRTY) / (seconds * 1000.0 / AUTOVACUUM_COST_DELAY_MS));
+    if (wanted > MAX_AUTOVACUUM_COST_LIMIT)
+        wanted = MAX_AUTOVACUUM_COST_LIMIT;
+    if (wanted <= get_config_map_setting(config_map, "autovacuum_vacuum_cost_limit", 1, MIN_AUTOVACUUM_COST_LIMIT) ||
+        !set_evidence_count(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %.0f to freeze the %.0f pages of data once every %.1f hours, between two vacuums forced by autovacuum_freeze_max_age",
+             map_entry->param, wanted, pages, seconds / 3600.0);
+}
+
+/*
+ * A forced vacuum of a large table holds a worker for as long as it runs.
+ * When the next one is less than XID_URGENT_SECONDS away there are more
+ * workers, so that the other tables are still vacuumed meanwhile.
+ */
+static void
+autovacuum_workers_xid_processor(PGConfigMap *config_map, XidRate *rate, double freeze_max_age)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "autovacuum_max_workers");
+    double seconds = seconds_to_freeze_age(rate, freeze_max_age);
+
+    if (map_entry == NULL || seconds >= XID_URGENT_SECONDS ||
+        XID_URGENT_AUTOVACUUM_WORKERS <= get_config_map_setting(config_map, "autovacuum_max_workers", 1, DEFAULT_AUTOVACUUM_MAX_WORKERS) ||
+        !set_evidence_count(map_entry, XID_URGENT_AUTOVACUUM_WORKERS, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %d since autovacuum_freeze_max_age %.0f is reached %s",
+             map_entry->param, XID_URGENT_AUTOVACUUM_WORKERS, freeze_max_age, seconds <= 0 ? "already" : "within a day");
+}
+
+/*
+ * Full page images that are most of the WAL mean the pages are written
+ * whole again after every checkpoint, fewer checkpoints write fewer of
+ * them.
+ */
+static void
+checkpoint_timeout_wal_processor(PGConfigMap *config_map, PGConfig *pg_config, WalStream *stream)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "checkpoint_timeout");
+    double current = get_duration_setting(config_map, pg_config, "checkpoint_timeout", DEFAULT_CHECKPOINT_TIMEOUT);
+
+    if (map_entry == NULL || stream->fpi_share < WAL_FPI_SHARE_HIGH || current >= WAL_FPI_CHECKPOINT_TIMEOUT ||
+        !set_evidence_count(map_entry, WAL_FPI_CHECKPOINT_TIMEOUT, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %.0f s since %.1f%% of the WAL are full page images",
+             map_entry->param, WAL_FPI_CHECKPOINT_TIMEOUT, 100.0 * stream->fpi_share);
+}
+
+/* Room for the WAL of a checkpoint_timeout, so checkpoints are not started by WAL */
+static void
+max_wal_size_wal_processor(PGConfigMap *config_map, PGConfig *pg_config, WalStream *stream)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "max_wal_size");
+    double timeout = get_duration_setting(config_map, pg_config, "checkpoint_timeout", DEFAULT_CHECKPOINT_TIMEOUT);
+    double target = get_config_map_setting(config_map, "checkpoint_completion_target", 1, DEFAULT_CHECKPOINT_COMPLETION_TARGET);
+    double wanted;
+
+    if (map_entry == NULL || stream->bytes_per_second <= 0)
+        return;
+    wanted = ceil(stream->bytes_per_second * timeout * (1 + target) / EVIDENCE_GRANULE) * EVIDENCE_GRANULE;
+    if (wanted <= get_config_map_setting(config_map, "max_wal_size", 1024 * 1024, 0) ||
+        !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %lld for checkpoints every %.0f s at the %.0f bytes/s of WAL in pg_wal",
+             map_entry->param, (long long)wanted, timeout, stream->bytes_per_second);
+}
+
+/*
+ * Full page images compress well, the hole in the middle of a page is
+ * left out anyway but the rest is mostly repeated tuple headers. Only a
+ * custom entry that is off is turned on.
+ */
+static void
+wal_compression_wal_processor(PGConfigMap *config_map, WalStream *stream)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "wal_compression");
+    char *value;
+
+    if (map_entry == NULL || map_entry->formula != CUSTOM || !config_map->arena || !map_entry->value ||
+        stream->fpi_share < WAL_FPI_SHARE_COMPRESS || stream->num_compressed_fpi > 0 ||
+        (strcasecmp(map_entry->value, "off") != 0 && strcasecmp(map_entry->value, "false") != 0 &&
+         strcmp(map_entry->value, "0") != 0))
+        return;
+    value = pg_arena_strdup(config_map->arena, "on");
+    if (value == NULL)
+        return;
+    map_entry->value = value;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is turned on since %.1f%% of the WAL are uncompressed full page images",
+             map_entry->param, 100.0 * stream->fpi_share);
+}
+
+/* What is written in WAL_BUFFER_SECONDS, so that backends do not have to write WAL themselves */
+static void
+wal_buffers_wal_processor(PGConfigMap *config_map, SystemInfo *system_info, WalStream *stream)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "wal_buffers");
+    double current = get_wal_buffers_setting(config_map, system_info);
+    double wanted;
+
+    if (map_entry == NULL || stream->bytes_per_second <= 0)
+        return;
+    wanted = ceil(stream->bytes_per_second * WAL_BUFFER_SECONDS / EVIDENCE_GRANULE) * EVIDENCE_GRANULE;
+    if (wanted > MAX_WAL_BUFFERS)
+        wanted = MAX_WAL_BUFFERS;
+    if (wanted <= current || !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %lld to hold %.0f s of WAL at %.0f bytes/s",
+             map_entry->param, (long long)wanted, WAL_BUFFER_SECONDS, stream->bytes_per_second);
+}
+
+static void
+wal_compression_bench_processor(PGConfigMap *config_map, SystemInfo *system_info, CompressionBench *bench,
+                                WalStream *stream)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "wal_compression");
+    CompressionChoice choice;
+
+    if (map_entry == NULL || map_entry->formula != CUSTOM || !map_entry->value ||
+        !choose_wal_compression(bench, system_info->server_version, system_info->disk_speed,
+                                stream ? stream->fpi_share : -1, &choice) ||
+        strcasecmp(map_entry->value, choice.value) == 0 || !set_custom_text(map_entry, choice.value, config_map->arena))
+        return;
+
+    if (choice.algorithm < 0)
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to off, no algorithm gets %.0f%% more than the %.1f MB/s of the disk through with %.1f cores free",
+                 map_entry->param, 100.0 * COMPRESSION_MIN_GAIN, choice.disk_throughput / (1024.0 * 1024.0), bench->free_cores);
+    else
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, %.1f MB/s of WAL get through with it against %.1f MB/s of the disk alone",
+                 map_entry->param, choice.value, choice.throughput / (1024.0 * 1024.0), choice.disk_throughput / (1024.0 * 1024.0));
+}
+
+static void
+toast_compression_bench_processor(PGConfigMap *config_map, SystemInfo *system_info, CompressionBench *bench)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "default_toast_compression");
+    CompressionChoice choice;
+
+    if (map_entry == NULL || map_entry->formula != CUSTOM || !map_entry->value ||
+        !choose_toast_compression(bench, system_info->server_version, system_info->disk_speed, &choice) ||
+        strcasecmp(map_entry->value, choice.value) == 0 || !set_custom_text(map_entry, choice.value, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, %.1f MB/s of values get written and read with it",
+             map_entry->param, choice.value, choice.throughput / (1024.0 * 1024.0));
+}
+
+/* Costs are in units of a sequential page read, what seq_page_cost 1 stands for */
+static void
+calibrated_cost_processor(PGConfigMapEntry *map_entry, CostCalibration *calibration, double cache_hit)
+{
+    PLANNER_COST cost = get_planner_cost(map_entry->param);
+    double value = calibrated_cost(calibration, cost, cache_hit);
+    char text[64];
+
+    if (value < 0)
+        return;
+    map_entry->optimised_value = value;
+    bound_value(map_entry);
+    format_config_map_value(map_entry, text, sizeof text);
+
+    switch (cost)
+    {
+    case COST_SEQ_PAGE:
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, the unit of the calibrated costs, a page read in a sequential scan takes %.1f us",
+                 map_entry->param, text, calibration->seq_page * 1e6);
+        break;
+    case COST_RANDOM_PAGE:
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, a random page read takes %.1f us against %.1f us sequentially and %.0f%% of them are expected from the cache",
+                 map_entry->param, text, calibration->random_page * 1e6, calibration->seq_page * 1e6, 100.0 * cache_hit);
+        break;
+    case COST_CPU_TUPLE:
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, a tuple is deformed in %.1f ns against %.1f us a sequential page read",
+                 map_entry->param, text, calibration->tuple * 1e9, calibration->seq_page * 1e6);
+        break;
+    case COST_CPU_OPERATOR:
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, an operator is evaluated in %.1f ns against %.1f us a sequential page read",
+                 map_entry->param, text, calibration->operator * 1e9, calibration->seq_page * 1e6);
+        break;
+    case COST_PARALLEL_SETUP:
+        snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is set to %s, a worker starts in %.1f us against %.1f us a sequential page read",
+                 map_entry->param, text, calibration->worker_start * 1e6, calibration->seq_page * 1e6);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * work_mem raised to the next whole sort knee, never below one, as long as
+ * one for every connection stays within KNEE_WORK_MEM_BUDGET_PCT of the
+ * memory. A sort smaller than the knee spills what would have sorted at
+ * the speed of the caches.
+ */
+static void
+work_mem_knee_processor(PGConfigMap *config_map, SystemInfo *system_info, MemoryKnee *knee)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "work_mem");
+    double step = knee->knee[KNEE_SORT];
+    double current;
+    double budget;
+    double wanted;
+    char step_text[32];
+
+    if (map_entry == NULL || step <= 0)
+        return;
+
+    current = get_config_map_setting(config_map, "work_mem", 1024, 0);
+    budget = system_info->total_ram * KNEE_WORK_MEM_BUDGET_PCT / 100 /
+        get_config_map_setting(config_map, "max_connections", 1, DEFAULT_MAX_CONNECTIONS);
+    wanted = ceil(current / step) * step;
+    if (wanted < step)
+        wanted = step;
+    if (wanted <= current || wanted > budget || !set_evidence_value(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %lld, a whole number of the %s sorted at the speed of the caches, %.1fx slower past it",
+             map_entry->param, (long long)wanted, knee_size_text(step, step_text, sizeof step_text),
+             knee->slowdown[KNEE_SORT]);
+}
+
+/*
+ * hash_mem_multiplier that makes the hash memory of a work_mem a whole
+ * number of hash knees, within 1 and KNEE_MAX_HASH_MEM_MULTIPLIER and
+ * the memory of all connections. It is only raised.
+ */
+static void
+hash_mem_multiplier_knee_processor(PGConfigMap *config_map, SystemInfo *system_info, MemoryKnee *knee)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "hash_mem_multiplier");
+    double step = knee->knee[KNEE_HASH];
+    double work_mem = get_config_map_setting(config_map, "work_mem", 1024, 4.0 * 1024 * 1024);
+    double current;
+    double budget;
+    double hash_mem;
+    double wanted;
+    char text[32];
+    char step_text[32];
+
+    if (map_entry == NULL || step <= 0 || work_mem <= 0)
+        return;
+
+    current = get_config_map_setting(config_map, "hash_mem_multiplier", 1, 2.0);
+    budget = system_info->total_ram * KNEE_WORK_MEM_BUDGET_PCT / 100 /
+        get_config_map_setting(config_map, "max_connections", 1, DEFAULT_MAX_CONNECTIONS);
+    hash_mem = ceil(work_mem * current / step) * step;
+    if (hash_mem > budget)
+        return;
+    wanted = ceil(hash_mem / work_mem * 100) / 100;
+    if (wanted < 1)
+        wanted = 1;
+    if (wanted > KNEE_MAX_HASH_MEM_MULTIPLIER)
+        wanted = KNEE_MAX_HASH_MEM_MULTIPLIER;
+    if (wanted <= current)
+        return;
+    if (map_entry->formula == CUSTOM)
+    {
+        snprintf(text, sizeof text, "%.2f", wanted);
+        if (!set_custom_text(map_entry, text, config_map->arena))
+            return;
+    }
+    else
+    {
+        map_entry->optimised_value = wanted;
+        bound_value(map_entry);
+    }
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is raised to %.2f, the hash memory of a work_mem of %lld bytes being a whole number of the %s hashed at the speed of the caches",
+             map_entry->param, wanted, (long long)work_mem, knee_size_text(step, step_text, sizeof step_text));
+}
+
+/*
+ * max_parallel_workers_per_gather lowered to the CPUs the memory feeds
+ * less the leader, which scans too. Entries of the MEMBW resource are
+ * sized from the bandwidth already.
+ */
+static void
+parallel_workers_bandwidth_processor(PGConfigMap *config_map, SystemInfo *system_info)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, "max_parallel_workers_per_gather");
+    double cpus = bandwidth_cpus(system_info->memory_bandwidth, system_info->core_bandwidth, system_info->cpu_count);
+    double current;
+    double wanted;
+
+    if (map_entry == NULL || map_entry->resource == RESOURCE_MEMBW)
+        return;
+
+    current = get_config_map_setting(config_map, "max_parallel_workers_per_gather", 1, 2);
+    wanted = floor(cpus + 0.5) - 1;
+    if (wanted < 0)
+        wanted = 0;
+    if (wanted >= current || !set_evidence_count(map_entry, wanted, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is lowered to %lld, %.1f GB/s of memory bandwidth feeds %.1f of %ld CPUs at the %.1f GB/s of one%s",
+             map_entry->param, (long long)wanted, system_info->memory_bandwidth, cpus, system_info->cpu_count,
+             system_info->core_bandwidth,
+             is_bandwidth_starved(system_info->memory_bandwidth, system_info->core_bandwidth, system_info->cpu_count) ?
+             ", the host is starved of memory bandwidth" : "");
+}
+
+static const char *
+knee_size_text(double bytes, char *buf, size_t len)
+{
+    if (bytes >= 1024.0 * 1024)
+        snprintf(buf, len, "%.0fMB", bytes / (1024.0 * 1024));
+    else
+        snprintf(buf, len, "%.0fkB", bytes / 1024.0);
+    return buf;
+}
+
+/*
+ * A parameter of another version becomes its replacement when there is
+ * one and the map does not set that already. Values that change their
+ * unit can only be converted in custom entries, which hold their text.
+ */
+static void
+param_version_processor(PGConfigMap *config_map, PGConfigMapEntry *map_entry, SystemInfo *system_info)
+{
+    const ParamVersion *version = get_param_version(map_entry->param);
+    const ParamVersion *replacement;
+    double segment_size = system_info->wal_segment_size > 0 ? system_info->wal_segment_size : DEFAULT_WAL_SEGMENT_SIZE;
+    char server_version[16];
+    char *old_param = map_entry->param;
+    bool converted = false;
+
+    if (version == NULL || param_exists_in(version, system_info->server_version))
+        return;
+
+    format_server_version(system_info->server_version, server_version, sizeof server_version);
+    replacement = version->replacement ? get_param_version(version->replacement) : NULL;
+    if (replacement && param_exists_in(replacement, system_info->server_version) && config_map->arena &&
+        find_processed_entry(config_map, replacement->param) == NULL)
+    {
+        if (version->conversion == CONVERT_NONE)
+            converted = true;
+        else if (map_entry->formula == CUSTOM && version->conversion == CONVERT_SEGMENTS_TO_SIZE)
+            converted = set_evidence_value(map_entry, get_config_map_setting(config_map, old_param, 1, 0) * segment_size,
+                                           config_map->arena);
+        else if (map_entry->formula == CUSTOM && version->conversion == CONVERT_SIZE_TO_SEGMENTS)
+            converted = set_evidence_count(map_entry, ceil(get_config_map_setting(config_map, old_param, 1024 * 1024, 0) / segment_size),
+                                           config_map->arena);
+    }
+    if (converted)
+    {
+        map_entry->param = pg_arena_strdup(config_map->arena, replacement->param);
+        if (map_entry->param)
+        {
+            if (map_entry->profile_param == NULL)
+                map_entry->profile_param = old_param;
+            snprintf(map_entry->message, MAX_MESSAGE_LEN, "Parameter: \"%s\" is written as \"%s\" for PostgreSQL %s",
+                     old_param, map_entry->param, server_version);
+            return;
+        }
+        map_entry->param = old_param;
+    }
+    map_entry->status = ENTRY_PROCESSED_ERROR;
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Parameter: \"%s\" does not exist in PostgreSQL %s and is left out",
+             map_entry->param, server_version);
+}
+
+/* The server counts min_wal_size and max_wal_size in segments, and wants at least MIN_WAL_SIZE_SEGMENTS */
+static void
+wal_size_segment_processor(PGConfigMap *config_map, SystemInfo *system_info, const char *param)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, param);
+    double segment_size = system_info->wal_segment_size > 0 ? system_info->wal_segment_size : DEFAULT_WAL_SEGMENT_SIZE;
+    double current;
+    double segments;
+
+    if (map_entry == NULL)
+        return;
+    current = get_config_map_setting(config_map, param, 1024 * 1024, -1);
+    if (current < 0)
+        return;
+    segments = ceil(current / segment_size);
+    if (segments < MIN_WAL_SIZE_SEGMENTS)
+        segments = MIN_WAL_SIZE_SEGMENTS;
+    if (segments * segment_size == current || !set_evidence_value(map_entry, segments * segment_size, config_map->arena))
+        return;
+
+    snprintf(map_entry->message, MAX_MESSAGE_LEN, "Optimised value for parameter: \"%s\" is rounded to %.0f WAL segments of %.0f bytes",
+             map_entry->param, segments, segment_size);
+}
+
+static bool
+param_exists_in(const ParamVersion *version, int server_version)
+{
+    return server_version >= version->since && (version->until == 0 || server_version < version->until);
+}
+
+/* Settings without a unit count in blocks of the server */
+long
+get_block_size(SystemInfo *system_info)
+{
+    return system_info->block_size > 0 ? system_info->block_size : DEFAULT_BLOCK_SIZE;
+}
+
+static PGConfigMapEntry *
+find_processed_entry(PGConfigMap *config_map, const char *param)
+{
+    PGConfigMapEntry *map_entry;
+
+    for (map_entry = config_map->list; map_entry; map_entry = map_entry->next)
+    {
+        if (map_entry->status == ENTRY_PROCESSED_SUCCESS && strcasecmp(map_entry->param, param) == 0)
+            return map_entry;
+    }
+    return NULL;
+}
+
+/* Memory entries hold bytes, custom ones their text, written in kB */
+static bool
+set_evidence_value(PGConfigMapEntry *map_entry, double bytes, PGArena *arena)
+{
+    if (map_entry->resource == RESOURCE_MEMORY)
+    {
+        map_entry->optimised_value = bytes;
+        return true;
+    }
+    if (map_entry->formula == CUSTOM && arena)
+    {
+        char *value = pg_arena_sprintf(arena, "%lldkB", (long long)(bytes / 1024));
+
+        if (value == NULL)
+            return false;
+        map_entry->value = value;
+        return true;
+    }
+    return false;
+}
+
+/* The text of a custom entry, e.g. an enum setting */
+static bool
+set_custom_text(PGConfigMapEntry *map_entry, const char *text, PGArena *arena)
+{
+    char *value;
+
+    if (map_entry->formula != CUSTOM || !arena)
+        return false;
+    value = pg_arena_strdup(arena, text);
+    if (value == NULL)
+        return false;
+    map_entry->value = value;
+    return true;
+}
+
+/* Custom entries hold their text, the others the number */
+static bool
+set_evidence_count(PGConfigMapEntry *map_entry, double count, PGArena *arena)
+{
+    if (map_entry->formula == CUSTOM && arena)
+    {
+        char *value = pg_arena_sprintf(arena, "%lld", (long long)count);
+
+        if (value == NULL)
+            return false;
+        map_entry->value = value;
+        return true;
+    }
+    map_entry->optimised_value = count;
+    return true;
+}
+
+/* A time setting of the map, or else of postgresql.conf, in seconds */
+static double
+get_duration_setting(PGConfigMap *config_map, PGConfig *pg_config, char *param, double default_value)
+{
+    PGConfigMapEntry *map_entry = find_processed_entry(config_map, param);
+    PGConfigKeyVal *conf;
+    double seconds;
+
+    if (map_entry && map_entry->formula == CUSTOM && parse_duration_text(map_entry->value, 1, &seconds))
+        return seconds;
+    conf = pg_config ? PGConfig_get_param_by_name(pg_config, param) : NULL;
+    if (conf && parse_duration_text(conf->value, 1, &seconds))
+        return seconds;
+    return default_value;
+}
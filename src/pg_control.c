@@ -0,0 +1,332 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_control.c
+ *		Read the build and WAL settings of a server from its data directory.
+ *
+ * The server writes the block size, the WAL block and segment sizes and
+ * whether data checksums are on into global/pg_control when the cluster
+ * is created, and refuses to start a data directory that does not match
+ * how it was built. So that, and not what the server usually looks like,
+ * is what page based units and WAL sizes have to be counted in.
+ *
+ * The layout of pg_control changes between major versions. Everything
+ * read here follows the floating point format check value, which sits at
+ * a different offset in every version but is followed by the same fields
+ * in all of them, and the CRC32C at the end of the data confirms the read.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "pg_control.h"
+
+/* FLOATFORMAT_VALUE of the server, right after maxAlign */
+#define FLOAT_FORMAT_VALUE 1234567.0
+
+/* Offsets of the fields that follow the float format value */
+#define BLOCK_SIZE_OFFSET 8
+#define SEGMENT_BLOCKS_OFFSET 12
+#define WAL_BLOCK_SIZE_OFFSET 16
+#define WAL_SEGMENT_SIZE_OFFSET 20
+#define DATA_CHECKSUM_OFFSET 44
+
+/*
+ * Where the CRC may follow the float format value: before the
+ * authentication nonce was added, after it, and after
+ * default_char_signedness was added in front of it
+ */
+static const int crc_offsets[] = {48, 80, 84};
+
+/* Offsets from the start of the file, the same in every version */
+#define SYSTEM_IDENTIFIER_OFFSET 0
+#define CONTROL_VERSION_OFFSET 8
+#define CATALOG_VERSION_OFFSET 12
+#define STATE_OFFSET 16
+
+/*
+ * The copy of the latest checkpoint record, after the location of the
+ * previous checkpoint up to version 10, and its counters. Version 12 made
+ * the next transaction id a 64 bit value, before it the epoch was kept
+ * next to it.
+ */
+#define CHECKPOINT_OFFSET 40
+#define CHECKPOINT_OFFSET_PRE_11 48
+#define CP_NEXT_XID_EPOCH_OFFSET 20
+#define CP_NEXT_XID_OFFSET 24
+#define CP_NEXT_MULTI_OFFSET 36
+#define CP_OLDEST_XID_OFFSET 44
+#define CP_OLDEST_MULTI_OFFSET 52
+#define CP_TIME_OFFSET 64
+#define CP_NEXT_MULTI_OFFSET_PRE_12 32
+#define CP_OLDEST_XID_OFFSET_PRE_12 40
+#define CP_OLDEST_MULTI_OFFSET_PRE_12 48
+#define CP_TIME_OFFSET_PRE_12 56
+
+/* CRC-32C, the Castagnoli polynomial the server checksums pg_control and WAL with */
+static uint32_t crc32c_table[256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static const char *state_names[] = {
+    "starting up", "shut down", "shut down in recovery", "shutting down",
+    "in crash recovery", "in archive recovery", "in production"};
+
+static const ParamVersion param_versions[] = {
+    {"checkpoint_segments", 0, 90500, NULL, CONVERT_NONE},
+    {"min_wal_size", 90500, 0, NULL, CONVERT_NONE},
+    {"max_wal_size", 90500, 0, NULL, CONVERT_NONE},
+    {"max_parallel_workers_per_gather", 90600, 0, NULL, CONVERT_NONE},
+    {"min_parallel_relation_size", 90600, 100000, "min_parallel_table_scan_size", CONVERT_NONE},
+    {"min_parallel_table_scan_size", 100000, 0, "min_parallel_relation_size", CONVERT_NONE},
+    {"min_parallel_index_scan_size", 100000, 0, NULL, CONVERT_NONE},
+    {"max_parallel_workers", 100000, 0, NULL, CONVERT_NONE},
+    {"replacement_sort_tuples", 90600, 110000, NULL, CONVERT_NONE},
+    {"max_parallel_maintenance_workers", 110000, 0, NULL, CONVERT_NONE},
+    {"parallel_leader_participation", 110000, 0, NULL, CONVERT_NONE},
+    {"jit", 110000, 0, NULL, CONVERT_NONE},
+    {"vacuum_cleanup_index_scale_factor", 110000, 140000, NULL, CONVERT_NONE},
+    {"wal_recycle", 120000, 0, NULL, CONVERT_NONE},
+    {"wal_init_zero", 120000, 0, NULL, CONVERT_NONE},
+    {"shared_memory_type", 120000, 0, NULL, CONVERT_NONE},
+    {"wal_keep_segments", 0, 130000, "wal_keep_size", CONVERT_SEGMENTS_TO_SIZE},
+    {"wal_keep_size", 130000, 0, "wal_keep_segments", CONVERT_SIZE_TO_SEGMENTS},
+    {"hash_mem_multiplier", 130000, 0, NULL, CONVERT_NONE},
+    {"maintenance_io_concurrency", 130000, 0, NULL, CONVERT_NONE},
+    {"logical_decoding_work_mem", 130000, 0, NULL, CONVERT_NONE},
+    {"autovacuum_vacuum_insert_threshold", 130000, 0, NULL, CONVERT_NONE},
+    {"autovacuum_vacuum_insert_scale_factor", 130000, 0, NULL, CONVERT_NONE},
+    {"operator_precedence_warning", 90500, 140000, NULL, CONVERT_NONE},
+    {"huge_page_size", 140000, 0, NULL, CONVERT_NONE},
+    {"vacuum_failsafe_age", 140000, 0, NULL, CONVERT_NONE},
+    {"default_toast_compression", 140000, 0, NULL, CONVERT_NONE},
+    {"client_connection_check_interval", 140000, 0, NULL, CONVERT_NONE},
+    {"recovery_prefetch", 150000, 0, NULL, CONVERT_NONE},
+    {"stats_temp_directory", 0, 150000, NULL, CONVERT_NONE},
+    {"vacuum_defer_cleanup_age", 0, 160000, NULL, CONVERT_NONE},
+    {"old_snapshot_threshold", 90600, 170000, NULL, CONVERT_NONE},
+    {"io_combine_limit", 170000, 0, NULL, CONVERT_NONE},
+    {"summarize_wal", 170000, 0, NULL, CONVERT_NONE},
+    {"io_method", 180000, 0, NULL, CONVERT_NONE},
+    {"io_workers", 180000, 0, NULL, CONVERT_NONE},
+    {"autovacuum_worker_slots", 180000, 0, NULL, CONVERT_NONE},
+    {"autovacuum_vacuum_max_threshold", 180000, 0, NULL, CONVERT_NONE},
+    {NULL, 0, 0, NULL, CONVERT_NONE}
+};
+
+static bool read_server_version(const char *data_dir, int *server_version);
+static bool read_control_file(const char *data_dir, ControlInfo *info);
+static void read_checkpoint(const unsigned char *data, ControlInfo *info);
+static void init_crc32c_table(void);
+
+bool
+read_control_info(const char *data_dir, ControlInfo *info)
+{
+    memset(info, 0x00, sizeof *info);
+    if (!read_server_version(data_dir, &info->server_version))
+        return false;
+    return read_control_file(data_dir, info);
+}
+
+void
+print_control_info(ControlInfo *info)
+{
+    char version[16];
+
+    format_server_version(info->server_version, version, sizeof version);
+    printf("LOG: data directory of PostgreSQL %s\n", version);
+    if (!info->has_control)
+        return;
+    printf("LOG:   system identifier      : %llu\n", (unsigned long long)info->system_identifier);
+    printf("LOG:   state                  : %s\n",
+           info->state >= 0 && info->state < (int)(sizeof state_names / sizeof state_names[0]) ? state_names[info->state] : "unknown");
+    printf("LOG:   block size             : %u\n", info->block_size);
+    printf("LOG:   WAL block size         : %u\n", info->wal_block_size);
+    printf("LOG:   WAL segment size       : %u MB\n", info->wal_segment_size / (1024 * 1024));
+    printf("LOG:   data checksums         : %s\n", info->data_checksum_version ? "on" : "off");
+    printf("LOG:   latest checkpoint      : next xid %u:%u, oldest xid %u, next multixact %u\n",
+           (uint32_t)(info->next_xid >> 32), (uint32_t)info->next_xid, info->oldest_xid, info->next_multi);
+}
+
+const ParamVersion *
+get_param_version(const char *param)
+{
+    const ParamVersion *version;
+
+    for (version = param_versions; version->param; version++)
+    {
+        if (strcasecmp(version->param, param) == 0)
+            return version;
+    }
+    return NULL;
+}
+
+void
+format_server_version(int server_version, char *buf, size_t len)
+{
+    if (server_version >= 100000)
+        snprintf(buf, len, "%d", server_version / 10000);
+    else
+        snprintf(buf, len, "%d.%d", server_version / 10000, server_version / 100 % 100);
+}
+
+uint32_t
+comp_crc32c(uint32_t crc, const unsigned char *data, size_t len)
+{
+    size_t i;
+
+    pthread_once(&crc32c_table_once, init_crc32c_table);
+    for (i = 0; i < len; i++)
+        crc = crc32c_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+/* "16" since version 10, "9.6" before */
+static bool
+read_server_version(const char *data_dir, int *server_version)
+{
+    char path[PATH_MAX];
+    int major, minor = 0;
+    int fields;
+    FILE *fp;
+
+    snprintf(path, sizeof path, "%s/%s", data_dir, PG_VERSION_FILE);
+    fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    fields = fscanf(fp, "%d.%d", &major, &minor);
+    fclose(fp);
+    if (fields < 1 || major < 9 || (major < 10 && fields < 2))
+    {
+        fprintf(stderr, "ERROR: %s does not hold a PostgreSQL version\n", path);
+        return false;
+    }
+    *server_version = major >= 10 ? major * 10000 : major * 10000 + minor * 100;
+    return true;
+}
+
+/* A data directory without pg_control is being created, that is not an error */
+static bool
+read_control_file(const char *data_dir, ControlInfo *info)
+{
+    unsigned char data[PG_CONTROL_FILE_SIZE];
+    char path[PATH_MAX];
+    size_t len;
+    size_t offset;
+    FILE *fp;
+    int i;
+
+    snprintf(path, sizeof path, "%s/%s", data_dir, PG_CONTROL_FILE);
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        if (errno == ENOENT)
+            return true;
+        fprintf(stderr, "Failed to open file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    len = fread(data, 1, sizeof data, fp);
+    fclose(fp);
+
+    for (offset = STATE_OFFSET + 8; offset + DATA_CHECKSUM_OFFSET + 4 <= len; offset += 8)
+    {
+        double float_format;
+
+        memcpy(&float_format, data + offset, sizeof float_format);
+        if (float_format == FLOAT_FORMAT_VALUE)
+            break;
+    }
+    if (offset + DATA_CHECKSUM_OFFSET + 4 > len)
+    {
+        fprintf(stderr, "ERROR: %s was written on a machine with another byte order or is not a control file\n", path);
+        return false;
+    }
+    for (i = 0; i < (int)(sizeof crc_offsets / sizeof crc_offsets[0]); i++)
+    {
+        size_t crc_offset = offset + crc_offsets[i];
+        uint32_t crc;
+
+        if (crc_offset + sizeof crc > len)
+            break;
+        memcpy(&crc, data + crc_offset, sizeof crc);
+        if (crc == FIN_CRC32C(comp_crc32c(INIT_CRC32C, data, crc_offset)))
+            break;
+    }
+    if (i == (int)(sizeof crc_offsets / sizeof crc_offsets[0]) || offset + crc_offsets[i] + 4 > len)
+    {
+        fprintf(stderr, "ERROR: %s fails its CRC check, the control file is damaged\n", path);
+        return false;
+    }
+
+    memcpy(&info->system_identifier, data + SYSTEM_IDENTIFIER_OFFSET, sizeof info->system_identifier);
+    memcpy(&info->control_version, data + CONTROL_VERSION_OFFSET, sizeof info->control_version);
+    memcpy(&info->catalog_version, data + CATALOG_VERSION_OFFSET, sizeof info->catalog_version);
+    memcpy(&info->state, data + STATE_OFFSET, sizeof info->state);
+    memcpy(&info->block_size, data + offset + BLOCK_SIZE_OFFSET, sizeof info->block_size);
+    memcpy(&info->segment_blocks, data + offset + SEGMENT_BLOCKS_OFFSET, sizeof info->segment_blocks);
+    memcpy(&info->wal_block_size, data + offset + WAL_BLOCK_SIZE_OFFSET, sizeof info->wal_block_size);
+    memcpy(&info->wal_segment_size, data + offset + WAL_SEGMENT_SIZE_OFFSET, sizeof info->wal_segment_size);
+    memcpy(&info->data_checksum_version, data + offset + DATA_CHECKSUM_OFFSET, sizeof info->data_checksum_version);
+    read_checkpoint(data, info);
+    info->has_control = true;
+    return true;
+}
+
+static void
+read_checkpoint(const unsigned char *data, ControlInfo *info)
+{
+    const unsigned char *checkpoint = data + (info->server_version >= 110000 ? CHECKPOINT_OFFSET : CHECKPOINT_OFFSET_PRE_11);
+
+    if (info->server_version >= 120000)
+    {
+        memcpy(&info->next_xid, checkpoint + CP_NEXT_XID_OFFSET, sizeof info->next_xid);
+        memcpy(&info->next_multi, checkpoint + CP_NEXT_MULTI_OFFSET, sizeof info->next_multi);
+        memcpy(&info->oldest_xid, checkpoint + CP_OLDEST_XID_OFFSET, sizeof info->oldest_xid);
+        memcpy(&info->oldest_multi, checkpoint + CP_OLDEST_MULTI_OFFSET, sizeof info->oldest_multi);
+        memcpy(&info->checkpoint_time, checkpoint + CP_TIME_OFFSET, sizeof info->checkpoint_time);
+    }
+    else
+    {
+        uint32_t epoch, xid;
+
+        memcpy(&epoch, checkpoint + CP_NEXT_XID_EPOCH_OFFSET, sizeof epoch);
+        memcpy(&xid, checkpoint + CP_NEXT_XID_OFFSET, sizeof xid);
+        info->next_xid = (uint64_t)epoch << 32 | xid;
+        memcpy(&info->next_multi, checkpoint + CP_NEXT_MULTI_OFFSET_PRE_12, sizeof info->next_multi);
+        memcpy(&info->oldest_xid, checkpoint + CP_OLDEST_XID_OFFSET_PRE_12, sizeof info->oldest_xid);
+        memcpy(&info->oldest_multi, checkpoint + CP_OLDEST_MULTI_OFFSET_PRE_12, sizeof info->oldest_multi);
+        memcpy(&info->checkpoint_time, checkpoint + CP_TIME_OFFSET_PRE_12, sizeof info->checkpoint_time);
+    }
+}
+
+static void
+init_crc32c_table(void)
+{
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+        crc32c_table[i] = crc;
+    }
+}
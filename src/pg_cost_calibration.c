@@ -0,0 +1,758 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cost_calibration.c
+ *		Planner cost constants of the host: page reads of the data
+ *		directory, tuple deforming, expression evaluation and parallel
+ *		worker starts timed against a sequential page read.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "pg_cost_calibration.h"
+#include "pg_data_dir.h"
+#include "pg_page.h"
+#include "pg_bench.h"
+
+/* O_DIRECT wants the buffer and the offsets aligned to the logical block of the device */
+#define DIRECT_IO_ALIGNMENT 4096
+
+/* Same reads on every run over the same data */
+#define CALIBRATION_RANDOM_SEED 0x9E3779B97F4A7C15ULL
+
+/* Alignment of the attributes of a tuple, c.h of the server */
+#define MAXIMUM_ALIGNOF 8
+#define TYPE_ALIGN(alignment, offset) (((offset) + (alignment) - 1) & ~((long)(alignment) - 1))
+
+/* The deforming kernel works through a page worth of tuples, every fourth with a null */
+#define KERNEL_TUPLES 64
+#define KERNEL_ATTS 8
+#define KERNEL_NULL_EVERY 4
+#define KERNEL_NULL_ATT 3
+#define KERNEL_TUPLE_SPACE 128
+#define KERNEL_ROUNDS 1000
+
+/* Registers of the expression kernel */
+#define KERNEL_REGISTERS 8
+
+typedef struct calibration_file
+{
+    const char *path;
+    int fd;
+    long long blocks;
+} CalibrationFile;
+
+/* The attributes of pg_attribute the deforming needs */
+typedef struct kernel_attribute
+{
+    int len;                    /* -1 for a varlena */
+    int align;
+} KernelAttribute;
+
+/* int4, int8, text, date, float8, numeric, bool and timestamp */
+static const KernelAttribute kernel_atts[KERNEL_ATTS] = {
+    {4, 4}, {8, 8}, {-1, 4}, {4, 4}, {8, 8}, {-1, 4}, {1, 1}, {8, 8}
+};
+
+typedef struct kernel_tuples
+{
+    unsigned char data[KERNEL_TUPLES * KERNEL_TUPLE_SPACE];
+    int offsets[KERNEL_TUPLES];
+} KernelTuples;
+
+/* The arguments of a function call, FunctionCallInfo of the server */
+typedef struct kernel_call
+{
+    uint64_t args[2];
+} KernelCall;
+
+typedef uint64_t (*KernelFunction)(KernelCall *call);
+
+typedef enum KERNEL_OPCODE
+{
+    KERNEL_OP_VAR,              /* an attribute of the tuple into a register */
+    KERNEL_OP_CONST,
+    KERNEL_OP_FUNC,             /* a strict function of two registers */
+    KERNEL_OP_AND,              /* the qual is false when the register is false or null */
+    KERNEL_OP_DONE
+} KERNEL_OPCODE;
+
+typedef struct kernel_step
+{
+    KERNEL_OPCODE opcode;
+    int result;
+    int arg1;                   /* register, or the attribute of a var */
+    int arg2;
+    uint64_t constant;
+    KernelFunction function;
+} KernelStep;
+
+static const char *cost_params[INVALID_PLANNER_COST] = {
+    "seq_page_cost", "random_page_cost", "cpu_tuple_cost", "cpu_operator_cost", "parallel_setup_cost"
+};
+
+/* Keeps the compiler from leaving out what the kernels compute */
+static volatile uint64_t kernel_sink;
+
+static int pick_largest_files(RelationFile *files, int num_files, long block_size, CalibrationFile *largest);
+static int open_files(CalibrationFile *files, int num_files, long block_size, unsigned char *buffer, bool *direct_io);
+static void close_files(CalibrationFile *files, int num_files);
+static void time_sequential_reads(CalibrationFile *files, int num_files, long block_size, unsigned char *buffer,
+                                  CostCalibration *calibration);
+static void time_random_reads(CalibrationFile *files, int num_files, long block_size, unsigned char *buffer,
+                              CostCalibration *calibration);
+static void time_cached_reads(CalibrationFile *file, long block_size, unsigned char *buffer, CostCalibration *calibration);
+static void build_tuples(KernelTuples *tuples);
+static double time_tuple_deforming(KernelTuples *tuples);
+static double time_expression_evaluation(KernelTuples *tuples);
+static double time_worker_starts(void);
+
+bool
+calibrate_costs(const char *data_dir, long block_size, CostCalibration *calibration)
+{
+    CalibrationFile largest[CALIBRATION_MAX_FILES];
+    RelationFile *files;
+    KernelTuples *tuples;
+    unsigned char *buffer;
+    struct timeval start;
+    int num_files;
+    int num_largest;
+
+    memset(calibration, 0x00, sizeof *calibration);
+    gettimeofday(&start, NULL);
+    if (block_size <= 0)
+        block_size = DEFAULT_BLOCK_SIZE;
+
+    num_files = list_relation_files(data_dir, &files);
+    if (num_files < 0)
+        return false;
+    num_largest = pick_largest_files(files, num_files, block_size, largest);
+    if (num_largest == 0)
+    {
+        fprintf(stderr, "ERROR: %s has no relation data to read for the planner costs\n", data_dir);
+        free_relation_files(files, num_files);
+        return false;
+    }
+    if (posix_memalign((void **)&buffer, DIRECT_IO_ALIGNMENT, CALIBRATION_SEQ_READ_SIZE) != 0)
+    {
+        perror("Not possible to allocate memory for the calibration reads");
+        free_relation_files(files, num_files);
+        return false;
+    }
+
+    num_largest = open_files(largest, num_largest, block_size, buffer, &calibration->direct_io);
+    calibration->num_files = num_largest;
+    if (num_largest > 0)
+    {
+        time_sequential_reads(largest, num_largest, block_size, buffer, calibration);
+        time_random_reads(largest, num_largest, block_size, buffer, calibration);
+        time_cached_reads(&largest[0], block_size, buffer, calibration);
+        close_files(largest, num_largest);
+    }
+    free(buffer);
+    free_relation_files(files, num_files);
+    if (calibration->seq_reads < CALIBRATION_MIN_READS || calibration->random_reads < CALIBRATION_MIN_READS)
+    {
+        fprintf(stderr, "ERROR: only %d sequential and %d random pages of %s could be read, at least %d of each are needed for the planner costs\n",
+                calibration->seq_reads, calibration->random_reads, data_dir, CALIBRATION_MIN_READS);
+        return false;
+    }
+
+    tuples = malloc(sizeof *tuples);
+    if (tuples == NULL)
+    {
+        perror("Not possible to allocate memory for the calibration tuples");
+        return false;
+    }
+    build_tuples(tuples);
+    calibration->tuple = time_tuple_deforming(tuples);
+    calibration->operator = time_expression_evaluation(tuples);
+    free(tuples);
+    calibration->worker_start = time_worker_starts();
+    if (calibration->worker_start < 0)
+        fprintf(stderr, "WARNING: Failed to start a worker process, parallel_setup_cost is not calibrated\n");
+
+    calibration->elapsed = bench_elapsed(&start);
+    return true;
+}
+
+void
+print_cost_calibration(CostCalibration *calibration)
+{
+    printf("LOG: calibrated the planner costs on %d relation files in %.3f seconds\n", calibration->num_files,
+           calibration->elapsed);
+    if (!calibration->direct_io)
+        fprintf(stderr, "WARNING: the reads could not go past the page cache, the pages in it read as fast as memory\n");
+    printf("LOG:   sequential page read   : %.1f us, %d pages\n", calibration->seq_page * 1e6, calibration->seq_reads);
+    printf("LOG:   random page read       : %.1f us, %d pages\n", calibration->random_page * 1e6, calibration->random_reads);
+    printf("LOG:   page from the cache    : %.2f us\n", calibration->cached_page * 1e6);
+    printf("LOG:   tuple deformed         : %.1f ns\n", calibration->tuple * 1e9);
+    printf("LOG:   operator evaluated     : %.1f ns\n", calibration->operator * 1e9);
+    if (calibration->worker_start > 0)
+        printf("LOG:   worker started         : %.1f us\n", calibration->worker_start * 1e6);
+}
+
+PLANNER_COST
+get_planner_cost(const char *param)
+{
+    int cost;
+
+    if (param == NULL)
+        return INVALID_PLANNER_COST;
+    for (cost = 0; cost < INVALID_PLANNER_COST; cost++)
+    {
+        if (strcasecmp(cost_params[cost], param) == 0)
+            return cost;
+    }
+    return INVALID_PLANNER_COST;
+}
+
+double
+expected_cache_hit(long long data_size, double cache_size, double resident_share)
+{
+    if (resident_share >= 0)
+        return resident_share < 1 ? resident_share : 1;
+    if (data_size > 0 && cache_size > 0)
+        return cache_size < data_size ? cache_size / data_size : 1;
+    return CALIBRATION_DEFAULT_CACHE_HIT;
+}
+
+double
+calibrated_cost(CostCalibration *calibration, PLANNER_COST cost, double cache_hit)
+{
+    double random_page;
+
+    if (calibration->seq_page <= 0)
+        return -1;
+    switch (cost)
+    {
+    case COST_SEQ_PAGE:
+        return 1.0;
+    case COST_RANDOM_PAGE:
+        /* A random read is never cheaper than a sequential one to the planner */
+        random_page = (1 - cache_hit) * calibration->random_page + cache_hit * calibration->cached_page;
+        return random_page > calibration->seq_page ? random_page / calibration->seq_page : 1.0;
+    case COST_CPU_TUPLE:
+        return calibration->tuple > 0 ? calibration->tuple / calibration->seq_page : -1;
+    case COST_CPU_OPERATOR:
+        return calibration->operator > 0 ? calibration->operator / calibration->seq_page : -1;
+    case COST_PARALLEL_SETUP:
+        return calibration->worker_start > 0 ? calibration->worker_start / calibration->seq_page : -1;
+    default:
+        return -1;
+    }
+}
+
+/* Main forks of the largest relations, the ones that stay out of the cache longest */
+static int
+pick_largest_files(RelationFile *files, int num_files, long block_size, CalibrationFile *largest)
+{
+    int num_largest = 0;
+    int i, j;
+
+    for (i = 0; i < num_files; i++)
+    {
+        struct stat st;
+        long long blocks;
+
+        if (files[i].fork != FORK_MAIN || stat(files[i].path, &st) != 0)
+            continue;
+        blocks = st.st_size / block_size;
+        if (blocks == 0)
+            continue;
+        if (num_largest == CALIBRATION_MAX_FILES && blocks <= largest[num_largest - 1].blocks)
+            continue;
+        if (num_largest < CALIBRATION_MAX_FILES)
+            num_largest++;
+        for (j = num_largest - 1; j > 0 && largest[j - 1].blocks < blocks; j--)
+            largest[j] = largest[j - 1];
+        largest[j].path = files[i].path;
+        largest[j].fd = -1;
+        largest[j].blocks = blocks;
+    }
+    return num_largest;
+}
+
+/*
+ * Open the files past the page cache when the file system allows it, so
+ * the reads measure the disk. Files that went away since they were listed
+ * are left out. Returns the number of files open.
+ */
+static int
+open_files(CalibrationFile *files, int num_files, long block_size, unsigned char *buffer, bool *direct_io)
+{
+    int flags = O_RDONLY;
+    int num_open = 0;
+    int i;
+
+    *direct_io = false;
+    if (block_size % DIRECT_IO_ALIGNMENT == 0)
+    {
+        int fd = open(files[0].path, O_RDONLY | O_DIRECT);
+
+        if (fd != -1)
+        {
+            *direct_io = pread(fd, buffer, block_size, 0) == block_size;
+            close(fd);
+        }
+    }
+    if (*direct_io)
+        flags |= O_DIRECT;
+
+    for (i = 0; i < num_files; i++)
+    {
+        files[num_open] = files[i];
+        files[num_open].fd = open(files[i].path, flags);
+        if (files[num_open].fd == -1)
+        {
+            fprintf(stderr, "WARNING: %s could not be opened reason:%s\n", files[i].path, strerror(errno));
+            continue;
+        }
+        num_open++;
+    }
+    return num_open;
+}
+
+static void
+close_files(CalibrationFile *files, int num_files)
+{
+    int i;
+
+    for (i = 0; i < num_files; i++)
+        close(files[i].fd);
+}
+
+/* Files from their start in read ahead windows, largest first */
+static void
+time_sequential_reads(CalibrationFile *files, int num_files, long block_size, unsigned char *buffer,
+                      CostCalibration *calibration)
+{
+    struct timeval start;
+    double elapsed = 0;
+    long long pages = 0;
+    int i;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < num_files && pages < CALIBRATION_MAX_READS && elapsed < CALIBRATION_IO_SECONDS; i++)
+    {
+        off_t offset = 0;
+        ssize_t len;
+
+        while (pages < CALIBRATION_MAX_READS && elapsed < CALIBRATION_IO_SECONDS &&
+               (len = pread(files[i].fd, buffer, CALIBRATION_SEQ_READ_SIZE, offset)) > 0)
+        {
+            pages += len / block_size;
+            offset += len;
+            elapsed = bench_elapsed(&start);
+        }
+    }
+    calibration->seq_reads = pages;
+    calibration->seq_page = pages > 0 ? elapsed / pages : 0;
+}
+
+/* Single blocks drawn over all the files, so that larger files get more reads */
+static void
+time_random_reads(CalibrationFile *files, int num_files, long block_size, unsigned char *buffer,
+                  CostCalibration *calibration)
+{
+    uint64_t random = CALIBRATION_RANDOM_SEED;
+    struct timeval start;
+    double elapsed = 0;
+    long long total = 0;
+    int reads = 0;
+    int i;
+
+    for (i = 0; i < num_files; i++)
+        total += files[i].blocks;
+
+    gettimeofday(&start, NULL);
+    while (reads < CALIBRATION_MAX_READS && elapsed < CALIBRATION_IO_SECONDS)
+    {
+        long long block = bench_random(&random) % total;
+
+        for (i = 0; i < num_files - 1 && block >= files[i].blocks; i++)
+            block -= files[i].blocks;
+        if (pread(files[i].fd, buffer, block_size, (off_t)block * block_size) == block_size)
+            reads++;
+        elapsed = bench_elapsed(&start);
+    }
+    calibration->random_reads = reads;
+    calibration->random_page = reads > 0 ? elapsed / reads : 0;
+}
+
+/* The same block again and again through the page cache, a hit of the cache */
+static void
+time_cached_reads(CalibrationFile *file, long block_size, unsigned char *buffer, CostCalibration *calibration)
+{
+    struct timeval start;
+    int fd;
+    int reads;
+
+    fd = open(file->path, O_RDONLY);
+    if (fd == -1)
+        return;
+    if (pread(fd, buffer, block_size, 0) != block_size)
+    {
+        close(fd);
+        return;
+    }
+    gettimeofday(&start, NULL);
+    for (reads = 0; reads < CALIBRATION_MAX_READS; reads++)
+    {
+        if (pread(fd, buffer, block_size, 0) != block_size)
+            break;
+    }
+    calibration->cached_page = reads > 0 ? bench_elapsed(&start) / reads : 0;
+    close(fd);
+}
+
+/*
+ * Tuples of the kernel attributes laid out as the server stores them: the
+ * header, the null bitmap when there is a null, and the attributes at
+ * their alignment, the varlenas with the short header of small values.
+ */
+static void
+build_tuples(KernelTuples *tuples)
+{
+    int t, att;
+
+    memset(tuples, 0x00, sizeof *tuples);
+    for (t = 0; t < KERNEL_TUPLES; t++)
+    {
+        unsigned char *tuple = tuples->data + t * KERNEL_TUPLE_SPACE;
+        bool hasnull = t % KERNEL_NULL_EVERY == 0;
+        uint16_t infomask2 = KERNEL_ATTS;
+        uint16_t infomask = HEAP_HASVARWIDTH | (hasnull ? HEAP_HASNULL : 0);
+        int hoff = TYPE_ALIGN(MAXIMUM_ALIGNOF, TUPLE_HEADER_SIZE + (hasnull ? (KERNEL_ATTS + 7) / 8 : 0));
+        unsigned char *data = tuple + hoff;
+        long off = 0;
+
+        memcpy(tuple + TUPLE_INFOMASK2_OFFSET, &infomask2, sizeof infomask2);
+        memcpy(tuple + TUPLE_INFOMASK_OFFSET, &infomask, sizeof infomask);
+        tuple[TUPLE_HOFF_OFFSET] = hoff;
+        for (att = 0; att < KERNEL_ATTS; att++)
+        {
+            const KernelAttribute *attribute = &kernel_atts[att];
+            uint64_t value = (uint64_t)t * 1000003 + att;
+
+            if (hasnull && att == KERNEL_NULL_ATT)
+                continue;
+            if (hasnull)
+                tuple[TUPLE_HEADER_SIZE + att / 8] |= 1 << (att % 8);
+            if (attribute->len == -1)
+            {
+                int len = 1 + 8 + t % 16;
+
+                data[off] = (len << 1) | 0x01;
+                memset(data + off + 1, 'a' + att, len - 1);
+                off += len;
+                continue;
+            }
+            off = TYPE_ALIGN(attribute->align, off);
+            memcpy(data + off, &value, attribute->len);
+            off += attribute->len;
+        }
+        tuples->offsets[t] = t * KERNEL_TUPLE_SPACE;
+    }
+}
+
+BENCH_KERNELS_BEGIN
+
+/* slot_deform_heap_tuple() of the server, without the cached offsets */
+static uint64_t
+deform_tuple(const unsigned char *tuple, uint64_t *values, bool *isnull)
+{
+    uint16_t infomask2, infomask;
+    const unsigned char *bits = tuple + TUPLE_HEADER_SIZE;
+    const unsigned char *data = tuple + tuple[TUPLE_HOFF_OFFSET];
+    bool hasnulls;
+    long off = 0;
+    int natts, att;
+
+    memcpy(&infomask2, tuple + TUPLE_INFOMASK2_OFFSET, sizeof infomask2);
+    memcpy(&infomask, tuple + TUPLE_INFOMASK_OFFSET, sizeof infomask);
+    natts = infomask2 & HEAP_NATTS_MASK;
+    hasnulls = (infomask & HEAP_HASNULL) != 0;
+    if (natts > KERNEL_ATTS)
+        natts = KERNEL_ATTS;
+
+    for (att = 0; att < natts; att++)
+    {
+        const KernelAttribute *attribute = &kernel_atts[att];
+
+        if (hasnulls && !(bits[att >> 3] & (1 << (att & 0x07))))
+        {
+            values[att] = 0;
+            isnull[att] = true;
+            continue;
+        }
+        isnull[att] = false;
+        if (attribute->len == -1)
+        {
+            uint32_t header;
+
+            /* A short varlena is not aligned, a 4 byte header is */
+            if (!(data[off] & 0x01))
+                off = TYPE_ALIGN(attribute->align, off);
+            values[att] = (uint64_t)(uintptr_t)(data + off);
+            if (data[off] & 0x01)
+                off += (data[off] >> 1) & 0x7F;
+            else
+            {
+                memcpy(&header, data + off, sizeof header);
+                off += (header >> 2) & 0x3FFFFFFF;
+            }
+            continue;
+        }
+        off = TYPE_ALIGN(attribute->align, off);
+        switch (attribute->len)
+        {
+        case 1:
+            values[att] = data[off];
+            break;
+        case 2:
+            {
+                uint16_t value;
+
+                memcpy(&value, data + off, sizeof value);
+                values[att] = value;
+            }
+            break;
+        case 4:
+            {
+                uint32_t value;
+
+                memcpy(&value, data + off, sizeof value);
+                values[att] = value;
+            }
+            break;
+        default:
+            memcpy(&values[att], data + off, sizeof values[att]);
+            break;
+        }
+        off += attribute->len;
+    }
+    return values[0] + off;
+}
+
+/* Seconds to deform a tuple */
+static double
+time_tuple_deforming(KernelTuples *tuples)
+{
+    uint64_t values[KERNEL_ATTS];
+    bool isnull[KERNEL_ATTS];
+    struct timeval start;
+    long long deformed = 0;
+    uint64_t sink = 0;
+    double elapsed;
+
+    gettimeofday(&start, NULL);
+    do
+    {
+        int round, i;
+
+        for (round = 0; round < KERNEL_ROUNDS; round++)
+        {
+            for (i = 0; i < KERNEL_TUPLES; i++)
+                sink += deform_tuple(tuples->data + tuples->offsets[i], values, isnull);
+        }
+        deformed += KERNEL_ROUNDS * KERNEL_TUPLES;
+        elapsed = bench_elapsed(&start);
+    } while (elapsed < CALIBRATION_CPU_SECONDS);
+    kernel_sink = sink;
+    return elapsed / deformed;
+}
+
+/* Operators of the qual, called through a pointer as the function manager does */
+static uint64_t __attribute__((noinline))
+int4gt(KernelCall *call)
+{
+    return (int32_t)call->args[0] > (int32_t)call->args[1];
+}
+
+static uint64_t __attribute__((noinline))
+int8pl(KernelCall *call)
+{
+    return (int64_t)call->args[0] + (int64_t)call->args[1];
+}
+
+static uint64_t __attribute__((noinline))
+int8gt(KernelCall *call)
+{
+    return (int64_t)call->args[0] > (int64_t)call->args[1];
+}
+
+static uint64_t __attribute__((noinline))
+int4ne(KernelCall *call)
+{
+    return (int32_t)call->args[0] != (int32_t)call->args[1];
+}
+
+/*
+ * ExecInterpExpr() of the server for a qual, the steps taking their
+ * arguments from registers. Returns the qual, *calls counts the operators
+ * evaluated.
+ */
+static bool
+evaluate_qual(const KernelStep *steps, const uint64_t *values, const bool *isnull, long long *calls)
+{
+    uint64_t registers[KERNEL_REGISTERS];
+    bool nulls[KERNEL_REGISTERS];
+    const KernelStep *step = steps;
+
+    for (;;)
+    {
+        switch (step->opcode)
+        {
+        case KERNEL_OP_VAR:
+            registers[step->result] = values[step->arg1];
+            nulls[step->result] = isnull[step->arg1];
+            break;
+        case KERNEL_OP_CONST:
+            registers[step->result] = step->constant;
+            nulls[step->result] = false;
+            break;
+        case KERNEL_OP_FUNC:
+            {
+                KernelCall call;
+
+                /* Strict, a null argument is a null result without a call */
+                if (nulls[step->arg1] || nulls[step->arg2])
+                {
+                    nulls[step->result] = true;
+                    break;
+                }
+                call.args[0] = registers[step->arg1];
+                call.args[1] = registers[step->arg2];
+                registers[step->result] = step->function(&call);
+                nulls[step->result] = false;
+                (*calls)++;
+            }
+            break;
+        case KERNEL_OP_AND:
+            if (nulls[step->result] || !registers[step->result])
+                return false;
+            break;
+        case KERNEL_OP_DONE:
+            return !nulls[step->result] && registers[step->result];
+        }
+        step++;
+    }
+}
+
+/* Seconds to evaluate an operator of "int4 > 10 AND int8 + 5 > date AND int4 <> 0" */
+static double
+time_expression_evaluation(KernelTuples *tuples)
+{
+    KernelStep steps[] = {
+        {KERNEL_OP_VAR, 0, 0, 0, 0, NULL},
+        {KERNEL_OP_CONST, 1, 0, 0, 10, NULL},
+        {KERNEL_OP_FUNC, 2, 0, 1, 0, int4gt},
+        {KERNEL_OP_AND, 2, 0, 0, 0, NULL},
+        {KERNEL_OP_VAR, 3, 1, 0, 0, NULL},
+        {KERNEL_OP_CONST, 4, 0, 0, 5, NULL},
+        {KERNEL_OP_FUNC, 5, 3, 4, 0, int8pl},
+        {KERNEL_OP_VAR, 6, KERNEL_NULL_ATT, 0, 0, NULL},
+        {KERNEL_OP_FUNC, 7, 5, 6, 0, int8gt},
+        {KERNEL_OP_AND, 7, 0, 0, 0, NULL},
+        {KERNEL_OP_CONST, 1, 0, 0, 0, NULL},
+        {KERNEL_OP_FUNC, 2, 0, 1, 0, int4ne},
+        {KERNEL_OP_DONE, 2, 0, 0, 0, NULL}
+    };
+    uint64_t values[KERNEL_TUPLES][KERNEL_ATTS];
+    bool isnull[KERNEL_TUPLES][KERNEL_ATTS];
+    struct timeval start;
+    long long calls = 0;
+    uint64_t sink = 0;
+    double elapsed;
+    int i;
+
+    /* The qual gets tuples that are deformed already */
+    for (i = 0; i < KERNEL_TUPLES; i++)
+        deform_tuple(tuples->data + tuples->offsets[i], values[i], isnull[i]);
+
+    gettimeofday(&start, NULL);
+    do
+    {
+        int round;
+
+        for (round = 0; round < KERNEL_ROUNDS; round++)
+        {
+            for (i = 0; i < KERNEL_TUPLES; i++)
+                sink += evaluate_qual(steps, values[i], isnull[i], &calls);
+        }
+        elapsed = bench_elapsed(&start);
+    } while (elapsed < CALIBRATION_CPU_SECONDS);
+    kernel_sink = sink;
+    return calls > 0 ? elapsed / calls : -1;
+}
+
+/*
+ * Seconds to start a worker process that attaches to the segment the
+ * leader serialized its state into and restores it, -1 when no process
+ * could be started. The server starts its workers from the postmaster and
+ * they load their caches on top, so this is what a start costs at least.
+ */
+static double
+time_worker_starts(void)
+{
+    uint64_t *state;
+    struct timeval start;
+    double elapsed;
+    int i;
+
+    state = mmap(NULL, CALIBRATION_WORKER_STATE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (state == MAP_FAILED)
+        return -1;
+    gettimeofday(&start, NULL);
+    for (i = 0; i < CALIBRATION_WORKER_STARTS; i++)
+    {
+        int status;
+        pid_t pid;
+
+        memset(state, i + 1, CALIBRATION_WORKER_STATE);
+        pid = fork();
+        if (pid == 0)
+        {
+            uint64_t restored = 0;
+            size_t word;
+
+            for (word = 1; word < CALIBRATION_WORKER_STATE / sizeof *state; word++)
+                restored ^= state[word];
+            state[0] = restored;
+            _exit(0);
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            munmap(state, CALIBRATION_WORKER_STATE);
+            return -1;
+        }
+    }
+    elapsed = bench_elapsed(&start);
+    kernel_sink = state[0];
+    munmap(state, CALIBRATION_WORKER_STATE);
+    return elapsed / CALIBRATION_WORKER_STARTS;
+}
+
+BENCH_KERNELS_END
@@ -0,0 +1,460 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_data_dir.c
+ *		Walk the relation files of a data directory.
+ *
+ * Relations are known by their files only, no catalog is read: a relation
+ * with a visibility map is a table (or a TOAST table), the others are
+ * indexes, sequences and tables that were never vacuumed. That is close
+ * enough to tell how big the data is and how it is spread.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "pg_data_dir.h"
+
+#define WAL_SEGMENT_NAME_LEN 24
+
+typedef struct file_worker_state
+{
+    RelationFile *files;
+    int num_files;
+    RelationFileWorker worker;
+    void *arg;
+    int next_file;              /* next file to hand out, atomic */
+    int failed;                 /* files the worker failed on, atomic */
+} FileWorkerState;
+
+static const char *fork_suffixes[NUM_RELATION_FORKS] = {"", "_fsm", "_vm", "_init"};
+static const char *size_class_names[NUM_SIZE_CLASSES] = {
+    "< 1MB", "< 10MB", "< 100MB", "< 1GB", "< 10GB", "< 100GB", "< 1TB", ">= 1TB"};
+
+static bool collect_database(RelationFile **files, int *num_files, int *capacity, const char *data_dir,
+                             const char *subdir, unsigned int database, unsigned int tablespace);
+static bool parse_relation_file_name(const char *name, unsigned int *relfilenode, RELATION_FORK *fork, unsigned int *segment);
+static void *file_worker(void *arg);
+static bool size_file(RelationFile *file, void *arg, void **worker_state);
+static void summarize_shape(DataDirShape *shape, RelationFile *files, int num_files);
+static void add_largest(RelationSize *largest, int *num_largest, unsigned int database, unsigned int relfilenode, long long size);
+static void scan_wal(const char *data_dir, DataDirShape *shape);
+static int compare_files(const void *a, const void *b);
+
+int
+list_relation_files(const char *data_dir, RelationFile **files)
+{
+    char path[PATH_MAX];
+    struct dirent *de;
+    int num_files = 0;
+    int capacity = 0;
+    DIR *dir;
+
+    *files = NULL;
+    if (!collect_database(files, &num_files, &capacity, data_dir, "global", 0, GLOBAL_TABLESPACE_OID))
+    {
+        free_relation_files(*files, num_files);
+        return -1;
+    }
+    snprintf(path, sizeof path, "%s/base", data_dir);
+    dir = opendir(path);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Failed to open directory %s reason:%s\n", path, strerror(errno));
+        free_relation_files(*files, num_files);
+        return -1;
+    }
+    while ((de = readdir(dir)) != NULL)
+    {
+        char subdir[NAME_MAX + 8];
+        char *end_ptr;
+        unsigned long database = strtoul(de->d_name, &end_ptr, 10);
+
+        if (*end_ptr != '\0' || end_ptr == de->d_name)
+            continue;
+        snprintf(subdir, sizeof subdir, "base/%s", de->d_name);
+        if (!collect_database(files, &num_files, &capacity, data_dir, subdir, database, DEFAULT_TABLESPACE_OID))
+        {
+            closedir(dir);
+            free_relation_files(*files, num_files);
+            return -1;
+        }
+    }
+    closedir(dir);
+    qsort(*files, num_files, sizeof **files, compare_files);
+    return num_files;
+}
+
+void
+free_relation_files(RelationFile *files, int num_files)
+{
+    int i;
+
+    for (i = 0; i < num_files; i++)
+    {
+        free(files[i].path);
+        free(files[i].blocks);
+    }
+    free(files);
+}
+
+int
+run_relation_file_workers(RelationFile *files, int num_files, int num_workers,
+                          RelationFileWorker worker, void *arg, int *failed)
+{
+    pthread_t workers[MAX_DATA_DIR_WORKERS];
+    FileWorkerState state;
+    int started;
+    int i;
+
+    memset(&state, 0x00, sizeof state);
+    state.files = files;
+    state.num_files = num_files;
+    state.worker = worker;
+    state.arg = arg;
+
+    if (num_workers > num_files)
+        num_workers = num_files;
+    if (num_workers > MAX_DATA_DIR_WORKERS)
+        num_workers = MAX_DATA_DIR_WORKERS;
+    if (num_workers < 1)
+        num_workers = 1;
+    for (started = 0; started < num_workers; started++)
+    {
+        int rc = pthread_create(&workers[started], NULL, file_worker, &state);
+
+        if (rc != 0)
+        {
+            fprintf(stderr, "Failed to start data directory worker reason:%s\n", strerror(rc));
+            break;
+        }
+    }
+    /* With no worker at all the files are done right here */
+    if (started == 0)
+        file_worker(&state);
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    *failed = state.failed;
+    return started > 0 ? started : 1;
+}
+
+const char *
+get_fork_suffix(RELATION_FORK fork)
+{
+    return fork < NUM_RELATION_FORKS ? fork_suffixes[fork] : "";
+}
+
+bool
+scan_data_dir_shape(const char *data_dir, int num_workers, DataDirShape *shape)
+{
+    struct timeval start, end;
+    RelationFile *files;
+    int num_files;
+    int failed;
+
+    memset(shape, 0x00, sizeof *shape);
+    gettimeofday(&start, NULL);
+    num_files = list_relation_files(data_dir, &files);
+    if (num_files < 0)
+        return false;
+    if (num_files == 0)
+    {
+        fprintf(stderr, "ERROR: no relation files in %s, is it a data directory?\n", data_dir);
+        free_relation_files(files, num_files);
+        return false;
+    }
+
+    shape->num_workers = run_relation_file_workers(files, num_files, num_workers, size_file, NULL, &failed);
+    if (failed > 0)
+        fprintf(stderr, "WARNING: %d relation files could not be sized\n", failed);
+    summarize_shape(shape, files, num_files);
+    free_relation_files(files, num_files);
+    scan_wal(data_dir, shape);
+
+    gettimeofday(&end, NULL);
+    shape->elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+    return true;
+}
+
+void
+print_data_dir_shape(DataDirShape *shape)
+{
+    int i;
+
+    printf("LOG: scanned %d relation files in %.3f seconds with %d workers\n", shape->num_files, shape->elapsed, shape->num_workers);
+    printf("LOG:   data size              : %.1f MB in %d databases, %d relations\n",
+           shape->data_size / (1024.0 * 1024.0), shape->num_databases, shape->num_relations);
+    printf("LOG:   tables, indexes        : %d of %.1f MB, %d of %.1f MB\n", shape->num_tables,
+           shape->table_size / (1024.0 * 1024.0), shape->num_indexes, shape->index_size / (1024.0 * 1024.0));
+    if (shape->index_size > 0)
+        printf("LOG:   heap to index ratio    : %.2f\n", (double)shape->table_size / shape->index_size);
+    printf("LOG:   fsm, vm                : %.1f MB, %.1f MB\n", shape->fsm_size / (1024.0 * 1024.0), shape->vm_size / (1024.0 * 1024.0));
+    printf("LOG:   WAL                    : %.1f MB in %d segments\n", shape->wal_size / (1024.0 * 1024.0), shape->num_wal_segments);
+    printf("LOG:   relations by size      :");
+    for (i = 0; i < NUM_SIZE_CLASSES; i++)
+    {
+        if (shape->size_classes[i] > 0)
+            printf(" %s: %d", size_class_names[i], shape->size_classes[i]);
+    }
+    printf("\n");
+    printf("LOG:   largest tables (database/relfilenode):\n");
+    for (i = 0; i < shape->num_largest_tables; i++)
+        printf("LOG:     %u/%-15u : %.1f MB\n", shape->largest_tables[i].database, shape->largest_tables[i].relfilenode,
+               shape->largest_tables[i].size / (1024.0 * 1024.0));
+    printf("LOG:   largest indexes (database/relfilenode):\n");
+    for (i = 0; i < shape->num_largest_indexes; i++)
+        printf("LOG:     %u/%-15u : %.1f MB\n", shape->largest_indexes[i].database, shape->largest_indexes[i].relfilenode,
+               shape->largest_indexes[i].size / (1024.0 * 1024.0));
+}
+
+static bool
+collect_database(RelationFile **files, int *num_files, int *capacity, const char *data_dir,
+                 const char *subdir, unsigned int database, unsigned int tablespace)
+{
+    char path[PATH_MAX];
+    struct dirent *de;
+    DIR *dir;
+
+    snprintf(path, sizeof path, "%s/%s", data_dir, subdir);
+    dir = opendir(path);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Failed to open directory %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    while ((de = readdir(dir)) != NULL)
+    {
+        RelationFile *file;
+
+        if (*num_files == *capacity)
+        {
+            int new_capacity = *capacity ? *capacity * 2 : 1024;
+            RelationFile *new_files = realloc(*files, new_capacity * sizeof *new_files);
+
+            if (new_files == NULL)
+            {
+                perror("Not possible to allocate memory for the relation files");
+                closedir(dir);
+                return false;
+            }
+            *files = new_files;
+            *capacity = new_capacity;
+        }
+        file = &(*files)[*num_files];
+        memset(file, 0x00, sizeof *file);
+        if (!parse_relation_file_name(de->d_name, &file->relfilenode, &file->fork, &file->segment))
+            continue;
+        file->database = database;
+        file->tablespace = tablespace;
+        if (asprintf(&file->path, "%s/%s", path, de->d_name) < 0)
+        {
+            perror("Not possible to allocate memory for the relation files");
+            closedir(dir);
+            return false;
+        }
+        (*num_files)++;
+    }
+    closedir(dir);
+    return true;
+}
+
+/* RELFILENODE[_fsm|_vm|_init][.SEGMENT], anything else is not relation data */
+static bool
+parse_relation_file_name(const char *name, unsigned int *relfilenode, RELATION_FORK *fork, unsigned int *segment)
+{
+    const char *pos = name;
+    char *end_ptr;
+    int i;
+
+    if (*pos < '0' || *pos > '9')
+        return false;
+    *relfilenode = strtoul(pos, &end_ptr, 10);
+    pos = end_ptr;
+    *fork = FORK_MAIN;
+    for (i = FORK_FSM; i < NUM_RELATION_FORKS; i++)
+    {
+        size_t len = strlen(fork_suffixes[i]);
+
+        if (strncmp(pos, fork_suffixes[i], len) == 0 && (pos[len] == '\0' || pos[len] == '.'))
+        {
+            *fork = i;
+            pos += len;
+            break;
+        }
+    }
+    *segment = 0;
+    if (*pos == '.')
+    {
+        if (pos[1] < '0' || pos[1] > '9')
+            return false;
+        *segment = strtoul(pos + 1, &end_ptr, 10);
+        pos = end_ptr;
+    }
+    return *pos == '\0';
+}
+
+static void *
+file_worker(void *arg)
+{
+    FileWorkerState *state = arg;
+    void *worker_state = NULL;
+    int i;
+
+    while ((i = __atomic_fetch_add(&state->next_file, 1, __ATOMIC_RELAXED)) < state->num_files)
+    {
+        if (!state->worker(&state->files[i], state->arg, &worker_state))
+            __atomic_fetch_add(&state->failed, 1, __ATOMIC_RELAXED);
+    }
+    free(worker_state);
+    return NULL;
+}
+
+/* Files dropped since they were listed are empty, not a failure */
+static bool
+size_file(RelationFile *file, void *arg, void **worker_state)
+{
+    struct stat st;
+
+    if (stat(file->path, &st) != 0)
+        return errno == ENOENT;
+    file->size = st.st_size;
+    return true;
+}
+
+/* The files are sorted, the forks and segments of a relation are next to each other */
+static void
+summarize_shape(DataDirShape *shape, RelationFile *files, int num_files)
+{
+    unsigned int last_database = UINT_MAX;
+    int first;
+    int i;
+
+    shape->num_files = num_files;
+    for (first = 0; first < num_files; first = i)
+    {
+        long long main_size = 0;
+        bool has_vm = false;
+        int size_class = 0;
+        long long limit;
+
+        if (files[first].database != last_database)
+        {
+            shape->num_databases++;
+            last_database = files[first].database;
+        }
+        for (i = first; i < num_files && files[i].database == files[first].database &&
+             files[i].relfilenode == files[first].relfilenode; i++)
+        {
+            shape->data_size += files[i].size;
+            if (files[i].fork == FORK_MAIN)
+                main_size += files[i].size;
+            else if (files[i].fork == FORK_FSM)
+                shape->fsm_size += files[i].size;
+            else if (files[i].fork == FORK_VM)
+            {
+                shape->vm_size += files[i].size;
+                has_vm = true;
+            }
+        }
+
+        shape->num_relations++;
+        if (has_vm)
+        {
+            shape->num_tables++;
+            shape->table_size += main_size;
+            add_largest(shape->largest_tables, &shape->num_largest_tables,
+                        files[first].database, files[first].relfilenode, main_size);
+        }
+        else
+        {
+            shape->num_indexes++;
+            shape->index_size += main_size;
+            add_largest(shape->largest_indexes, &shape->num_largest_indexes,
+                        files[first].database, files[first].relfilenode, main_size);
+        }
+        for (limit = 1024 * 1024; size_class < NUM_SIZE_CLASSES - 1 && main_size >= limit; limit *= 10)
+            size_class++;
+        shape->size_classes[size_class]++;
+    }
+}
+
+/* Keep the DATA_DIR_TOP_RELATIONS largest, largest first */
+static void
+add_largest(RelationSize *largest, int *num_largest, unsigned int database, unsigned int relfilenode, long long size)
+{
+    int i;
+
+    if (*num_largest == DATA_DIR_TOP_RELATIONS && size <= largest[*num_largest - 1].size)
+        return;
+    if (*num_largest < DATA_DIR_TOP_RELATIONS)
+        (*num_largest)++;
+    for (i = *num_largest - 1; i > 0 && largest[i - 1].size < size; i--)
+        largest[i] = largest[i - 1];
+    largest[i].database = database;
+    largest[i].relfilenode = relfilenode;
+    largest[i].size = size;
+}
+
+/* WAL segments are named by 24 hex digits, everything else in pg_wal is not counted */
+static void
+scan_wal(const char *data_dir, DataDirShape *shape)
+{
+    char path[PATH_MAX];
+    struct dirent *de;
+    DIR *dir;
+
+    snprintf(path, sizeof path, "%s/%s", data_dir, WAL_DIRECTORY);
+    dir = opendir(path);
+    if (dir == NULL)
+        return;
+    while ((de = readdir(dir)) != NULL)
+    {
+        char file_path[PATH_MAX + NAME_MAX + 2];
+        struct stat st;
+
+        if (strlen(de->d_name) != WAL_SEGMENT_NAME_LEN ||
+            strspn(de->d_name, "0123456789ABCDEF") != WAL_SEGMENT_NAME_LEN)
+            continue;
+        snprintf(file_path, sizeof file_path, "%s/%s", path, de->d_name);
+        if (stat(file_path, &st) != 0)
+            continue;
+        shape->wal_size += st.st_size;
+        shape->num_wal_segments++;
+    }
+    closedir(dir);
+}
+
+static int
+compare_files(const void *a, const void *b)
+{
+    const RelationFile *fa = a;
+    const RelationFile *fb = b;
+
+    if (fa->database != fb->database)
+        return fa->database < fb->database ? -1 : 1;
+    if (fa->relfilenode != fb->relfilenode)
+        return fa->relfilenode < fb->relfilenode ? -1 : 1;
+    if (fa->fork != fb->fork)
+        return fa->fork < fb->fork ? -1 : 1;
+    if (fa->segment != fb->segment)
+        return fa->segment < fb->segment ? -1 : 1;
+    return 0;
+}
@@ -0,0 +1,487 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_heap_scan.c
+ *		Bloat and free space of the tables of a data directory, without a
+ *		connection to the server.
+ *
+ * Every heap page starts with a header that tells where its free space is
+ * (pd_lower to pd_upper) and an array of line pointers, and every tuple
+ * carries the hint bits that vacuum and the readers set once they know
+ * whether the inserting and deleting transactions committed. That is
+ * enough to tell live, dead and free space apart page by page. Tuples
+ * whose hint bits nobody set yet count as live, so dead space is a lower
+ * bound.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "pg_heap_scan.h"
+#include "pg_page.h"
+
+/* Visibility map, two bits per heap block after the page header */
+#define VM_ALL_VISIBLE 0x01
+#define VM_ALL_FROZEN 0x02
+
+typedef struct heap_file_scan
+{
+    RelationFile *files;
+    HeapStats *stats;           /* one per file */
+} HeapFileScan;
+
+static bool read_file(RelationFile *file, void *arg, void **worker_state);
+static void scan_heap_page(const unsigned char *page, HeapStats *stats);
+static void scan_vm_page(const unsigned char *page, HeapStats *stats);
+static bool summarize_tables(HeapScan *scan, RelationFile *files, HeapStats *stats, int num_files);
+static void add_stats(HeapStats *to, const HeapStats *from);
+static void recommend_settings(TableHeap *table);
+static double vacuum_cost(const HeapStats *stats);
+static int compare_dead_bytes(const void *a, const void *b);
+
+bool
+scan_heap_pages(const char *data_dir, int num_workers, HeapScan *scan)
+{
+    struct timeval start, end;
+    HeapFileScan file_scan;
+    RelationFile *files;
+    int num_files;
+    int failed;
+    int i;
+
+    memset(scan, 0x00, sizeof *scan);
+    gettimeofday(&start, NULL);
+    num_files = list_relation_files(data_dir, &files);
+    if (num_files < 0)
+        return false;
+    if (num_files == 0)
+    {
+        fprintf(stderr, "ERROR: no relation files in %s, is it a data directory?\n", data_dir);
+        free_relation_files(files, num_files);
+        return false;
+    }
+
+    file_scan.files = files;
+    file_scan.stats = calloc(num_files, sizeof *file_scan.stats);
+    if (file_scan.stats == NULL)
+    {
+        perror("Not possible to allocate memory for the heap scan");
+        free_relation_files(files, num_files);
+        return false;
+    }
+    scan->num_workers = run_relation_file_workers(files, num_files, num_workers, read_file, &file_scan, &failed);
+    if (failed > 0)
+        fprintf(stderr, "WARNING: %d relation files could not be read\n", failed);
+    for (i = 0; i < num_files; i++)
+        scan->bytes_read += files[i].size;
+
+    if (!summarize_tables(scan, files, file_scan.stats, num_files))
+    {
+        perror("Not possible to allocate memory for the heap scan");
+        free(file_scan.stats);
+        free_relation_files(files, num_files);
+        return false;
+    }
+    free(file_scan.stats);
+    free_relation_files(files, num_files);
+
+    scan->cost_limit = scan->vacuum_cost / (AUTOVACUUM_CYCLE_SECONDS * 1000.0 / AUTOVACUUM_COST_DELAY_MS);
+    scan->cost_limit = ceil(scan->cost_limit / 100) * 100;
+    if (scan->cost_limit < MIN_AUTOVACUUM_COST_LIMIT)
+        scan->cost_limit = MIN_AUTOVACUUM_COST_LIMIT;
+    if (scan->cost_limit > MAX_AUTOVACUUM_COST_LIMIT)
+        scan->cost_limit = MAX_AUTOVACUUM_COST_LIMIT;
+
+    gettimeofday(&end, NULL);
+    scan->elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+    return true;
+}
+
+void
+free_heap_scan(HeapScan *scan)
+{
+    free(scan->tables);
+    memset(scan, 0x00, sizeof *scan);
+}
+
+void
+print_heap_scan(HeapScan *scan, int top_tables)
+{
+    HeapStats *total = &scan->total;
+    TableHeap **bloated;
+    double heap_size = total->pages * (double)HEAP_BLOCK_SIZE;
+    int i;
+
+    printf("LOG: read %.1f MB of relation files in %.3f seconds with %d workers\n",
+           scan->bytes_read / (1024.0 * 1024.0), scan->elapsed, scan->num_workers);
+    printf("LOG:   tables                 : %d of %.1f MB\n", scan->num_tables, heap_size / (1024.0 * 1024.0));
+    if (heap_size > 0)
+    {
+        printf("LOG:   free space             : %.1f MB (%.1f%%)\n", total->free_bytes / (1024.0 * 1024.0),
+               100.0 * total->free_bytes / heap_size);
+        printf("LOG:   dead space             : %.1f MB (%.1f%%) in %lld dead tuples\n", total->dead_bytes / (1024.0 * 1024.0),
+               100.0 * total->dead_bytes / heap_size, total->dead_tuples);
+        printf("LOG:   all visible            : %.1f%% of the pages\n", 100.0 * total->vm_visible / total->pages);
+    }
+    printf("LOG:   vacuum cost            : %.0f, autovacuum_vacuum_cost_limit %.0f gets through it in %.0f seconds\n",
+           scan->vacuum_cost, scan->cost_limit, AUTOVACUUM_CYCLE_SECONDS);
+
+    bloated = malloc(scan->num_tables * sizeof *bloated);
+    if (bloated == NULL)
+        return;
+    for (i = 0; i < scan->num_tables; i++)
+        bloated[i] = &scan->tables[i];
+    qsort(bloated, scan->num_tables, sizeof *bloated, compare_dead_bytes);
+    printf("LOG:   most dead space (database/relfilenode):\n");
+    for (i = 0; i < scan->num_tables && i < top_tables && bloated[i]->stats.dead_bytes > 0; i++)
+    {
+        TableHeap *table = bloated[i];
+        double size = table->stats.pages * (double)HEAP_BLOCK_SIZE;
+        char name[64];
+        char settings[128] = "";
+
+        snprintf(name, sizeof name, "%u/%u", table->database, table->relfilenode);
+        if (table->scale_factor > 0)
+            snprintf(settings, sizeof settings, ", scale factor %g", table->scale_factor);
+        if (table->fillfactor > 0)
+            snprintf(settings + strlen(settings), sizeof settings - strlen(settings), ", fillfactor %d", table->fillfactor);
+        printf("LOG:     %-20s : %.1f MB, %.1f%% dead, %.1f%% free, %.1f%% all visible%s%s\n", name, size / (1024.0 * 1024.0),
+               100.0 * table->stats.dead_bytes / size, 100.0 * table->stats.free_bytes / size,
+               100.0 * table->stats.vm_visible / table->stats.pages, settings,
+               100.0 * table->stats.dead_bytes / size > HEAP_REWRITE_BLOAT_PCT ? ", rewrite it" : "");
+    }
+    free(bloated);
+}
+
+bool
+write_table_settings(HeapScan *scan, const char *path)
+{
+    int count = 0;
+    FILE *fp;
+    int i;
+
+    fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to create table settings %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    fprintf(fp, "-- Per table settings from the heap pages, run with psql in every database\n");
+    for (i = 0; i < scan->num_tables; i++)
+    {
+        TableHeap *table = &scan->tables[i];
+        char settings[128] = "";
+
+        /* Shared catalogs can not be altered */
+        if (table->database == 0 || (table->scale_factor == 0 && table->fillfactor == 0))
+            continue;
+        if (table->scale_factor > 0)
+            snprintf(settings, sizeof settings, "autovacuum_vacuum_scale_factor = %g", table->scale_factor);
+        if (table->fillfactor > 0)
+            snprintf(settings + strlen(settings), sizeof settings - strlen(settings), "%sfillfactor = %d",
+                     table->scale_factor > 0 ? ", " : "", table->fillfactor);
+        fprintf(fp, "SELECT format('ALTER TABLE %%s SET (%s)', c.oid::regclass)\n"
+                "  FROM pg_class c JOIN pg_database d ON d.datname = current_database()\n"
+                " WHERE d.oid = %u AND c.relkind IN ('r', 'm') AND pg_relation_filenode(c.oid) = %u \\gexec\n",
+                settings, table->database, table->relfilenode);
+        count++;
+    }
+    if (fclose(fp) != 0)
+    {
+        fprintf(stderr, "Failed to write table settings %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    printf("LOG: settings of %d tables written to \"%s\"\n", count, path);
+    return true;
+}
+
+/*
+ * Read main and visibility map forks in HEAP_SCAN_READ_BLOCKS chunks, the
+ * chunk buffer is the worker state. Files dropped since they were listed
+ * are empty, not a failure.
+ */
+static bool
+read_file(RelationFile *file, void *arg, void **worker_state)
+{
+    HeapFileScan *file_scan = arg;
+    HeapStats *stats = &file_scan->stats[file - file_scan->files];
+    unsigned char *buffer = *worker_state;
+    off_t offset = 0;
+    int fd;
+
+    if (file->fork != FORK_MAIN && file->fork != FORK_VM)
+        return true;
+    if (buffer == NULL)
+    {
+        buffer = *worker_state = malloc(HEAP_SCAN_READ_BLOCKS * HEAP_BLOCK_SIZE);
+        if (buffer == NULL)
+            return false;
+    }
+    fd = open(file->path, O_RDONLY);
+    if (fd == -1)
+        return errno == ENOENT;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    for (;;)
+    {
+        ssize_t len = pread(fd, buffer, HEAP_SCAN_READ_BLOCKS * HEAP_BLOCK_SIZE, offset);
+        ssize_t block;
+
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            close(fd);
+            return false;
+        }
+        /* A partial block at the end is being extended right now */
+        for (block = 0; block + HEAP_BLOCK_SIZE <= len; block += HEAP_BLOCK_SIZE)
+        {
+            if (file->fork == FORK_MAIN)
+                scan_heap_page(buffer + block, stats);
+            else
+                scan_vm_page(buffer + block, stats);
+        }
+        offset += len;
+        if (len < HEAP_SCAN_READ_BLOCKS * HEAP_BLOCK_SIZE)
+            break;
+    }
+    close(fd);
+    file->size = offset;
+    return true;
+}
+
+static void
+scan_heap_page(const unsigned char *page, HeapStats *stats)
+{
+    uint16_t flags, lower, upper, special, pagesize_version;
+    long long dead_before;
+    int num_items;
+    int i;
+
+    memcpy(&flags, page + 10, sizeof flags);
+    memcpy(&lower, page + 12, sizeof lower);
+    memcpy(&upper, page + 14, sizeof upper);
+    memcpy(&special, page + 16, sizeof special);
+    memcpy(&pagesize_version, page + 18, sizeof pagesize_version);
+
+    stats->pages++;
+    if (upper == 0)
+    {
+        /* New pages are all zeros, free space for the next insert */
+        stats->empty_pages++;
+        stats->free_bytes += HEAP_BLOCK_SIZE - PAGE_HEADER_SIZE;
+        return;
+    }
+    /* Index and sequence pages keep their own data in the special space */
+    if (pagesize_version != (HEAP_BLOCK_SIZE | PAGE_LAYOUT_VERSION) || special != HEAP_BLOCK_SIZE ||
+        lower < PAGE_HEADER_SIZE || lower > upper || upper > special)
+    {
+        stats->other_pages++;
+        return;
+    }
+
+    stats->free_bytes += upper - lower;
+    if (flags & PD_ALL_VISIBLE)
+        stats->all_visible_pages++;
+    dead_before = stats->dead_items + stats->dead_tuples;
+    num_items = (lower - PAGE_HEADER_SIZE) / ITEM_ID_SIZE;
+    for (i = 0; i < num_items; i++)
+    {
+        uint32_t item;
+        unsigned int item_offset, item_flags, item_len;
+        uint16_t infomask, infomask2;
+
+        memcpy(&item, page + PAGE_HEADER_SIZE + i * ITEM_ID_SIZE, sizeof item);
+        item_offset = item & 0x7FFF;
+        item_flags = (item >> 15) & 0x03;
+        item_len = item >> 17;
+
+        if (item_flags == LP_DEAD)
+        {
+            stats->dead_items++;
+            stats->dead_bytes += ITEM_ID_SIZE + item_len;
+            continue;
+        }
+        if (item_flags == LP_REDIRECT)
+        {
+            stats->hot_tuples++;
+            continue;
+        }
+        if (item_flags != LP_NORMAL || item_len < TUPLE_HEADER_SIZE ||
+            item_offset < upper || item_offset + item_len > special)
+            continue;
+
+        memcpy(&infomask2, page + item_offset + TUPLE_INFOMASK2_OFFSET, sizeof infomask2);
+        memcpy(&infomask, page + item_offset + TUPLE_INFOMASK_OFFSET, sizeof infomask);
+        if (infomask2 & (HEAP_HOT_UPDATED | HEAP_ONLY_TUPLE))
+            stats->hot_tuples++;
+        /* Both xmin bits are HEAP_XMIN_FROZEN, a live tuple */
+        if ((infomask & (HEAP_XMIN_COMMITTED | HEAP_XMIN_INVALID)) == HEAP_XMIN_INVALID ||
+            ((infomask & HEAP_XMAX_COMMITTED) && !(infomask & HEAP_XMAX_LOCK_ONLY)))
+        {
+            stats->dead_tuples++;
+            stats->dead_bytes += ITEM_ID_SIZE + item_len;
+        }
+        else
+        {
+            stats->live_tuples++;
+            stats->live_bytes += ITEM_ID_SIZE + item_len;
+        }
+    }
+    /* Only pages with something dead on them get dirtied by vacuum */
+    if (stats->dead_items + stats->dead_tuples > dead_before)
+        stats->dirty_pages++;
+}
+
+static void
+scan_vm_page(const unsigned char *page, HeapStats *stats)
+{
+    int i;
+
+    stats->has_vm = true;
+    for (i = PAGE_HEADER_SIZE; i < HEAP_BLOCK_SIZE; i++)
+    {
+        int bit;
+
+        for (bit = 0; bit < 8; bit += 2)
+        {
+            int map = page[i] >> bit;
+
+            if (map & VM_ALL_VISIBLE)
+                stats->vm_visible++;
+            if (map & VM_ALL_FROZEN)
+                stats->vm_frozen++;
+        }
+    }
+}
+
+/*
+ * The files are sorted, the forks and segments of a relation are next to
+ * each other. A relation with nothing but heap pages is a table.
+ */
+static bool
+summarize_tables(HeapScan *scan, RelationFile *files, HeapStats *stats, int num_files)
+{
+    int first;
+    int i;
+
+    scan->tables = malloc(num_files * sizeof *scan->tables);
+    if (scan->tables == NULL)
+        return false;
+    for (first = 0; first < num_files; first = i)
+    {
+        TableHeap *table = &scan->tables[scan->num_tables];
+
+        memset(table, 0x00, sizeof *table);
+        table->database = files[first].database;
+        table->relfilenode = files[first].relfilenode;
+        for (i = first; i < num_files && files[i].database == files[first].database &&
+             files[i].relfilenode == files[first].relfilenode; i++)
+            add_stats(&table->stats, &stats[i]);
+        if (table->stats.pages == 0 || table->stats.other_pages > 0)
+            continue;
+
+        /* Without a visibility map the page flags are all there is */
+        if (!table->stats.has_vm)
+            table->stats.vm_visible = table->stats.all_visible_pages;
+        if (table->stats.vm_visible > table->stats.pages)
+            table->stats.vm_visible = table->stats.pages;
+        recommend_settings(table);
+        add_stats(&scan->total, &table->stats);
+        scan->vacuum_cost += vacuum_cost(&table->stats);
+        scan->num_tables++;
+    }
+    return true;
+}
+
+static void
+add_stats(HeapStats *to, const HeapStats *from)
+{
+    to->pages += from->pages;
+    to->empty_pages += from->empty_pages;
+    to->other_pages += from->other_pages;
+    to->dirty_pages += from->dirty_pages;
+    to->all_visible_pages += from->all_visible_pages;
+    to->free_bytes += from->free_bytes;
+    to->dead_bytes += from->dead_bytes;
+    to->live_bytes += from->live_bytes;
+    to->live_tuples += from->live_tuples;
+    to->dead_tuples += from->dead_tuples;
+    to->dead_items += from->dead_items;
+    to->hot_tuples += from->hot_tuples;
+    to->vm_visible += from->vm_visible;
+    to->vm_frozen += from->vm_frozen;
+    to->has_vm |= from->has_vm;
+}
+
+/*
+ * A scale factor that vacuums a large table after about
+ * HEAP_TARGET_DEAD_TUPLES dead tuples instead of a fifth of it, and room
+ * on every page for HOT updates where they are common.
+ */
+static void
+recommend_settings(TableHeap *table)
+{
+    HeapStats *stats = &table->stats;
+    long long tuples = stats->live_tuples + stats->dead_tuples;
+    double hot_share;
+
+    if (stats->pages < HEAP_MIN_TUNED_PAGES || tuples == 0)
+        return;
+
+    if (stats->live_tuples > 0 && HEAP_TARGET_DEAD_TUPLES / stats->live_tuples < DEFAULT_AUTOVACUUM_SCALE_FACTOR)
+    {
+        char text[32];
+
+        table->scale_factor = HEAP_TARGET_DEAD_TUPLES / stats->live_tuples;
+        if (table->scale_factor < HEAP_MIN_SCALE_FACTOR)
+            table->scale_factor = HEAP_MIN_SCALE_FACTOR;
+        /* Two significant digits are all the precision it has */
+        snprintf(text, sizeof text, "%.2g", table->scale_factor);
+        table->scale_factor = strtod(text, NULL);
+    }
+
+    hot_share = (double)stats->hot_tuples / tuples;
+    if (hot_share >= HEAP_HOT_SHARE_HIGH)
+        table->fillfactor = 80;
+    else if (hot_share >= HEAP_HOT_SHARE_LOW)
+        table->fillfactor = 90;
+}
+
+/* Vacuum dirties the pages with dead tuples and reads the ones not all visible */
+static double
+vacuum_cost(const HeapStats *stats)
+{
+    long long clean = stats->pages - stats->vm_visible - stats->dirty_pages;
+
+    if (clean < 0)
+        clean = 0;
+    return stats->dirty_pages * (VACUUM_COST_PAGE_MISS + VACUUM_COST_PAGE_DIRTY) + clean * VACUUM_COST_PAGE_MISS;
+}
+
+static int
+compare_dead_bytes(const void *a, const void *b)
+{
+    const TableHeap *ta = *(TableHeap * const *) a;
+    const TableHeap *tb = *(TableHeap * const *) b;
+
+    if (ta->stats.dead_bytes != tb->stats.dead_bytes)
+        return ta->stats.dead_bytes > tb->stats.dead_bytes ? -1 : 1;
+    return 0;
+}
@@ -3,278 +3,709 @@
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "json.h"
+#include "json_scan.h"
+#include "pg_arena.h"
 
 #include "pg_config_map.h"
-/* profile keys */
-#define NAME_KEY "name"
-#define VERSION_KEY "version"
-#define DATE_CREATED_KEY "date_created"
-#define ENGINE_KEY "engine"
-#define AUTHOR_KEY "author"
-#define DESCRIPTION_KEY "description"
-#define MIN_MEMORY_KEY "min_memory"
-#define MIN_CPU_KEY "min_cpu"
-#define MAX_MEMORY_KEY "max_memory"
-#define MAX_CPU_KEY "max_cpu"
-
-/* map entriy keys */
-#define CONFIG_MAP_KEY "config_map"
-#define PARAMETER_KEY "parameter"
-#define RESOURCE_KEY "resource"
-#define FORMULA_KEY "formula"
-#define OLAP_FACTOR_KEY "olap_factor"
-#define OLTP_FACTOR_KEY "oltp_factor"
-#define MIXED_FACTOR_KEY "mixed_factor"
-#define TRIGGER_KEY "trigger"
-
-static PGConfigMapEntry *get_config_map_entry_from_json_obj(json_value *map_entry_json, SystemInfo *system_info);
-static bool load_profile_details(json_value *map_entry_json, PGMapProfileDetails *pfofile);
+#include "pg_profile_schema.h"
+#include "pg_cost_calibration.h"
+
+/*
+ * A profile can extend another profile, which in turn can extend another one.
+ * MAX_PROFILE_DEPTH limits the length of that chain.
+ */
+#define MAX_PROFILE_DEPTH 16
+
+/*
+ * Merged view of one config_map entry across the profile chain.
+ * layers[0] is the definition from the furthest base profile and
+ * every later layer is an overlay, so key lookups walk the layers
+ * backwards and the top-most overlay that defines a key wins.
+ */
+typedef struct profile_layered_entry ProfileLayeredEntry;
+struct profile_layered_entry
+{
+    const char *param;      /* points into the tape of the first layer */
+    json_cursor layers[MAX_PROFILE_DEPTH];
+    const char *paths[MAX_PROFILE_DEPTH];   /* profile file of each layer */
+    int num_layers;
+    bool removed;
+    ProfileLayeredEntry *next;
+};
+
+typedef struct profile_chain
+{
+    PGConfigMap *config;        /* the map loaded, logs through its hook */
+    PGArena *arena;             /* everything temporary but the tapes */
+    int depth;
+    char *paths[MAX_PROFILE_DEPTH];
+    json_tape *tapes[MAX_PROFILE_DEPTH];    /* parsed profiles, read in place */
+    json_cursor roots[MAX_PROFILE_DEPTH];   /* roots[0] is the base profile */
+    ProfileLayeredEntry *entries;
+    ProfileLayeredEntry *last_entry;
+    int errors;                 /* problems found in the profiles */
+} ProfileChain;
+
+static PGConfigMapEntry *get_config_map_entry_from_json_obj(ProfileLayeredEntry *layered_entry, SystemInfo *system_info, PGArena *arena, int *errors);
+static bool load_profile_details(ProfileChain *chain, PGMapProfileDetails *pfofile, PGArena *arena);
+static bool parse_json_file(const char *file_path, json_tape *tape, json_cursor *root);
+static char *get_value_text(const json_cursor *value, PGArena *arena);
+static int load_profile_chain(ProfileChain *chain, const char *file_path);
+static int merge_profile_layer(ProfileChain *chain, const json_cursor *root, const char *file_path);
+static const json_cursor *find_layer_for_key(const json_cursor *layers, int num_layers, const char *key);
+static bool get_layered_value(ProfileLayeredEntry *layered_entry, const char *key, int *layer, json_cursor *value);
+static void free_profile_chain(ProfileChain *chain);
 
 int load_json_config_map(PGConfigMap *config, PGMapProfileDetails *profile, SystemInfo *system_info, const char *file_path)
 {
-    FILE *input_json;
-    int seek_end_result;
-    long tell_result;
-    int seek_set_result;
-    char *input_json_buffer;
+    ProfileChain chain;
+    ProfileLayeredEntry *layered_entry;
     int i;
-    size_t read_result;
-    json_value *parsed_json;
-    json_value *map_value = NULL;
 
     config->list = NULL;
     config->num_entries = 0;
-
-    printf("DEBUG: Loading config map from file:%s\n", file_path);
-    input_json = fopen(file_path, "rb");
-    if (input_json == NULL)
+    config->image = NULL;
+    config->image_size = 0;
+    memset(&chain, 0x00, sizeof chain);
+    chain.config = config;
+
+    /*
+     * Entries and their strings live in the map arena until the map is
+     * freed. The tapes of the profiles only live while we load.
+     */
+    config->arena = pg_arena_create(ARENA_MIN_BLOCK_SIZE);
+    chain.arena = pg_arena_create(ARENA_MIN_BLOCK_SIZE);
+    if (config->arena == NULL || chain.arena == NULL)
     {
-        fprintf(stderr, "Failed to read file %s reason:%s\n", file_path, strerror(errno));
+        free_profile_chain(&chain);
         return -1;
     }
 
-    seek_end_result = fseek(input_json, 0, SEEK_END);
-    if (seek_end_result != 0)
+    config_map_log(config, PGAT_LOG_DEBUG, "Loading config map from file:%s", file_path);
+    if (load_profile_chain(&chain, file_path) < 0)
     {
-        fprintf(stderr, "fseek end error, %i\n", seek_end_result);
-        fclose(input_json);
+        free_profile_chain(&chain);
         return -1;
     }
 
-    tell_result = ftell(input_json);
-    if (tell_result < 0)
+    if (chain.errors > 0)
     {
-        fprintf(stderr, "ftell error, %li\n", tell_result);
-        fclose(input_json);
+        fprintf(stderr, "Invalid profile %s: %d error(s) found, refusing to use it\n", file_path, chain.errors);
+        free_profile_chain(&chain);
         return -1;
     }
 
-    seek_set_result = fseek(input_json, 0, SEEK_SET);
-    if (seek_set_result != 0)
+    if (load_profile_details(&chain, profile, config->arena) == false)
     {
-        fprintf(stderr, "fseek set error, %i\n", seek_set_result);
-        fclose(input_json);
+        fprintf(stderr, "Failed to load profile infromation from json file %s\n", file_path);
+        free_profile_chain(&chain);
         return -1;
     }
 
-    if (tell_result == 0)
+    for (i = 0; i < chain.depth; i++)
     {
-        input_json_buffer = (char *)calloc(1, 1);
+        if (merge_profile_layer(&chain, &chain.roots[i], chain.paths[i]) < 0)
+        {
+            free_profile_chain(&chain);
+            return -1;
+        }
     }
-    else
+
+    if (chain.entries == NULL)
+    {
+        fprintf(stderr, "Invalid Json. \"%s\" does not contain any data\n", CONFIG_MAP_KEY);
+        free_profile_chain(&chain);
+        return -1;
+    }
+
+    for (layered_entry = chain.entries; layered_entry; layered_entry = layered_entry->next)
     {
-        input_json_buffer = (char *)malloc(tell_result);
+        PGConfigMapEntry *entry;
+
+        if (layered_entry->removed)
+            continue;
+
+        entry = get_config_map_entry_from_json_obj(layered_entry, system_info, config->arena, &chain.errors);
+        if (entry == NULL)
+            continue;
+        if (config->list != NULL)
+            entry->next = config->list;
+        entry->status = ENTRY_LOADED;
+        config->list = entry;
+        config->num_entries++;
     }
-    if (input_json_buffer == NULL)
+    if (chain.errors > 0)
     {
-        fprintf(stderr, "memory allocation failed, %li bytes\n", tell_result);
-        fclose(input_json);
+        fprintf(stderr, "Invalid profile %s: %d error(s) found, refusing to use it\n", file_path, chain.errors);
+        free_profile_chain(&chain);
         return -1;
     }
+    free_profile_chain(&chain);
+    return config->num_entries;
+}
 
-    read_result = fread(input_json_buffer, 1, tell_result, input_json);
-    fclose(input_json);
-    if (read_result < (size_t)tell_result)
+/*
+ * Map and parse a single json file into tape, with its lines indexed for
+ * the positions of the errors. Returns false on error.
+ */
+static bool
+parse_json_file(const char *file_path, json_tape *tape, json_cursor *root)
+{
+    char error[json_error_max];
+    struct stat st;
+    void *input_json;
+    int fd;
+    int rc;
+
+    fd = open(file_path, O_RDONLY);
+    if (fd == -1)
     {
-        fprintf(stderr, "fread error, %lu\n", (unsigned long)read_result);
-        free(input_json_buffer);
-        return -1;
+        fprintf(stderr, "Failed to read file %s reason:%s\n", file_path, strerror(errno));
+        return false;
+    }
+    if (fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "Failed to stat file %s reason:%s\n", file_path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        fprintf(stderr, "Failed to parse json file %s: file is empty\n", file_path);
+        close(fd);
+        return false;
     }
 
-    parsed_json = json_parse(input_json_buffer, tell_result);
-    free(input_json_buffer);
-    if (parsed_json == NULL)
+    input_json = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (input_json == MAP_FAILED)
     {
-        fprintf(stderr, "Failed to parse json file %s\n", file_path);
-        return -1;
+        fprintf(stderr, "Failed to map file %s reason:%s\n", file_path, strerror(errno));
+        return false;
     }
+    madvise(input_json, st.st_size, MADV_SEQUENTIAL);
 
-    if (load_profile_details(parsed_json, profile) == false)
+    rc = json_tape_parse_ex(tape, input_json, st.st_size, error);
+    if (rc == 0 && json_tape_index_lines(tape, input_json, st.st_size) != 0)
+        snprintf(error, sizeof error, "out of memory");
+    munmap(input_json, st.st_size);
+    if (rc != 0 || tape->line_starts == NULL)
     {
-        fprintf(stderr, "Failed to load profile infromation from json file %s\n", file_path);
-        return -1;
+        fprintf(stderr, "Failed to parse json file %s: %s\n", file_path, error);
+        return false;
+    }
+    json_tape_root(tape, root);
+    if (json_cursor_type(root) != json_object)
+    {
+        fprintf(stderr, "Invalid Json. profile %s is not a json object\n", file_path);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Follow the "extends" references starting from file_path and load every
+ * profile in the chain. On return chain->roots[0] holds the base profile
+ * and chain->roots[depth - 1] the one we were asked to load.
+ * A relative "extends" path is resolved against the directory of the
+ * profile that contains it.
+ */
+static int
+load_profile_chain(ProfileChain *chain, const char *file_path)
+{
+    char next_path[PATH_MAX];
+    int i;
+
+    strncpy(next_path, file_path, PATH_MAX - 1);
+    next_path[PATH_MAX - 1] = '\0';
+
+    while (true)
+    {
+        char resolved_path[PATH_MAX];
+        char dir_path[PATH_MAX];
+        json_tape *tape;
+        json_cursor extends;
+        const char *extends_path;
+
+        if (realpath(next_path, resolved_path) == NULL)
+        {
+            fprintf(stderr, "Failed to resolve profile path %s reason:%s\n", next_path, strerror(errno));
+            return -1;
+        }
+
+        for (i = 0; i < chain->depth; i++)
+        {
+            if (strcmp(chain->paths[i], resolved_path) == 0)
+            {
+                fprintf(stderr, "Invalid profile chain. profile \"%s\" extends itself through \"%s\"\n",
+                        resolved_path, chain->paths[chain->depth - 1]);
+                return -1;
+            }
+        }
+        if (chain->depth >= MAX_PROFILE_DEPTH)
+        {
+            fprintf(stderr, "Invalid profile chain. More than %d levels of \"%s\" starting from %s\n",
+                    MAX_PROFILE_DEPTH, EXTENDS_KEY, file_path);
+            return -1;
+        }
+
+        /* counted in the chain from the start, so a failed parse is freed too */
+        tape = pg_arena_calloc(chain->arena, sizeof *tape);
+        if (tape == NULL)
+        {
+            perror("Not possible to allocate memory for the profile");
+            return -1;
+        }
+        chain->tapes[chain->depth] = tape;
+        chain->paths[chain->depth] = pg_arena_strdup(chain->arena, resolved_path);
+        chain->depth++;
+        if (!parse_json_file(resolved_path, tape, &chain->roots[chain->depth - 1]))
+            return -1;
+        chain->errors += validate_profile_document(&chain->roots[chain->depth - 1], chain->paths[chain->depth - 1]);
+
+        if (!json_cursor_get(&chain->roots[chain->depth - 1], EXTENDS_KEY, &extends))
+            break;
+        extends_path = json_cursor_string(&extends);
+        if (extends_path == NULL || *extends_path == '\0')
+        {
+            fprintf(stderr, "Invalid Json. \"%s\" key in profile %s must be a file path\n", EXTENDS_KEY, resolved_path);
+            return -1;
+        }
+
+        if (extends_path[0] == '/')
+            snprintf(next_path, PATH_MAX, "%s", extends_path);
+        else
+        {
+            strncpy(dir_path, resolved_path, PATH_MAX);
+            snprintf(next_path, PATH_MAX, "%s/%s", dirname(dir_path), extends_path);
+        }
+        config_map_log(chain->config, PGAT_LOG_INFO, "profile %s extends %s", resolved_path, next_path);
     }
 
-    map_value = json_get_value_for_key(parsed_json, CONFIG_MAP_KEY);
-    if (map_value == NULL || map_value->type != json_array)
+    /* We loaded the chain top down, flip it so the base comes first */
+    for (i = 0; i < chain->depth / 2; i++)
+    {
+        char *tmp_path = chain->paths[i];
+        json_tape *tmp_tape = chain->tapes[i];
+        json_cursor tmp_root = chain->roots[i];
+
+        chain->paths[i] = chain->paths[chain->depth - 1 - i];
+        chain->tapes[i] = chain->tapes[chain->depth - 1 - i];
+        chain->roots[i] = chain->roots[chain->depth - 1 - i];
+        chain->paths[chain->depth - 1 - i] = tmp_path;
+        chain->tapes[chain->depth - 1 - i] = tmp_tape;
+        chain->roots[chain->depth - 1 - i] = tmp_root;
+    }
+    return chain->depth;
+}
+
+/*
+ * Apply the config_map of one profile on top of the entries merged so far.
+ * An entry for a parameter we already have overrides only the keys it
+ * specifies, an entry with "remove" set drops the parameter, and anything
+ * else is appended as a new entry.
+ */
+static int
+merge_profile_layer(ProfileChain *chain, const json_cursor *root, const char *file_path)
+{
+    json_cursor map_value;
+    json_cursor map_entry;
+    uint32_t length;
+    uint32_t i;
+
+    if (!json_cursor_get(root, CONFIG_MAP_KEY, &map_value))
     {
-        fprintf(stderr, "Invalid Json. \"%s\" key not found\n", CONFIG_MAP_KEY);
-        json_value_free(parsed_json);
+        /* An overlay may only change the profile details */
+        if (chain->roots[0].tape != root->tape)
+            return 0;
+        fprintf(stderr, "Invalid Json. \"%s\" key not found in %s\n", CONFIG_MAP_KEY, file_path);
         return -1;
     }
-    if (map_value->u.array.length <= 0)
+    if (json_cursor_type(&map_value) != json_array)
     {
-        fprintf(stderr, "Invalid Json. \"%s\" does not contain any data\n", CONFIG_MAP_KEY);
-        json_value_free(parsed_json);
+        fprintf(stderr, "Invalid Json. \"%s\" key in %s is not an array\n", CONFIG_MAP_KEY, file_path);
         return -1;
     }
-    printf("LOG: Trying to load config map containing %d entries\n", map_value->u.array.length);
+    config_map_log(chain->config, PGAT_LOG_INFO, "Trying to load config map containing %d entries from %s",
+                   json_cursor_node(&map_value)->length, file_path);
 
-    for (i = 0; i < map_value->u.array.length; i++)
+    length = json_cursor_node(&map_value)->length;
+    json_cursor_child(&map_value, &map_entry);
+    for (i = 0; i < length; i++, json_cursor_next(&map_entry))
     {
-        json_value *map_entry = map_value->u.array.values[i];
-        PGConfigMapEntry *entry = get_config_map_entry_from_json_obj(map_entry, system_info);
-        if (entry)
+        ProfileLayeredEntry *layered_entry;
+        const char *param;
+        bool remove = false;
+
+        if (json_cursor_type(&map_entry) != json_object)
+        {
+            fprintf(stderr, "Invalid Json object\n");
+            continue;
+        }
+        param = json_cursor_get_string(&map_entry, PARAMETER_KEY);
+        if (param == NULL)
+        {
+            fprintf(stderr, "Invalid Json object, Json object does not contains required parameter\n");
+            continue;
+        }
+        json_cursor_get_bool(&map_entry, REMOVE_KEY, &remove);
+
+        for (layered_entry = chain->entries; layered_entry; layered_entry = layered_entry->next)
+        {
+            if (!strcasecmp(layered_entry->param, param))
+                break;
+        }
+
+        if (remove)
+        {
+            if (layered_entry == NULL || layered_entry->removed)
+                fprintf(stderr, "WARNING: %s removes parameter \"%s\" that is not defined by the profiles it extends\n",
+                        file_path, param);
+            else
+                layered_entry->removed = true;
+            continue;
+        }
+
+        if (layered_entry == NULL)
+        {
+            layered_entry = pg_arena_calloc(chain->arena, sizeof *layered_entry);
+            if (layered_entry == NULL)
+            {
+                perror("Not possible to allocate memory for the Parameters");
+                return -1;
+            }
+            layered_entry->param = param;
+            if (chain->last_entry)
+                chain->last_entry->next = layered_entry;
+            else
+                chain->entries = layered_entry;
+            chain->last_entry = layered_entry;
+        }
+        else
+        {
+            /* A parameter added back after a removal starts from scratch */
+            if (layered_entry->removed)
+            {
+                layered_entry->removed = false;
+                layered_entry->num_layers = 0;
+            }
+        }
+        if (layered_entry->num_layers >= MAX_PROFILE_DEPTH)
         {
-            if (config->list != NULL)
-                entry->next = config->list;
-            entry->status = ENTRY_LOADED;
-            config->list = entry;
-            config->num_entries++;
+            fprintf(stderr, "ERROR: parameter \"%s\" is defined more than %d times by %s and the profiles it extends\n",
+                    param, MAX_PROFILE_DEPTH, file_path);
+            return -1;
         }
+        layered_entry->paths[layered_entry->num_layers] = file_path;
+        layered_entry->layers[layered_entry->num_layers++] = map_entry;
+    }
+    return 0;
+}
+
+/*
+ * Returns the top-most layer that defines the key. When none of them does
+ * the top-most layer is returned so that the lookup on it fails as usual.
+ */
+static const json_cursor *
+find_layer_for_key(const json_cursor *layers, int num_layers, const char *key)
+{
+    json_cursor value;
+    int i;
+
+    for (i = num_layers - 1; i >= 0; i--)
+    {
+        if (json_cursor_get(&layers[i], key, &value))
+            return &layers[i];
+    }
+    return &layers[num_layers - 1];
+}
+
+static void
+free_profile_chain(ProfileChain *chain)
+{
+    int i;
+
+    for (i = 0; i < chain->depth; i++)
+        json_tape_free(chain->tapes[i]);
+    /* nothing else in the chain outlives its arena */
+    pg_arena_destroy(chain->arena);
+    memset(chain, 0x00, sizeof *chain);
+}
+
+/*
+ * Text of a string or number value, copied into the arena. Numbers are
+ * printed the way the processors and the generated conf expect them.
+ */
+static char *
+get_value_text(const json_cursor *value, PGArena *arena)
+{
+    const json_tape_node *node = json_cursor_node(value);
+
+    switch (node->type)
+    {
+    case json_string:
+        return pg_arena_strndup(arena, json_cursor_string(value), node->length);
+    case json_integer:
+        return pg_arena_sprintf(arena, "%ld", (long)node->u.integer);
+    case json_double:
+        return pg_arena_sprintf(arena, "%f", node->u.dbl);
+    default:
+        return NULL;
     }
-    json_value_free(parsed_json);
-    return config->num_entries;
 }
 
 static bool
-load_profile_details(json_value *map_entry_json, PGMapProfileDetails *profile)
+load_profile_details(ProfileChain *chain, PGMapProfileDetails *profile, PGArena *arena)
 {
-    char *ptr;
+    const char *ptr;
 
-    if (map_entry_json == NULL || map_entry_json->type != json_object)
+    if (chain->depth <= 0)
     {
         fprintf(stderr, "Invalid Json object\n");
         return false;
     }
 
-    ptr = json_get_string_value_for_key(map_entry_json, NAME_KEY);
-    profile->name = ptr ? strdup(ptr) : strdup("no name");
+    ptr = json_cursor_get_string(find_layer_for_key(chain->roots, chain->depth, NAME_KEY), NAME_KEY);
+    profile->name = pg_arena_strdup(arena, ptr ? ptr : "no name");
 
-    ptr = json_get_string_value_for_key(map_entry_json, VERSION_KEY);
-    profile->version = ptr ? strdup(ptr) : strdup("no version info");
+    ptr = json_cursor_get_string(find_layer_for_key(chain->roots, chain->depth, VERSION_KEY), VERSION_KEY);
+    profile->version = pg_arena_strdup(arena, ptr ? ptr : "no version info");
 
-    ptr = json_get_string_value_for_key(map_entry_json, ENGINE_KEY);
-    profile->engine = ptr ? strdup(ptr) : strdup("no Engine info");
+    ptr = json_cursor_get_string(find_layer_for_key(chain->roots, chain->depth, ENGINE_KEY), ENGINE_KEY);
+    profile->engine = pg_arena_strdup(arena, ptr ? ptr : "no Engine info");
 
-    ptr = json_get_string_value_for_key(map_entry_json, AUTHOR_KEY);
-    profile->author = ptr ? strdup(ptr) : strdup("no author info");
+    ptr = json_cursor_get_string(find_layer_for_key(chain->roots, chain->depth, AUTHOR_KEY), AUTHOR_KEY);
+    profile->author = pg_arena_strdup(arena, ptr ? ptr : "no author info");
 
-    ptr = json_get_string_value_for_key(map_entry_json, DESCRIPTION_KEY);
-    profile->description = ptr ? strdup(ptr) : strdup("no description");
+    ptr = json_cursor_get_string(find_layer_for_key(chain->roots, chain->depth, DESCRIPTION_KEY), DESCRIPTION_KEY);
+    profile->description = pg_arena_strdup(arena, ptr ? ptr : "no description");
 
-    ptr = json_get_string_value_for_key(map_entry_json, DATE_CREATED_KEY);
-    profile->date_created = ptr ? strdup(ptr) : strdup("no date info");
+    ptr = json_cursor_get_string(find_layer_for_key(chain->roots, chain->depth, DATE_CREATED_KEY), DATE_CREATED_KEY);
+    profile->date_created = pg_arena_strdup(arena, ptr ? ptr : "no date info");
 
-    if (json_get_long_value_for_key(map_entry_json, MIN_MEMORY_KEY, &profile->max_memory))
+    if (json_cursor_get_long(find_layer_for_key(chain->roots, chain->depth, MIN_MEMORY_KEY), MIN_MEMORY_KEY, &profile->min_memory))
         profile->min_memory = -1;
-    if (json_get_long_value_for_key(map_entry_json, MIN_CPU_KEY, &profile->min_cpu))
+    if (json_cursor_get_long(find_layer_for_key(chain->roots, chain->depth, MIN_CPU_KEY), MIN_CPU_KEY, &profile->min_cpu))
         profile->min_cpu = -1;
-    if (json_get_long_value_for_key(map_entry_json, MAX_MEMORY_KEY, &profile->max_memory))
+    if (json_cursor_get_long(find_layer_for_key(chain->roots, chain->depth, MAX_MEMORY_KEY), MAX_MEMORY_KEY, &profile->max_memory))
         profile->max_memory = -1;
-    if (json_get_long_value_for_key(map_entry_json, MAX_CPU_KEY, &profile->max_cpu))
+    if (json_cursor_get_long(find_layer_for_key(chain->roots, chain->depth, MAX_CPU_KEY), MAX_CPU_KEY, &profile->max_cpu))
         profile->max_cpu = -1;
 
     return true;
 }
 
+/*
+ * Value of a key in the top-most layer of the entry that defines it. The
+ * index of that layer is returned in layer, or the top-most layer when no
+ * layer defines the key and false is returned.
+ */
+static bool
+get_layered_value(ProfileLayeredEntry *layered_entry, const char *key, int *layer, json_cursor *value)
+{
+    int i;
+
+    for (i = layered_entry->num_layers - 1; i >= 0; i--)
+    {
+        if (json_cursor_get(&layered_entry->layers[i], key, value))
+        {
+            *layer = i;
+            return true;
+        }
+    }
+    *layer = layered_entry->num_layers - 1;
+    return false;
+}
+
+/*
+ * Build the map entry of a merged parameter. The documents were validated
+ * on their own already, what is left is what only the merged entry shows:
+ * missing keys, and factors that do not fit the formula.
+ */
 static PGConfigMapEntry *
-get_config_map_entry_from_json_obj(json_value *map_entry_json, SystemInfo *system_info)
+get_config_map_entry_from_json_obj(ProfileLayeredEntry *layered_entry, SystemInfo *system_info, PGArena *arena, int *errors)
 {
+    static const char *factor_keys[NUM_WORKLOAD_FACTORS] = {
+        [OLAP] = OLAP_FACTOR_KEY,
+        [OLTP] = OLTP_FACTOR_KEY,
+        [MIXED] = MIXED_FACTOR_KEY,
+    };
     PGConfigMapEntry *entry = NULL;
-    char *ptr;
-
-    if (map_entry_json == NULL || map_entry_json->type != json_object)
+    const char **paths = layered_entry->paths;
+    const json_cursor *first_layer;
+    json_cursor resource_value;
+    json_cursor value;
+    bool has_resource;
+    bool has_formula;
+    double max_factor;
+    int errors_before = *errors;
+    int resource_layer;
+    int layer;
+    int w;
+
+    if (layered_entry->num_layers <= 0)
     {
         fprintf(stderr, "Invalid Json object\n");
         return NULL;
     }
-    entry = malloc(sizeof *entry);
-    memset(entry, 0x00, sizeof *entry);
-    entry->status = ENTRY_EMPTY;
+    first_layer = &layered_entry->layers[0];
+
+    entry = pg_arena_calloc(arena, sizeof *entry);
     if (entry == NULL)
     {
         perror("Not possible to allocate memory for the Parameters");
         return NULL;
     }
+    entry->status = ENTRY_EMPTY;
     entry->next = NULL;
+    entry->param = pg_arena_strdup(arena, layered_entry->param);
+
+    entry->resource = INVALID_RESOURCE;
+    entry->formula = INVALID_FORMULA;
 
-    ptr = json_get_string_value_for_key(map_entry_json, PARAMETER_KEY);
-    if (!ptr)
+    has_resource = get_layered_value(layered_entry, RESOURCE_KEY, &resource_layer, &resource_value);
+    if (!has_resource)
     {
-        fprintf(stderr, "Invalid Json object, Json object does not contains required parameter\n");
-        goto ERROR_EXIT;
+        profile_error(paths[0], first_layer, "parameter \"%s\" has no \"%s\"", entry->param, RESOURCE_KEY);
+        (*errors)++;
     }
-    entry->param = strdup(ptr);
+    else
+        entry->resource = identify_resource(json_cursor_string(&resource_value));
 
-    ptr = json_get_string_value_for_key(map_entry_json, RESOURCE_KEY);
-    if (!ptr)
+    has_formula = get_layered_value(layered_entry, FORMULA_KEY, &layer, &value);
+    if (!has_formula)
     {
-        fprintf(stderr, "Invalid Json object, Json object does not contains required resource\n");
-        goto ERROR_EXIT;
+        profile_error(paths[0], first_layer, "parameter \"%s\" has no \"%s\"", entry->param, FORMULA_KEY);
+        (*errors)++;
     }
-    entry->resource = identify_resource(ptr);
-    if (entry->resource == INVALID_RESOURCE)
+    else
     {
-        fprintf(stderr, "Invalid Json object, parameter \"%s\" specifies invalid resource:\"%s\"\n", entry->param, ptr);
-        goto ERROR_EXIT;
+        entry->formula = identify_formula(json_cursor_string(&value));
+        if (entry->formula == CALIBRATED && get_planner_cost(entry->param) == INVALID_PLANNER_COST)
+        {
+            profile_error(paths[layer], &value, "parameter \"%s\" can not be calibrated, only %s can",
+                          entry->param, CALIBRATED_PARAMETERS);
+            (*errors)++;
+        }
     }
 
-    ptr = json_get_string_value_for_key(map_entry_json, FORMULA_KEY);
-    if (!ptr)
-    {
-        fprintf(stderr, "Invalid Json object, Json object does not contains required formula\n");
-        goto ERROR_EXIT;
-    }
-    entry->formula = identify_formula(ptr);
-    if (entry->formula == INVALID_FORMULA)
+    if (has_resource && has_formula && !formula_accepts_resource(entry->formula, entry->resource))
     {
-        fprintf(stderr, "Invalid Json object, parameter \"%s\" specifies invalid formula:\"%s\"\n", entry->param, ptr);
-        goto ERROR_EXIT;
+        /* blame whichever of the two was set last */
+        if (resource_layer > layer)
+        {
+            layer = resource_layer;
+            value = resource_value;
+        }
+        profile_error(paths[layer], &value, "parameter \"%s\": formula %s can not be used with resource %s",
+                      entry->param, get_formula_name(entry->formula), get_resource_name(entry->resource));
+        (*errors)++;
     }
 
-    switch (system_info->workload_type)
+    max_factor = is_data_resource(entry->resource) ? MAX_DATA_PERCENTAGE_FACTOR : MAX_PERCENTAGE_FACTOR;
+    for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
     {
-    case OLAP:
-        entry->value = json_get_string_value_for_key(map_entry_json, OLAP_FACTOR_KEY);
-        break;
+        double factor;
 
-    case OLTP:
-        entry->value = json_get_string_value_for_key(map_entry_json, OLTP_FACTOR_KEY);
-        break;
+        if (!get_layered_value(layered_entry, factor_keys[w], &layer, &value))
+        {
+            profile_error(paths[0], first_layer, "parameter \"%s\" has no \"%s\"", entry->param, factor_keys[w]);
+            (*errors)++;
+            continue;
+        }
+        if (entry->formula == CALIBRATED)
+        {
+            if (!get_factor_number(&value, &factor))
+            {
+                profile_error(paths[layer], &value, "parameter \"%s\": %s of a %s formula must be a number",
+                              entry->param, factor_keys[w], get_formula_name(entry->formula));
+                (*errors)++;
+            }
+            else if (factor < 0)
+            {
+                profile_error(paths[layer], &value, "parameter \"%s\": %s %g can not be negative",
+                              entry->param, factor_keys[w], factor);
+                (*errors)++;
+            }
+        }
+        else if (entry->formula == PERCENTAGE)
+        {
+            if (!get_factor_number(&value, &factor))
+            {
+                profile_error(paths[layer], &value, "parameter \"%s\": %s of a %s formula must be a number",
+                              entry->param, factor_keys[w], get_formula_name(entry->formula));
+                (*errors)++;
+            }
+            else if (factor < MIN_PERCENTAGE_FACTOR || factor > max_factor)
+            {
+                profile_error(paths[layer], &value, "parameter \"%s\": %s %g is out of range [%g, %g]",
+                              entry->param, factor_keys[w], factor, MIN_PERCENTAGE_FACTOR, max_factor);
+                (*errors)++;
+            }
+        }
+        entry->workload_values[w] = get_value_text(&value, arena);
+    }
 
-    case MIXED:
-        entry->value = json_get_string_value_for_key(map_entry_json, MIXED_FACTOR_KEY);
-        break;
+    /* Bounds are optional, a size of the data needs a max so a big database can not run away with it */
+    if (get_layered_value(layered_entry, MIN_KEY, &layer, &value))
+    {
+        entry->has_min = get_bound_number(&value, &entry->min_value);
+        if (!entry->has_min)
+        {
+            profile_error(paths[layer], &value, "parameter \"%s\": \"%s\" must be a number or a size", entry->param, MIN_KEY);
+            (*errors)++;
+        }
+    }
+    if (get_layered_value(layered_entry, MAX_KEY, &layer, &value))
+    {
+        entry->has_max = get_bound_number(&value, &entry->max_value);
+        if (!entry->has_max)
+        {
+            profile_error(paths[layer], &value, "parameter \"%s\": \"%s\" must be a number or a size", entry->param, MAX_KEY);
+            (*errors)++;
+        }
+        else if (entry->has_min && entry->min_value > entry->max_value)
+        {
+            profile_error(paths[layer], &value, "parameter \"%s\": \"%s\" %g is below \"%s\" %g",
+                          entry->param, MAX_KEY, entry->max_value, MIN_KEY, entry->min_value);
+            (*errors)++;
+        }
+    }
+    if (entry->formula == PERCENTAGE && !entry->has_max &&
+        (entry->resource == RESOURCE_DATA_SIZE || entry->resource == RESOURCE_LARGEST_TABLE))
+    {
+        profile_error(paths[resource_layer], &resource_value, "parameter \"%s\": resource %s needs a \"%s\"",
+                      entry->param, get_resource_name(entry->resource), MAX_KEY);
+        (*errors)++;
+    }
+    if (*errors > errors_before)
+        return NULL;
 
-    default:
+    if (system_info->workload_type < 0 || system_info->workload_type >= NUM_WORKLOAD_FACTORS)
+    {
         fprintf(stderr, "Invalid Json object, Json object does not contains required any valid workload Factor\n");
-        goto ERROR_EXIT;
-        break;
+        return NULL;
     }
+    entry->value = entry->workload_values[system_info->workload_type];
+    entry->factor_value = strtod(entry->value, NULL);
 
     /* Trigger is optional */
-    if (json_get_double_value_for_key(map_entry_json, TRIGGER_KEY, &entry->trigger_value))
-    {
+    if (!get_layered_value(layered_entry, TRIGGER_KEY, &layer, &value) ||
+        !get_factor_number(&value, &entry->trigger_value))
         entry->trigger_value = INVALID_DOUBLE_VAL;
-    }
 
-    return entry;
+    /* Blend is optional, the schema check already rejected unknown modes */
+    if (get_layered_value(layered_entry, BLEND_KEY, &layer, &value))
+        entry->blend = identify_blend_mode(json_cursor_string(&value));
+    else
+        entry->blend = BLEND_LINEAR;
 
-ERROR_EXIT:
-    if (entry->param)
-        free(entry->param);
-    free(entry);
-    return NULL;
-}
\ No newline at end of file
+    return entry;
+}
@@ -0,0 +1,517 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_log_analyzer.c
+ *		Evidence of what the server actually did, read from its logs.
+ *
+ * The percentage model sizes memory from the size of the host alone. The
+ * server logs tell how the current settings work out: log_temp_files
+ * reports every sort and hash that spilled out of work_mem with its size,
+ * log_checkpoints reports every checkpoint with its cause, timings and the
+ * WAL written since the previous one, and checkpoints triggered by WAL
+ * faster than checkpoint_warning are reported even without it.
+ *
+ * Logs can be several GB. Each file is mapped and every message of interest
+ * is found with memmem() over the whole mapping, which runs at memory
+ * speed, and only the lines around the matches are parsed. All messages
+ * are matched on their English text, which also makes the scan work for
+ * stderr, csvlog and jsonlog alike.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pg_log_analyzer.h"
+#include "pg_config_map.h"
+
+#define TEMP_FILE_MESSAGE "temporary file: path"
+#define TEMP_FILE_SIZE ", size "
+#define CHECKPOINT_MESSAGE "checkpoint"
+#define CHECKPOINT_COMPLETE " complete: "
+#define CHECKPOINT_STARTING " starting: "
+#define CHECKPOINT_TOO_FREQUENT "s are occurring too frequently ("
+#define AUTOVACUUM_MESSAGE "automatic vacuum of table"
+#define AUTOVACUUM_ELAPSED "elapsed: "
+
+/* How far after an autovacuum message its statistics may be */
+#define AUTOVACUUM_WINDOW 8192
+
+static const char *compressed_suffixes[] = {".gz", ".bz2", ".xz", ".zst", ".lz4", NULL};
+
+static bool scan_log_file(LogEvidence *evidence, const char *path, double *last_checkpoint);
+static bool scan_temp_files(LogEvidence *evidence, const char *data, size_t size);
+static bool scan_checkpoints(LogEvidence *evidence, const char *data, size_t size, double *last_checkpoint);
+static bool scan_autovacuum(LogEvidence *evidence, const char *data, size_t size);
+static const char *line_start(const char *data, const char *pos);
+static const char *line_end(const char *pos, const char *end);
+static bool line_timestamp(const char *line, const char *end, double *seconds);
+static bool field_number(const char *line, const char *end, const char *name, double *number);
+static bool number_at(const char *pos, const char *end, double *number);
+static bool add_sample(LogSamples *samples, double value);
+static int compare_names(const void *a, const void *b);
+static int compare_doubles(const void *a, const void *b);
+
+bool
+analyze_logs(const char *path, LogEvidence *evidence)
+{
+    double last_checkpoint = -1;
+    struct stat st;
+    char **names = NULL;
+    int num_names = 0;
+    struct dirent *dirent;
+    DIR *dir;
+    bool ok = true;
+    int i;
+
+    memset(evidence, 0x00, sizeof *evidence);
+    if (stat(path, &st) != 0)
+    {
+        fprintf(stderr, "ERROR: can not read the logs in \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return scan_log_file(evidence, path, &last_checkpoint);
+
+    dir = opendir(path);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "ERROR: can not read the logs in \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+    names = calloc(MAX_LOG_FILES, sizeof *names);
+    if (names == NULL)
+    {
+        closedir(dir);
+        perror("Not possible to allocate memory for the log files");
+        return false;
+    }
+    while ((dirent = readdir(dir)) != NULL && num_names < MAX_LOG_FILES)
+    {
+        size_t len = strlen(dirent->d_name);
+        const char **suffix;
+
+        if (dirent->d_name[0] == '.')
+            continue;
+        for (suffix = compressed_suffixes; *suffix; suffix++)
+        {
+            size_t suffix_len = strlen(*suffix);
+
+            if (len > suffix_len && strcmp(dirent->d_name + len - suffix_len, *suffix) == 0)
+                break;
+        }
+        if (*suffix)
+            continue;
+        names[num_names] = strdup(dirent->d_name);
+        if (names[num_names] == NULL)
+        {
+            ok = false;
+            break;
+        }
+        num_names++;
+    }
+    closedir(dir);
+
+    /* The default log_filename sorts in time order, checkpoint gaps rely on it */
+    qsort(names, num_names, sizeof *names, compare_names);
+    for (i = 0; ok && i < num_names; i++)
+    {
+        char file_path[PATH_MAX];
+
+        snprintf(file_path, sizeof file_path, "%s/%s", path, names[i]);
+        if (stat(file_path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+            continue;
+        ok = scan_log_file(evidence, file_path, &last_checkpoint);
+    }
+    for (i = 0; i < num_names; i++)
+        free(names[i]);
+    free(names);
+
+    if (ok && evidence->num_files == 0)
+    {
+        fprintf(stderr, "ERROR: no log files found in \"%s\"\n", path);
+        return false;
+    }
+    return ok;
+}
+
+void
+free_log_evidence(LogEvidence *evidence)
+{
+    free(evidence->temp_file_sizes.values);
+    free(evidence->checkpoint_wal_rates.values);
+    free(evidence->checkpoint_write_times.values);
+    free(evidence->checkpoint_sync_times.values);
+    free(evidence->checkpoint_distances.values);
+    free(evidence->frequent_checkpoint_gaps.values);
+    free(evidence->autovacuum_times.values);
+    memset(evidence, 0x00, sizeof *evidence);
+}
+
+void
+print_log_evidence(LogEvidence *evidence)
+{
+    LogSamples *samples;
+
+    printf("LOG: scanned %d log file(s), %.1f MB\n", evidence->num_files, evidence->bytes_scanned / (1024.0 * 1024.0));
+
+    samples = &evidence->temp_file_sizes;
+    if (samples->count > 0)
+        printf("LOG:   temp file spills       : %zu, p50 %.0fkB, p95 %.0fkB, max %.0fkB\n", samples->count,
+               log_percentile(samples, 50) / 1024, log_percentile(samples, 95) / 1024, log_percentile(samples, 100) / 1024);
+    else
+        printf("LOG:   temp file spills       : none (is log_temp_files set?)\n");
+
+    printf("LOG:   checkpoints            : %d by time, %d by WAL, %zu too frequent\n",
+           evidence->checkpoints_by_time, evidence->checkpoints_by_wal, evidence->frequent_checkpoint_gaps.count);
+    samples = &evidence->checkpoint_wal_rates;
+    if (samples->count > 0)
+        printf("LOG:   checkpoint WAL rate    : p50 %.0fkB/s, p95 %.0fkB/s\n",
+               log_percentile(samples, 50) / 1024, log_percentile(samples, 95) / 1024);
+    samples = &evidence->frequent_checkpoint_gaps;
+    if (samples->count > 0)
+        printf("LOG:   too frequent gaps      : p5 %.0fs, p50 %.0fs\n", log_percentile(samples, 5), log_percentile(samples, 50));
+    if (evidence->checkpoint_write_times.count > 0)
+        printf("LOG:   checkpoint write, sync : p95 %.3fs, p95 %.3fs\n",
+               log_percentile(&evidence->checkpoint_write_times, 95), log_percentile(&evidence->checkpoint_sync_times, 95));
+    samples = &evidence->autovacuum_times;
+    if (samples->count > 0)
+        printf("LOG:   autovacuum runs        : %zu, p50 %.2fs, p95 %.2fs, max %.2fs\n", samples->count,
+               log_percentile(samples, 50), log_percentile(samples, 95), log_percentile(samples, 100));
+}
+
+double
+log_percentile(LogSamples *samples, double percentile)
+{
+    size_t rank;
+
+    if (samples->count == 0)
+        return 0;
+    if (!samples->sorted)
+    {
+        qsort(samples->values, samples->count, sizeof *samples->values, compare_doubles);
+        samples->sorted = true;
+    }
+    rank = (size_t)ceil(percentile / 100.0 * samples->count);
+    if (rank < 1)
+        rank = 1;
+    if (rank > samples->count)
+        rank = samples->count;
+    return samples->values[rank - 1];
+}
+
+bool
+parse_duration_text(const char *text, double default_unit, double *seconds)
+{
+    double number;
+    char *unit;
+
+    if (text == NULL)
+        return false;
+    number = strtod(text, &unit);
+    if (unit == text || number < 0)
+        return false;
+    while (*unit == ' ')
+        unit++;
+    if (*unit == '\0')
+        *seconds = number * default_unit;
+    else if (strcmp(unit, "us") == 0)
+        *seconds = number / 1000000.0;
+    else if (strcmp(unit, "ms") == 0)
+        *seconds = number / 1000.0;
+    else if (strcmp(unit, "s") == 0)
+        *seconds = number;
+    else if (strcmp(unit, "min") == 0)
+        *seconds = number * 60.0;
+    else if (strcmp(unit, "h") == 0)
+        *seconds = number * 3600.0;
+    else if (strcmp(unit, "d") == 0)
+        *seconds = number * 86400.0;
+    else
+        return false;
+    return true;
+}
+
+static bool
+scan_log_file(LogEvidence *evidence, const char *path, double *last_checkpoint)
+{
+    struct stat st;
+    void *data;
+    bool ok;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to read file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    ok = scan_temp_files(evidence, data, st.st_size) &&
+        scan_checkpoints(evidence, data, st.st_size, last_checkpoint) &&
+        scan_autovacuum(evidence, data, st.st_size);
+    munmap(data, st.st_size);
+    if (!ok)
+    {
+        perror("Not possible to allocate memory for the log evidence");
+        return false;
+    }
+    evidence->num_files++;
+    evidence->bytes_scanned += st.st_size;
+    return true;
+}
+
+/* LOG:  temporary file: path "base/pgsql_tmp/pgsql_tmp1234.0", size 1048576 */
+static bool
+scan_temp_files(LogEvidence *evidence, const char *data, size_t size)
+{
+    const char *end = data + size;
+    const char *pos = data;
+
+    while ((pos = memmem(pos, end - pos, TEMP_FILE_MESSAGE, strlen(TEMP_FILE_MESSAGE))) != NULL)
+    {
+        const char *eol = line_end(pos, end);
+        const char *size_pos = memmem(pos, eol - pos, TEMP_FILE_SIZE, strlen(TEMP_FILE_SIZE));
+        double number;
+
+        if (size_pos && number_at(size_pos + strlen(TEMP_FILE_SIZE), eol, &number) &&
+            !add_sample(&evidence->temp_file_sizes, number))
+            return false;
+        pos = eol;
+    }
+    return true;
+}
+
+/*
+ * LOG:  checkpoint starting: wal
+ * LOG:  checkpoint complete: wrote 1234 buffers (7.5%); ... write=26.9 s, sync=0.003 s,
+ *       total=27.0 s; ... distance=524288 kB, estimate=530000 kB
+ * LOG:  checkpoints are occurring too frequently (12 seconds apart)
+ */
+static bool
+scan_checkpoints(LogEvidence *evidence, const char *data, size_t size, double *last_checkpoint)
+{
+    const char *end = data + size;
+    const char *pos = data;
+
+    while ((pos = memmem(pos, end - pos, CHECKPOINT_MESSAGE, strlen(CHECKPOINT_MESSAGE))) != NULL)
+    {
+        const char *eol = line_end(pos, end);
+        const char *rest = pos + strlen(CHECKPOINT_MESSAGE);
+        size_t rest_len = eol - rest;
+        double number;
+
+        if (rest_len > strlen(CHECKPOINT_COMPLETE) &&
+            strncmp(rest, CHECKPOINT_COMPLETE, strlen(CHECKPOINT_COMPLETE)) == 0)
+        {
+            double now;
+
+            if (field_number(rest, eol, "write=", &number) && !add_sample(&evidence->checkpoint_write_times, number))
+                return false;
+            if (field_number(rest, eol, "sync=", &number) && !add_sample(&evidence->checkpoint_sync_times, number))
+                return false;
+            if (field_number(rest, eol, "distance=", &number))
+            {
+                number *= 1024.0;
+                if (!add_sample(&evidence->checkpoint_distances, number))
+                    return false;
+
+                /* WAL written since the previous checkpoint, over the time since */
+                if (line_timestamp(line_start(data, pos), eol, &now))
+                {
+                    if (*last_checkpoint > 0 && now > *last_checkpoint && now - *last_checkpoint <= MAX_CHECKPOINT_GAP &&
+                        !add_sample(&evidence->checkpoint_wal_rates, number / (now - *last_checkpoint)))
+                        return false;
+                    *last_checkpoint = now;
+                }
+            }
+        }
+        else if (rest_len > strlen(CHECKPOINT_STARTING) &&
+                 strncmp(rest, CHECKPOINT_STARTING, strlen(CHECKPOINT_STARTING)) == 0)
+        {
+            const char *flags = rest + strlen(CHECKPOINT_STARTING);
+            const char *quote = memchr(flags, '"', eol - flags);
+            size_t flags_len = (quote ? quote : eol) - flags;
+
+            /* "xlog" before PostgreSQL 10 */
+            if (memmem(flags, flags_len, "wal", 3) || memmem(flags, flags_len, "xlog", 4))
+                evidence->checkpoints_by_wal++;
+            else if (memmem(flags, flags_len, "time", 4))
+                evidence->checkpoints_by_time++;
+        }
+        else if (rest_len > strlen(CHECKPOINT_TOO_FREQUENT) &&
+                 strncmp(rest, CHECKPOINT_TOO_FREQUENT, strlen(CHECKPOINT_TOO_FREQUENT)) == 0)
+        {
+            if (number_at(rest + strlen(CHECKPOINT_TOO_FREQUENT), eol, &number) &&
+                !add_sample(&evidence->frequent_checkpoint_gaps, number))
+                return false;
+        }
+        pos = eol;
+    }
+    return true;
+}
+
+/*
+ * The statistics of an autovacuum follow its message, on the lines after it
+ * in stderr and csvlog:
+ *
+ * LOG:  automatic vacuum of table "db.public.t": index scans: 1
+ *       ...
+ *       system usage: CPU: user: 0.10 s, system: 0.01 s, elapsed: 1.25 s
+ */
+static bool
+scan_autovacuum(LogEvidence *evidence, const char *data, size_t size)
+{
+    const char *end = data + size;
+    const char *pos = data;
+
+    while ((pos = memmem(pos, end - pos, AUTOVACUUM_MESSAGE, strlen(AUTOVACUUM_MESSAGE))) != NULL)
+    {
+        const char *message = pos + strlen(AUTOVACUUM_MESSAGE);
+        const char *window_end = end - message > AUTOVACUUM_WINDOW ? message + AUTOVACUUM_WINDOW : end;
+        const char *next = memmem(message, window_end - message, AUTOVACUUM_MESSAGE, strlen(AUTOVACUUM_MESSAGE));
+        const char *elapsed;
+        double number;
+
+        if (next)
+            window_end = next;
+        elapsed = memmem(message, window_end - message, AUTOVACUUM_ELAPSED, strlen(AUTOVACUUM_ELAPSED));
+        if (elapsed && number_at(elapsed + strlen(AUTOVACUUM_ELAPSED), window_end, &number) &&
+            !add_sample(&evidence->autovacuum_times, number))
+            return false;
+        pos = message;
+    }
+    return true;
+}
+
+static const char *
+line_start(const char *data, const char *pos)
+{
+    while (pos > data && pos[-1] != '\n')
+        pos--;
+    return pos;
+}
+
+static const char *
+line_end(const char *pos, const char *end)
+{
+    const char *eol = memchr(pos, '\n', end - pos);
+
+    return eol ? eol : end;
+}
+
+/*
+ * Time of a log line with the default log_line_prefix, which csvlog shares,
+ * or of a jsonlog record. The zone is ignored, only differences are used.
+ */
+static bool
+line_timestamp(const char *line, const char *end, double *seconds)
+{
+    char buf[64];
+    size_t len;
+
+    if (line < end && *line == '{')
+    {
+        const char *field = memmem(line, end - line, "\"timestamp\":\"", 13);
+
+        if (field == NULL)
+            return false;
+        line = field + 13;
+    }
+    len = end - line < (ptrdiff_t)sizeof buf - 1 ? (size_t)(end - line) : sizeof buf - 1;
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+    return parse_timestamp_text(buf, seconds);
+}
+
+/* The number after name=, e.g. "write=26.9 s" */
+static bool
+field_number(const char *line, const char *end, const char *name, double *number)
+{
+    const char *field = memmem(line, end - line, name, strlen(name));
+
+    if (field == NULL)
+        return false;
+    return number_at(field + strlen(name), end, number);
+}
+
+/* strtod() directly on the mapping could read past its end */
+static bool
+number_at(const char *pos, const char *end, double *number)
+{
+    char buf[64];
+    char *number_end;
+    size_t len = end - pos < (ptrdiff_t)sizeof buf - 1 ? (size_t)(end - pos) : sizeof buf - 1;
+
+    memcpy(buf, pos, len);
+    buf[len] = '\0';
+    *number = strtod(buf, &number_end);
+    return number_end != buf;
+}
+
+static bool
+add_sample(LogSamples *samples, double value)
+{
+    if (samples->count == samples->capacity)
+    {
+        size_t capacity = samples->capacity ? samples->capacity * 2 : 64;
+        double *values = realloc(samples->values, capacity * sizeof *values);
+
+        if (values == NULL)
+            return false;
+        samples->values = values;
+        samples->capacity = capacity;
+    }
+    samples->values[samples->count++] = value;
+    samples->sorted = false;
+    return true;
+}
+
+static int
+compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,622 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_memory_bandwidth.c
+ *		Memory bandwidth and latency of the host, STREAM copy, scale and
+ *		triad kernels on every CPU of every NUMA node and a pointer chase
+ *		in the memory of each node.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "pg_memory_bandwidth.h"
+#include "pg_bench.h"
+
+#define NODE_DIR "/sys/devices/system/node"
+#define CACHE_LINE_SIZE 64
+
+/* The scalar of STREAM */
+#define STREAM_SCALAR 3.0
+
+/* Same cycle on every run */
+#define CHASE_RANDOM_SEED 0x9E3779B97F4A7C15ULL
+
+typedef struct stream_run StreamRun;
+
+typedef struct stream_thread
+{
+    pthread_t thread;
+    StreamRun *run;
+    int cpu;
+    bool pinned;
+    long long elements;         /* of each array, 0 when they could not be allocated */
+    double *a;
+    double *b;
+    double *c;
+} StreamThread;
+
+/*
+ * The threads start together once all of them are created, so the barrier
+ * is sized for the threads that really run.
+ */
+struct stream_run
+{
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    bool go;
+    pthread_barrier_t barrier;
+    long long elements;         /* of each array of every thread */
+    StreamThread threads[MEMBW_MAX_THREADS];
+};
+
+typedef struct chase_thread
+{
+    int cpu;
+    long long bytes;
+    bool pinned;
+    double latency;             /* ns, negative when the memory could not be allocated */
+} ChaseThread;
+
+/* CPUs of the process on a NUMA node */
+typedef struct node_cpus
+{
+    int node;
+    int num_cpus;
+    int cpus[MEMBW_MAX_THREADS];
+} NodeCpus;
+
+/* Bytes a kernel moves for every element, as STREAM counts them */
+static const int kernel_bytes[NUM_STREAM_KERNELS] = {16, 16, 24};
+static const char *kernel_names[NUM_STREAM_KERNELS] = {"copy", "scale", "triad"};
+
+/* Keeps the compiler from leaving out the pointer chase */
+static volatile uintptr_t chase_sink;
+
+static int list_node_cpus(NodeCpus *nodes);
+static int parse_cpu_list(const char *list, const cpu_set_t *allowed, NodeCpus *node);
+static bool run_stream(const int *cpus, int num_cpus, long long array_bytes, double bandwidth[NUM_STREAM_KERNELS],
+                       bool *pinned);
+static void *stream_worker(void *arg);
+static void *chase_worker(void *arg);
+static bool chase_pointers(int cpu, long long bytes, double *latency, bool *pinned);
+static bool pin_thread(int cpu);
+static void run_kernel(StreamThread *thread, STREAM_KERNEL kernel);
+static uintptr_t chase(void *start, long steps);
+
+bool
+measure_memory_bandwidth(long long total_ram, long cpu_count, MemoryBandwidth *bandwidth)
+{
+    NodeCpus *nodes;
+    int cpus[MEMBW_MAX_THREADS];
+    int taken[MEMBW_MAX_NODES];
+    long long array_bytes = MEMBW_ARRAY_BYTES / 3;
+    long long chase_bytes = MEMBW_CHASE_BYTES;
+    struct timeval start;
+    int num_nodes;
+    int num_threads = 0;
+    bool pinned;
+    bool more;
+    int n, i;
+
+    memset(bandwidth, 0x00, sizeof *bandwidth);
+    gettimeofday(&start, NULL);
+    if (total_ram > 0 && total_ram * MEMBW_MEMORY_PCT / 100 / 3 < array_bytes)
+        array_bytes = (long long)(total_ram * MEMBW_MEMORY_PCT / 100 / 3);
+    if (array_bytes < MEMBW_MIN_ARRAY_BYTES)
+        array_bytes = MEMBW_MIN_ARRAY_BYTES;
+    if (total_ram > 0 && total_ram * MEMBW_MEMORY_PCT / 100 < chase_bytes)
+        chase_bytes = (long long)(total_ram * MEMBW_MEMORY_PCT / 100);
+
+    nodes = calloc(MEMBW_MAX_NODES, sizeof *nodes);
+    if (nodes == NULL)
+    {
+        perror("Not possible to allocate memory for the NUMA nodes");
+        return false;
+    }
+    num_nodes = list_node_cpus(nodes);
+    if (num_nodes <= 0)
+    {
+        fprintf(stderr, "ERROR: no CPU of the process could be found to run the memory kernels on\n");
+        free(nodes);
+        return false;
+    }
+
+    /* The threads go round the nodes, the way the server spreads its processes */
+    if (cpu_count <= 0 || cpu_count > MEMBW_MAX_THREADS)
+        cpu_count = MEMBW_MAX_THREADS;
+    memset(taken, 0x00, sizeof taken);
+    do
+    {
+        more = false;
+        for (n = 0; n < num_nodes && num_threads < cpu_count; n++)
+        {
+            if (taken[n] < nodes[n].num_cpus)
+            {
+                taken[n]++;
+                more = true;
+                num_threads++;
+            }
+        }
+    } while (more && num_threads < cpu_count);
+    for (n = 0, num_threads = 0; n < num_nodes; n++)
+    {
+        for (i = 0; i < taken[n]; i++)
+            cpus[num_threads++] = nodes[n].cpus[i];
+    }
+
+    if (!run_stream(cpus, num_threads, array_bytes, bandwidth->bandwidth, &bandwidth->pinned) ||
+        !run_stream(cpus, 1, array_bytes, bandwidth->core_bandwidth, &pinned))
+    {
+        free(nodes);
+        return false;
+    }
+    bandwidth->pinned &= pinned;
+    bandwidth->num_threads = num_threads;
+    bandwidth->array_bytes = array_bytes;
+
+    for (n = 0, num_threads = 0; n < num_nodes; n++)
+    {
+        MemoryNode *node;
+
+        if (taken[n] == 0)
+            continue;
+        node = &bandwidth->nodes[bandwidth->num_nodes++];
+        node->node = nodes[n].node;
+        node->num_threads = taken[n];
+
+        /* With a single node all the threads already ran on it */
+        if (num_nodes == 1)
+            memcpy(node->bandwidth, bandwidth->bandwidth, sizeof node->bandwidth);
+        else if (run_stream(&cpus[num_threads], taken[n], array_bytes, node->bandwidth, &pinned))
+            bandwidth->pinned &= pinned;
+        if (chase_pointers(nodes[n].cpus[0], chase_bytes, &node->latency, &pinned))
+        {
+            bandwidth->pinned &= pinned;
+            bandwidth->latency += node->latency;
+        }
+        num_threads += taken[n];
+    }
+    if (bandwidth->num_nodes > 0)
+        bandwidth->latency /= bandwidth->num_nodes;
+    free(nodes);
+    bandwidth->elapsed = bench_elapsed(&start);
+    return true;
+}
+
+void
+print_memory_bandwidth(MemoryBandwidth *bandwidth, long cpu_count)
+{
+    char label[64];
+    double cpus;
+    int n;
+
+    if (bandwidth->num_threads == 0)
+        return;
+    printf("LOG: measured the memory on %d threads of %d NUMA nodes in %.3f seconds%s\n", bandwidth->num_threads,
+           bandwidth->num_nodes, bandwidth->elapsed, bandwidth->pinned ? "" : ", not every thread could be pinned");
+    printf("LOG:   %-22s : %8s %8s %8s GB/s\n", "", kernel_names[STREAM_COPY], kernel_names[STREAM_SCALE],
+           kernel_names[STREAM_TRIAD]);
+    printf("LOG:   %-22s : %8.1f %8.1f %8.1f\n", "one thread", bandwidth->core_bandwidth[STREAM_COPY],
+           bandwidth->core_bandwidth[STREAM_SCALE], bandwidth->core_bandwidth[STREAM_TRIAD]);
+    for (n = 0; n < bandwidth->num_nodes; n++)
+    {
+        MemoryNode *node = &bandwidth->nodes[n];
+
+        snprintf(label, sizeof label, "node %d, %d threads", node->node, node->num_threads);
+        printf("LOG:   %-22s : %8.1f %8.1f %8.1f, %.1f ns a load\n", label, node->bandwidth[STREAM_COPY],
+               node->bandwidth[STREAM_SCALE], node->bandwidth[STREAM_TRIAD], node->latency);
+    }
+    if (bandwidth->num_nodes > 1)
+    {
+        snprintf(label, sizeof label, "all %d threads", bandwidth->num_threads);
+        printf("LOG:   %-22s : %8.1f %8.1f %8.1f, %.1f ns a load\n", label, bandwidth->bandwidth[STREAM_COPY],
+               bandwidth->bandwidth[STREAM_SCALE], bandwidth->bandwidth[STREAM_TRIAD], bandwidth->latency);
+    }
+
+    cpus = bandwidth_cpus(bandwidth->bandwidth[STREAM_TRIAD], bandwidth->core_bandwidth[STREAM_TRIAD], cpu_count);
+    printf("LOG:   %-22s : %.1f of %ld\n", "CPUs the memory feeds", cpus, cpu_count);
+    if (is_bandwidth_starved(bandwidth->bandwidth[STREAM_TRIAD], bandwidth->core_bandwidth[STREAM_TRIAD], cpu_count))
+        fprintf(stderr, "WARNING: the host is starved of memory bandwidth, %.1f GB/s for %ld CPUs feeds %.1f of them at the %.1f GB/s a CPU pulls alone\n",
+                bandwidth->bandwidth[STREAM_TRIAD], cpu_count, cpus, bandwidth->core_bandwidth[STREAM_TRIAD]);
+}
+
+const char *
+get_stream_kernel_name(STREAM_KERNEL kernel)
+{
+    return kernel >= 0 && kernel < NUM_STREAM_KERNELS ? kernel_names[kernel] : "unknown";
+}
+
+double
+bandwidth_cpus(double bandwidth, double core_bandwidth, long cpu_count)
+{
+    double cpus;
+
+    if (bandwidth <= 0 || core_bandwidth <= 0)
+        return (double)cpu_count;
+    cpus = bandwidth / core_bandwidth;
+    if (cpus > cpu_count)
+        cpus = (double)cpu_count;
+    if (cpus < 1)
+        cpus = 1;
+    return cpus;
+}
+
+bool
+is_bandwidth_starved(double bandwidth, double core_bandwidth, long cpu_count)
+{
+    return bandwidth > 0 && core_bandwidth > 0 && cpu_count > 1 &&
+        bandwidth < MEMBW_STARVED_SHARE * core_bandwidth * cpu_count;
+}
+
+/*
+ * The CPUs the process may run on, by NUMA node. Without the node
+ * directory of sysfs they all are on node 0.
+ */
+static int
+list_node_cpus(NodeCpus *nodes)
+{
+    cpu_set_t allowed;
+    struct dirent *entry;
+    DIR *dir;
+    int num_nodes = 0;
+    int cpu;
+
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+        CPU_ZERO(&allowed);
+        for (cpu = 0; cpu < online && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, &allowed);
+    }
+
+    dir = opendir(NODE_DIR);
+    while (dir && (entry = readdir(dir)) != NULL && num_nodes < MEMBW_MAX_NODES)
+    {
+        char path[512];
+        char list[4096];
+        FILE *fp;
+        int node;
+
+        if (sscanf(entry->d_name, "node%d", &node) != 1)
+            continue;
+        snprintf(path, sizeof path, "%s/%s/cpulist", NODE_DIR, entry->d_name);
+        fp = fopen(path, "r");
+        if (fp == NULL)
+            continue;
+        if (fgets(list, sizeof list, fp) != NULL)
+        {
+            nodes[num_nodes].node = node;
+            if (parse_cpu_list(list, &allowed, &nodes[num_nodes]) > 0)
+                num_nodes++;
+        }
+        fclose(fp);
+    }
+    if (dir)
+        closedir(dir);
+
+    if (num_nodes == 0)
+    {
+        nodes[0].node = 0;
+        nodes[0].num_cpus = 0;
+        for (cpu = 0; cpu < CPU_SETSIZE && nodes[0].num_cpus < MEMBW_MAX_THREADS; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+                nodes[0].cpus[nodes[0].num_cpus++] = cpu;
+        }
+        if (nodes[0].num_cpus > 0)
+            num_nodes = 1;
+    }
+    return num_nodes;
+}
+
+/* A cpulist of sysfs, e.g. "0-3,8-11", keeping the CPUs the process may run on */
+static int
+parse_cpu_list(const char *list, const cpu_set_t *allowed, NodeCpus *node)
+{
+    const char *p = list;
+
+    node->num_cpus = 0;
+    while (*p)
+    {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        long cpu;
+
+        if (end == p)
+            break;
+        p = end;
+        if (*p == '-')
+        {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (cpu = first; cpu <= last && cpu < CPU_SETSIZE && node->num_cpus < MEMBW_MAX_THREADS; cpu++)
+        {
+            if (CPU_ISSET(cpu, allowed))
+                node->cpus[node->num_cpus++] = (int)cpu;
+        }
+        if (*p != ',')
+            break;
+        p++;
+    }
+    return node->num_cpus;
+}
+
+/*
+ * Run every kernel MEMBW_REPEATS times on a thread for every CPU, all
+ * threads at once, and keep the best GB/s of each. array_bytes is the
+ * size of each array of all threads together.
+ */
+static bool
+run_stream(const int *cpus, int num_cpus, long long array_bytes, double bandwidth[NUM_STREAM_KERNELS], bool *pinned)
+{
+    StreamRun *run;
+    double best[NUM_STREAM_KERNELS];
+    long long elements = 0;
+    int started;
+    int repeat, kernel, i;
+
+    run = calloc(1, sizeof *run);
+    if (run == NULL)
+    {
+        perror("Not possible to allocate memory for the memory kernels");
+        return false;
+    }
+    pthread_mutex_init(&run->lock, NULL);
+    pthread_cond_init(&run->started, NULL);
+    run->elements = array_bytes / num_cpus / (long long)sizeof(double);
+
+    for (started = 0; started < num_cpus; started++)
+    {
+        int rc;
+
+        run->threads[started].run = run;
+        run->threads[started].cpu = cpus[started];
+        rc = pthread_create(&run->threads[started].thread, NULL, stream_worker, &run->threads[started]);
+        if (rc != 0)
+        {
+            fprintf(stderr, "Failed to start memory kernel thread reason:%s\n", strerror(rc));
+            break;
+        }
+    }
+    pthread_barrier_init(&run->barrier, NULL, started + 1);
+    pthread_mutex_lock(&run->lock);
+    run->go = true;
+    pthread_cond_broadcast(&run->started);
+    pthread_mutex_unlock(&run->lock);
+
+    /* Wait for the arrays, then time every kernel between two barriers */
+    pthread_barrier_wait(&run->barrier);
+    for (kernel = 0; kernel < NUM_STREAM_KERNELS; kernel++)
+        best[kernel] = -1;
+    for (repeat = 0; repeat < MEMBW_REPEATS; repeat++)
+    {
+        for (kernel = 0; kernel < NUM_STREAM_KERNELS; kernel++)
+        {
+            struct timeval start;
+            double seconds;
+
+            pthread_barrier_wait(&run->barrier);
+            gettimeofday(&start, NULL);
+            pthread_barrier_wait(&run->barrier);
+            seconds = bench_elapsed(&start);
+            if (best[kernel] < 0 || seconds < best[kernel])
+                best[kernel] = seconds;
+        }
+    }
+
+    *pinned = true;
+    for (i = 0; i < started; i++)
+    {
+        pthread_join(run->threads[i].thread, NULL);
+        elements += run->threads[i].elements;
+        *pinned &= run->threads[i].pinned;
+    }
+    pthread_barrier_destroy(&run->barrier);
+    pthread_cond_destroy(&run->started);
+    pthread_mutex_destroy(&run->lock);
+    free(run);
+
+    if (elements == 0)
+    {
+        fprintf(stderr, "ERROR: the arrays of the memory kernels could not be allocated\n");
+        return false;
+    }
+    for (kernel = 0; kernel < NUM_STREAM_KERNELS; kernel++)
+        bandwidth[kernel] = best[kernel] > 0 ? kernel_bytes[kernel] * (double)elements / best[kernel] / 1e9 : 0;
+    return true;
+}
+
+static void *
+stream_worker(void *arg)
+{
+    StreamThread *thread = arg;
+    StreamRun *run = thread->run;
+    long long j;
+    int repeat, kernel;
+
+    thread->pinned = pin_thread(thread->cpu);
+    pthread_mutex_lock(&run->lock);
+    while (!run->go)
+        pthread_cond_wait(&run->started, &run->lock);
+    pthread_mutex_unlock(&run->lock);
+
+    /* The pages go to the node of the thread that touches them first */
+    thread->a = malloc(run->elements * sizeof(double));
+    thread->b = malloc(run->elements * sizeof(double));
+    thread->c = malloc(run->elements * sizeof(double));
+    if (thread->a && thread->b && thread->c)
+    {
+        thread->elements = run->elements;
+        for (j = 0; j < thread->elements; j++)
+        {
+            thread->a[j] = 1.0;
+            thread->b[j] = 2.0;
+            thread->c[j] = 0.0;
+        }
+    }
+
+    pthread_barrier_wait(&run->barrier);
+    for (repeat = 0; repeat < MEMBW_REPEATS; repeat++)
+    {
+        for (kernel = 0; kernel < NUM_STREAM_KERNELS; kernel++)
+        {
+            pthread_barrier_wait(&run->barrier);
+            if (thread->elements > 0)
+                run_kernel(thread, kernel);
+            pthread_barrier_wait(&run->barrier);
+        }
+    }
+    free(thread->a);
+    free(thread->b);
+    free(thread->c);
+    return NULL;
+}
+
+/* Chase pointers from a thread on cpu through memory it touched itself */
+static bool
+chase_pointers(int cpu, long long bytes, double *latency, bool *pinned)
+{
+    ChaseThread chase_thread;
+    pthread_t thread;
+    int rc;
+
+    chase_thread.cpu = cpu;
+    chase_thread.bytes = bytes;
+    chase_thread.pinned = false;
+    chase_thread.latency = -1;
+    rc = pthread_create(&thread, NULL, chase_worker, &chase_thread);
+    if (rc != 0)
+    {
+        fprintf(stderr, "Failed to start pointer chase thread reason:%s\n", strerror(rc));
+        return false;
+    }
+    pthread_join(thread, NULL);
+    if (chase_thread.latency < 0)
+    {
+        fprintf(stderr, "WARNING: %lld bytes for the pointer chase could not be allocated\n", bytes);
+        return false;
+    }
+    *latency = chase_thread.latency;
+    *pinned = chase_thread.pinned;
+    return true;
+}
+
+/*
+ * Every cache line points to the next of a single random cycle through
+ * all of them, Sattolo's shuffle, so no prefetcher can guess the next
+ * load and every load waits for the one before.
+ */
+static void *
+chase_worker(void *arg)
+{
+    ChaseThread *thread = arg;
+    long long num_lines = thread->bytes / CACHE_LINE_SIZE;
+    uint64_t random = CHASE_RANDOM_SEED;
+    struct timeval start;
+    char *lines;
+    long long i;
+
+    thread->pinned = pin_thread(thread->cpu);
+    if (num_lines < 2 || (lines = malloc(num_lines * CACHE_LINE_SIZE)) == NULL)
+        return NULL;
+    for (i = 0; i < num_lines; i++)
+        *(uintptr_t *)(lines + i * CACHE_LINE_SIZE) = (uintptr_t)i;
+    for (i = num_lines - 1; i > 0; i--)
+    {
+        long long j = (long long)(bench_random(&random) % (uint64_t)i);
+        uintptr_t *line_i = (uintptr_t *)(lines + i * CACHE_LINE_SIZE);
+        uintptr_t *line_j = (uintptr_t *)(lines + j * CACHE_LINE_SIZE);
+        uintptr_t swap = *line_i;
+
+        *line_i = *line_j;
+        *line_j = swap;
+    }
+    for (i = 0; i < num_lines; i++)
+    {
+        uintptr_t *line = (uintptr_t *)(lines + i * CACHE_LINE_SIZE);
+
+        *line = (uintptr_t)(lines + *line * CACHE_LINE_SIZE);
+    }
+
+    gettimeofday(&start, NULL);
+    chase_sink = chase(lines, MEMBW_CHASE_STEPS);
+    thread->latency = bench_elapsed(&start) / MEMBW_CHASE_STEPS * 1e9;
+    free(lines);
+    return NULL;
+}
+
+static bool
+pin_thread(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+}
+
+BENCH_KERNELS_BEGIN
+
+static void
+run_kernel(StreamThread *thread, STREAM_KERNEL kernel)
+{
+    double *restrict a = thread->a;
+    double *restrict b = thread->b;
+    double *restrict c = thread->c;
+    const double scalar = STREAM_SCALAR;
+    long long n = thread->elements;
+    long long j;
+
+    switch (kernel)
+    {
+    case STREAM_COPY:
+        for (j = 0; j < n; j++)
+            c[j] = a[j];
+        break;
+    case STREAM_SCALE:
+        for (j = 0; j < n; j++)
+            b[j] = scalar * c[j];
+        break;
+    case STREAM_TRIAD:
+        for (j = 0; j < n; j++)
+            a[j] = b[j] + scalar * c[j];
+        break;
+    default:
+        break;
+    }
+}
+
+static uintptr_t
+chase(void *start, long steps)
+{
+    void *p = start;
+    long i;
+
+    for (i = 0; i < steps; i++)
+        p = *(void **)p;
+    return (uintptr_t)p;
+}
+
+BENCH_KERNELS_END
@@ -0,0 +1,426 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_memory_knee.c
+ *		Sizes at which in-memory sorts and hash builds fall out of the
+ *		caches of the host, the steps work_mem and hash_mem_multiplier
+ *		are sized in.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "pg_memory_knee.h"
+#include "pg_bench.h"
+
+/* Same tuples on every run */
+#define KNEE_RANDOM_SEED 0x9E3779B97F4A7C15ULL
+
+/* Partitions this small are sorted by insertion, as the qsort of the server does */
+#define KNEE_INSERTION_SORT 7
+
+/* The abbreviated key keeps the top bits of the key, ties are told apart by the tuple */
+#define KNEE_ABBREV_SHIFT 48
+
+/* A MinimalTuple of a few columns, 64 bytes with its header */
+typedef struct knee_tuple
+{
+    uint32_t len;
+    uint16_t natts;
+    uint16_t infomask;
+    uint64_t header;
+    uint64_t key;
+    unsigned char payload[40];
+} KneeTuple;
+
+/* SortTuple of tuplesort.c */
+typedef struct sort_tuple
+{
+    KneeTuple *tuple;
+    uint64_t datum1;            /* the abbreviated key */
+    bool isnull1;
+    int srctape;
+} SortTuple;
+
+/* HashJoinTuple of hashjoin.h, the tuple follows the header */
+typedef struct hash_tuple
+{
+    struct hash_tuple *next;
+    uint32_t hashvalue;
+    KneeTuple tuple;
+} HashTuple;
+
+static const char *kernel_names[NUM_KNEE_KERNELS] = {"sort", "hash build"};
+
+/* Keeps the compiler from leaving out what the kernels compute */
+static volatile uint64_t kernel_sink;
+
+static double time_sort(void *memory, long long size, long long *num_tuples);
+static double time_hash(void *memory, long long size, long long *num_tuples);
+static void find_knee(MemoryKnee *knee, KNEE_KERNEL kernel);
+static const char *size_text(double bytes, char *buf, size_t len);
+
+bool
+find_memory_knee(long long total_ram, MemoryKnee *knee)
+{
+    long long max_size = KNEE_MAX_SIZE;
+    long long size;
+    struct timeval start;
+    double sort_levels = 0;
+    int kernel;
+
+    memset(knee, 0x00, sizeof *knee);
+    gettimeofday(&start, NULL);
+    if (total_ram > 0 && total_ram * KNEE_MEMORY_PCT / 100 < max_size)
+        max_size = (long long)(total_ram * KNEE_MEMORY_PCT / 100);
+
+    for (size = KNEE_MIN_SIZE; size <= max_size && knee->num_sizes < KNEE_MAX_SIZES; size *= 2)
+    {
+        void *memory = malloc(size);
+        long long num_tuples;
+        double seconds;
+        char buf[32];
+
+        if (memory == NULL)
+        {
+            if (knee->num_sizes == 0)
+            {
+                perror("Not possible to allocate memory for the sort and hash kernels");
+                return false;
+            }
+            fprintf(stderr, "WARNING: %s could not be allocated, the sizes stop at %s\n", size_text(size, buf, sizeof buf),
+                    size_text(knee->sizes[knee->num_sizes - 1], buf, sizeof buf));
+            break;
+        }
+
+        /* A sort of n tuples takes log2(n) comparisons a tuple */
+        seconds = time_sort(memory, size, &num_tuples);
+        if (knee->num_sizes == 0)
+            sort_levels = log2(num_tuples);
+        knee->sizes[knee->num_sizes] = size;
+        knee->tuples[knee->num_sizes] = num_tuples;
+        knee->throughput[KNEE_SORT][knee->num_sizes] = size * sort_levels / log2(num_tuples) / seconds;
+        seconds = time_hash(memory, size, &num_tuples);
+        knee->throughput[KNEE_HASH][knee->num_sizes] = size / seconds;
+        knee->num_sizes++;
+        free(memory);
+    }
+
+    for (kernel = 0; kernel < NUM_KNEE_KERNELS; kernel++)
+        find_knee(knee, kernel);
+    knee->elapsed = bench_elapsed(&start);
+    return true;
+}
+
+void
+print_memory_knee(MemoryKnee *knee)
+{
+    char size[32], knee_size[32], plateau_size[32];
+    int kernel, i;
+
+    if (knee->num_sizes == 0)
+        return;
+    printf("LOG: sorted and hashed in memory at %d sizes from %s to %s in %.3f seconds\n", knee->num_sizes,
+           size_text(knee->sizes[0], knee_size, sizeof knee_size),
+           size_text(knee->sizes[knee->num_sizes - 1], plateau_size, sizeof plateau_size), knee->elapsed);
+    printf("LOG:   %-10s %12s %12s\n", "size", "sort MB/s", "hash MB/s");
+    for (i = 0; i < knee->num_sizes; i++)
+        printf("LOG:   %-10s %12.1f %12.1f\n", size_text(knee->sizes[i], size, sizeof size),
+               knee->throughput[KNEE_SORT][i] / (1024.0 * 1024.0), knee->throughput[KNEE_HASH][i] / (1024.0 * 1024.0));
+    for (kernel = 0; kernel < NUM_KNEE_KERNELS; kernel++)
+    {
+        size_text(knee->sizes[knee->num_sizes - 1], size, sizeof size);
+        if (knee->knee[kernel] == 0)
+        {
+            printf("LOG:   %-22s : no knee up to %s, %.1fx slower there than in the caches\n", kernel_names[kernel],
+                   size, knee->slowdown[kernel]);
+            continue;
+        }
+        size_text(knee->knee[kernel], knee_size, sizeof knee_size);
+        if (knee->plateau[kernel] > 0)
+            printf("LOG:   %-22s : the speed of the caches up to %s, of the memory from %s, %.1fx slower at %s\n",
+                   kernel_names[kernel], knee_size, size_text(knee->plateau[kernel], plateau_size, sizeof plateau_size),
+                   knee->slowdown[kernel], size);
+        else
+            printf("LOG:   %-22s : the speed of the caches up to %s, %.1fx slower at %s\n", kernel_names[kernel],
+                   knee_size, knee->slowdown[kernel], size);
+    }
+}
+
+const char *
+get_knee_kernel_name(KNEE_KERNEL kernel)
+{
+    return kernel >= 0 && kernel < NUM_KNEE_KERNELS ? kernel_names[kernel] : "unknown";
+}
+
+/*
+ * The knee is the last size before the speed a byte drops KNEE_SLOWDOWN
+ * below that of the caches, the plateau the first size after it that a
+ * doubling slows by less than KNEE_FLAT.
+ */
+static void
+find_knee(MemoryKnee *knee, KNEE_KERNEL kernel)
+{
+    double *throughput = knee->throughput[kernel];
+    double cache = 0;
+    int collapse = -1;
+    int i;
+
+    for (i = 0; i < knee->num_sizes && i < KNEE_CACHE_SIZES; i++)
+    {
+        if (throughput[i] > cache)
+            cache = throughput[i];
+    }
+    if (cache <= 0)
+        return;
+    knee->slowdown[kernel] = cache / throughput[knee->num_sizes - 1];
+
+    for (i = 1; i < knee->num_sizes; i++)
+    {
+        if (throughput[i] < cache / KNEE_SLOWDOWN)
+        {
+            collapse = i;
+            break;
+        }
+    }
+    if (collapse < 0)
+        return;
+    knee->knee[kernel] = knee->sizes[collapse - 1];
+    for (i = collapse + 1; i < knee->num_sizes; i++)
+    {
+        if (throughput[i] >= throughput[i - 1] * (1 - KNEE_FLAT))
+        {
+            knee->plateau[kernel] = knee->sizes[i - 1];
+            break;
+        }
+    }
+}
+
+static const char *
+size_text(double bytes, char *buf, size_t len)
+{
+    if (bytes >= 1024.0 * 1024 * 1024)
+        snprintf(buf, len, "%.1fGB", bytes / (1024.0 * 1024 * 1024));
+    else if (bytes >= 1024.0 * 1024)
+        snprintf(buf, len, "%.1fMB", bytes / (1024.0 * 1024));
+    else
+        snprintf(buf, len, "%.0fkB", bytes / 1024.0);
+    return buf;
+}
+
+BENCH_KERNELS_BEGIN
+
+/* comparetup_heap() of a single int8 column with an abbreviated key */
+static inline int
+compare_tuples(const SortTuple *a, const SortTuple *b)
+{
+    if (a->datum1 != b->datum1)
+        return a->datum1 < b->datum1 ? -1 : 1;
+    if (a->tuple->key != b->tuple->key)
+        return a->tuple->key < b->tuple->key ? -1 : 1;
+    return 0;
+}
+
+/* Quicksort with a median of three pivot, the smaller partition recursed into */
+static void
+sort_tuples(SortTuple *tuples, long long n)
+{
+    while (n > KNEE_INSERTION_SORT)
+    {
+        long long middle = n / 2;
+        long long i = -1, j = n;
+        SortTuple pivot, swap;
+
+        if (compare_tuples(&tuples[middle], &tuples[0]) < 0)
+        {
+            swap = tuples[0];
+            tuples[0] = tuples[middle];
+            tuples[middle] = swap;
+        }
+        if (compare_tuples(&tuples[n - 1], &tuples[0]) < 0)
+        {
+            swap = tuples[0];
+            tuples[0] = tuples[n - 1];
+            tuples[n - 1] = swap;
+        }
+        if (compare_tuples(&tuples[n - 1], &tuples[middle]) < 0)
+        {
+            swap = tuples[middle];
+            tuples[middle] = tuples[n - 1];
+            tuples[n - 1] = swap;
+        }
+        pivot = tuples[middle];
+        for (;;)
+        {
+            do
+                i++;
+            while (compare_tuples(&tuples[i], &pivot) < 0);
+            do
+                j--;
+            while (compare_tuples(&tuples[j], &pivot) > 0);
+            if (i >= j)
+                break;
+            swap = tuples[i];
+            tuples[i] = tuples[j];
+            tuples[j] = swap;
+        }
+        if (j + 1 < n - j - 1)
+        {
+            sort_tuples(tuples, j + 1);
+            tuples += j + 1;
+            n -= j + 1;
+        }
+        else
+        {
+            sort_tuples(tuples + j + 1, n - j - 1);
+            n = j + 1;
+        }
+    }
+    for (long long i = 1; i < n; i++)
+    {
+        SortTuple tuple = tuples[i];
+        long long j = i;
+
+        for (; j > 0 && compare_tuples(&tuple, &tuples[j - 1]) < 0; j--)
+            tuples[j] = tuples[j - 1];
+        tuples[j] = tuple;
+    }
+}
+
+/*
+ * Seconds to sort the SortTuple array and the tuples that fill size
+ * bytes, the tuples drawn again before every round.
+ */
+static double
+time_sort(void *memory, long long size, long long *num_tuples)
+{
+    long long n = size / (sizeof(SortTuple) + sizeof(KneeTuple));
+    SortTuple *sort_tuples_array = memory;
+    KneeTuple *tuples = (KneeTuple *)(sort_tuples_array + n);
+    uint64_t random = KNEE_RANDOM_SEED;
+    double seconds = 0;
+    int rounds = 0;
+
+    *num_tuples = n;
+    do
+    {
+        struct timeval start;
+        long long i;
+
+        for (i = 0; i < n; i++)
+        {
+            tuples[i].len = sizeof(KneeTuple);
+            tuples[i].natts = 2;
+            tuples[i].key = bench_random(&random);
+            sort_tuples_array[i].tuple = &tuples[i];
+            sort_tuples_array[i].datum1 = tuples[i].key >> KNEE_ABBREV_SHIFT;
+            sort_tuples_array[i].isnull1 = false;
+        }
+        gettimeofday(&start, NULL);
+        sort_tuples(sort_tuples_array, n);
+        seconds += bench_elapsed(&start);
+        rounds++;
+    } while (seconds < KNEE_MIN_SECONDS);
+    kernel_sink = sort_tuples_array[n / 2].datum1;
+    return seconds / rounds;
+}
+
+/* murmur3 finalizer, as hash_uint32() of the server spreads the keys over the buckets */
+static inline uint32_t
+hash_key(uint64_t key)
+{
+    uint32_t h = (uint32_t)(key ^ (key >> 32));
+
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+/*
+ * Seconds to build a hash join table of the tuples that fill size bytes
+ * with its buckets, a bucket for every one or two tuples, and to probe it
+ * with every key once.
+ */
+static double
+time_hash(void *memory, long long size, long long *num_tuples)
+{
+    long long num_buckets = 1;
+    HashTuple **buckets = memory;
+    HashTuple *tuples;
+    double seconds = 0;
+    int rounds = 0;
+    long long n, i;
+
+    while (num_buckets * 2 <= size / (long long)(sizeof(HashTuple) + sizeof(HashTuple *)))
+        num_buckets *= 2;
+    n = (size - num_buckets * (long long)sizeof(HashTuple *)) / (long long)sizeof(HashTuple);
+    tuples = (HashTuple *)(buckets + num_buckets);
+    *num_tuples = n;
+
+    {
+        uint64_t random = KNEE_RANDOM_SEED;
+
+        for (i = 0; i < n; i++)
+        {
+            tuples[i].tuple.len = sizeof(KneeTuple);
+            tuples[i].tuple.natts = 2;
+            tuples[i].tuple.key = bench_random(&random);
+        }
+    }
+    do
+    {
+        uint64_t random = KNEE_RANDOM_SEED;
+        uint64_t matches = 0;
+        struct timeval start;
+
+        gettimeofday(&start, NULL);
+        memset(buckets, 0x00, num_buckets * sizeof *buckets);
+        for (i = 0; i < n; i++)
+        {
+            HashTuple *tuple = &tuples[i];
+            long long bucket;
+
+            tuple->hashvalue = hash_key(tuple->tuple.key);
+            bucket = tuple->hashvalue & (num_buckets - 1);
+            tuple->next = buckets[bucket];
+            buckets[bucket] = tuple;
+        }
+        for (i = 0; i < n; i++)
+        {
+            uint64_t key = bench_random(&random);
+            uint32_t hashvalue = hash_key(key);
+            HashTuple *tuple;
+
+            for (tuple = buckets[hashvalue & (num_buckets - 1)]; tuple; tuple = tuple->next)
+            {
+                if (tuple->hashvalue == hashvalue && tuple->tuple.key == key)
+                {
+                    matches++;
+                    break;
+                }
+            }
+        }
+        seconds += bench_elapsed(&start);
+        rounds++;
+        kernel_sink = matches;
+    } while (seconds < KNEE_MIN_SECONDS);
+    return seconds / rounds;
+}
+
+BENCH_KERNELS_END
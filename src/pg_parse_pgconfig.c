@@ -45,10 +45,9 @@
 #define NUM_UNIT_TB (NUM_UNIT_GB * NUM_UNIT_KB)
 #define NUM_UNIT_PB (NUM_UNIT_TB * NUM_UNIT_KB)
 
-static bool PGConfig_parse_line(PGConfig *config, PGConfigKeyVal **curr_param, char *line);
+static bool PGConfig_parse_line(PGConfig *config, PGConfigKeyVal **curr_param, char *line, ssize_t line_nu);
 static void PGConfigKeyVal_free(PGConfigKeyVal *param);
 
-ssize_t line_nu = 0;
 
 PGConfig *
 PGConfig_parse(char *path)
@@ -68,10 +67,11 @@ PGConfig_parse(char *path)
     if (config == NULL)
     {
         perror("Not possible to allocate memory for the Parameters");
+        fclose(fp);
         return NULL;
     }
-
     size_t len = 0;
+    ssize_t line_nu = 0;
     ssize_t read;
     char *line = NULL;
 
@@ -79,7 +79,7 @@ PGConfig_parse(char *path)
     while ((read = getline(&line, &len, fp)) != -1)
     {
         line_nu++;
-        if (PGConfig_parse_line(config, &curr_param, line) == false)
+        if (PGConfig_parse_line(config, &curr_param, line, line_nu) == false)
             fprintf(stderr, "Error at line %ld: %s\n", line_nu, line);
     }
 
@@ -94,7 +94,7 @@ PGConfig_parse(char *path)
 }
 
 static bool
-PGConfig_parse_line(PGConfig *config, PGConfigKeyVal **curr_param, char *line)
+PGConfig_parse_line(PGConfig *config, PGConfigKeyVal **curr_param, char *line, ssize_t line_nu)
 {
     //
     PGConfigKeyVal *param = NULL;
@@ -155,7 +155,7 @@ PGConfig_parse_line(PGConfig *config, PGConfigKeyVal **curr_param, char *line)
                     is_reading = false;
                     line++;
 
-                    param->key = calloc(strlen(char_val), sizeof(char));
+                    param->key = calloc(strlen(char_val) + 1, sizeof(char));
                     if (param->key == NULL)
                     {
                         perror("Not possible to allocate memory for the Parameters");
@@ -296,7 +296,7 @@ PGConfig_parse_line(PGConfig *config, PGConfigKeyVal **curr_param, char *line)
 
     if (phase >= 3)
     {
-        param->value = calloc(strlen(char_val), sizeof(char));
+        param->value = calloc(strlen(char_val) + 1, sizeof(char));
         if (param->value == NULL)
         {
             perror("Not possible to allocate memory for the Parameters");
@@ -353,13 +353,14 @@ void PGConfig_destroy(PGConfig *config)
     if (config != NULL)
     {
         PGConfigKeyVal *next_param;
-        while ((next_param = config->list->next) != NULL)
+        while (config->list && (next_param = config->list->next) != NULL)
         {
             config->list->next = next_param->next;
             PGConfigKeyVal_free(next_param);
         }
 
-        PGConfigKeyVal_free(config->list);
+        if (config->list)
+            PGConfigKeyVal_free(config->list);
         free(config);
     }
 }
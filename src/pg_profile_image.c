@@ -0,0 +1,441 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_profile_image.c
+ *		Compile a tuning profile into a binary image and load it back.
+ *
+ * The image is a flat, versioned file that is mmap'ed at load time, so
+ * loading a profile needs neither json parsing nor the per key lookups of
+ * the json loader. Resources and formulas are stored as resolved enums and
+ * the workload factors are stored pre-parsed.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pg_config_map.h"
+#include "pg_profile_image.h"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* Interned string table used while compiling */
+typedef struct string_table
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+    uint32_t *slots;            /* open addressing, offset + 1, 0 is empty */
+    size_t num_slots;
+    size_t num_strings;
+    bool failed;                /* a string could not be interned */
+} StringTable;
+
+static uint32_t intern_string(StringTable *table, const char *str);
+static bool grow_string_slots(StringTable *table);
+static uint64_t fnv1a_hash(const void *data, size_t len, uint64_t hash);
+static char *image_string(const char *strings, uint64_t strings_size, uint32_t offset);
+
+bool
+is_profile_image(const char *file_path)
+{
+    char magic[PROFILE_IMAGE_MAGIC_LEN];
+    FILE *fp;
+    size_t len;
+
+    fp = fopen(file_path, "rb");
+    if (fp == NULL)
+        return false;
+    len = fread(magic, 1, PROFILE_IMAGE_MAGIC_LEN, fp);
+    fclose(fp);
+
+    return len == PROFILE_IMAGE_MAGIC_LEN && memcmp(magic, PROFILE_IMAGE_MAGIC, PROFILE_IMAGE_MAGIC_LEN) == 0;
+}
+
+int
+compile_profile_image(PGConfigMap *config, PGMapProfileDetails *profile, const char *output_path)
+{
+    StringTable strings;
+    ProfileImageHeader header;
+    ProfileImageEntry *entries;
+    PGConfigMapEntry *map_entry;
+    char tmp_path[MAX_LINE];
+    uint64_t checksum;
+    FILE *fp;
+    int i, w;
+
+    if (!config || config->num_entries <= 0)
+    {
+        fprintf(stderr, "Nothing to compile, config map is empty\n");
+        return -1;
+    }
+
+    memset(&strings, 0x00, sizeof strings);
+    memset(&header, 0x00, sizeof header);
+    entries = calloc(config->num_entries, sizeof *entries);
+    if (entries == NULL)
+    {
+        perror("Not possible to allocate memory for the profile image");
+        return -1;
+    }
+
+    i = 0;
+    for (map_entry = config->list; map_entry && i < config->num_entries; map_entry = map_entry->next, i++)
+    {
+        ProfileImageEntry *image_entry = &entries[i];
+
+        image_entry->param = intern_string(&strings, map_entry->param);
+        image_entry->resource = map_entry->resource;
+        image_entry->formula = map_entry->formula;
+        image_entry->type = map_entry->type;
+        image_entry->blend = map_entry->blend;
+        image_entry->trigger_value = map_entry->trigger_value;
+        image_entry->bounds = (map_entry->has_min ? PROFILE_IMAGE_HAS_MIN : 0) |
+            (map_entry->has_max ? PROFILE_IMAGE_HAS_MAX : 0);
+        image_entry->min_value = map_entry->min_value;
+        image_entry->max_value = map_entry->max_value;
+        for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+        {
+            char *value = map_entry->workload_values[w];
+
+            image_entry->value[w] = intern_string(&strings, value);
+            image_entry->factor[w] = value ? strtod(value, NULL) : 0;
+        }
+    }
+
+    memcpy(header.magic, PROFILE_IMAGE_MAGIC, PROFILE_IMAGE_MAGIC_LEN);
+    header.version = PROFILE_IMAGE_VERSION;
+    header.byte_order = PROFILE_IMAGE_BYTE_ORDER;
+    header.header_size = sizeof header;
+    header.entry_size = sizeof(ProfileImageEntry);
+    header.num_entries = i;
+    header.num_workloads = NUM_WORKLOAD_FACTORS;
+    header.entries_offset = sizeof header;
+    header.strings_offset = header.entries_offset + (uint64_t)i * sizeof(ProfileImageEntry);
+    header.min_memory = profile->min_memory;
+    header.min_cpu = profile->min_cpu;
+    header.max_memory = profile->max_memory;
+    header.max_cpu = profile->max_cpu;
+    header.name = intern_string(&strings, profile->name);
+    header.author = intern_string(&strings, profile->author);
+    header.description = intern_string(&strings, profile->description);
+    header.version_info = intern_string(&strings, profile->version);
+    header.date_created = intern_string(&strings, profile->date_created);
+    header.engine = intern_string(&strings, profile->engine);
+    if (strings.failed)
+        goto ERROR_EXIT;
+    header.strings_size = strings.size;
+    header.image_size = header.strings_offset + strings.size;
+
+    checksum = fnv1a_hash(entries, (size_t)i * sizeof(ProfileImageEntry), FNV_OFFSET_BASIS);
+    header.checksum = fnv1a_hash(strings.data, strings.size, checksum);
+
+    /* Write to a temporary file first so readers never see a partial image */
+    snprintf(tmp_path, sizeof tmp_path, "%s.tmp", output_path);
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to create profile image %s reason:%s\n", tmp_path, strerror(errno));
+        goto ERROR_EXIT;
+    }
+    if (fwrite(&header, sizeof header, 1, fp) != 1 ||
+        fwrite(entries, sizeof(ProfileImageEntry), i, fp) != (size_t)i ||
+        (strings.size > 0 && fwrite(strings.data, 1, strings.size, fp) != strings.size))
+    {
+        fprintf(stderr, "Failed to write profile image %s reason:%s\n", tmp_path, strerror(errno));
+        fclose(fp);
+        unlink(tmp_path);
+        goto ERROR_EXIT;
+    }
+    if (fclose(fp) != 0 || rename(tmp_path, output_path) != 0)
+    {
+        fprintf(stderr, "Failed to write profile image %s reason:%s\n", output_path, strerror(errno));
+        unlink(tmp_path);
+        goto ERROR_EXIT;
+    }
+
+    config_map_log(config, PGAT_LOG_INFO, "compiled %d entries into profile image \"%s\" (%llu bytes, %zu strings)",
+                   i, output_path, (unsigned long long)header.image_size, strings.num_strings);
+    free(entries);
+    free(strings.data);
+    free(strings.slots);
+    return i;
+
+ERROR_EXIT:
+    free(entries);
+    free(strings.data);
+    free(strings.slots);
+    return -1;
+}
+
+int
+load_profile_image(PGConfigMap *config, PGMapProfileDetails *profile, SystemInfo *system_info, const char *file_path)
+{
+    const ProfileImageHeader *header;
+    const ProfileImageEntry *image_entries;
+    const char *strings;
+    PGConfigMapEntry *entries;
+    struct stat st;
+    void *image;
+    int fd;
+    uint32_t i;
+    int w;
+
+    config->list = NULL;
+    config->num_entries = 0;
+    config->arena = NULL;
+    config->image = NULL;
+    config->image_size = 0;
+
+    if (system_info->workload_type < 0 || system_info->workload_type >= NUM_WORKLOAD_FACTORS)
+    {
+        fprintf(stderr, "Invalid workload type for profile image %s\n", file_path);
+        return -1;
+    }
+
+    fd = open(file_path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to read file %s reason:%s\n", file_path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ProfileImageHeader))
+    {
+        fprintf(stderr, "Invalid profile image %s, file is too small\n", file_path);
+        close(fd);
+        return -1;
+    }
+    image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map profile image %s reason:%s\n", file_path, strerror(errno));
+        return -1;
+    }
+
+    header = image;
+    if (memcmp(header->magic, PROFILE_IMAGE_MAGIC, PROFILE_IMAGE_MAGIC_LEN) != 0 ||
+        header->byte_order != PROFILE_IMAGE_BYTE_ORDER)
+    {
+        fprintf(stderr, "Invalid profile image %s, bad magic or byte order\n", file_path);
+        goto ERROR_EXIT;
+    }
+    if (header->version != PROFILE_IMAGE_VERSION ||
+        header->header_size != sizeof(ProfileImageHeader) ||
+        header->entry_size != sizeof(ProfileImageEntry) ||
+        header->num_workloads != NUM_WORKLOAD_FACTORS)
+    {
+        fprintf(stderr, "Incompatible profile image %s (version %u), recompile the profile\n",
+                file_path, header->version);
+        goto ERROR_EXIT;
+    }
+    if (header->image_size != (uint64_t)st.st_size ||
+        header->entries_offset != sizeof(ProfileImageHeader) ||
+        header->strings_offset != header->entries_offset + (uint64_t)header->num_entries * sizeof(ProfileImageEntry) ||
+        header->strings_offset + header->strings_size != header->image_size ||
+        (header->strings_size > 0 && ((const char *)image)[header->image_size - 1] != '\0'))
+    {
+        fprintf(stderr, "Invalid profile image %s, file is truncated or corrupted\n", file_path);
+        goto ERROR_EXIT;
+    }
+    if (fnv1a_hash((const char *)image + header->entries_offset,
+                   header->image_size - header->entries_offset, FNV_OFFSET_BASIS) != header->checksum)
+    {
+        fprintf(stderr, "Invalid profile image %s, checksum mismatch\n", file_path);
+        goto ERROR_EXIT;
+    }
+
+    image_entries = (const ProfileImageEntry *)((const char *)image + header->entries_offset);
+    strings = (const char *)image + header->strings_offset;
+
+    config->arena = pg_arena_create((size_t)header->num_entries * sizeof *entries);
+    entries = config->arena ? pg_arena_calloc(config->arena, ((size_t)header->num_entries + 1) * sizeof *entries) : NULL;
+    if (entries == NULL)
+    {
+        perror("Not possible to allocate memory for the Parameters");
+        goto ERROR_EXIT;
+    }
+
+    for (i = 0; i < header->num_entries; i++)
+    {
+        const ProfileImageEntry *image_entry = &image_entries[i];
+        PGConfigMapEntry *entry = &entries[i];
+
+        entry->param = image_string(strings, header->strings_size, image_entry->param);
+        if (entry->param == NULL ||
+            image_entry->resource >= INVALID_RESOURCE || image_entry->formula >= INVALID_FORMULA ||
+            image_entry->blend >= INVALID_BLEND)
+        {
+            fprintf(stderr, "Invalid profile image %s, entry %u is corrupted\n", file_path, i);
+            goto ERROR_EXIT;
+        }
+        entry->resource = image_entry->resource;
+        entry->formula = image_entry->formula;
+        entry->type = image_entry->type;
+        entry->blend = image_entry->blend;
+        entry->trigger_value = image_entry->trigger_value;
+        entry->has_min = (image_entry->bounds & PROFILE_IMAGE_HAS_MIN) != 0;
+        entry->has_max = (image_entry->bounds & PROFILE_IMAGE_HAS_MAX) != 0;
+        entry->min_value = image_entry->min_value;
+        entry->max_value = image_entry->max_value;
+        for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+            entry->workload_values[w] = image_string(strings, header->strings_size, image_entry->value[w]);
+        entry->value = entry->workload_values[system_info->workload_type];
+        entry->factor_value = image_entry->factor[system_info->workload_type];
+        entry->status = ENTRY_LOADED;
+        entry->next = (i + 1 < header->num_entries) ? &entries[i + 1] : NULL;
+    }
+
+    profile->min_memory = header->min_memory;
+    profile->min_cpu = header->min_cpu;
+    profile->max_memory = header->max_memory;
+    profile->max_cpu = header->max_cpu;
+    profile->name = image_string(strings, header->strings_size, header->name);
+    profile->author = image_string(strings, header->strings_size, header->author);
+    profile->description = image_string(strings, header->strings_size, header->description);
+    profile->version = image_string(strings, header->strings_size, header->version_info);
+    profile->date_created = image_string(strings, header->strings_size, header->date_created);
+    profile->engine = image_string(strings, header->strings_size, header->engine);
+
+    config->image = image;
+    config->image_size = st.st_size;
+    config->list = header->num_entries ? entries : NULL;
+    config->num_entries = header->num_entries;
+
+    config_map_log(config, PGAT_LOG_DEBUG, "Loaded %d entries from profile image %s", config->num_entries, file_path);
+    return config->num_entries;
+
+ERROR_EXIT:
+    pg_arena_destroy(config->arena);
+    config->arena = NULL;
+    munmap(image, st.st_size);
+    return -1;
+}
+
+static char *
+image_string(const char *strings, uint64_t strings_size, uint32_t offset)
+{
+    if (offset == PROFILE_IMAGE_NO_STRING || offset >= strings_size)
+        return NULL;
+    /* The image is mapped read-only, callers must not modify the strings */
+    return (char *)strings + offset;
+}
+
+static uint32_t
+intern_string(StringTable *table, const char *str)
+{
+    size_t len;
+    size_t slot;
+    uint32_t offset;
+
+    if (str == NULL || table->failed)
+        return PROFILE_IMAGE_NO_STRING;
+
+    if (table->num_strings * 2 >= table->num_slots && !grow_string_slots(table))
+    {
+        table->failed = true;
+        return PROFILE_IMAGE_NO_STRING;
+    }
+
+    len = strlen(str);
+    slot = fnv1a_hash(str, len, FNV_OFFSET_BASIS) & (table->num_slots - 1);
+    while (table->slots[slot] != 0)
+    {
+        offset = table->slots[slot] - 1;
+        if (strcmp(table->data + offset, str) == 0)
+            return offset;
+        slot = (slot + 1) & (table->num_slots - 1);
+    }
+
+    /* Offsets are 32 bits, PROFILE_IMAGE_NO_STRING included */
+    if (table->size + len + 1 >= PROFILE_IMAGE_NO_STRING)
+    {
+        fprintf(stderr, "ERROR: the strings of the profile do not fit in a profile image\n");
+        table->failed = true;
+        return PROFILE_IMAGE_NO_STRING;
+    }
+    if (table->size + len + 1 > table->capacity)
+    {
+        size_t capacity = table->capacity ? table->capacity : 1024;
+        char *data;
+
+        while (table->size + len + 1 > capacity)
+            capacity *= 2;
+        data = realloc(table->data, capacity);
+        if (data == NULL)
+        {
+            perror("Not possible to allocate memory for the profile image");
+            table->failed = true;
+            return PROFILE_IMAGE_NO_STRING;
+        }
+        table->data = data;
+        table->capacity = capacity;
+    }
+    offset = table->size;
+    memcpy(table->data + offset, str, len + 1);
+    table->size += len + 1;
+    table->slots[slot] = offset + 1;
+    table->num_strings++;
+    return offset;
+}
+
+static bool
+grow_string_slots(StringTable *table)
+{
+    size_t num_slots = table->num_slots ? table->num_slots * 2 : 64;
+    uint32_t *slots;
+    size_t i;
+
+    slots = calloc(num_slots, sizeof *slots);
+    if (slots == NULL)
+    {
+        perror("Not possible to allocate memory for the profile image");
+        return false;
+    }
+    for (i = 0; i < table->num_slots; i++)
+    {
+        uint32_t offset;
+        size_t slot;
+
+        if (table->slots[i] == 0)
+            continue;
+        offset = table->slots[i] - 1;
+        slot = fnv1a_hash(table->data + offset, strlen(table->data + offset), FNV_OFFSET_BASIS) & (num_slots - 1);
+        while (slots[slot] != 0)
+            slot = (slot + 1) & (num_slots - 1);
+        slots[slot] = table->slots[i];
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->num_slots = num_slots;
+    return true;
+}
+
+static uint64_t
+fnv1a_hash(const void *data, size_t len, uint64_t hash)
+{
+    const unsigned char *ptr = data;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        hash ^= ptr[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
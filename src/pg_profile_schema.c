@@ -0,0 +1,446 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_profile_schema.c
+ *		Validate json tuning profiles before anything is tuned with them.
+ *
+ * A profile that loads with a wrong type, a typo in a key or a factor out
+ * of range silently produces a bad postgresql.conf, so every problem is
+ * reported with its position in the file and loading is refused.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+
+#include "pg_config_map.h"
+#include "pg_profile_schema.h"
+
+typedef enum PROFILE_VALUE_TYPE
+{
+    PVAL_STRING,                /* any string */
+    PVAL_NAME,                  /* non empty string */
+    PVAL_SIZE,                  /* non negative integer */
+    PVAL_NUMBER,                /* integer or double */
+    PVAL_BOOLEAN,
+    PVAL_FACTOR,                /* number or string */
+    PVAL_RESOURCE,              /* one of the known resources */
+    PVAL_FORMULA,               /* one of the known formulas */
+    PVAL_BLEND,                 /* one of the known blend modes */
+    PVAL_CONFIG_MAP             /* array of map entries */
+} PROFILE_VALUE_TYPE;
+
+typedef struct profile_key
+{
+    const char *name;
+    PROFILE_VALUE_TYPE type;
+} ProfileKey;
+
+/* A parameter of the map, the position of its entry and its first definition */
+typedef struct map_param
+{
+    json_cursor param;
+    json_cursor first;          /* no tape unless the parameter was given before */
+    unsigned int index;
+} MapParam;
+
+static const ProfileKey profile_keys[] = {
+    {NAME_KEY, PVAL_STRING},
+    {VERSION_KEY, PVAL_STRING},
+    {DATE_CREATED_KEY, PVAL_STRING},
+    {ENGINE_KEY, PVAL_STRING},
+    {AUTHOR_KEY, PVAL_STRING},
+    {DESCRIPTION_KEY, PVAL_STRING},
+    {MIN_MEMORY_KEY, PVAL_SIZE},
+    {MIN_CPU_KEY, PVAL_SIZE},
+    {MAX_MEMORY_KEY, PVAL_SIZE},
+    {MAX_CPU_KEY, PVAL_SIZE},
+    {EXTENDS_KEY, PVAL_NAME},
+    {CONFIG_MAP_KEY, PVAL_CONFIG_MAP},
+    {NULL, 0}
+};
+
+static const ProfileKey entry_keys[] = {
+    {PARAMETER_KEY, PVAL_NAME},
+    {RESOURCE_KEY, PVAL_RESOURCE},
+    {FORMULA_KEY, PVAL_FORMULA},
+    {OLAP_FACTOR_KEY, PVAL_FACTOR},
+    {OLTP_FACTOR_KEY, PVAL_FACTOR},
+    {MIXED_FACTOR_KEY, PVAL_FACTOR},
+    {TRIGGER_KEY, PVAL_NUMBER},
+    {BLEND_KEY, PVAL_BLEND},
+    {REMOVE_KEY, PVAL_BOOLEAN},
+    {MIN_KEY, PVAL_FACTOR},
+    {MAX_KEY, PVAL_FACTOR},
+    {NULL, 0}
+};
+
+static int validate_object(const json_cursor *object, const ProfileKey *keys, const char *file_path);
+static int validate_value(const json_cursor *value, const char *key, PROFILE_VALUE_TYPE type, const char *file_path);
+static int validate_config_map(const json_cursor *map_value, const char *file_path);
+static int compare_map_params(const void *a, const void *b);
+static int compare_map_entries(const void *a, const void *b);
+static const char *json_type_name(json_type type);
+
+void
+profile_error(const char *file_path, const json_cursor *value, const char *fmt, ...)
+{
+    va_list args;
+    unsigned int line, col;
+
+    if (value && json_cursor_position(value, &line, &col))
+        fprintf(stderr, "ERROR: %s:%u:%u: ", file_path, line, col);
+    else
+        fprintf(stderr, "ERROR: %s: ", file_path);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+int
+validate_profile_document(const json_cursor *root, const char *file_path)
+{
+    json_cursor value;
+    int errors;
+
+    if (root == NULL || json_cursor_type(root) != json_object)
+    {
+        profile_error(file_path, root, "profile must be a json object");
+        return 1;
+    }
+    errors = validate_object(root, profile_keys, file_path);
+
+    /* The base of a chain has to bring the entries, overlays only change them */
+    if (!json_cursor_get(root, EXTENDS_KEY, &value) &&
+        !json_cursor_get(root, CONFIG_MAP_KEY, &value))
+    {
+        profile_error(file_path, root, "required key \"%s\" is missing", CONFIG_MAP_KEY);
+        errors++;
+    }
+    return errors;
+}
+
+bool
+formula_accepts_resource(FORMULAS formula, RESOURCES resource)
+{
+    switch (formula)
+    {
+    case PERCENTAGE:
+        return resource == RESOURCE_MEMORY || resource == RESOURCE_CPU || resource == RESOURCE_MRC ||
+            resource == RESOURCE_MEMBW || is_data_resource(resource);
+    case CUSTOM:
+        return resource == RESOURCE_CUSTOM;
+    case CALIBRATED:
+        return resource == RESOURCE_DISK;
+    default:
+        return false;
+    }
+}
+
+bool
+get_factor_number(const json_cursor *value, double *number)
+{
+    const char *text;
+    char *end;
+
+    if (value == NULL)
+        return false;
+    if (json_cursor_number(value, number))
+        return true;
+    text = json_cursor_string(value);
+    if (text == NULL || *text == '\0')
+        return false;
+    *number = strtod(text, &end);
+    while (*end == ' ')
+        end++;
+    return *end == '\0';
+}
+
+bool
+get_bound_number(const json_cursor *value, double *number)
+{
+    const char *text;
+    long long size;
+
+    if (get_factor_number(value, number))
+        return true;
+    text = json_cursor_string(value);
+    if (text == NULL || !parse_size_text(text, &size))
+        return false;
+    *number = (double)size;
+    return true;
+}
+
+/*
+ * Check every member of an object against the known keys. Keys are matched
+ * without regard to case, like json_get_value_for_key() does, which also
+ * means a key given twice would silently shadow the second definition.
+ */
+static int
+validate_object(const json_cursor *object, const ProfileKey *keys, const char *file_path)
+{
+    json_cursor member;
+    unsigned int length = json_cursor_node(object)->length;
+    unsigned int i, j;
+    int errors = 0;
+
+    if (!json_cursor_child(object, &member))
+        return 0;
+    for (i = 0; i < length; i++)
+    {
+        const char *name = json_cursor_string(&member);
+        json_cursor earlier;
+        json_cursor value;
+        const ProfileKey *key;
+
+        value = member;
+        json_cursor_next(&value);
+        json_cursor_child(object, &earlier);
+        for (j = 0; j < i; j++)
+        {
+            if (strcasecmp(json_cursor_string(&earlier), name) == 0)
+                break;
+            json_cursor_next(&earlier);
+            json_cursor_next(&earlier);
+        }
+        member = value;
+        json_cursor_next(&member);
+        if (j < i)
+        {
+            unsigned int line = 0, col = 0;
+
+            json_cursor_next(&earlier);
+            json_cursor_position(&earlier, &line, &col);
+            profile_error(file_path, &value, "duplicate key \"%s\", first defined at %u:%u", name, line, col);
+            errors++;
+            continue;
+        }
+
+        for (key = keys; key->name; key++)
+        {
+            if (strcasecmp(key->name, name) == 0)
+                break;
+        }
+        if (key->name == NULL)
+        {
+            profile_error(file_path, &value, "unknown key \"%s\"", name);
+            errors++;
+            continue;
+        }
+        errors += validate_value(&value, key->name, key->type, file_path);
+    }
+    return errors;
+}
+
+static int
+validate_value(const json_cursor *value, const char *key, PROFILE_VALUE_TYPE type, const char *file_path)
+{
+    json_type value_type = json_cursor_type(value);
+    const char *text = json_cursor_string(value);
+
+    switch (type)
+    {
+    case PVAL_STRING:
+        if (value_type == json_string)
+            return 0;
+        profile_error(file_path, value, "\"%s\" must be a string, not %s", key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_NAME:
+        if (text && *text)
+            return 0;
+        profile_error(file_path, value, "\"%s\" must be a non empty string", key);
+        return 1;
+
+    case PVAL_SIZE:
+        if (value_type == json_integer && json_cursor_node(value)->u.integer >= 0)
+            return 0;
+        profile_error(file_path, value, "\"%s\" must be a non negative integer", key);
+        return 1;
+
+    case PVAL_NUMBER:
+        if (value_type == json_integer || value_type == json_double)
+            return 0;
+        profile_error(file_path, value, "\"%s\" must be a number, not %s", key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_BOOLEAN:
+        if (value_type == json_boolean)
+            return 0;
+        profile_error(file_path, value, "\"%s\" must be true or false, not %s", key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_FACTOR:
+        if (value_type == json_integer || value_type == json_double || (text && *text))
+            return 0;
+        profile_error(file_path, value, "\"%s\" must be a number or a non empty string, not %s",
+                      key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_RESOURCE:
+        if (text && identify_resource(text) != INVALID_RESOURCE)
+            return 0;
+        if (value_type == json_string)
+            profile_error(file_path, value, "invalid resource \"%s\"", text);
+        else
+            profile_error(file_path, value, "\"%s\" must be a string, not %s", key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_FORMULA:
+        if (text && identify_formula(text) != INVALID_FORMULA)
+            return 0;
+        if (value_type == json_string)
+            profile_error(file_path, value, "invalid formula \"%s\"", text);
+        else
+            profile_error(file_path, value, "\"%s\" must be a string, not %s", key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_BLEND:
+        if (text && identify_blend_mode(text) != INVALID_BLEND)
+            return 0;
+        if (value_type == json_string)
+            profile_error(file_path, value, "invalid blend \"%s\", must be linear, geometric or max", text);
+        else
+            profile_error(file_path, value, "\"%s\" must be a string, not %s", key, json_type_name(value_type));
+        return 1;
+
+    case PVAL_CONFIG_MAP:
+        if (value_type == json_array)
+            return validate_config_map(value, file_path);
+        profile_error(file_path, value, "\"%s\" must be an array, not %s", key, json_type_name(value_type));
+        return 1;
+    }
+    return 0;
+}
+
+static int
+validate_config_map(const json_cursor *map_value, const char *file_path)
+{
+    unsigned int length = json_cursor_node(map_value)->length;
+    json_cursor map_entry;
+    MapParam *params;
+    unsigned int num_params = 0;
+    unsigned int i;
+    int errors = 0;
+
+    if (!json_cursor_child(map_value, &map_entry))
+        return 0;
+    params = malloc(length * sizeof *params);
+    if (params == NULL)
+    {
+        profile_error(file_path, map_value, "out of memory validating \"%s\"", CONFIG_MAP_KEY);
+        return 1;
+    }
+
+    for (i = 0; i < length; i++, json_cursor_next(&map_entry))
+    {
+        json_cursor param;
+
+        if (json_cursor_type(&map_entry) != json_object)
+        {
+            profile_error(file_path, &map_entry, "\"%s\" entries must be objects, not %s",
+                          CONFIG_MAP_KEY, json_type_name(json_cursor_type(&map_entry)));
+            errors++;
+            continue;
+        }
+        errors += validate_object(&map_entry, entry_keys, file_path);
+
+        if (!json_cursor_get(&map_entry, PARAMETER_KEY, &param))
+        {
+            profile_error(file_path, &map_entry, "required key \"%s\" is missing", PARAMETER_KEY);
+            errors++;
+            continue;
+        }
+        if (json_cursor_type(&param) != json_string)
+            continue;
+        params[num_params].param = param;
+        params[num_params].first.tape = NULL;
+        params[num_params].index = i;
+        num_params++;
+    }
+
+    /*
+     * Overriding a parameter is done by a profile extending this one. Sorted
+     * by name, the entries of a parameter given twice are next to each other
+     * with the first definition ahead, and a large map is not compared pair
+     * by pair. Sorted back, they are reported in the order of the document.
+     */
+    qsort(params, num_params, sizeof *params, compare_map_params);
+    for (i = 1; i < num_params; i++)
+    {
+        if (strcasecmp(json_cursor_string(&params[i].param), json_cursor_string(&params[i - 1].param)) == 0)
+            params[i].first = params[i - 1].first.tape ? params[i - 1].first : params[i - 1].param;
+    }
+    qsort(params, num_params, sizeof *params, compare_map_entries);
+    for (i = 0; i < num_params; i++)
+    {
+        unsigned int line = 0, col = 0;
+
+        if (params[i].first.tape == NULL)
+            continue;
+        json_cursor_position(&params[i].first, &line, &col);
+        profile_error(file_path, &params[i].param, "duplicate parameter \"%s\", first defined at %u:%u",
+                      json_cursor_string(&params[i].param), line, col);
+        errors++;
+    }
+    free(params);
+    return errors;
+}
+
+/* By name without regard to case, then by position */
+static int
+compare_map_params(const void *a, const void *b)
+{
+    const MapParam *pa = a;
+    const MapParam *pb = b;
+    int cmp = strcasecmp(json_cursor_string(&pa->param), json_cursor_string(&pb->param));
+
+    if (cmp != 0)
+        return cmp;
+    return pa->index < pb->index ? -1 : pa->index > pb->index;
+}
+
+/* By position only */
+static int
+compare_map_entries(const void *a, const void *b)
+{
+    const MapParam *pa = a;
+    const MapParam *pb = b;
+
+    return pa->index < pb->index ? -1 : pa->index > pb->index;
+}
+
+static const char *
+json_type_name(json_type type)
+{
+    switch (type)
+    {
+    case json_object:
+        return "an object";
+    case json_array:
+        return "an array";
+    case json_integer:
+    case json_double:
+        return "a number";
+    case json_string:
+        return "a string";
+    case json_boolean:
+        return "a boolean";
+    case json_null:
+        return "null";
+    default:
+        return "nothing";
+    }
+}
@@ -0,0 +1,626 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_simulate.c
+ *		Evaluate a profile over a grid of hypothetical hosts.
+ *
+ * Capacity planning needs to know where a profile stops fitting before the
+ * instances are bought. Every point of the cartesian product of the given
+ * dimensions is tuned like a real host would be, and the resulting
+ * parameters are listed with the worst case memory footprint they add up
+ * to. A point whose footprint exceeds its memory is marked unsafe.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+
+#include "pg_arena.h"
+#include "pg_config_map.h"
+#include "pg_simulate.h"
+
+#define MAX_SIMULATE_ERROR_LEN 512
+
+typedef enum AXIS
+{
+    AXIS_RAM,
+    AXIS_CPUS,
+    AXIS_DISK,
+    AXIS_WORKLOAD,
+    AXIS_NODE,
+    AXIS_HOST,
+    NUM_AXES
+} AXIS;
+
+typedef struct grid_axis
+{
+    const char *key;
+    bool given;                 /* on the command line, so it gets a column */
+    int num_values;
+    long long *values;          /* sizes, counts or enum values */
+} GridAxis;
+
+typedef struct simulate_table
+{
+    int num_columns;            /* set once the header is complete */
+    int num_cells;
+    int capacity;
+    const char **cells;         /* row by row, the first row is the header */
+    bool failed;                /* a cell could not be added */
+} SimulateTable;
+
+static const char *axis_keys[NUM_AXES] = {
+    SIMULATE_RAM_KEY, SIMULATE_CPUS_KEY, SIMULATE_DISK_KEY,
+    SIMULATE_WORKLOAD_KEY, SIMULATE_NODE_KEY, SIMULATE_HOST_KEY
+};
+
+static bool parse_dimension(const char *dimension, GridAxis *axes, PGArena *arena);
+static bool parse_range(const char *spec, AXIS axis_id, GridAxis *axis, PGArena *arena);
+static bool parse_axis_value(AXIS axis, const char *text, long long *value);
+static bool add_axis_value(GridAxis *axis, long long value, PGArena *arena);
+static void set_axis(SystemInfo *system_info, AXIS axis, long long value);
+static const char *axis_value_name(AXIS axis, long long value, SIMULATE_FORMAT format, PGArena *arena);
+static const char *format_bytes(double bytes, PGArena *arena);
+static void add_cell(SimulateTable *table, const char *cell);
+static void write_table(FILE *fp, SimulateTable *table);
+static void write_csv(FILE *fp, SimulateTable *table);
+
+int
+run_simulate(SimulateOptions *options, PGConfigMap *config_map, PGMapProfileDetails *profile)
+{
+    GridAxis axes[NUM_AXES];
+    SimulateTable table;
+    PGArena *grid_arena;
+    PGArena *point_arena;
+    PGConfigMapEntry *entry;
+    int position[NUM_AXES];
+    long long num_points = 1;
+    int flagged = 0;
+    FILE *out = stdout;
+    int i;
+
+    memset(&table, 0x00, sizeof table);
+    grid_arena = pg_arena_create(0);
+    point_arena = pg_arena_create(0);
+    if (grid_arena == NULL || point_arena == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory\n");
+        pg_arena_destroy(grid_arena);
+        pg_arena_destroy(point_arena);
+        return -1;
+    }
+
+    memset(axes, 0x00, sizeof axes);
+    for (i = 0; i < NUM_AXES; i++)
+        axes[i].key = axis_keys[i];
+    for (i = 0; i < options->num_dimensions; i++)
+    {
+        if (!parse_dimension(options->dimensions[i], axes, grid_arena))
+            goto SIMULATE_FAILED;
+    }
+    if (!axes[AXIS_RAM].given || !axes[AXIS_CPUS].given)
+    {
+        fprintf(stderr, "ERROR: a simulation needs at least the \"%s\" and \"%s\" dimensions\n",
+                SIMULATE_RAM_KEY, SIMULATE_CPUS_KEY);
+        goto SIMULATE_FAILED;
+    }
+
+    /* Whatever is not simulated is what the command line says */
+    if ((!axes[AXIS_DISK].given && !add_axis_value(&axes[AXIS_DISK], options->defaults.disk_type, grid_arena)) ||
+        (!axes[AXIS_WORKLOAD].given && !add_axis_value(&axes[AXIS_WORKLOAD], options->defaults.workload_type, grid_arena)) ||
+        (!axes[AXIS_NODE].given && !add_axis_value(&axes[AXIS_NODE], options->defaults.node_type, grid_arena)) ||
+        (!axes[AXIS_HOST].given && !add_axis_value(&axes[AXIS_HOST], options->defaults.host_type, grid_arena)))
+        goto SIMULATE_FAILED;
+    for (i = 0; i < NUM_AXES; i++)
+    {
+        num_points *= axes[i].num_values;
+        if (num_points > MAX_SIMULATE_POINTS)
+        {
+            fprintf(stderr, "ERROR: the grid has more than %d points\n", MAX_SIMULATE_POINTS);
+            goto SIMULATE_FAILED;
+        }
+    }
+
+    /* The header */
+    for (i = 0; i < NUM_AXES; i++)
+    {
+        if (axes[i].given)
+            add_cell(&table, axes[i].key);
+    }
+    for (entry = config_map->list; entry; entry = entry->next)
+        add_cell(&table, entry->param);
+    add_cell(&table, "footprint");
+    add_cell(&table, "footprint_pct");
+    add_cell(&table, "status");
+    table.num_columns = table.num_cells;
+
+    memset(position, 0x00, sizeof position);
+    for (;;)
+    {
+        SystemInfo system_info = options->defaults;
+        PGConfigMap point_map;
+        char error[MAX_SIMULATE_ERROR_LEN];
+        const char *status = "ok";
+        bool evaluated = true;
+        long long footprint = 0;
+
+        /* The axes that are not given already hold the command line values */
+        for (i = 0; i < NUM_AXES; i++)
+        {
+            if (!axes[i].given)
+                continue;
+            set_axis(&system_info, i, axes[i].values[position[i]]);
+            add_cell(&table, axis_value_name(i, axes[i].values[position[i]], options->format, grid_arena));
+        }
+
+        pg_arena_reset(point_arena);
+        if (!clone_config_map(config_map, &point_map, &system_info, point_arena))
+        {
+            fprintf(stderr, "ERROR: out of memory\n");
+            goto SIMULATE_FAILED;
+        }
+        if (!check_profile_bounds(profile, &system_info, error, sizeof error))
+        {
+            status = pg_arena_sprintf(grid_arena, "outside profile bounds: %s", error);
+            evaluated = options->force;
+            flagged++;
+        }
+        if (evaluated)
+        {
+            process_config_map(&point_map, &system_info);
+            footprint = estimate_memory_footprint(&point_map, &system_info);
+            if (footprint > system_info.total_ram && strcmp(status, "ok") == 0)
+            {
+                status = "unsafe";
+                flagged++;
+            }
+        }
+
+        for (entry = point_map.list; entry; entry = entry->next)
+        {
+            char value[MAX_TOKEN_LEN];
+
+            if (entry->status == ENTRY_PROCESSED_SUCCESS)
+            {
+                format_config_map_value(entry, value, sizeof value);
+                add_cell(&table, pg_arena_strdup(grid_arena, value));
+            }
+            else
+                add_cell(&table, evaluated ? "error" : "");
+        }
+        if (!evaluated)
+        {
+            add_cell(&table, "");
+            add_cell(&table, "");
+        }
+        else if (options->format == SIMULATE_CSV)
+        {
+            add_cell(&table, pg_arena_sprintf(grid_arena, "%lld", footprint));
+            add_cell(&table, pg_arena_sprintf(grid_arena, "%.1f", footprint * 100.0 / system_info.total_ram));
+        }
+        else
+        {
+            add_cell(&table, format_bytes(footprint, grid_arena));
+            add_cell(&table, pg_arena_sprintf(grid_arena, "%.1f%%", footprint * 100.0 / system_info.total_ram));
+        }
+        add_cell(&table, status);
+        if (table.failed)
+        {
+            fprintf(stderr, "ERROR: out of memory\n");
+            goto SIMULATE_FAILED;
+        }
+
+        /* Next point, the last dimension changes fastest */
+        for (i = NUM_AXES - 1; i >= 0; i--)
+        {
+            if (++position[i] < axes[i].num_values)
+                break;
+            position[i] = 0;
+        }
+        if (i < 0)
+            break;
+    }
+
+    if (options->output_path)
+    {
+        out = fopen(options->output_path, "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Failed to create simulation output %s reason:%s\n", options->output_path, strerror(errno));
+            goto SIMULATE_FAILED;
+        }
+    }
+    if (options->format == SIMULATE_CSV)
+        write_csv(out, &table);
+    else
+        write_table(out, &table);
+    if (out != stdout && fclose(out) != 0)
+    {
+        fprintf(stderr, "Failed to write simulation output %s reason:%s\n", options->output_path, strerror(errno));
+        goto SIMULATE_FAILED;
+    }
+    if (options->output_path)
+        printf("LOG: simulated %lld hosts, %d unsafe or outside the profile bounds, output written to \"%s\"\n",
+               num_points, flagged, options->output_path);
+
+    free(table.cells);
+    pg_arena_destroy(point_arena);
+    pg_arena_destroy(grid_arena);
+    return flagged;
+
+SIMULATE_FAILED:
+    free(table.cells);
+    pg_arena_destroy(point_arena);
+    pg_arena_destroy(grid_arena);
+    return -1;
+}
+
+/* key=value[,value...] or key=first..last[:xFACTOR|:+STEP] */
+static bool
+parse_dimension(const char *dimension, GridAxis *axes, PGArena *arena)
+{
+    const char *equal = strchr(dimension, '=');
+    char *values;
+    char *value;
+    char *saveptr;
+    int axis;
+
+    if (equal == NULL || equal == dimension || equal[1] == '\0')
+    {
+        fprintf(stderr, "ERROR: invalid simulation dimension \"%s\", expected KEY=VALUES\n", dimension);
+        return false;
+    }
+    for (axis = 0; axis < NUM_AXES; axis++)
+    {
+        if (strlen(axis_keys[axis]) == (size_t)(equal - dimension) &&
+            strncasecmp(axis_keys[axis], dimension, equal - dimension) == 0)
+            break;
+    }
+    if (axis == NUM_AXES)
+    {
+        fprintf(stderr, "ERROR: unknown simulation dimension \"%.*s\", must be one of ram, cpus, disk, workload, node or host\n",
+                (int)(equal - dimension), dimension);
+        return false;
+    }
+    if (axes[axis].given)
+    {
+        fprintf(stderr, "ERROR: simulation dimension \"%s\" is given twice\n", axis_keys[axis]);
+        return false;
+    }
+    axes[axis].given = true;
+
+    if (strstr(equal + 1, ".."))
+    {
+        if (axis != AXIS_RAM && axis != AXIS_CPUS)
+        {
+            fprintf(stderr, "ERROR: \"%s\" can not be a range, list its values instead\n", axis_keys[axis]);
+            return false;
+        }
+        return parse_range(equal + 1, axis, &axes[axis], arena);
+    }
+
+    values = pg_arena_strdup(arena, equal + 1);
+    if (values == NULL)
+        return false;
+    for (value = strtok_r(values, ",", &saveptr); value; value = strtok_r(NULL, ",", &saveptr))
+    {
+        long long number;
+
+        if (!parse_axis_value(axis, value, &number))
+        {
+            fprintf(stderr, "ERROR: invalid %s \"%s\" in simulation dimension \"%s\"\n", axis_keys[axis], value, dimension);
+            return false;
+        }
+        if (!add_axis_value(&axes[axis], number, arena))
+            return false;
+    }
+    if (axes[axis].num_values == 0)
+    {
+        fprintf(stderr, "ERROR: simulation dimension \"%s\" has no values\n", dimension);
+        return false;
+    }
+    return true;
+}
+
+/* first..last, stepping by :xFACTOR or :+STEP, doubling by default */
+static bool
+parse_range(const char *spec, AXIS axis_id, GridAxis *axis, PGArena *arena)
+{
+    char *copy = pg_arena_strdup(arena, spec);
+    char *dots;
+    char *step;
+    long long first, last, value;
+    double factor = 2;
+    long long increment = 0;
+
+    if (copy == NULL)
+        return false;
+    dots = strstr(copy, "..");
+    *dots = '\0';
+    step = strchr(dots + 2, ':');
+    if (step)
+        *step++ = '\0';
+
+    if (!parse_axis_value(axis_id, copy, &first) ||
+        !parse_axis_value(axis_id, dots + 2, &last) ||
+        first > last)
+    {
+        fprintf(stderr, "ERROR: invalid %s range \"%s\"\n", axis->key, spec);
+        return false;
+    }
+    if (step)
+    {
+        char *end;
+
+        if (step[0] == 'x' || step[0] == '*')
+        {
+            factor = strtod(step + 1, &end);
+            if (end == step + 1 || *end != '\0' || factor <= 1)
+            {
+                fprintf(stderr, "ERROR: invalid %s range step \"%s\", the factor must be above 1\n", axis->key, step);
+                return false;
+            }
+        }
+        else if (step[0] == '+')
+        {
+            if (!parse_axis_value(axis_id, step + 1, &increment))
+            {
+                fprintf(stderr, "ERROR: invalid %s range step \"%s\"\n", axis->key, step);
+                return false;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: invalid %s range step \"%s\", expected xFACTOR or +STEP\n", axis->key, step);
+            return false;
+        }
+    }
+
+    for (value = first; value <= last;)
+    {
+        long long next;
+
+        if (!add_axis_value(axis, value, arena))
+            return false;
+        next = increment ? value + increment : (long long)(value * factor);
+        if (next <= value)
+            next = value + 1;
+        value = next;
+    }
+    return true;
+}
+
+static bool
+parse_axis_value(AXIS axis, const char *text, long long *value)
+{
+    char *end;
+
+    switch (axis)
+    {
+    case AXIS_RAM:
+        return parse_size_text(text, value) && *value > 0;
+    case AXIS_CPUS:
+        *value = strtoll(text, &end, 10);
+        return end != text && *end == '\0' && *value > 0;
+    case AXIS_DISK:
+        *value = identify_disk_type(text);
+        return *value != UNKNOWN_DT;
+    case AXIS_WORKLOAD:
+        *value = identify_workload_type(text);
+        return *value != UNKNOWN_WL;
+    case AXIS_NODE:
+        *value = identify_node_type(text);
+        return *value != UNKNOWN_NT;
+    case AXIS_HOST:
+        *value = identify_host_type(text);
+        return *value != UNKNOWN_HOST;
+    default:
+        return false;
+    }
+}
+
+static bool
+add_axis_value(GridAxis *axis, long long value, PGArena *arena)
+{
+    if (axis->values == NULL)
+    {
+        axis->values = pg_arena_alloc(arena, MAX_SIMULATE_AXIS_VALUES * sizeof *axis->values);
+        if (axis->values == NULL)
+        {
+            fprintf(stderr, "ERROR: out of memory\n");
+            return false;
+        }
+    }
+
+    if (axis->num_values >= MAX_SIMULATE_AXIS_VALUES)
+    {
+        fprintf(stderr, "ERROR: simulation dimension \"%s\" has more than %d values\n", axis->key, MAX_SIMULATE_AXIS_VALUES);
+        return false;
+    }
+    axis->values[axis->num_values++] = value;
+    return true;
+}
+
+static void
+set_axis(SystemInfo *system_info, AXIS axis, long long value)
+{
+    switch (axis)
+    {
+    case AXIS_RAM:
+        system_info->total_ram = value;
+        break;
+    case AXIS_CPUS:
+        system_info->cpu_count = value;
+        break;
+    case AXIS_DISK:
+        system_info->disk_type = value;
+        break;
+    case AXIS_WORKLOAD:
+        /* a simulated workload replaces any blend of the command line */
+        system_info->workload_type = value;
+        memset(system_info->workload_weights, 0x00, sizeof system_info->workload_weights);
+        break;
+    case AXIS_NODE:
+        system_info->node_type = value;
+        break;
+    case AXIS_HOST:
+        system_info->host_type = value;
+        break;
+    default:
+        break;
+    }
+}
+
+static const char *
+axis_value_name(AXIS axis, long long value, SIMULATE_FORMAT format, PGArena *arena)
+{
+    static const char *disk_names[] = {"magnetic", "ssd", "network"};
+    static const char *node_names[] = {"primary", "standby"};
+    static const char *host_names[] = {"pod", "standard", "cloud"};
+
+    switch (axis)
+    {
+    case AXIS_RAM:
+        if (format == SIMULATE_CSV)
+            return pg_arena_sprintf(arena, "%lld", value);
+        return format_bytes(value, arena);
+    case AXIS_CPUS:
+        return pg_arena_sprintf(arena, "%lld", value);
+    case AXIS_DISK:
+        return value < UNKNOWN_DT ? disk_names[value] : "";
+    case AXIS_WORKLOAD:
+        return value < UNKNOWN_WL ? get_workload_type(value) : "";
+    case AXIS_NODE:
+        return value < UNKNOWN_NT ? node_names[value] : "";
+    case AXIS_HOST:
+        return value < UNKNOWN_HOST ? host_names[value] : "";
+    default:
+        return "";
+    }
+}
+
+/* Sizes for people, exact when they are a whole number of units */
+static const char *
+format_bytes(double bytes, PGArena *arena)
+{
+    static const char *units[] = {"B", "kB", "MB", "GB", "TB", "PB"};
+    int unit = 0;
+
+    while (bytes >= 1024 && unit < 5)
+    {
+        bytes /= 1024;
+        unit++;
+    }
+    if (bytes == (long long)bytes)
+        return pg_arena_sprintf(arena, "%lld%s", (long long)bytes, units[unit]);
+    return pg_arena_sprintf(arena, "%.1f%s", bytes, units[unit]);
+}
+
+/* Append a cell, the rows follow from the number of columns */
+static void
+add_cell(SimulateTable *table, const char *cell)
+{
+    if (table->failed)
+        return;
+    if (cell == NULL)
+    {
+        table->failed = true;
+        return;
+    }
+    if (table->num_cells == table->capacity)
+    {
+        int capacity = table->capacity ? table->capacity * 2 : 256;
+        const char **cells = realloc(table->cells, capacity * sizeof *cells);
+
+        if (cells == NULL)
+        {
+            table->failed = true;
+            return;
+        }
+        table->cells = cells;
+        table->capacity = capacity;
+    }
+    table->cells[table->num_cells++] = cell;
+}
+
+/* Columns padded to their widest cell, numbers and sizes right aligned */
+static void
+write_table(FILE *fp, SimulateTable *table)
+{
+    int *widths = calloc(table->num_columns, sizeof *widths);
+    int i, column;
+
+    if (widths == NULL)
+        return;
+    for (i = 0; i < table->num_cells; i++)
+    {
+        int len = strlen(table->cells[i]);
+
+        column = i % table->num_columns;
+        if (len > widths[column])
+            widths[column] = len;
+    }
+    for (i = 0; i < table->num_cells; i++)
+    {
+        column = i % table->num_columns;
+        /* the status is last and not padded */
+        if (column == table->num_columns - 1)
+            fprintf(fp, "%s\n", table->cells[i]);
+        else if (i < table->num_columns)
+            fprintf(fp, "%-*s  ", widths[column], table->cells[i]);
+        else
+            fprintf(fp, "%*s  ", widths[column], table->cells[i]);
+
+        /* underline the header */
+        if (i == table->num_columns - 1)
+        {
+            for (column = 0; column < table->num_columns; column++)
+            {
+                int width = column == table->num_columns - 1 ? (int)strlen(table->cells[column]) : widths[column];
+
+                while (width-- > 0)
+                    fputc('-', fp);
+                fputs(column == table->num_columns - 1 ? "\n" : "  ", fp);
+            }
+        }
+    }
+    free(widths);
+}
+
+static void
+write_csv(FILE *fp, SimulateTable *table)
+{
+    int i;
+
+    for (i = 0; i < table->num_cells; i++)
+    {
+        const char *cell = table->cells[i];
+
+        /* quote what would otherwise be split or misread */
+        if (strpbrk(cell, ",\"\n"))
+        {
+            fputc('"', fp);
+            for (; *cell; cell++)
+            {
+                if (*cell == '"')
+                    fputc('"', fp);
+                fputc(*cell, fp);
+            }
+            fputc('"', fp);
+        }
+        else
+            fputs(cell, fp);
+        fputc((i + 1) % table->num_columns == 0 ? '\n' : ',', fp);
+    }
+}
@@ -0,0 +1,343 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_sizing.c
+ *		Find the smallest host for which a profile meets workload targets.
+ *
+ * The question capacity planning asks is the reverse of tuning: given what
+ * the workload needs, how big must the host be for the profile to deliver
+ * it. The profile is evaluated with the same processors as for a real host
+ * while the CPU count grows, and for the first CPU count that can meet the
+ * targets the memory is bisected down to the smallest whole GB that still
+ * does. Every formula grows with its resource, which is what makes the
+ * bisection valid.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+
+#include "pg_arena.h"
+#include "pg_config_map.h"
+#include "pg_sizing.h"
+
+#define MAX_SIZING_ERROR_LEN 512
+
+/* PostgreSQL defaults for what a profile does not set */
+#define DEFAULT_SHARED_BUFFERS (128.0 * 1024 * 1024)
+#define DEFAULT_WORK_MEM (4.0 * 1024 * 1024)
+#define DEFAULT_MAX_CONNECTIONS 100
+#define DEFAULT_MAX_PARALLEL_WORKERS_PER_GATHER 2
+#define DEFAULT_MAX_PARALLEL_WORKERS 8
+#define DEFAULT_MAX_WORKER_PROCESSES 8
+
+typedef enum SIZING_TARGET
+{
+    TARGET_WORKING_SET = 0,
+    TARGET_CONNECTIONS,
+    TARGET_PARALLEL,
+    TARGET_WORK_MEM,
+    TARGET_BUDGET,
+    TARGET_BOUNDS               /* not a target, the profile bounds */
+} SIZING_TARGET;
+
+#define TARGET_BIT(target) (1u << (target))
+
+typedef struct sizing_targets
+{
+    long long working_set;      /* -1 when not given */
+    long connections;
+    long parallel;
+    long long work_mem;
+    int budget;                 /* percent of the memory the footprint may use */
+} SizingTargets;
+
+/* What the profile tunes a host to, and which targets it misses */
+typedef struct sizing_result
+{
+    double shared_buffers;
+    double work_mem;
+    double parallel;
+    double max_connections;
+    long long footprint;
+    unsigned int missed;
+    char bounds_error[MAX_SIZING_ERROR_LEN];
+} SizingResult;
+
+static bool parse_target(const char *target, SizingTargets *targets);
+static bool evaluate_host(PGConfigMap *config_map, PGMapProfileDetails *profile, SizingTargets *targets,
+                          SystemInfo *system_info, PGConfigMap *host_map, PGArena *arena, SizingResult *result);
+static void report_host(SizingTargets *targets, SystemInfo *system_info, SizingResult *result);
+static const char *size_text(double bytes, char *buf, size_t len);
+
+int
+run_sizing(SizingOptions *options, PGConfigMap *config_map, PGMapProfileDetails *profile)
+{
+    SizingTargets targets = {-1, -1, -1, -1, DEFAULT_SIZING_BUDGET};
+    SystemInfo system_info = options->defaults;
+    SizingResult result;
+    PGConfigMap host_map;
+    PGArena *arena;
+    long long max_ram = MAX_SIZING_RAM;
+    long long min_ram = SIZING_RAM_GRANULE;
+    long cpus;
+    int i;
+
+    for (i = 0; i < options->num_targets; i++)
+    {
+        if (!parse_target(options->targets[i], &targets))
+            return -1;
+    }
+    if (targets.working_set < 0 && targets.connections < 0 && targets.parallel < 0 && targets.work_mem < 0)
+    {
+        fprintf(stderr, "ERROR: sizing needs at least one of the %s, %s, %s or %s targets\n",
+                SIZING_WORKING_SET_KEY, SIZING_CONNECTIONS_KEY, SIZING_PARALLEL_KEY, SIZING_WORK_MEM_KEY);
+        return -1;
+    }
+
+    /* The profile bounds narrow the search */
+    if (profile->max_memory >= profile->min_memory)
+    {
+        if (profile->max_memory > 0 && profile->max_memory < max_ram)
+            max_ram = profile->max_memory;
+        if (profile->min_memory > min_ram)
+            min_ram = profile->min_memory;
+    }
+
+    arena = pg_arena_create(0);
+    if (arena == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory\n");
+        return -1;
+    }
+
+    for (cpus = 1; cpus <= MAX_SIZING_CPUS; cpus++)
+    {
+        long long low, high;
+
+        /* if even the most memory does not do it, more CPUs are needed */
+        system_info.cpu_count = cpus;
+        system_info.total_ram = max_ram;
+        if (!evaluate_host(config_map, profile, &targets, &system_info, &host_map, arena, &result))
+            goto SIZING_FAILED;
+        if (result.missed)
+            continue;
+
+        /* smallest number of granules that meets the targets, high always does */
+        low = (min_ram + SIZING_RAM_GRANULE - 1) / SIZING_RAM_GRANULE;
+        high = max_ram / SIZING_RAM_GRANULE;
+        while (low < high)
+        {
+            long long middle = low + (high - low) / 2;
+
+            system_info.total_ram = middle * SIZING_RAM_GRANULE;
+            if (!evaluate_host(config_map, profile, &targets, &system_info, &host_map, arena, &result))
+                goto SIZING_FAILED;
+            if (result.missed)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        system_info.total_ram = high * SIZING_RAM_GRANULE;
+        if (system_info.total_ram < min_ram || system_info.total_ram > max_ram)
+            system_info.total_ram = max_ram;
+        if (!evaluate_host(config_map, profile, &targets, &system_info, &host_map, arena, &result))
+            goto SIZING_FAILED;
+
+        printf("LOG: smallest host meeting the targets has %ld CPUs and %lld GB of memory\n",
+               system_info.cpu_count, system_info.total_ram / SIZING_RAM_GRANULE);
+        report_host(&targets, &system_info, &result);
+        printf("\n");
+        write_postgresql_conf(stdout, &host_map);
+
+        if (options->output_path)
+        {
+            FILE *fp = fopen(options->output_path, "w");
+
+            if (fp == NULL)
+            {
+                fprintf(stderr, "Failed to create configuration file %s reason:%s\n", options->output_path, strerror(errno));
+                goto SIZING_FAILED;
+            }
+            write_postgresql_conf(fp, &host_map);
+            if (fclose(fp) != 0)
+            {
+                fprintf(stderr, "Failed to write configuration file %s reason:%s\n", options->output_path, strerror(errno));
+                goto SIZING_FAILED;
+            }
+            printf("\nLOG: configuration file \"%s\" generated\n", options->output_path);
+        }
+        pg_arena_destroy(arena);
+        return 0;
+    }
+
+    /* Tell what the biggest host still misses */
+    system_info.cpu_count = MAX_SIZING_CPUS;
+    system_info.total_ram = max_ram;
+    if (!evaluate_host(config_map, profile, &targets, &system_info, &host_map, arena, &result))
+        goto SIZING_FAILED;
+    fprintf(stderr, "ERROR: no host with up to %d CPUs and %lld GB of memory meets the targets\n",
+            MAX_SIZING_CPUS, max_ram / SIZING_RAM_GRANULE);
+    report_host(&targets, &system_info, &result);
+    pg_arena_destroy(arena);
+    return 1;
+
+SIZING_FAILED:
+    fprintf(stderr, "ERROR: out of memory\n");
+    pg_arena_destroy(arena);
+    return -1;
+}
+
+static bool
+parse_target(const char *target, SizingTargets *targets)
+{
+    const char *equal = strchr(target, '=');
+    const char *value;
+    char *end;
+    long number;
+
+    if (equal == NULL || equal == target || equal[1] == '\0')
+    {
+        fprintf(stderr, "ERROR: invalid sizing target \"%s\", expected KEY=VALUE\n", target);
+        return false;
+    }
+    value = equal + 1;
+
+#define IS_TARGET(key) (strlen(key) == (size_t)(equal - target) && strncasecmp(key, target, equal - target) == 0)
+    if (IS_TARGET(SIZING_WORKING_SET_KEY) || IS_TARGET(SIZING_WORK_MEM_KEY))
+    {
+        long long *size = IS_TARGET(SIZING_WORK_MEM_KEY) ? &targets->work_mem : &targets->working_set;
+
+        if (!parse_size_text(value, size) || *size <= 0)
+        {
+            fprintf(stderr, "ERROR: sizing target \"%s\" must be a size in bytes or with a kB, MB, GB or TB unit\n", target);
+            return false;
+        }
+        return true;
+    }
+
+    number = strtol(value, &end, 10);
+    if (end == value || (*end != '\0' && !(IS_TARGET(SIZING_BUDGET_KEY) && strcmp(end, "%") == 0)))
+    {
+        fprintf(stderr, "ERROR: sizing target \"%s\" must be a number\n", target);
+        return false;
+    }
+    if (IS_TARGET(SIZING_CONNECTIONS_KEY) && number > 0)
+        targets->connections = number;
+    else if (IS_TARGET(SIZING_PARALLEL_KEY) && number > 0)
+        targets->parallel = number;
+    else if (IS_TARGET(SIZING_BUDGET_KEY) && number > 0 && number <= 100)
+        targets->budget = number;
+    else
+    {
+        fprintf(stderr, "ERROR: invalid sizing target \"%s\", must be one of %s, %s, %s, %s or %s=1..100\n", target,
+                SIZING_WORKING_SET_KEY, SIZING_CONNECTIONS_KEY, SIZING_PARALLEL_KEY, SIZING_WORK_MEM_KEY, SIZING_BUDGET_KEY);
+        return false;
+    }
+#undef IS_TARGET
+    return true;
+}
+
+/*
+ * Tune the host and check it against the targets. The working set has to
+ * fit in shared_buffers, the parallel degree in both the per gather and
+ * the total worker limits, and the worst case footprint with the target
+ * connections in the memory budget.
+ */
+static bool
+evaluate_host(PGConfigMap *config_map, PGMapProfileDetails *profile, SizingTargets *targets,
+              SystemInfo *system_info, PGConfigMap *host_map, PGArena *arena, SizingResult *result)
+{
+    double max_workers;
+
+    memset(result, 0x00, sizeof *result);
+    pg_arena_reset(arena);
+    if (!clone_config_map(config_map, host_map, system_info, arena))
+        return false;
+    if (!check_profile_bounds(profile, system_info, result->bounds_error, sizeof result->bounds_error))
+        result->missed |= TARGET_BIT(TARGET_BOUNDS);
+    process_config_map(host_map, system_info);
+
+    result->shared_buffers = get_config_map_setting(host_map, "shared_buffers", get_block_size(system_info), DEFAULT_SHARED_BUFFERS);
+    result->work_mem = get_config_map_setting(host_map, "work_mem", 1024, DEFAULT_WORK_MEM);
+    result->max_connections = get_config_map_setting(host_map, "max_connections", 1, DEFAULT_MAX_CONNECTIONS);
+    result->parallel = get_config_map_setting(host_map, "max_parallel_workers_per_gather", 1, DEFAULT_MAX_PARALLEL_WORKERS_PER_GATHER);
+    max_workers = get_config_map_setting(host_map, "max_parallel_workers", 1, DEFAULT_MAX_PARALLEL_WORKERS);
+    if (max_workers > get_config_map_setting(host_map, "max_worker_processes", 1, DEFAULT_MAX_WORKER_PROCESSES))
+        max_workers = get_config_map_setting(host_map, "max_worker_processes", 1, DEFAULT_MAX_WORKER_PROCESSES);
+    if (result->parallel > max_workers)
+        result->parallel = max_workers;
+
+    /* a profile that does not set max_connections gets it set to the target */
+    result->footprint = estimate_memory_footprint(host_map, system_info);
+    if (targets->connections > 0 && get_config_map_setting(host_map, "max_connections", 1, -1) < 0)
+    {
+        result->footprint += (long long)((targets->connections - result->max_connections) * result->work_mem);
+        result->max_connections = targets->connections;
+    }
+
+    if (targets->working_set > 0 && result->shared_buffers < targets->working_set)
+        result->missed |= TARGET_BIT(TARGET_WORKING_SET);
+    if (targets->connections > 0 && result->max_connections < targets->connections)
+        result->missed |= TARGET_BIT(TARGET_CONNECTIONS);
+    if (targets->parallel > 0 && result->parallel < targets->parallel)
+        result->missed |= TARGET_BIT(TARGET_PARALLEL);
+    if (targets->work_mem > 0 && result->work_mem < targets->work_mem)
+        result->missed |= TARGET_BIT(TARGET_WORK_MEM);
+    if (result->footprint > system_info->total_ram / 100.0 * targets->budget)
+        result->missed |= TARGET_BIT(TARGET_BUDGET);
+    return true;
+}
+
+static void
+report_host(SizingTargets *targets, SystemInfo *system_info, SizingResult *result)
+{
+    char wanted[64], tuned[64];
+
+#define MISSED(target) ((result->missed & TARGET_BIT(target)) ? "missed" : "met")
+    printf("%-12s  %10s  %-40s  %s\n", "target", "wanted", "tuned", "status");
+    if (targets->working_set > 0)
+        printf("%-12s  %10s  shared_buffers = %-23s  %s\n", SIZING_WORKING_SET_KEY,
+               size_text(targets->working_set, wanted, sizeof wanted),
+               size_text(result->shared_buffers, tuned, sizeof tuned), MISSED(TARGET_WORKING_SET));
+    if (targets->connections > 0)
+        printf("%-12s  %10ld  max_connections = %-22.0f  %s\n", SIZING_CONNECTIONS_KEY,
+               targets->connections, result->max_connections, MISSED(TARGET_CONNECTIONS));
+    if (targets->parallel > 0)
+        printf("%-12s  %10ld  parallel workers = %-21.0f  %s\n", SIZING_PARALLEL_KEY,
+               targets->parallel, result->parallel, MISSED(TARGET_PARALLEL));
+    if (targets->work_mem > 0)
+        printf("%-12s  %10s  work_mem = %-29s  %s\n", SIZING_WORK_MEM_KEY,
+               size_text(targets->work_mem, wanted, sizeof wanted),
+               size_text(result->work_mem, tuned, sizeof tuned), MISSED(TARGET_WORK_MEM));
+    snprintf(wanted, sizeof wanted, "%d%%", targets->budget);
+    snprintf(tuned, sizeof tuned, "footprint = %.1f%% of %lld GB",
+             result->footprint * 100.0 / system_info->total_ram, system_info->total_ram / SIZING_RAM_GRANULE);
+    printf("%-12s  %10s  %-40s  %s\n", SIZING_BUDGET_KEY, wanted, tuned, MISSED(TARGET_BUDGET));
+    if (result->missed & TARGET_BIT(TARGET_BOUNDS))
+        printf("profile bounds missed: %s\n", result->bounds_error);
+#undef MISSED
+}
+
+static const char *
+size_text(double bytes, char *buf, size_t len)
+{
+    if (bytes >= 1024.0 * 1024 * 1024)
+        snprintf(buf, len, "%.1fGB", bytes / (1024.0 * 1024 * 1024));
+    else if (bytes >= 1024.0 * 1024)
+        snprintf(buf, len, "%.1fMB", bytes / (1024.0 * 1024));
+    else
+        snprintf(buf, len, "%.0fkB", bytes / 1024.0);
+    return buf;
+}
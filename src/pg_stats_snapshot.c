@@ -0,0 +1,610 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_stats_snapshot.c
+ *		Classify the workload of a cluster from dumps of its statistics views.
+ *
+ * The factor set of the wrong workload costs more than any single badly
+ * tuned parameter, and the workload a cluster is labelled with is often
+ * not the one it runs. The cumulative statistics tell what it actually
+ * does: OLTP runs many short statements returning a few rows and commits
+ * at a high rate, OLAP runs long statements over many rows, scans
+ * sequentially and spills to temp files. Each feature gets a score from 0
+ * (looks like OLTP) to 1 (looks like OLAP) on a log scale around a center
+ * value, and the weighted mean of the scores places the cluster between
+ * the two. Clusters in the middle are MIXED, so the score maps to blend
+ * weights of the three workloads.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "json.h"
+#include "json_scan.h"
+#include "pg_arena.h"
+#include "pg_config_map.h"
+#include "pg_stats_snapshot.h"
+
+#define STATS_BLOCK_SIZE 8192.0
+
+/* Counters summed over every row of every dump */
+typedef enum STATS_COUNTER
+{
+    STAT_CALLS = 0,             /* pg_stat_statements */
+    STAT_ROWS,
+    STAT_EXEC_TIME,
+    STAT_TEMP_BLKS_WRITTEN,
+    STAT_XACT_COMMIT,           /* pg_stat_database */
+    STAT_TEMP_BYTES,
+    STAT_TUP_RETURNED,
+    STAT_TUP_FETCHED,
+    STAT_TUP_INSERTED,
+    STAT_TUP_UPDATED,
+    STAT_TUP_DELETED,
+    STAT_SEQ_TUP_READ,          /* pg_stat_user_tables */
+    STAT_IDX_TUP_FETCH,
+    STAT_N_TUP_INS,
+    STAT_N_TUP_UPD,
+    STAT_N_TUP_DEL,
+    NUM_STATS_COUNTERS
+} STATS_COUNTER;
+
+typedef struct stats_column
+{
+    const char *name;
+    STATS_COUNTER counter;
+} StatsColumn;
+
+static const StatsColumn stats_columns[] = {
+    {"calls", STAT_CALLS},
+    {"rows", STAT_ROWS},
+    {"total_exec_time", STAT_EXEC_TIME},
+    {"total_time", STAT_EXEC_TIME},         /* before PostgreSQL 13 */
+    {"temp_blks_written", STAT_TEMP_BLKS_WRITTEN},
+    {"xact_commit", STAT_XACT_COMMIT},
+    {"temp_bytes", STAT_TEMP_BYTES},
+    {"tup_returned", STAT_TUP_RETURNED},
+    {"tup_fetched", STAT_TUP_FETCHED},
+    {"tup_inserted", STAT_TUP_INSERTED},
+    {"tup_updated", STAT_TUP_UPDATED},
+    {"tup_deleted", STAT_TUP_DELETED},
+    {"seq_tup_read", STAT_SEQ_TUP_READ},
+    {"idx_tup_fetch", STAT_IDX_TUP_FETCH},
+    {"n_tup_ins", STAT_N_TUP_INS},
+    {"n_tup_upd", STAT_N_TUP_UPD},
+    {"n_tup_del", STAT_N_TUP_DEL},
+    {NULL, 0}
+};
+
+/*
+ * Where a feature stops looking like OLTP and starts looking like OLAP,
+ * and how much it counts in the classification.
+ */
+typedef struct stats_feature_scale
+{
+    const char *name;
+    double center;
+    bool olap_above;            /* larger values look like OLAP */
+    double weight;
+} StatsFeatureScale;
+
+static const StatsFeatureScale feature_scales[NUM_STATS_FEATURES] = {
+    [FEATURE_ROWS_PER_CALL] = {"rows per call", 100.0, true, 2.0},
+    [FEATURE_MEAN_EXEC_TIME] = {"mean exec time (ms)", 50.0, true, 2.0},
+    [FEATURE_READ_WRITE_RATIO] = {"read/write ratio", 100.0, true, 1.0},
+    [FEATURE_TEMP_BYTES] = {"temp bytes per xact", 1024.0 * 1024.0, true, 1.0},
+    [FEATURE_COMMIT_RATE] = {"commits per second", 50.0, false, 1.0},
+    [FEATURE_SEQ_SCAN_SHARE] = {"seq scan share", 0, true, 1.0},
+    [FEATURE_WAL_PER_XACT] = {"WAL bytes per xact", 64.0 * 1024.0, true, 1.0}
+};
+
+typedef struct stats_snapshot
+{
+    double counters[NUM_STATS_COUNTERS];
+    bool seen[NUM_STATS_COUNTERS];
+    double commit_rate;         /* summed over the databases */
+    bool has_commit_rate;
+    time_t file_time;           /* of the dump being read */
+    int num_rows;
+} StatsSnapshot;
+
+static bool read_snapshot_file(StatsSnapshot *snapshot, const char *path);
+static int read_csv(StatsSnapshot *snapshot, char *data, char *end);
+static int next_csv_record(char **cursor, char *end, char **fields, int max_fields);
+static int read_json(StatsSnapshot *snapshot, const char *data, size_t size, PGArena *arena);
+static int read_json_row(StatsSnapshot *snapshot, const json_cursor *object, PGArena *arena);
+static void add_row(StatsSnapshot *snapshot, char **names, char **values, int num_columns);
+static void compute_features(StatsSnapshot *snapshot, WorkloadClassification *result);
+static bool score_workload(WorkloadClassification *result);
+
+bool
+classify_workload(const char **paths, int num_paths, WorkloadClassification *result)
+{
+    StatsSnapshot snapshot;
+    int i;
+
+    memset(&snapshot, 0x00, sizeof snapshot);
+    memset(result, 0x00, sizeof *result);
+    for (i = 0; i < num_paths; i++)
+    {
+        if (!read_snapshot_file(&snapshot, paths[i]))
+            return false;
+    }
+
+    compute_features(&snapshot, result);
+    result->num_rows = snapshot.num_rows;
+    if (!score_workload(result))
+    {
+        fprintf(stderr, "ERROR: the statistics snapshots hold none of the columns of pg_stat_statements, "
+                "pg_stat_database or pg_stat_user_tables the workload is classified on\n");
+        return false;
+    }
+    return true;
+}
+
+bool
+add_wal_features(WorkloadClassification *result, double bytes_per_commit, double commit_rate)
+{
+    if (bytes_per_commit > 0)
+    {
+        result->features[FEATURE_WAL_PER_XACT] = bytes_per_commit;
+        result->has_feature[FEATURE_WAL_PER_XACT] = true;
+    }
+    if (commit_rate > 0 && !result->has_feature[FEATURE_COMMIT_RATE])
+    {
+        result->features[FEATURE_COMMIT_RATE] = commit_rate;
+        result->has_feature[FEATURE_COMMIT_RATE] = true;
+    }
+    return score_workload(result);
+}
+
+void
+print_workload_classification(WorkloadClassification *result)
+{
+    int i;
+
+    printf("LOG: workload features from %d statistics row(s)%s\n", result->num_rows,
+           result->has_feature[FEATURE_WAL_PER_XACT] ? " and the WAL" : "");
+    for (i = 0; i < NUM_STATS_FEATURES; i++)
+    {
+        if (result->has_feature[i])
+            printf("LOG:   %-22s: %14.2f  olap score %.2f\n",
+                   feature_scales[i].name, result->features[i], result->olap_scores[i]);
+        else
+            printf("LOG:   %-22s: %14s\n", feature_scales[i].name, "n/a");
+    }
+    printf("LOG: workload classified as %s, olap score %.2f, blend oltp=%.2f,olap=%.2f,mixed=%.2f\n",
+           get_workload_type(result->workload_type), result->olap_score,
+           result->weights[OLTP], result->weights[OLAP], result->weights[MIXED]);
+}
+
+/* Score every feature there is and blend the workloads by the weighted mean */
+static bool
+score_workload(WorkloadClassification *result)
+{
+    double score_sum = 0;
+    double weight_sum = 0;
+    int dominant = 0;
+    int i;
+
+    for (i = 0; i < NUM_STATS_FEATURES; i++)
+    {
+        const StatsFeatureScale *scale = &feature_scales[i];
+        double value = result->features[i];
+        double score;
+
+        if (!result->has_feature[i])
+            continue;
+        /* x / (x + c) is 0.5 at the center and ~0.9 an order of magnitude above */
+        if (scale->center <= 0)
+            score = value;
+        else if (scale->olap_above)
+            score = value / (value + scale->center);
+        else
+            score = scale->center / (value + scale->center);
+        result->olap_scores[i] = score;
+        score_sum += scale->weight * score;
+        weight_sum += scale->weight;
+    }
+    if (weight_sum == 0)
+        return false;
+
+    /* Pure OLTP at 0, pure OLAP at 1 and all MIXED in the middle */
+    result->olap_score = score_sum / weight_sum;
+    result->weights[OLTP] = result->olap_score < 0.5 ? 1.0 - 2.0 * result->olap_score : 0;
+    result->weights[OLAP] = result->olap_score > 0.5 ? 2.0 * result->olap_score - 1.0 : 0;
+    result->weights[MIXED] = 1.0 - result->weights[OLTP] - result->weights[OLAP];
+    for (i = 0; i < NUM_WORKLOAD_FACTORS; i++)
+    {
+        if (result->weights[i] > result->weights[dominant])
+            dominant = i;
+    }
+    result->workload_type = dominant;
+    return true;
+}
+
+static bool
+read_snapshot_file(StatsSnapshot *snapshot, const char *path)
+{
+    struct stat st;
+    PGArena *arena;
+    char *data;
+    char *start;
+    ssize_t len;
+    int rows;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to read file %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "ERROR: statistics snapshot %s is empty\n", path);
+        close(fd);
+        return false;
+    }
+
+    /* The CSV reader splits the fields in place, it needs its own copy */
+    data = malloc(st.st_size + 1);
+    if (data == NULL)
+    {
+        close(fd);
+        perror("Not possible to allocate memory for the statistics snapshot");
+        return false;
+    }
+    len = read(fd, data, st.st_size);
+    close(fd);
+    if (len != st.st_size)
+    {
+        fprintf(stderr, "Failed to read file %s reason:%s\n", path, len < 0 ? strerror(errno) : "short read");
+        free(data);
+        return false;
+    }
+    data[len] = '\0';
+    snapshot->file_time = st.st_mtime;
+
+    for (start = data; *start == ' ' || *start == '\t' || *start == '\r' || *start == '\n'; start++)
+        ;
+    if (*start == '[' || *start == '{')
+    {
+        arena = pg_arena_create(0);
+        rows = arena ? read_json(snapshot, start, len - (start - data), arena) : -1;
+        pg_arena_destroy(arena);
+    }
+    else
+        rows = read_csv(snapshot, start, data + len);
+    free(data);
+
+    if (rows < 0)
+    {
+        fprintf(stderr, "ERROR: statistics snapshot %s is neither a CSV file with a header nor json\n", path);
+        return false;
+    }
+    printf("LOG: read %d row(s) of statistics from %s\n", rows, path);
+    return true;
+}
+
+static int
+read_csv(StatsSnapshot *snapshot, char *data, char *end)
+{
+    char *names[MAX_STATS_COLUMNS];
+    char *values[MAX_STATS_COLUMNS];
+    char *cursor = data;
+    int num_columns;
+    int num_values;
+    int rows = 0;
+
+    num_columns = next_csv_record(&cursor, end, names, MAX_STATS_COLUMNS);
+    if (num_columns <= 1)
+        return -1;
+    while ((num_values = next_csv_record(&cursor, end, values, MAX_STATS_COLUMNS)) >= 0)
+    {
+        /* skip empty lines */
+        if (num_values == 1 && values[0][0] == '\0')
+            continue;
+        add_row(snapshot, names, values, num_values < num_columns ? num_values : num_columns);
+        rows++;
+    }
+    return rows;
+}
+
+/*
+ * Split the next record of RFC 4180 CSV, as written by COPY ... CSV, in
+ * place. Fields are NUL terminated and unquoted, quoted fields may hold
+ * commas, doubled quotes and line breaks. Fields beyond max_fields are
+ * dropped. Returns the number of fields, -1 at the end of the input.
+ */
+static int
+next_csv_record(char **cursor, char *end, char **fields, int max_fields)
+{
+    char *p = *cursor;
+    int num_fields = 0;
+
+    if (p >= end)
+        return -1;
+    for (;;)
+    {
+        char *field = p;
+        char *out = p;
+        char delimiter;
+
+        if (p < end && *p == '"')
+        {
+            p++;
+            while (p < end)
+            {
+                if (*p == '"')
+                {
+                    if (p + 1 < end && p[1] == '"')
+                    {
+                        *out++ = '"';
+                        p += 2;
+                        continue;
+                    }
+                    p++;
+                    break;
+                }
+                *out++ = *p++;
+            }
+            while (p < end && *p != ',' && *p != '\n')
+                p++;
+        }
+        else
+        {
+            while (p < end && *p != ',' && *p != '\n')
+                p++;
+            out = p;
+            if (out > field && out[-1] == '\r')
+                out--;
+        }
+
+        /* the buffer has a NUL after end, so out may be written at end */
+        delimiter = p < end ? *p : '\n';
+        *out = '\0';
+        if (num_fields < max_fields)
+            fields[num_fields++] = field;
+        p++;
+        if (delimiter == '\n')
+            break;
+    }
+    *cursor = p;
+    return num_fields;
+}
+
+/* An array of objects, a single object or one object per line */
+static int
+read_json(StatsSnapshot *snapshot, const char *data, size_t size, PGArena *arena)
+{
+    json_tape tape;
+    json_cursor root;
+    json_cursor row;
+    const char *line;
+    uint32_t i;
+    int rows = 0;
+
+    if (json_tape_parse(&tape, data, size) == 0)
+    {
+        json_tape_root(&tape, &root);
+        if (json_cursor_type(&root) != json_array)
+            rows = read_json_row(snapshot, &root, arena);
+        else if (json_cursor_child(&root, &row))
+        {
+            for (i = 0; i < json_cursor_node(&root)->length; i++, json_cursor_next(&row))
+            {
+                if (read_json_row(snapshot, &row, arena) < 0)
+                {
+                    rows = -1;
+                    break;
+                }
+                rows++;
+            }
+        }
+        json_tape_free(&tape);
+        return rows;
+    }
+
+    for (line = data; line < data + size;)
+    {
+        const char *next = memchr(line, '\n', data + size - line);
+        size_t length = next ? (size_t)(next - line) : (size_t)(data + size - line);
+
+        if (length > 0 && strspn(line, " \t\r") < length)
+        {
+            if (json_tape_parse(&tape, line, length) != 0)
+                return -1;
+            json_tape_root(&tape, &root);
+            if (read_json_row(snapshot, &root, arena) < 0)
+                rows = -1;
+            json_tape_free(&tape);
+            if (rows < 0)
+                return -1;
+            rows++;
+        }
+        line += length + 1;
+    }
+    return rows;
+}
+
+static int
+read_json_row(StatsSnapshot *snapshot, const json_cursor *object, PGArena *arena)
+{
+    char *names[MAX_STATS_COLUMNS];
+    char *values[MAX_STATS_COLUMNS];
+    json_cursor member;
+    json_cursor value;
+    int num_columns = 0;
+    uint32_t i;
+
+    if (json_cursor_type(object) != json_object)
+        return -1;
+    json_cursor_child(object, &member);
+    for (i = 0; i < json_cursor_node(object)->length && num_columns < MAX_STATS_COLUMNS; i++)
+    {
+        const char *name = json_cursor_string(&member);
+        const json_tape_node *node;
+        char *text;
+
+        /* from the key to its value, and on to the next key */
+        json_cursor_next(&member);
+        value = member;
+        json_cursor_next(&member);
+        node = json_cursor_node(&value);
+        switch (node->type)
+        {
+        case json_integer:
+            text = pg_arena_sprintf(arena, "%lld", (long long)node->u.integer);
+            break;
+        case json_double:
+            text = pg_arena_sprintf(arena, "%.17g", node->u.dbl);
+            break;
+        case json_string:
+            text = (char *)json_cursor_string(&value);
+            break;
+        default:
+            continue;
+        }
+        if (text == NULL)
+            return -1;
+        names[num_columns] = (char *)name;
+        values[num_columns++] = text;
+    }
+    add_row(snapshot, names, values, num_columns);
+    return 1;
+}
+
+static void
+add_row(StatsSnapshot *snapshot, char **names, char **values, int num_columns)
+{
+    const char *stats_reset = NULL;
+    const char *snapshot_time = NULL;
+    double xact_commit = -1;
+    int i;
+
+    for (i = 0; i < num_columns; i++)
+    {
+        const StatsColumn *column;
+        double number;
+        char *end;
+
+        if (strcasecmp(names[i], "stats_reset") == 0)
+            stats_reset = values[i];
+        else if (strcasecmp(names[i], STATS_SNAPSHOT_TIME_COLUMN) == 0)
+            snapshot_time = values[i];
+
+        for (column = stats_columns; column->name; column++)
+        {
+            if (strcasecmp(column->name, names[i]) == 0)
+                break;
+        }
+        if (column->name == NULL)
+            continue;
+        /* NULL is an empty field */
+        number = strtod(values[i], &end);
+        if (end == values[i])
+            continue;
+        snapshot->counters[column->counter] += number;
+        snapshot->seen[column->counter] = true;
+        if (column->counter == STAT_XACT_COMMIT)
+            xact_commit = number;
+    }
+    snapshot->num_rows++;
+
+    /* The commit rate of a database over the time since its stats were reset */
+    if (xact_commit >= 0 && stats_reset && *stats_reset)
+    {
+        double reset;
+        double taken = (double)snapshot->file_time;
+
+        if (parse_timestamp_text(stats_reset, &reset) &&
+            (snapshot_time == NULL || parse_timestamp_text(snapshot_time, &taken)) &&
+            taken > reset)
+        {
+            snapshot->commit_rate += xact_commit / (taken - reset);
+            snapshot->has_commit_rate = true;
+        }
+    }
+}
+
+static void
+compute_features(StatsSnapshot *snapshot, WorkloadClassification *result)
+{
+    double *counters = snapshot->counters;
+    bool *seen = snapshot->seen;
+    double reads;
+    double writes;
+
+    if (seen[STAT_CALLS] && counters[STAT_CALLS] > 0)
+    {
+        if (seen[STAT_ROWS])
+        {
+            result->features[FEATURE_ROWS_PER_CALL] = counters[STAT_ROWS] / counters[STAT_CALLS];
+            result->has_feature[FEATURE_ROWS_PER_CALL] = true;
+        }
+        if (seen[STAT_EXEC_TIME])
+        {
+            result->features[FEATURE_MEAN_EXEC_TIME] = counters[STAT_EXEC_TIME] / counters[STAT_CALLS];
+            result->has_feature[FEATURE_MEAN_EXEC_TIME] = true;
+        }
+    }
+
+    /* Tuples read per tuple written, from the databases or else the tables */
+    if (seen[STAT_TUP_RETURNED] || seen[STAT_TUP_FETCHED])
+    {
+        reads = counters[STAT_TUP_RETURNED] + counters[STAT_TUP_FETCHED];
+        writes = counters[STAT_TUP_INSERTED] + counters[STAT_TUP_UPDATED] + counters[STAT_TUP_DELETED];
+        result->has_feature[FEATURE_READ_WRITE_RATIO] = true;
+    }
+    else if (seen[STAT_SEQ_TUP_READ] || seen[STAT_IDX_TUP_FETCH])
+    {
+        reads = counters[STAT_SEQ_TUP_READ] + counters[STAT_IDX_TUP_FETCH];
+        writes = counters[STAT_N_TUP_INS] + counters[STAT_N_TUP_UPD] + counters[STAT_N_TUP_DEL];
+        result->has_feature[FEATURE_READ_WRITE_RATIO] = true;
+    }
+    else
+        reads = writes = 0;
+    result->features[FEATURE_READ_WRITE_RATIO] = reads / (writes > 1 ? writes : 1);
+
+    /* Temp bytes per transaction, or per statement without pg_stat_database */
+    if (seen[STAT_TEMP_BYTES] && seen[STAT_XACT_COMMIT] && counters[STAT_XACT_COMMIT] > 0)
+    {
+        result->features[FEATURE_TEMP_BYTES] = counters[STAT_TEMP_BYTES] / counters[STAT_XACT_COMMIT];
+        result->has_feature[FEATURE_TEMP_BYTES] = true;
+    }
+    else if (seen[STAT_TEMP_BLKS_WRITTEN] && counters[STAT_CALLS] > 0)
+    {
+        result->features[FEATURE_TEMP_BYTES] = counters[STAT_TEMP_BLKS_WRITTEN] * STATS_BLOCK_SIZE / counters[STAT_CALLS];
+        result->has_feature[FEATURE_TEMP_BYTES] = true;
+    }
+
+    if (snapshot->has_commit_rate)
+    {
+        result->features[FEATURE_COMMIT_RATE] = snapshot->commit_rate;
+        result->has_feature[FEATURE_COMMIT_RATE] = true;
+    }
+
+    if (counters[STAT_SEQ_TUP_READ] + counters[STAT_IDX_TUP_FETCH] > 0)
+    {
+        result->features[FEATURE_SEQ_SCAN_SHARE] = counters[STAT_SEQ_TUP_READ] /
+            (counters[STAT_SEQ_TUP_READ] + counters[STAT_IDX_TUP_FETCH]);
+        result->has_feature[FEATURE_SEQ_SCAN_SHARE] = true;
+    }
+}
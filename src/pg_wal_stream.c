@@ -0,0 +1,704 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_wal_stream.c
+ *		Write intensity, full page images and record mix of the WAL kept
+ *		in pg_wal, decoded from the segment files.
+ *
+ * This is the part of what pg_waldump does that tuning needs: the page
+ * headers say which pages hold WAL of the segment they are in, and which
+ * are left over from before the segment was recycled, and the record
+ * headers give the resource manager, length and block references of
+ * every record, with their full page images. Records are checked against
+ * their CRC, the first one that fails ends the WAL of the segment. Only
+ * the commit, heap and checkpoint records are looked into further.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "pg_wal_stream.h"
+#include "pg_control.h"
+
+#define MAXALIGN(len) (((len) + 7) & ~((uint64_t)7))
+
+/* XLogPageHeaderData, and XLogLongPageHeaderData on the first page of a segment */
+#define XLP_MAGIC_OFFSET 0
+#define XLP_INFO_OFFSET 2
+#define XLP_PAGEADDR_OFFSET 8
+#define XLP_REM_LEN_OFFSET 16
+#define XLP_SEG_SIZE_OFFSET 32
+#define XLP_XLOG_BLCKSZ_OFFSET 36
+#define SIZE_OF_SHORT_PHD 24
+#define SIZE_OF_LONG_PHD 40
+#define XLP_FIRST_IS_CONTRECORD 0x0001
+#define XLP_LONG_HEADER 0x0002
+#define XLP_ALL_FLAGS 0x000F
+
+/* Every version since 9.6 has a magic of 0xD0nn or 0xD1nn, 15 started at this one */
+#define XLP_MAGIC_MASK 0xFE00
+#define XLP_MAGIC_BASE 0xD000
+#define XLP_MAGIC_15 0xD110
+
+/* XLogRecord */
+#define XL_INFO_OFFSET 16
+#define XL_RMID_OFFSET 17
+#define XL_CRC_OFFSET 20
+#define SIZE_OF_XLOG_RECORD 24
+#define MAX_XLOG_RECORD_SIZE (1020 * 1024 * 1024)
+
+/* Block references of a record */
+#define XLR_MAX_BLOCK_ID 32
+#define XLR_BLOCK_ID_DATA_SHORT 255
+#define XLR_BLOCK_ID_DATA_LONG 254
+#define XLR_BLOCK_ID_ORIGIN 253
+#define XLR_BLOCK_ID_TOPLEVEL_XID 252
+#define BKPBLOCK_HAS_IMAGE 0x10
+#define BKPBLOCK_SAME_REL 0x80
+#define SIZE_OF_REL_LOCATOR 12
+#define BKPIMAGE_HAS_HOLE 0x01
+#define BKPIMAGE_IS_COMPRESSED_PRE_15 0x02
+#define BKPIMAGE_COMPRESSED_15 (0x04 | 0x08 | 0x10)
+
+/* Resource managers and the operations of them that are counted */
+#define RM_XLOG_ID 0
+#define RM_XACT_ID 1
+#define RM_HEAP2_ID 9
+#define RM_HEAP_ID 10
+#define XLOG_CHECKPOINT_ONLINE 0x10
+#define XLOG_XACT_OPMASK 0x70
+#define XLOG_XACT_COMMIT 0x00
+#define XLOG_XACT_ABORT 0x20
+#define XLOG_XACT_COMMIT_PREPARED 0x30
+#define XLOG_XACT_ABORT_PREPARED 0x40
+#define XLOG_HEAP_OPMASK 0x70
+#define XLOG_HEAP_INSERT 0x00
+#define XLOG_HEAP_DELETE 0x10
+#define XLOG_HEAP_UPDATE 0x20
+#define XLOG_HEAP_HOT_UPDATE 0x40
+#define XLOG_HEAP2_MULTI_INSERT 0x50
+#define MULTI_INSERT_NTUPLES_OFFSET 2
+
+/* TimestampTz counts microseconds since 2000-01-01 */
+#define POSTGRES_EPOCH_UNIX 946684800.0
+
+static const char *rmgr_names[WAL_NUM_RMGRS] = {
+    "XLOG", "Transaction", "Storage", "CLOG", "Database", "Tablespace", "MultiXact", "RelMap",
+    "Standby", "Heap2", "Heap", "Btree", "Hash", "Gin", "Gist", "Sequence", "SPGist", "BRIN",
+    "CommitTs", "ReplicationOrigin", "Generic", "LogicalMessage"};
+
+typedef struct wal_segment
+{
+    char name[25];
+    uint32_t timeline;
+    uint64_t segno;
+    time_t mtime;
+} WalSegment;
+
+/* A record that goes on past the page it starts on is put together here */
+typedef struct wal_decoder
+{
+    WalStream *stream;
+    unsigned char *record;
+    size_t record_size;         /* allocated */
+    uint32_t record_len;        /* xl_tot_len of the record being put together, 0 for none */
+    uint32_t record_have;
+    uint64_t record_lsn;
+    uint64_t end_lsn;           /* after the last complete record */
+    bool compressed_15;         /* full page images are flagged the way 15 does */
+} WalDecoder;
+
+static int list_wal_segments(const char *wal_dir, uint32_t *segment_size, WalSegment **segments);
+static bool read_segment_size(const char *path, uint32_t *segment_size, uint32_t *block_size);
+static bool decode_segment(WalDecoder *decoder, const char *path, uint64_t segno, bool follows);
+static int decode_page(WalDecoder *decoder, const unsigned char *page, uint64_t pageaddr);
+static bool add_record_data(WalDecoder *decoder, const unsigned char *data, uint32_t len);
+static bool decode_record(WalDecoder *decoder, const unsigned char *record, uint32_t len, uint64_t lsn);
+static void summarize_wal_stream(WalStream *stream, WalSegment *first, WalSegment *last, uint64_t first_end,
+                                 uint64_t end_lsn);
+static int compare_segments(const void *a, const void *b);
+
+bool
+analyze_wal_stream(const char *wal_dir, int server_version, WalStream *stream)
+{
+    struct timeval start, end;
+    WalSegment *segments = NULL;
+    WalSegment *first = NULL, *last = NULL;
+    WalDecoder decoder;
+    uint64_t first_end = 0;
+    uint64_t prev_segno = 0;
+    int num_segments;
+    int i;
+
+    memset(stream, 0x00, sizeof *stream);
+    memset(&decoder, 0x00, sizeof decoder);
+    gettimeofday(&start, NULL);
+
+    num_segments = list_wal_segments(wal_dir, &stream->segment_size, &segments);
+    if (num_segments < 0)
+        return false;
+    if (num_segments == 0)
+    {
+        fprintf(stderr, "ERROR: no WAL segments in %s\n", wal_dir);
+        free(segments);
+        return false;
+    }
+
+    decoder.stream = stream;
+    stream->server_version = server_version;
+    for (i = 0; i < num_segments; i++)
+    {
+        char path[PATH_MAX];
+        bool follows = last != NULL && segments[i].segno == prev_segno + 1;
+
+        /* Of the timelines a segment is on, the last one is the history that went on */
+        if (i + 1 < num_segments && segments[i + 1].segno == segments[i].segno)
+            continue;
+        snprintf(path, sizeof path, "%s/%s", wal_dir, segments[i].name);
+        if (!decode_segment(&decoder, path, segments[i].segno, follows))
+        {
+            stream->num_skipped++;
+            continue;
+        }
+        stream->num_segments++;
+        if (first == NULL)
+        {
+            first = &segments[i];
+            first_end = (segments[i].segno + 1) * stream->segment_size;
+        }
+        last = &segments[i];
+        prev_segno = segments[i].segno;
+    }
+    free(decoder.record);
+    if (stream->num_segments == 0)
+    {
+        fprintf(stderr, "ERROR: none of the %d segments in %s holds WAL that can be decoded\n", num_segments, wal_dir);
+        free(segments);
+        return false;
+    }
+
+    summarize_wal_stream(stream, first, last, first_end, decoder.end_lsn);
+    free(segments);
+    gettimeofday(&end, NULL);
+    stream->elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+    return true;
+}
+
+void
+print_wal_stream(WalStream *stream)
+{
+    long long heap_changes = stream->inserts + stream->updates + stream->deletes;
+    int i;
+
+    printf("LOG: decoded %d WAL segments, %.1f MB, in %.3f seconds, %d skipped\n", stream->num_segments,
+           stream->bytes_read / (1024.0 * 1024.0), stream->elapsed, stream->num_skipped);
+    printf("LOG:   records                : %lld, %.1f MB\n", stream->num_records,
+           stream->record_bytes / (1024.0 * 1024.0));
+    printf("LOG:   full page images       : %lld, %.1f MB (%.1f%%), %lld compressed\n", stream->num_fpi,
+           stream->fpi_bytes / (1024.0 * 1024.0), 100.0 * stream->fpi_share, stream->num_compressed_fpi);
+    if (stream->bytes_per_second > 0)
+        printf("LOG:   write rate             : %.1f kB/s over %.1f minutes, from the %s\n",
+               stream->bytes_per_second / 1024.0, stream->span / 60.0,
+               stream->rate_from_files ? "segment file times" : "commit times");
+    else
+        printf("LOG:   write rate             : not known, the WAL has no two commits or segments apart in time\n");
+    printf("LOG:   transactions           : %lld commits, %lld aborts, %.1f commits a second\n", stream->commits,
+           stream->aborts, stream->commit_rate);
+    printf("LOG:   checkpoints            : %lld\n", stream->checkpoints);
+    if (heap_changes > 0)
+        printf("LOG:   heap changes           : %.1f%% inserts, %.1f%% updates (%.1f%% HOT), %.1f%% deletes\n",
+               100.0 * stream->inserts / heap_changes, 100.0 * stream->updates / heap_changes,
+               stream->updates > 0 ? 100.0 * stream->hot_updates / stream->updates : 0,
+               100.0 * stream->deletes / heap_changes);
+    printf("LOG:   records by resource manager:\n");
+    for (i = 0; i < WAL_NUM_RMGRS; i++)
+    {
+        if (stream->rmgr_records[i] > 0)
+            printf("LOG:     %-20s : %lld records, %.1f MB (%.1f%%)\n", rmgr_names[i], stream->rmgr_records[i],
+                   stream->rmgr_bytes[i] / (1024.0 * 1024.0),
+                   stream->record_bytes > 0 ? 100.0 * stream->rmgr_bytes[i] / stream->record_bytes : 0);
+    }
+}
+
+/*
+ * Segment files are named by their timeline and number. The segment size
+ * comes from the long page header of the first one, so the numbers can be
+ * worked out. Returns the number of segments, sorted, or -1.
+ */
+static int
+list_wal_segments(const char *wal_dir, uint32_t *segment_size, WalSegment **segments)
+{
+    struct dirent *entry;
+    int num_segments = 0;
+    int max_segments = 0;
+    uint32_t block_size;
+    DIR *dir;
+    int i;
+
+    dir = opendir(wal_dir);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Failed to open WAL directory %s reason:%s\n", wal_dir, strerror(errno));
+        return -1;
+    }
+    while ((entry = readdir(dir)) != NULL)
+    {
+        unsigned int timeline, log, seg;
+        char path[PATH_MAX];
+        struct stat st;
+
+        if (strlen(entry->d_name) != 24 || strspn(entry->d_name, "0123456789ABCDEF") != 24 ||
+            sscanf(entry->d_name, "%8X%8X%8X", &timeline, &log, &seg) != 3)
+            continue;
+        snprintf(path, sizeof path, "%s/%s", wal_dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (num_segments == max_segments)
+        {
+            WalSegment *new_segments;
+
+            max_segments = max_segments > 0 ? max_segments * 2 : 64;
+            new_segments = realloc(*segments, max_segments * sizeof *new_segments);
+            if (new_segments == NULL)
+            {
+                perror("Not possible to allocate memory for the WAL segments");
+                closedir(dir);
+                free(*segments);
+                *segments = NULL;
+                return -1;
+            }
+            *segments = new_segments;
+        }
+        memcpy((*segments)[num_segments].name, entry->d_name, 25);
+        (*segments)[num_segments].timeline = timeline;
+        /* log and seg until the size is known */
+        (*segments)[num_segments].segno = (uint64_t)log << 32 | seg;
+        (*segments)[num_segments].mtime = st.st_mtime;
+        num_segments++;
+    }
+    closedir(dir);
+
+    for (i = 0; i < num_segments && *segment_size == 0; i++)
+    {
+        char path[PATH_MAX];
+
+        snprintf(path, sizeof path, "%s/%s", wal_dir, (*segments)[i].name);
+        read_segment_size(path, segment_size, &block_size);
+    }
+    if (num_segments > 0 && *segment_size == 0)
+    {
+        fprintf(stderr, "ERROR: none of the segments in %s starts with a long page header\n", wal_dir);
+        free(*segments);
+        *segments = NULL;
+        return -1;
+    }
+    for (i = 0; i < num_segments; i++)
+    {
+        uint64_t log = (*segments)[i].segno >> 32;
+        uint64_t seg = (*segments)[i].segno & 0xFFFFFFFF;
+
+        (*segments)[i].segno = log * (0x100000000ULL / *segment_size) + seg;
+    }
+    qsort(*segments, num_segments, sizeof **segments, compare_segments);
+    return num_segments;
+}
+
+/* A power of two between 1MB and 1GB, the sizes initdb allows */
+static bool
+read_segment_size(const char *path, uint32_t *segment_size, uint32_t *block_size)
+{
+    unsigned char header[SIZE_OF_LONG_PHD];
+    uint16_t magic, info;
+    uint32_t size, blcksz;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return false;
+    if (pread(fd, header, sizeof header, 0) != sizeof header)
+    {
+        close(fd);
+        return false;
+    }
+    close(fd);
+    memcpy(&magic, header + XLP_MAGIC_OFFSET, sizeof magic);
+    memcpy(&info, header + XLP_INFO_OFFSET, sizeof info);
+    memcpy(&size, header + XLP_SEG_SIZE_OFFSET, sizeof size);
+    memcpy(&blcksz, header + XLP_XLOG_BLCKSZ_OFFSET, sizeof blcksz);
+    if ((magic & XLP_MAGIC_MASK) != XLP_MAGIC_BASE || !(info & XLP_LONG_HEADER) ||
+        size < 1024 * 1024 || size > 1024 * 1024 * 1024 || (size & (size - 1)) != 0 ||
+        blcksz < 1024 || blcksz > 65536 || (blcksz & (blcksz - 1)) != 0)
+        return false;
+    *segment_size = size;
+    *block_size = blcksz;
+    return true;
+}
+
+/*
+ * The pages of a segment up to the first one that is not of it, the rest
+ * was written before the segment was recycled or not written at all. A
+ * record carries on into the segment only when that follows the last one.
+ */
+static bool
+decode_segment(WalDecoder *decoder, const char *path, uint64_t segno, bool follows)
+{
+    WalStream *stream = decoder->stream;
+    uint32_t segment_size, block_size;
+    unsigned char *buffer;
+    uint64_t offset;
+    bool valid = false;
+    struct stat st;
+    int fd;
+
+    if (!read_segment_size(path, &segment_size, &block_size) || segment_size != stream->segment_size ||
+        (stream->block_size != 0 && block_size != stream->block_size))
+        return false;
+    stream->block_size = block_size;
+    if (!follows)
+        decoder->record_len = 0;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return false;
+    if (fstat(fd, &st) != 0 || st.st_size != segment_size)
+    {
+        close(fd);
+        return false;
+    }
+    buffer = malloc(WAL_READ_SIZE);
+    if (buffer == NULL)
+    {
+        close(fd);
+        return false;
+    }
+    for (offset = 0; offset < segment_size; offset += WAL_READ_SIZE)
+    {
+        size_t len = segment_size - offset < WAL_READ_SIZE ? segment_size - offset : WAL_READ_SIZE;
+        size_t page;
+
+        if (pread(fd, buffer, len, offset) != (ssize_t)len)
+            break;
+        stream->bytes_read += len;
+        for (page = 0; page < len; page += block_size)
+        {
+            int result = decode_page(decoder, buffer + page, segno * segment_size + offset + page);
+
+            valid |= result >= 0;
+            if (result <= 0)
+                break;
+        }
+        if (page < len)
+            break;
+    }
+    free(buffer);
+    close(fd);
+    if (offset < segment_size)
+        decoder->record_len = 0;
+    return valid;
+}
+
+/*
+ * Returns -1 for a page that is not of this place of the WAL, 0 when the
+ * WAL ends on the page, at a record that is not there or fails its checks,
+ * and 1 when it goes on on the next page.
+ */
+static int
+decode_page(WalDecoder *decoder, const unsigned char *page, uint64_t pageaddr)
+{
+    WalStream *stream = decoder->stream;
+    uint32_t block_size = stream->block_size;
+    uint16_t magic, info;
+    uint64_t addr;
+    uint32_t rem_len;
+    uint32_t pos;
+
+    memcpy(&magic, page + XLP_MAGIC_OFFSET, sizeof magic);
+    memcpy(&info, page + XLP_INFO_OFFSET, sizeof info);
+    memcpy(&addr, page + XLP_PAGEADDR_OFFSET, sizeof addr);
+    memcpy(&rem_len, page + XLP_REM_LEN_OFFSET, sizeof rem_len);
+    if ((magic & XLP_MAGIC_MASK) != XLP_MAGIC_BASE || (info & ~XLP_ALL_FLAGS) != 0 || addr != pageaddr)
+        return -1;
+    if (stream->server_version == 0)
+        stream->server_version = magic >= XLP_MAGIC_15 ? 150000 : 140000;
+    decoder->compressed_15 = stream->server_version >= 150000;
+    pos = (info & XLP_LONG_HEADER) ? SIZE_OF_LONG_PHD : SIZE_OF_SHORT_PHD;
+
+    /* The rest of a record from the page before */
+    if (info & XLP_FIRST_IS_CONTRECORD)
+    {
+        uint32_t len = rem_len < block_size - pos ? rem_len : block_size - pos;
+
+        if (decoder->record_len > 0)
+        {
+            if (rem_len != decoder->record_len - decoder->record_have || !add_record_data(decoder, page + pos, len))
+                return 0;
+        }
+        pos = MAXALIGN(pos + len);
+    }
+    else if (decoder->record_len > 0)
+        decoder->record_len = 0;
+
+    while (pos + sizeof(uint32_t) <= block_size)
+    {
+        uint32_t tot_len;
+
+        memcpy(&tot_len, page + pos, sizeof tot_len);
+        if (tot_len == 0 || tot_len < SIZE_OF_XLOG_RECORD || tot_len > MAX_XLOG_RECORD_SIZE)
+            return 0;
+        if (tot_len <= block_size - pos)
+        {
+            if (!decode_record(decoder, page + pos, tot_len, pageaddr + pos))
+                return 0;
+            pos = MAXALIGN(pos + tot_len);
+            continue;
+        }
+
+        /* Goes on on the next page */
+        if (decoder->record_size < tot_len)
+        {
+            unsigned char *record = realloc(decoder->record, tot_len);
+
+            if (record == NULL)
+                return 0;
+            decoder->record = record;
+            decoder->record_size = tot_len;
+        }
+        decoder->record_len = tot_len;
+        decoder->record_have = 0;
+        decoder->record_lsn = pageaddr + pos;
+        return add_record_data(decoder, page + pos, block_size - pos) ? 1 : 0;
+    }
+    return 1;
+}
+
+static bool
+add_record_data(WalDecoder *decoder, const unsigned char *data, uint32_t len)
+{
+    memcpy(decoder->record + decoder->record_have, data, len);
+    decoder->record_have += len;
+    if (decoder->record_have < decoder->record_len)
+        return true;
+    decoder->record_len = 0;
+    return decode_record(decoder, decoder->record, decoder->record_have, decoder->record_lsn);
+}
+
+/*
+ * Check the CRC of a record, which covers the data and then the header up
+ * to the CRC, walk its block references the way the server decodes them
+ * and count what it is.
+ */
+static bool
+decode_record(WalDecoder *decoder, const unsigned char *record, uint32_t len, uint64_t lsn)
+{
+    WalStream *stream = decoder->stream;
+    const unsigned char *ptr = record + SIZE_OF_XLOG_RECORD;
+    const unsigned char *end = record + len;
+    const unsigned char *main_data;
+    uint8_t info = record[XL_INFO_OFFSET];
+    uint8_t rmid = record[XL_RMID_OFFSET];
+    uint32_t main_data_len = 0;
+    uint64_t datatotal = 0;
+    long long fpi_bytes = 0;
+    long long num_fpi = 0, num_compressed = 0;
+    uint32_t crc;
+
+    memcpy(&crc, record + XL_CRC_OFFSET, sizeof crc);
+    if (crc != FIN_CRC32C(comp_crc32c(comp_crc32c(INIT_CRC32C, ptr, len - SIZE_OF_XLOG_RECORD), record, XL_CRC_OFFSET)))
+        return false;
+
+    while ((uint64_t)(end - ptr) > datatotal)
+    {
+        uint8_t block_id = *ptr++;
+
+        if (block_id == XLR_BLOCK_ID_DATA_SHORT)
+        {
+            if (end - ptr < 1)
+                return false;
+            main_data_len = *ptr++;
+            datatotal += main_data_len;
+            break;
+        }
+        else if (block_id == XLR_BLOCK_ID_DATA_LONG)
+        {
+            if (end - ptr < 4)
+                return false;
+            memcpy(&main_data_len, ptr, sizeof main_data_len);
+            ptr += 4;
+            datatotal += main_data_len;
+            break;
+        }
+        else if (block_id == XLR_BLOCK_ID_ORIGIN)
+            ptr += 2;
+        else if (block_id == XLR_BLOCK_ID_TOPLEVEL_XID)
+            ptr += 4;
+        else if (block_id <= XLR_MAX_BLOCK_ID)
+        {
+            uint8_t fork_flags;
+            uint16_t data_len;
+
+            if (end - ptr < 3)
+                return false;
+            fork_flags = ptr[0];
+            memcpy(&data_len, ptr + 1, sizeof data_len);
+            ptr += 3;
+            datatotal += data_len;
+            if (fork_flags & BKPBLOCK_HAS_IMAGE)
+            {
+                uint16_t bimg_len;
+                uint8_t bimg_info;
+                bool compressed;
+
+                if (end - ptr < 5)
+                    return false;
+                memcpy(&bimg_len, ptr, sizeof bimg_len);
+                bimg_info = ptr[4];
+                ptr += 5;
+                compressed = decoder->compressed_15 ? (bimg_info & BKPIMAGE_COMPRESSED_15) != 0
+                                                    : (bimg_info & BKPIMAGE_IS_COMPRESSED_PRE_15) != 0;
+                if (compressed && (bimg_info & BKPIMAGE_HAS_HOLE))
+                    ptr += 2;
+                datatotal += bimg_len;
+                fpi_bytes += bimg_len;
+                num_fpi++;
+                num_compressed += compressed;
+            }
+            if (!(fork_flags & BKPBLOCK_SAME_REL))
+                ptr += SIZE_OF_REL_LOCATOR;
+            ptr += 4;
+        }
+        else
+            return false;
+        if (ptr > end)
+            return false;
+    }
+    if ((uint64_t)(end - ptr) != datatotal)
+        return false;
+    main_data = end - main_data_len;
+
+    stream->num_records++;
+    stream->record_bytes += len;
+    stream->fpi_bytes += fpi_bytes;
+    stream->num_fpi += num_fpi;
+    stream->num_compressed_fpi += num_compressed;
+    if (rmid < WAL_NUM_RMGRS)
+    {
+        stream->rmgr_records[rmid]++;
+        stream->rmgr_bytes[rmid] += len;
+    }
+    decoder->end_lsn = lsn + len;
+
+    if (rmid == RM_XACT_ID)
+    {
+        uint8_t op = info & XLOG_XACT_OPMASK;
+
+        if ((op == XLOG_XACT_COMMIT || op == XLOG_XACT_COMMIT_PREPARED) && main_data_len >= sizeof(int64_t))
+        {
+            int64_t xact_time;
+            double seconds;
+
+            memcpy(&xact_time, main_data, sizeof xact_time);
+            seconds = xact_time / 1000000.0 + POSTGRES_EPOCH_UNIX;
+            if (stream->commits == 0)
+            {
+                stream->first_commit_lsn = lsn;
+                stream->first_commit_time = seconds;
+            }
+            stream->last_commit_lsn = lsn;
+            stream->last_commit_time = seconds;
+            stream->commits++;
+        }
+        else if (op == XLOG_XACT_ABORT || op == XLOG_XACT_ABORT_PREPARED)
+            stream->aborts++;
+    }
+    else if (rmid == RM_HEAP_ID)
+    {
+        switch (info & XLOG_HEAP_OPMASK)
+        {
+            case XLOG_HEAP_INSERT:
+                stream->inserts++;
+                break;
+            case XLOG_HEAP_DELETE:
+                stream->deletes++;
+                break;
+            case XLOG_HEAP_UPDATE:
+                stream->updates++;
+                break;
+            case XLOG_HEAP_HOT_UPDATE:
+                stream->updates++;
+                stream->hot_updates++;
+                break;
+        }
+    }
+    else if (rmid == RM_HEAP2_ID && (info & XLOG_HEAP_OPMASK) == XLOG_HEAP2_MULTI_INSERT &&
+             main_data_len >= MULTI_INSERT_NTUPLES_OFFSET + sizeof(uint16_t))
+    {
+        uint16_t ntuples;
+
+        memcpy(&ntuples, main_data + MULTI_INSERT_NTUPLES_OFFSET, sizeof ntuples);
+        stream->inserts += ntuples;
+    }
+    else if (rmid == RM_XLOG_ID && (info & 0xF0) == XLOG_CHECKPOINT_ONLINE)
+        stream->checkpoints++;
+    return true;
+}
+
+/*
+ * The commit times are when the WAL between them was written. Without two
+ * of them the time a segment file was last written is when the WAL got
+ * past its end, the last one is still being written.
+ */
+static void
+summarize_wal_stream(WalStream *stream, WalSegment *first, WalSegment *last, uint64_t first_end, uint64_t end_lsn)
+{
+    double bytes = 0;
+
+    if (stream->commits >= 2 && stream->last_commit_time > stream->first_commit_time)
+    {
+        stream->span = stream->last_commit_time - stream->first_commit_time;
+        bytes = (double)(stream->last_commit_lsn - stream->first_commit_lsn);
+        stream->commit_rate = (stream->commits - 1) / stream->span;
+    }
+    else if (first != last && last->mtime > first->mtime && end_lsn > first_end)
+    {
+        stream->span = (double)(last->mtime - first->mtime);
+        bytes = (double)(end_lsn - first_end);
+        stream->commit_rate = stream->commits / stream->span;
+        stream->rate_from_files = true;
+    }
+    if (stream->span > 0)
+        stream->bytes_per_second = bytes / stream->span;
+    if (stream->commit_rate > 0)
+        stream->bytes_per_commit = stream->bytes_per_second / stream->commit_rate;
+    if (stream->record_bytes > 0)
+        stream->fpi_share = (double)stream->fpi_bytes / stream->record_bytes;
+}
+
+static int
+compare_segments(const void *a, const void *b)
+{
+    const WalSegment *sa = a;
+    const WalSegment *sb = b;
+
+    if (sa->segno != sb->segno)
+        return sa->segno < sb->segno ? -1 : 1;
+    if (sa->timeline != sb->timeline)
+        return sa->timeline < sb->timeline ? -1 : 1;
+    return 0;
+}
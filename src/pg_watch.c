@@ -0,0 +1,303 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_watch.c
+ *		Stay resident and tune again when the resources of the host change.
+ *
+ * A vertical pod autoscaler changes memory.max and cpu.max of a running
+ * pod, and CPUs can be hot plugged on a virtual machine. Neither cgroupfs
+ * nor sysfs notify inotify of such writes, so the resources are checked
+ * again every interval. Only a change of the mount table, through poll(),
+ * and a move of the data directory, through inotify, wake us up earlier.
+ * Only the parameters depending on a changed resource are computed again,
+ * the configuration is replaced atomically, and the server is reloaded
+ * when a parameter that does not need a restart changed.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+
+#include "pg_watch.h"
+#include "pg_config_map.h"
+
+#define MOUNTINFO_FILE "/proc/self/mountinfo"
+#define INOTIFY_BUFFER_SIZE (64 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+
+extern char **environ;
+
+typedef struct watch_state
+{
+    int inotify_fd;
+    int mountinfo_fd;
+    bool rewatch;               /* a watched file went away, add the watches again */
+    int num_entries;
+    char (*values)[MAX_TOKEN_LEN];  /* values written last, in map order */
+    bool *written;
+} WatchState;
+
+static void add_watches(WatchState *state, const char *data_dir);
+static void drain_notifications(WatchState *state);
+static void snapshot_values(PGConfigMap *config_map, WatchState *state);
+static int report_changes(PGConfigMap *config_map, WatchState *state, bool *reloadable);
+static void describe_changes(unsigned int changed, SystemInfo *system_info);
+static int reload_server(WatchOptions *options);
+
+int
+run_watch(pgat_context *ctx, WatchOptions *options)
+{
+    PGConfigMap *config_map = pgat_get_config_map(ctx);
+    PGConfigMapEntry *entry;
+    WatchState state = {.inotify_fd = -1, .mountinfo_fd = -1};
+    struct pollfd fds[2];
+
+    if (config_map == NULL)
+    {
+        fprintf(stderr, "ERROR: nothing to watch, no profile is loaded\n");
+        return -1;
+    }
+    if (options->stop == NULL)
+    {
+        fprintf(stderr, "ERROR: no stop flag is given to end watching\n");
+        return -1;
+    }
+    for (entry = config_map->list; entry; entry = entry->next)
+        state.num_entries++;
+    state.values = calloc(state.num_entries + 1, sizeof *state.values);
+    state.written = calloc(state.num_entries + 1, sizeof *state.written);
+    if (state.values == NULL || state.written == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory\n");
+        free(state.values);
+        free(state.written);
+        return -1;
+    }
+    snapshot_values(config_map, &state);
+
+    state.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (state.inotify_fd < 0)
+        fprintf(stderr, "WARNING: inotify is not available, a move of the data directory is only seen every %d seconds: %s\n",
+                options->interval, strerror(errno));
+    else
+        add_watches(&state, options->data_dir);
+    state.mountinfo_fd = open(MOUNTINFO_FILE, O_RDONLY | O_CLOEXEC);
+
+    printf("LOG: watching for resource changes, checking every %d seconds\n", options->interval);
+    while (!*options->stop)
+    {
+        unsigned int changed;
+        bool reloadable = false;
+        int num_changed;
+        int nfds = 0;
+
+        fds[0].fd = state.inotify_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = state.mountinfo_fd;
+        fds[1].events = POLLPRI;
+        if (state.inotify_fd >= 0)
+            nfds = 1;
+        if (state.mountinfo_fd >= 0)
+            fds[nfds++] = fds[1];
+
+        if (poll(fds, nfds, options->interval * 1000) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "ERROR: failed to wait for resource changes: %s\n", strerror(errno));
+            break;
+        }
+        drain_notifications(&state);
+        if (state.rewatch)
+            add_watches(&state, options->data_dir);
+
+        if (pgat_refresh(ctx, &changed) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            continue;
+        }
+        if (changed == 0)
+            continue;
+        describe_changes(changed, pgat_get_system_info(ctx));
+
+        /* a host outside the bounds of the profile keeps its last configuration */
+        if (pgat_reprocess(ctx, changed) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s, keeping the current configuration\n", pgat_error_message(ctx));
+            continue;
+        }
+        num_changed = report_changes(config_map, &state, &reloadable);
+        if (num_changed == 0)
+        {
+            printf("LOG: no parameter changed\n");
+            continue;
+        }
+        if (pgat_emit(ctx, options->output_path) != PGAT_OK)
+        {
+            fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+            continue;
+        }
+        snapshot_values(config_map, &state);
+        printf("LOG: configuration file \"%s\" generated with %d changed parameter(s)\n", options->output_path, num_changed);
+
+        if (options->reload && reloadable)
+            reload_server(options);
+    }
+    printf("LOG: stopped watching for resource changes\n");
+
+    if (state.inotify_fd >= 0)
+        close(state.inotify_fd);
+    if (state.mountinfo_fd >= 0)
+        close(state.mountinfo_fd);
+    free(state.values);
+    free(state.written);
+    return 0;
+}
+
+/*
+ * Watch the data directory for a move to another mount. The cgroup limits
+ * and the online CPUs are not watched, writes to cgroupfs and sysfs do not
+ * raise IN_MODIFY, the interval covers them.
+ */
+static void
+add_watches(WatchState *state, const char *data_dir)
+{
+    if (data_dir)
+        inotify_add_watch(state->inotify_fd, data_dir, IN_MOVE_SELF | IN_DELETE_SELF | IN_UNMOUNT);
+    state->rewatch = false;
+}
+
+/*
+ * Consume whatever woke us up, we check every resource anyway. A change of
+ * the mount table is acknowledged by poll() itself.
+ */
+static void
+drain_notifications(WatchState *state)
+{
+    char buffer[INOTIFY_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while (state->inotify_fd >= 0 && (len = read(state->inotify_fd, buffer, sizeof buffer)) > 0)
+    {
+        char *ptr;
+
+        for (ptr = buffer; ptr < buffer + len;)
+        {
+            struct inotify_event *event = (struct inotify_event *)ptr;
+
+            if (event->mask & IN_IGNORED)
+                state->rewatch = true;
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+}
+
+static void
+snapshot_values(PGConfigMap *config_map, WatchState *state)
+{
+    PGConfigMapEntry *entry;
+    int i = 0;
+
+    for (entry = config_map->list; entry && i < state->num_entries; entry = entry->next, i++)
+    {
+        state->written[i] = entry->status == ENTRY_PROCESSED_SUCCESS;
+        if (state->written[i])
+            format_config_map_value(entry, state->values[i], MAX_TOKEN_LEN);
+    }
+}
+
+/*
+ * Log every parameter whose value differs from what was written last.
+ * Returns how many changed, reloadable tells whether a reload picks up at
+ * least one of them.
+ */
+static int
+report_changes(PGConfigMap *config_map, WatchState *state, bool *reloadable)
+{
+    PGConfigMapEntry *entry;
+    int changed = 0;
+    int i = 0;
+
+    for (entry = config_map->list; entry && i < state->num_entries; entry = entry->next, i++)
+    {
+        char value[MAX_TOKEN_LEN];
+
+        if (entry->status != ENTRY_PROCESSED_SUCCESS)
+            continue;
+        format_config_map_value(entry, value, sizeof value);
+        if (state->written[i] && strcmp(state->values[i], value) == 0)
+            continue;
+
+        changed++;
+        if (parameter_needs_restart(entry->param))
+            printf("LOG: parameter \"%s\" changed from %s to %s, it needs a restart to take effect\n",
+                   entry->param, state->written[i] ? state->values[i] : "unset", value);
+        else
+        {
+            printf("LOG: parameter \"%s\" changed from %s to %s\n",
+                   entry->param, state->written[i] ? state->values[i] : "unset", value);
+            *reloadable = true;
+        }
+    }
+    return changed;
+}
+
+static void
+describe_changes(unsigned int changed, SystemInfo *system_info)
+{
+    if (changed & RESOURCE_BIT(RESOURCE_MEMORY))
+        printf("LOG: memory changed to %lld bytes\n", system_info->total_ram);
+    if (changed & RESOURCE_BIT(RESOURCE_CPU))
+        printf("LOG: CPU count changed to %ld\n", system_info->cpu_count);
+    if (changed & RESOURCE_BIT(RESOURCE_DISK))
+        printf("LOG: data directory moved to another device, disk read speed is now %.2f MB/s\n",
+               system_info->disk_speed);
+}
+
+static int
+reload_server(WatchOptions *options)
+{
+    char *argv[] = {(char *)options->pg_ctl, "reload", "-s", "-D", (char *)options->data_dir, NULL};
+    pid_t pid;
+    int status;
+    int rc;
+
+    rc = posix_spawnp(&pid, options->pg_ctl, NULL, NULL, argv, environ);
+    if (rc != 0)
+    {
+        fprintf(stderr, "ERROR: failed to run %s: %s\n", options->pg_ctl, strerror(rc));
+        return -1;
+    }
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            fprintf(stderr, "ERROR: failed to wait for %s: %s\n", options->pg_ctl, strerror(errno));
+            return -1;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "ERROR: \"%s reload\" failed\n", options->pg_ctl);
+        return -1;
+    }
+    printf("LOG: server reloaded\n");
+    return 0;
+}
@@ -0,0 +1,338 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_xid_rate.c
+ *		How fast a server uses up transaction ids, from the counters of its
+ *		checkpoints in pg_control.
+ *
+ * Every checkpoint writes the next transaction id and the oldest
+ * datfrozenxid of the cluster into pg_control, with its time. Two of them
+ * are enough for the rate ids are used at, and so for how long until
+ * autovacuum has to force a vacuum on the tables that are oldest. One run
+ * only sees the last checkpoint, so the samples are kept in a history file
+ * from run to run, or taken over a window the run waits for.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pg_xid_rate.h"
+
+#define XID_HISTORY_HEADER "# pg_auto_tune transaction id history\n" \
+                           "# system_identifier checkpoint_time next_xid oldest_xid next_multi oldest_multi\n"
+
+static void sample_control(ControlInfo *control, XidSample *sample);
+static bool add_sample(XidRate *rate, XidSample *sample);
+static bool load_xid_history(const char *path, XidRate *rate);
+static bool append_xid_history(const char *path, XidRate *rate, int64_t after);
+static bool sample_window(const char *data_dir, int window, XidRate *rate);
+static void estimate_xid_rate(XidRate *rate);
+static int compare_sample_time(const void *a, const void *b);
+
+bool
+measure_xid_rate(const char *data_dir, ControlInfo *control, const char *history_path, int window, XidRate *rate)
+{
+    XidSample sample;
+    int64_t recorded = INT64_MIN;
+
+    memset(rate, 0x00, sizeof *rate);
+    if (!control->has_control)
+    {
+        fprintf(stderr, "ERROR: %s/%s could not be read for its checkpoint\n", data_dir, PG_CONTROL_FILE);
+        return false;
+    }
+    rate->system_identifier = control->system_identifier;
+
+    if (history_path)
+    {
+        if (!load_xid_history(history_path, rate))
+        {
+            free_xid_rate(rate);
+            return false;
+        }
+        if (rate->num_samples > 0)
+            recorded = rate->samples[rate->num_samples - 1].time;
+    }
+    sample_control(control, &sample);
+    if (!add_sample(rate, &sample) || (window > 0 && !sample_window(data_dir, window, rate)))
+    {
+        free_xid_rate(rate);
+        return false;
+    }
+    if (history_path && !append_xid_history(history_path, rate, recorded))
+    {
+        free_xid_rate(rate);
+        return false;
+    }
+    estimate_xid_rate(rate);
+    return true;
+}
+
+void
+free_xid_rate(XidRate *rate)
+{
+    free(rate->samples);
+    memset(rate, 0x00, sizeof *rate);
+}
+
+void
+print_xid_rate(XidRate *rate, double freeze_max_age)
+{
+    double seconds;
+
+    printf("LOG: %d checkpoints over %.1f hours sampled for the transaction id rate\n", rate->num_samples,
+           rate->span / 3600.0);
+    printf("LOG:   age of datfrozenxid    : %.0f\n", rate->xid_age);
+    printf("LOG:   age of datminmxid      : %.0f\n", rate->multi_age);
+    if (rate->xid_rate <= 0)
+    {
+        printf("LOG:   transaction ids        : no rate, fewer than two checkpoints were sampled\n");
+        return;
+    }
+    printf("LOG:   transaction ids        : %.1f a second, %.0f a day\n", rate->xid_rate, rate->xid_rate * 86400.0);
+    printf("LOG:   multixact ids          : %.1f a second\n", rate->multi_rate);
+    seconds = seconds_to_freeze_age(rate, freeze_max_age);
+    if (seconds <= 0)
+        printf("LOG:   autovacuum_freeze_max_age %.0f is reached already\n", freeze_max_age);
+    else
+        printf("LOG:   autovacuum_freeze_max_age %.0f is reached in %.1f hours\n", freeze_max_age, seconds / 3600.0);
+}
+
+double
+seconds_to_freeze_age(XidRate *rate, double freeze_max_age)
+{
+    double since_checkpoint = 0;
+
+    if (rate->num_samples > 0)
+        since_checkpoint = (double)time(NULL) - rate->samples[rate->num_samples - 1].time;
+    if (since_checkpoint < 0)
+        since_checkpoint = 0;
+    return (freeze_max_age - rate->xid_age) / rate->xid_rate - since_checkpoint;
+}
+
+static void
+sample_control(ControlInfo *control, XidSample *sample)
+{
+    sample->time = control->checkpoint_time;
+    sample->next_xid = control->next_xid;
+    sample->oldest_xid = control->oldest_xid;
+    sample->next_multi = control->next_multi;
+    sample->oldest_multi = control->oldest_multi;
+}
+
+/* Only a new checkpoint is a new sample, the oldest ones make room when there are too many */
+static bool
+add_sample(XidRate *rate, XidSample *sample)
+{
+    int i;
+
+    for (i = 0; i < rate->num_samples; i++)
+    {
+        if (rate->samples[i].time == sample->time)
+            return true;
+    }
+    if (rate->num_samples == XID_HISTORY_MAX_SAMPLES)
+    {
+        memmove(rate->samples, rate->samples + 1, (rate->num_samples - 1) * sizeof *rate->samples);
+        rate->num_samples--;
+    }
+    else if (rate->num_samples == rate->max_samples)
+    {
+        int new_size = rate->max_samples > 0 ? rate->max_samples * 2 : 16;
+        XidSample *samples = realloc(rate->samples, new_size * sizeof *samples);
+
+        if (samples == NULL)
+        {
+            perror("Not possible to allocate memory for the transaction id samples");
+            return false;
+        }
+        rate->samples = samples;
+        rate->max_samples = new_size;
+    }
+    rate->samples[rate->num_samples++] = *sample;
+    if (rate->num_samples > 1 && sample->time < rate->samples[rate->num_samples - 2].time)
+        qsort(rate->samples, rate->num_samples, sizeof *rate->samples, compare_sample_time);
+    return true;
+}
+
+/* A history that does not exist yet is empty, samples of other clusters are skipped */
+static bool
+load_xid_history(const char *path, XidRate *rate)
+{
+    char line[256];
+    int line_number = 0;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        if (errno == ENOENT)
+            return true;
+        fprintf(stderr, "Failed to open transaction id history %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    while (fgets(line, sizeof line, fp))
+    {
+        unsigned long long system_identifier, next_xid;
+        unsigned int oldest_xid, next_multi, oldest_multi;
+        long long checkpoint_time;
+        XidSample sample;
+
+        line_number++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+        if (sscanf(line, "%llu %lld %llu %u %u %u", &system_identifier, &checkpoint_time, &next_xid,
+                   &oldest_xid, &next_multi, &oldest_multi) != 6)
+        {
+            fprintf(stderr, "WARNING: line %d of transaction id history %s is not a sample, skipped\n", line_number, path);
+            continue;
+        }
+        if (system_identifier != rate->system_identifier)
+            continue;
+        sample.time = checkpoint_time;
+        sample.next_xid = next_xid;
+        sample.oldest_xid = oldest_xid;
+        sample.next_multi = next_multi;
+        sample.oldest_multi = oldest_multi;
+        if (!add_sample(rate, &sample))
+        {
+            fclose(fp);
+            return false;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool
+append_xid_history(const char *path, XidRate *rate, int64_t after)
+{
+    FILE *fp;
+    int i;
+
+    fp = fopen(path, "a");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open transaction id history %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    if (ftell(fp) == 0)
+        fputs(XID_HISTORY_HEADER, fp);
+    for (i = 0; i < rate->num_samples; i++)
+    {
+        XidSample *sample = &rate->samples[i];
+
+        if (sample->time <= after)
+            continue;
+        fprintf(fp, "%llu %lld %llu %u %u %u\n", (unsigned long long)rate->system_identifier, (long long)sample->time,
+                (unsigned long long)sample->next_xid, sample->oldest_xid, sample->next_multi, sample->oldest_multi);
+        rate->num_recorded++;
+    }
+    if (fclose(fp) != 0)
+    {
+        fprintf(stderr, "Failed to write transaction id history %s reason:%s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool
+sample_window(const char *data_dir, int window, XidRate *rate)
+{
+    time_t end = time(NULL) + window;
+    time_t now;
+
+    while ((now = time(NULL)) < end)
+    {
+        ControlInfo control;
+        XidSample sample;
+
+        sleep(end - now < XID_SAMPLE_INTERVAL ? end - now : XID_SAMPLE_INTERVAL);
+        if (!read_control_info(data_dir, &control) || !control.has_control)
+            return false;
+        if (control.system_identifier != rate->system_identifier)
+        {
+            fprintf(stderr, "ERROR: %s belongs to another cluster since the sampling started\n", data_dir);
+            return false;
+        }
+        sample_control(&control, &sample);
+        if (!add_sample(rate, &sample))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Least squares slope of the next transaction id over the checkpoint time.
+ * The next transaction id never goes back, unless the cluster was restored
+ * from a backup or reset, so only the samples since then count, and only
+ * those of the last XID_HISTORY_SECONDS, the rate of the recent workload.
+ */
+static void
+estimate_xid_rate(XidRate *rate)
+{
+    XidSample *first, *last;
+    double mean_time = 0, mean_xid = 0, covariance = 0, variance = 0;
+    int start = 0;
+    int n, i;
+
+    if (rate->num_samples == 0)
+        return;
+    last = &rate->samples[rate->num_samples - 1];
+    rate->xid_age = (uint32_t)((uint32_t)last->next_xid - last->oldest_xid);
+    rate->multi_age = (uint32_t)(last->next_multi - last->oldest_multi);
+
+    for (i = 1; i < rate->num_samples; i++)
+    {
+        if (rate->samples[i].next_xid < rate->samples[i - 1].next_xid)
+            start = i;
+    }
+    while (start < rate->num_samples - 1 && last->time - rate->samples[start].time > XID_HISTORY_SECONDS)
+        start++;
+    first = &rate->samples[start];
+    n = rate->num_samples - start;
+    rate->span = (double)(last->time - first->time);
+    if (n < 2 || rate->span <= 0)
+        return;
+
+    for (i = start; i < rate->num_samples; i++)
+    {
+        mean_time += (double)(rate->samples[i].time - first->time) / n;
+        mean_xid += (double)(rate->samples[i].next_xid - first->next_xid) / n;
+    }
+    for (i = start; i < rate->num_samples; i++)
+    {
+        double dt = (double)(rate->samples[i].time - first->time) - mean_time;
+
+        covariance += dt * ((double)(rate->samples[i].next_xid - first->next_xid) - mean_xid);
+        variance += dt * dt;
+    }
+    rate->xid_rate = variance > 0 ? covariance / variance : 0;
+    if (rate->xid_rate < 0)
+        rate->xid_rate = 0;
+    rate->multi_rate = (uint32_t)(last->next_multi - first->next_multi) / rate->span;
+}
+
+static int
+compare_sample_time(const void *a, const void *b)
+{
+    const XidSample *sa = a;
+    const XidSample *sb = b;
+
+    if (sa->time != sb->time)
+        return sa->time < sb->time ? -1 : 1;
+    return 0;
+}
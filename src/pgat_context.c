@@ -0,0 +1,1114 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgat_context.c
+ *		Entry points of libpgautotune.
+ *
+ * Everything a tuning run needs is kept in the context, so contexts can be
+ * used from different threads at the same time, and errors are returned to
+ * the caller instead of ending the process.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <math.h>
+#include <libgen.h>
+#include <sys/sysinfo.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+
+#include "pgautotune.h"
+#include "pg_config_map.h"
+#include "pg_profile_image.h"
+#include "pg_cgroup.h"
+#include "pg_log_analyzer.h"
+#include "pg_buffer_sim.h"
+#include "pg_cache_residency.h"
+#include "pg_data_dir.h"
+#include "pg_heap_scan.h"
+#include "pg_control.h"
+#include "pg_xid_rate.h"
+#include "pg_wal_stream.h"
+#include "pg_compression.h"
+#include "pg_cost_calibration.h"
+#include "pg_memory_knee.h"
+#include "pg_memory_bandwidth.h"
+
+#define MAX_FILE_PATH_SIZE 1024
+#define SPEED_TEST_FILE "base/1/1255"
+#define PGCONF_FILE "postgresql.conf"
+
+struct pgat_context
+{
+    SystemInfo system_info;
+    bool force_profile;
+    bool probed;
+    bool profile_loaded;
+    bool processed;
+    /* resources that were probed, and so are probed again on a refresh */
+    unsigned int probed_resources;
+    char *data_dir;
+    dev_t data_dev;
+    /* where the diagnostics of the library go, nowhere when NULL */
+    PGATLogHook log_hook;
+    void *log_arg;
+    PGConfig *pg_config;
+    PGConfigMap config_map;
+    PGMapProfileDetails profile;
+    /* a processed copy of the map for every workload */
+    PGArena *workload_arena;
+    PGConfigMap workload_maps[NUM_WORKLOAD_FACTORS];
+    bool workloads_processed;
+    /* what the server logs showed, NULL when they are not analyzed */
+    LogEvidence *log_evidence;
+    /* what the page cache holds of the data directory, NULL when not scanned */
+    CacheResidency *cache_residency;
+    /* sizes of the relations of the data directory, NULL when not scanned */
+    DataDirShape *data_shape;
+    /* free and dead space of the tables, NULL when not scanned */
+    HeapScan *heap_scan;
+    /* what pg_control and PG_VERSION of the data directory say */
+    ControlInfo control;
+    bool has_control;
+    /* transaction ids used by the checkpoints, NULL when not measured */
+    XidRate *xid_rate;
+    /* what the WAL in pg_wal holds, NULL when not decoded */
+    WalStream *wal_stream;
+    /* how the algorithms compress the pages, NULL when not benchmarked */
+    CompressionBench *compression;
+    /* planner costs timed on the host, NULL when not calibrated */
+    CostCalibration *cost_calibration;
+    /* sizes the sorts and hash builds fall out of the caches at, NULL when not found */
+    MemoryKnee *memory_knee;
+    /* bandwidth and latency of the memory, NULL when not measured */
+    MemoryBandwidth *memory_bandwidth;
+    char error[PGAT_MAX_ERROR_LEN];
+};
+
+static PGAT_STATUS set_error(pgat_context *ctx, PGAT_STATUS status, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+static PGAT_STATUS check_bounds(pgat_context *ctx);
+static void apply_evidence(pgat_context *ctx, PGConfigMap *config_map, SystemInfo *system_info);
+static PGAT_STATUS emit_config_map(pgat_context *ctx, PGConfigMap *config_map, const char *output_path);
+static PGAT_STATUS emit_config_map_stream(pgat_context *ctx, PGConfigMap *config_map, FILE *fp);
+static long long get_ram_size(void);
+static int get_CPU_count(void);
+static double get_disk_speed(const char *filePath);
+static double probe_disk_speed(const char *data_dir);
+static void get_wal_dir(pgat_context *ctx, char *path, size_t len);
+
+pgat_context *
+pgat_create(void)
+{
+    pgat_context *ctx = calloc(1, sizeof *ctx);
+
+    if (ctx == NULL)
+        return NULL;
+    ctx->system_info.total_ram = -1;
+    ctx->system_info.cpu_count = -1;
+    ctx->system_info.disk_speed = -1;
+    ctx->system_info.host_type = UNKNOWN_HOST;
+    ctx->system_info.node_type = UNKNOWN_NT;
+    ctx->system_info.disk_type = UNKNOWN_DT;
+    ctx->system_info.workload_type = MIXED;
+    return ctx;
+}
+
+void
+pgat_destroy(pgat_context *ctx)
+{
+    if (ctx == NULL)
+        return;
+    if (ctx->profile_loaded)
+        free_config_map(&ctx->config_map);
+    PGConfig_destroy(ctx->pg_config);
+    pg_arena_destroy(ctx->workload_arena);
+    if (ctx->log_evidence)
+        free_log_evidence(ctx->log_evidence);
+    free(ctx->log_evidence);
+    if (ctx->cache_residency)
+        free_cache_residency(ctx->cache_residency);
+    free(ctx->cache_residency);
+    free(ctx->data_shape);
+    if (ctx->heap_scan)
+        free_heap_scan(ctx->heap_scan);
+    free(ctx->heap_scan);
+    if (ctx->xid_rate)
+        free_xid_rate(ctx->xid_rate);
+    free(ctx->xid_rate);
+    free(ctx->wal_stream);
+    free(ctx->compression);
+    free(ctx->cost_calibration);
+    free(ctx->memory_knee);
+    free(ctx->memory_bandwidth);
+    free(ctx->data_dir);
+    free(ctx);
+}
+
+const char *
+pgat_error_message(const pgat_context *ctx)
+{
+    return ctx ? ctx->error : "no context";
+}
+
+void
+pgat_set_workload_type(pgat_context *ctx, WORKLOAD_TYPE workload_type)
+{
+    ctx->system_info.workload_type = workload_type;
+    memset(ctx->system_info.workload_weights, 0x00, sizeof ctx->system_info.workload_weights);
+}
+
+PGAT_STATUS
+pgat_set_workload_blend(pgat_context *ctx, const char *blend)
+{
+    SystemInfo system_info = ctx->system_info;
+
+    if (blend == NULL || !parse_workload_weights(blend, &system_info))
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "invalid workload blend \"%s\"", blend ? blend : "");
+    ctx->system_info = system_info;
+    return PGAT_OK;
+}
+
+void
+pgat_set_host_type(pgat_context *ctx, HOST_TYPE host_type)
+{
+    ctx->system_info.host_type = host_type;
+}
+
+void
+pgat_set_node_type(pgat_context *ctx, NODE_TYPE node_type)
+{
+    ctx->system_info.node_type = node_type;
+}
+
+void
+pgat_set_disk_type(pgat_context *ctx, DISK_TYPE disk_type)
+{
+    ctx->system_info.disk_type = disk_type;
+}
+
+void
+pgat_set_force_profile(pgat_context *ctx, bool force)
+{
+    ctx->force_profile = force;
+}
+
+void
+pgat_set_log_hook(pgat_context *ctx, PGATLogHook hook, void *arg)
+{
+    ctx->log_hook = hook;
+    ctx->log_arg = arg;
+    ctx->config_map.log_hook = hook;
+    ctx->config_map.log_arg = arg;
+}
+
+void
+pgat_set_resources(pgat_context *ctx, long long total_ram, long cpu_count, double disk_speed)
+{
+    ctx->system_info.total_ram = total_ram;
+    ctx->system_info.cpu_count = cpu_count;
+    ctx->system_info.disk_speed = disk_speed;
+}
+
+PGAT_STATUS
+pgat_probe(pgat_context *ctx, const char *data_dir)
+{
+    SystemInfo *system_info = &ctx->system_info;
+    char file_path[MAX_FILE_PATH_SIZE];
+    struct stat st;
+
+    if (system_info->total_ram <= 0)
+    {
+        system_info->total_ram = get_ram_size();
+        ctx->probed_resources |= RESOURCE_BIT(RESOURCE_MEMORY);
+    }
+    if (system_info->cpu_count <= 0)
+    {
+        system_info->cpu_count = get_CPU_count();
+        ctx->probed_resources |= RESOURCE_BIT(RESOURCE_CPU);
+    }
+
+    if (system_info->total_ram <= 0)
+        return set_error(ctx, PGAT_ERROR_PROBE, "Failed to get installed RAM size");
+    if (system_info->cpu_count <= 0)
+        return set_error(ctx, PGAT_ERROR_PROBE, "Failed to get installed CPU count from system");
+
+    if (data_dir)
+    {
+        free(ctx->data_dir);
+        ctx->data_dir = strdup(data_dir);
+        if (ctx->data_dir == NULL)
+            return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+        if (stat(data_dir, &st) == 0)
+            ctx->data_dev = st.st_dev;
+
+        /* Without the version the parameters are written for any version */
+        ctx->has_control = read_control_info(data_dir, &ctx->control);
+        if (ctx->has_control)
+        {
+            system_info->server_version = ctx->control.server_version;
+            if (ctx->control.has_control)
+            {
+                system_info->block_size = ctx->control.block_size;
+                system_info->wal_segment_size = ctx->control.wal_segment_size;
+            }
+        }
+        else
+            fprintf(stderr, "WARNING: the server version of %s is not known, parameters are not checked against it\n", data_dir);
+
+        if (system_info->disk_speed <= 0)
+        {
+            system_info->disk_speed = probe_disk_speed(data_dir);
+            ctx->probed_resources |= RESOURCE_BIT(RESOURCE_DISK);
+        }
+
+        /* Load configuration parameters from postgresql.conf */
+        snprintf(file_path, MAX_FILE_PATH_SIZE, "%s/%s", data_dir, PGCONF_FILE);
+        PGConfig_destroy(ctx->pg_config);
+        ctx->pg_config = PGConfig_parse(file_path);
+    }
+    ctx->probed = true;
+    ctx->processed = false;
+    ctx->workloads_processed = false;
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_refresh(pgat_context *ctx, unsigned int *changed)
+{
+    SystemInfo *system_info = &ctx->system_info;
+    struct stat st;
+
+    *changed = 0;
+    if (!ctx->probed)
+        return set_error(ctx, PGAT_ERROR_STATE, "system resources are not probed yet");
+
+    if (ctx->probed_resources & RESOURCE_BIT(RESOURCE_MEMORY))
+    {
+        long long total_ram = get_ram_size();
+
+        if (total_ram <= 0)
+            return set_error(ctx, PGAT_ERROR_PROBE, "Failed to get installed RAM size");
+        if (total_ram != system_info->total_ram)
+        {
+            system_info->total_ram = total_ram;
+            *changed |= RESOURCE_BIT(RESOURCE_MEMORY);
+        }
+    }
+    if (ctx->probed_resources & RESOURCE_BIT(RESOURCE_CPU))
+    {
+        long cpu_count = get_CPU_count();
+
+        if (cpu_count <= 0)
+            return set_error(ctx, PGAT_ERROR_PROBE, "Failed to get installed CPU count from system");
+        if (cpu_count != system_info->cpu_count)
+        {
+            system_info->cpu_count = cpu_count;
+            *changed |= RESOURCE_BIT(RESOURCE_CPU) | RESOURCE_BIT(RESOURCE_MEMBW);
+        }
+    }
+
+    /* Measuring the disk is expensive, only do it when the data moved to another device */
+    if (ctx->data_dir && stat(ctx->data_dir, &st) == 0 && st.st_dev != ctx->data_dev)
+    {
+        ctx->data_dev = st.st_dev;
+        if (ctx->probed_resources & RESOURCE_BIT(RESOURCE_DISK))
+        {
+            system_info->disk_speed = probe_disk_speed(ctx->data_dir);
+            *changed |= RESOURCE_BIT(RESOURCE_DISK);
+        }
+    }
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_load_profile(pgat_context *ctx, const char *file_path)
+{
+    int map_entries;
+
+    if (file_path == NULL)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "no profile given");
+
+    if (ctx->profile_loaded)
+    {
+        free_config_map(&ctx->config_map);
+        ctx->profile_loaded = false;
+        ctx->workloads_processed = false;
+    }
+    memset(&ctx->config_map, 0x00, sizeof ctx->config_map);
+    memset(&ctx->profile, 0x00, sizeof ctx->profile);
+    ctx->config_map.log_hook = ctx->log_hook;
+    ctx->config_map.log_arg = ctx->log_arg;
+
+    /* The map file is either a compiled profile image or a json profile */
+    if (is_profile_image(file_path))
+        map_entries = load_profile_image(&ctx->config_map, &ctx->profile, &ctx->system_info, file_path);
+    else
+        map_entries = load_json_config_map(&ctx->config_map, &ctx->profile, &ctx->system_info, file_path);
+    if (map_entries < 0)
+    {
+        /* whatever was loaded before failing is still owned by the map */
+        free_config_map(&ctx->config_map);
+        return set_error(ctx, PGAT_ERROR_PROFILE, "failed to load configuration map file %s", file_path);
+    }
+    ctx->profile_loaded = true;
+    ctx->processed = false;
+    ctx->workloads_processed = false;
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_process(pgat_context *ctx)
+{
+    SystemInfo *system_info = &ctx->system_info;
+    PGConfigMapEntry *entry;
+    PGAT_STATUS status;
+
+    if (!ctx->probed)
+        return set_error(ctx, PGAT_ERROR_STATE, "system resources are not probed yet");
+    if (!ctx->profile_loaded)
+        return set_error(ctx, PGAT_ERROR_STATE, "no profile is loaded");
+
+    status = check_bounds(ctx);
+    if (status != PGAT_OK)
+        return status;
+
+    /*
+     * The workload may have changed since the profile was loaded, and the
+     * last run may have written a parameter under its name of another
+     * version.
+     */
+    for (entry = ctx->config_map.list; entry; entry = entry->next)
+    {
+        if (entry->profile_param)
+        {
+            entry->param = entry->profile_param;
+            entry->profile_param = NULL;
+        }
+        if (!select_workload_value(entry, system_info, ctx->config_map.arena))
+            return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+        entry->status = ENTRY_LOADED;
+        entry->message[0] = '\0';
+        entry->conf_ref = NULL;
+    }
+
+    if (ctx->pg_config)
+        load_pg_config_in_map(&ctx->config_map, ctx->pg_config);
+    process_config_map(&ctx->config_map, system_info);
+    apply_evidence(ctx, &ctx->config_map, system_info);
+    ctx->processed = true;
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_analyze_logs(pgat_context *ctx, const char *log_path)
+{
+    char path[MAX_FILE_PATH_SIZE];
+    LogEvidence *evidence;
+
+    if (log_path == NULL)
+    {
+        PGConfigKeyVal *conf = ctx->pg_config ? PGConfig_get_param_by_name(ctx->pg_config, "log_directory") : NULL;
+        const char *directory = DEFAULT_LOG_DIRECTORY;
+        int len;
+
+        if (!ctx->data_dir)
+            return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to find the logs in");
+        /* the parser keeps the closing quote of string values */
+        if (conf && conf->value && conf->value[0])
+            directory = conf->value;
+        len = strcspn(directory, "'");
+        if (directory[0] == '/')
+            snprintf(path, sizeof path, "%.*s", len, directory);
+        else
+            snprintf(path, sizeof path, "%s/%.*s", ctx->data_dir, len, directory);
+        log_path = path;
+    }
+
+    evidence = calloc(1, sizeof *evidence);
+    if (evidence == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!analyze_logs(log_path, evidence))
+    {
+        free_log_evidence(evidence);
+        free(evidence);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the logs in \"%s\" could not be analyzed", log_path);
+    }
+    if (ctx->log_evidence)
+        free_log_evidence(ctx->log_evidence);
+    free(ctx->log_evidence);
+    ctx->log_evidence = evidence;
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_analyze_wal(pgat_context *ctx, const char *wal_dir)
+{
+    char path[MAX_FILE_PATH_SIZE];
+    WalStream *stream;
+
+    if (wal_dir == NULL)
+    {
+        if (!ctx->data_dir)
+            return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to find the WAL in");
+        get_wal_dir(ctx, path, sizeof path);
+        wal_dir = path;
+    }
+
+    stream = calloc(1, sizeof *stream);
+    if (stream == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!analyze_wal_stream(wal_dir, ctx->system_info.server_version, stream))
+    {
+        free(stream);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the WAL in \"%s\" could not be decoded", wal_dir);
+    }
+    free(ctx->wal_stream);
+    ctx->wal_stream = stream;
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_analyze_buffer_trace(pgat_context *ctx, const char **paths, int num_paths, struct miss_ratio_curve *curve)
+{
+    MissRatioCurve local_curve;
+
+    if (!ctx->probed)
+        return set_error(ctx, PGAT_ERROR_STATE, "system resources are not probed yet");
+    if (num_paths <= 0)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "no buffer trace is given");
+    if (curve == NULL)
+        curve = &local_curve;
+    if (!build_miss_ratio_curve(paths, num_paths, (long long)(ctx->system_info.total_ram * MRC_MAX_RAM_PCT / 100), curve))
+        return set_error(ctx, PGAT_ERROR_PROBE, "no miss ratio curve could be built from the buffer traces");
+    ctx->system_info.cache_knee = curve->knee;
+    ctx->processed = false;
+    ctx->workloads_processed = false;
+    return PGAT_OK;
+}
+
+struct log_evidence *
+pgat_get_log_evidence(pgat_context *ctx)
+{
+    return ctx->log_evidence;
+}
+
+PGAT_STATUS
+pgat_scan_cache_residency(pgat_context *ctx, bool keep_blocks)
+{
+    CacheResidency *residency;
+
+    if (!ctx->data_dir)
+        return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to scan");
+    if (ctx->system_info.block_size > 0 && ctx->system_info.block_size != RESIDENCY_BLOCK_SIZE)
+        return set_error(ctx, PGAT_ERROR_PROBE, "the cache residency scan needs %d byte blocks, \"%s\" has %ld",
+                         RESIDENCY_BLOCK_SIZE, ctx->data_dir, ctx->system_info.block_size);
+
+    residency = calloc(1, sizeof *residency);
+    if (residency == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!scan_cache_residency(ctx->data_dir, ctx->system_info.cpu_count, keep_blocks, residency))
+    {
+        free(residency);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the page cache residency of \"%s\" could not be scanned", ctx->data_dir);
+    }
+    if (ctx->cache_residency)
+        free_cache_residency(ctx->cache_residency);
+    free(ctx->cache_residency);
+    ctx->cache_residency = residency;
+    return PGAT_OK;
+}
+
+struct cache_residency *
+pgat_get_cache_residency(pgat_context *ctx)
+{
+    return ctx->cache_residency;
+}
+
+PGAT_STATUS
+pgat_scan_data_dir(pgat_context *ctx)
+{
+    DataDirShape *shape;
+
+    if (!ctx->data_dir)
+        return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to scan");
+
+    shape = calloc(1, sizeof *shape);
+    if (shape == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!scan_data_dir_shape(ctx->data_dir, ctx->system_info.cpu_count, shape))
+    {
+        free(shape);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the data directory \"%s\" could not be scanned", ctx->data_dir);
+    }
+    free(ctx->data_shape);
+    ctx->data_shape = shape;
+    ctx->system_info.data_size = shape->data_size;
+    ctx->system_info.largest_table = shape->num_largest_tables > 0 ? shape->largest_tables[0].size : 0;
+    ctx->system_info.relation_count = shape->num_relations;
+    ctx->processed = false;
+    ctx->workloads_processed = false;
+    return PGAT_OK;
+}
+
+struct data_dir_shape *
+pgat_get_data_dir_shape(pgat_context *ctx)
+{
+    return ctx->data_shape;
+}
+
+PGAT_STATUS
+pgat_scan_heap(pgat_context *ctx)
+{
+    HeapScan *scan;
+
+    if (!ctx->data_dir)
+        return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to scan");
+    if (ctx->system_info.block_size > 0 && ctx->system_info.block_size != HEAP_BLOCK_SIZE)
+        return set_error(ctx, PGAT_ERROR_PROBE, "the heap scan needs %d byte blocks, \"%s\" has %ld",
+                         HEAP_BLOCK_SIZE, ctx->data_dir, ctx->system_info.block_size);
+
+    scan = calloc(1, sizeof *scan);
+    if (scan == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!scan_heap_pages(ctx->data_dir, ctx->system_info.cpu_count, scan))
+    {
+        free(scan);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the heap pages of \"%s\" could not be scanned", ctx->data_dir);
+    }
+    if (ctx->heap_scan)
+        free_heap_scan(ctx->heap_scan);
+    free(ctx->heap_scan);
+    ctx->heap_scan = scan;
+    return PGAT_OK;
+}
+
+struct heap_scan *
+pgat_get_heap_scan(pgat_context *ctx)
+{
+    return ctx->heap_scan;
+}
+
+struct control_info *
+pgat_get_control_info(pgat_context *ctx)
+{
+    return ctx->has_control ? &ctx->control : NULL;
+}
+
+PGAT_STATUS
+pgat_measure_xid_rate(pgat_context *ctx, const char *history_path, int window)
+{
+    XidRate *rate;
+
+    if (!ctx->data_dir)
+        return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to sample");
+    if (!ctx->has_control || !ctx->control.has_control)
+        return set_error(ctx, PGAT_ERROR_PROBE, "the pg_control of \"%s\" could not be read", ctx->data_dir);
+    if (window < 0)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "the sampling window can not be negative");
+
+    rate = calloc(1, sizeof *rate);
+    if (rate == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!measure_xid_rate(ctx->data_dir, &ctx->control, history_path, window, rate))
+    {
+        free(rate);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the transaction ids of \"%s\" could not be sampled", ctx->data_dir);
+    }
+    if (ctx->xid_rate)
+        free_xid_rate(ctx->xid_rate);
+    free(ctx->xid_rate);
+    ctx->xid_rate = rate;
+    return PGAT_OK;
+}
+
+struct xid_rate *
+pgat_get_xid_rate(pgat_context *ctx)
+{
+    return ctx->xid_rate;
+}
+
+struct wal_stream *
+pgat_get_wal_stream(pgat_context *ctx)
+{
+    return ctx->wal_stream;
+}
+
+PGAT_STATUS
+pgat_benchmark_compression(pgat_context *ctx)
+{
+    char wal_dir[MAX_FILE_PATH_SIZE];
+    CompressionBench *bench;
+
+    if (!ctx->data_dir)
+        return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to sample");
+
+    bench = calloc(1, sizeof *bench);
+    if (bench == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    get_wal_dir(ctx, wal_dir, sizeof wal_dir);
+    if (!benchmark_compression(ctx->data_dir, wal_dir, ctx->system_info.block_size, ctx->system_info.cpu_count, bench))
+    {
+        free(bench);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the pages of \"%s\" could not be sampled", ctx->data_dir);
+    }
+    free(ctx->compression);
+    ctx->compression = bench;
+    return PGAT_OK;
+}
+
+struct compression_bench *
+pgat_get_compression_bench(pgat_context *ctx)
+{
+    return ctx->compression;
+}
+
+PGAT_STATUS
+pgat_calibrate_costs(pgat_context *ctx)
+{
+    CostCalibration *calibration;
+
+    if (!ctx->data_dir)
+        return set_error(ctx, PGAT_ERROR_STATE, "no data directory is probed to read");
+
+    calibration = calloc(1, sizeof *calibration);
+    if (calibration == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!calibrate_costs(ctx->data_dir, ctx->system_info.block_size, calibration))
+    {
+        free(calibration);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the planner costs could not be calibrated on \"%s\"", ctx->data_dir);
+    }
+    free(ctx->cost_calibration);
+    ctx->cost_calibration = calibration;
+    return PGAT_OK;
+}
+
+struct cost_calibration *
+pgat_get_cost_calibration(pgat_context *ctx)
+{
+    return ctx->cost_calibration;
+}
+
+PGAT_STATUS
+pgat_find_memory_knee(pgat_context *ctx)
+{
+    MemoryKnee *knee;
+
+    knee = calloc(1, sizeof *knee);
+    if (knee == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!find_memory_knee(ctx->system_info.total_ram, knee))
+    {
+        free(knee);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the sort and hash kernels could not be run");
+    }
+    free(ctx->memory_knee);
+    ctx->memory_knee = knee;
+    return PGAT_OK;
+}
+
+struct memory_knee *
+pgat_get_memory_knee(pgat_context *ctx)
+{
+    return ctx->memory_knee;
+}
+
+PGAT_STATUS
+pgat_measure_memory_bandwidth(pgat_context *ctx)
+{
+    MemoryBandwidth *bandwidth;
+
+    if (!ctx->probed)
+        return set_error(ctx, PGAT_ERROR_STATE, "system resources are not probed yet");
+
+    bandwidth = calloc(1, sizeof *bandwidth);
+    if (bandwidth == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+    if (!measure_memory_bandwidth(ctx->system_info.total_ram, ctx->system_info.cpu_count, bandwidth))
+    {
+        free(bandwidth);
+        return set_error(ctx, PGAT_ERROR_PROBE, "the memory bandwidth could not be measured");
+    }
+    free(ctx->memory_bandwidth);
+    ctx->memory_bandwidth = bandwidth;
+    ctx->system_info.memory_bandwidth = bandwidth->bandwidth[STREAM_TRIAD];
+    ctx->system_info.core_bandwidth = bandwidth->core_bandwidth[STREAM_TRIAD];
+    ctx->system_info.memory_latency = bandwidth->latency;
+    ctx->processed = false;
+    ctx->workloads_processed = false;
+    return PGAT_OK;
+}
+
+struct memory_bandwidth *
+pgat_get_memory_bandwidth(pgat_context *ctx)
+{
+    return ctx->memory_bandwidth;
+}
+
+PGAT_STATUS
+pgat_process_all_workloads(pgat_context *ctx)
+{
+    PGAT_STATUS status;
+    int workload;
+
+    if (!ctx->probed)
+        return set_error(ctx, PGAT_ERROR_STATE, "system resources are not probed yet");
+    if (!ctx->profile_loaded)
+        return set_error(ctx, PGAT_ERROR_STATE, "no profile is loaded");
+
+    status = check_bounds(ctx);
+    if (status != PGAT_OK)
+        return status;
+
+    if (ctx->workload_arena)
+        pg_arena_reset(ctx->workload_arena);
+    else
+        ctx->workload_arena = pg_arena_create(0);
+    if (ctx->workload_arena == NULL)
+        return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+
+    /* One probe and one parse, the factors of every workload are on the entries */
+    for (workload = 0; workload < NUM_WORKLOAD_FACTORS; workload++)
+    {
+        SystemInfo system_info = ctx->system_info;
+        PGConfigMap *config_map = &ctx->workload_maps[workload];
+
+        system_info.workload_type = workload;
+        memset(system_info.workload_weights, 0x00, sizeof system_info.workload_weights);
+        if (!clone_config_map(&ctx->config_map, config_map, &system_info, ctx->workload_arena))
+            return set_error(ctx, PGAT_ERROR_MEMORY, "out of memory");
+        if (ctx->pg_config)
+            load_pg_config_in_map(config_map, ctx->pg_config);
+        process_config_map(config_map, &system_info);
+        apply_evidence(ctx, config_map, &system_info);
+    }
+    ctx->workloads_processed = true;
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_reprocess(pgat_context *ctx, unsigned int resources)
+{
+    PGAT_STATUS status;
+
+    if (!ctx->processed)
+        return set_error(ctx, PGAT_ERROR_STATE, "nothing is processed yet");
+
+    status = check_bounds(ctx);
+    if (status != PGAT_OK)
+        return status;
+    process_config_map_resources(&ctx->config_map, &ctx->system_info, resources);
+    apply_evidence(ctx, &ctx->config_map, &ctx->system_info);
+    return PGAT_OK;
+}
+
+PGAT_STATUS
+pgat_emit(pgat_context *ctx, const char *output_path)
+{
+    if (output_path == NULL)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "no output file given");
+    if (!ctx->processed)
+        return set_error(ctx, PGAT_ERROR_STATE, "nothing is processed yet");
+    return emit_config_map(ctx, &ctx->config_map, output_path);
+}
+
+PGAT_STATUS
+pgat_emit_stream(pgat_context *ctx, FILE *fp)
+{
+    if (fp == NULL)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "no output stream given");
+    if (!ctx->processed)
+        return set_error(ctx, PGAT_ERROR_STATE, "nothing is processed yet");
+    return emit_config_map_stream(ctx, &ctx->config_map, fp);
+}
+
+PGAT_STATUS
+pgat_emit_workload(pgat_context *ctx, WORKLOAD_TYPE workload, const char *output_path)
+{
+    if (output_path == NULL)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "no output file given");
+    if (workload < 0 || workload >= NUM_WORKLOAD_FACTORS)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "invalid workload");
+    if (!ctx->workloads_processed)
+        return set_error(ctx, PGAT_ERROR_STATE, "workloads are not processed yet");
+    return emit_config_map(ctx, &ctx->workload_maps[workload], output_path);
+}
+
+SystemInfo *
+pgat_get_system_info(pgat_context *ctx)
+{
+    return &ctx->system_info;
+}
+
+PGMapProfileDetails *
+pgat_get_profile(pgat_context *ctx)
+{
+    return ctx->profile_loaded ? &ctx->profile : NULL;
+}
+
+PGConfigMap *
+pgat_get_config_map(pgat_context *ctx)
+{
+    return ctx->profile_loaded ? &ctx->config_map : NULL;
+}
+
+PGConfigMap *
+pgat_get_workload_config_map(pgat_context *ctx, WORKLOAD_TYPE workload)
+{
+    if (!ctx->workloads_processed || workload < 0 || workload >= NUM_WORKLOAD_FACTORS)
+        return NULL;
+    return &ctx->workload_maps[workload];
+}
+
+/*
+ * The configuration is written to a temporary file next to the output and
+ * renamed over it, so a server reloading at the wrong moment never reads a
+ * half written file.
+ */
+static PGAT_STATUS
+emit_config_map(pgat_context *ctx, PGConfigMap *config_map, const char *output_path)
+{
+    PGAT_STATUS status;
+    char tmp_path[PATH_MAX + 8];
+    char dir_path[PATH_MAX];
+    char real_path[PATH_MAX];
+    struct stat st;
+    bool exists;
+    FILE *fp;
+    int fd;
+
+    exists = stat(output_path, &st) == 0;
+
+    /* Devices and pipes can not be replaced, they are written in place */
+    if (exists && !S_ISREG(st.st_mode))
+    {
+        fp = fopen(output_path, "w");
+        if (fp == NULL)
+            return set_error(ctx, PGAT_ERROR_IO, "Failed to create configuration file %s reason:%s", output_path, strerror(errno));
+        status = emit_config_map_stream(ctx, config_map, fp);
+        if (fclose(fp) != 0 && status == PGAT_OK)
+            status = set_error(ctx, PGAT_ERROR_IO, "Failed to write configuration file %s reason:%s", output_path, strerror(errno));
+        return status;
+    }
+    /* Replace the file a symbolic link points to, not the link */
+    if (exists && realpath(output_path, real_path))
+        output_path = real_path;
+
+    if (snprintf(tmp_path, sizeof tmp_path, "%s.XXXXXX", output_path) >= (int)sizeof tmp_path)
+        return set_error(ctx, PGAT_ERROR_ARGUMENT, "output file name %s is too long", output_path);
+    fd = mkstemp(tmp_path);
+    if (fd < 0)
+        return set_error(ctx, PGAT_ERROR_IO, "Failed to create configuration file %s reason:%s", output_path, strerror(errno));
+    /* mkstemp creates the file private, keep the mode of the file we replace */
+    fchmod(fd, exists ? (st.st_mode & 07777) : 0644);
+
+    fp = fdopen(fd, "w");
+    if (fp == NULL)
+    {
+        close(fd);
+        unlink(tmp_path);
+        return set_error(ctx, PGAT_ERROR_IO, "Failed to create configuration file %s reason:%s", output_path, strerror(errno));
+    }
+    status = emit_config_map_stream(ctx, config_map, fp);
+    if (status == PGAT_OK && (fflush(fp) != 0 || fsync(fileno(fp)) != 0))
+        status = set_error(ctx, PGAT_ERROR_IO, "Failed to write configuration file %s reason:%s", output_path, strerror(errno));
+    if (fclose(fp) != 0 && status == PGAT_OK)
+        status = set_error(ctx, PGAT_ERROR_IO, "Failed to write configuration file %s reason:%s", output_path, strerror(errno));
+    if (status == PGAT_OK && rename(tmp_path, output_path) != 0)
+        status = set_error(ctx, PGAT_ERROR_IO, "Failed to replace configuration file %s reason:%s", output_path, strerror(errno));
+    if (status != PGAT_OK)
+    {
+        unlink(tmp_path);
+        return status;
+    }
+
+    /* make the rename itself durable */
+    snprintf(dir_path, sizeof dir_path, "%s", output_path);
+    fd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    return PGAT_OK;
+}
+
+static PGAT_STATUS
+emit_config_map_stream(pgat_context *ctx, PGConfigMap *config_map, FILE *fp)
+{
+    write_postgresql_conf(fp, config_map);
+    if (ferror(fp))
+        return set_error(ctx, PGAT_ERROR_IO, "Failed to write configuration reason:%s", strerror(errno));
+    return PGAT_OK;
+}
+
+static PGAT_STATUS
+set_error(pgat_context *ctx, PGAT_STATUS status, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(ctx->error, sizeof ctx->error, fmt, args);
+    va_end(args);
+    return status;
+}
+
+/* What the server showed overrides the model, after every processing */
+static void
+apply_evidence(pgat_context *ctx, PGConfigMap *config_map, SystemInfo *system_info)
+{
+    if (ctx->log_evidence)
+        process_log_evidence(config_map, system_info, ctx->pg_config, ctx->log_evidence);
+    if (ctx->cache_residency)
+        process_cache_residency(config_map, system_info, ctx->cache_residency);
+    if (ctx->heap_scan)
+        process_heap_scan(config_map, system_info, ctx->heap_scan);
+    if (ctx->xid_rate)
+        process_xid_rate(config_map, system_info, ctx->xid_rate);
+    if (ctx->wal_stream)
+        process_wal_stream(config_map, system_info, ctx->pg_config, ctx->wal_stream);
+    if (ctx->compression)
+        process_compression(config_map, system_info, ctx->compression, ctx->wal_stream);
+    if (ctx->cost_calibration)
+        process_cost_calibration(config_map, system_info, ctx->cost_calibration, ctx->cache_residency);
+    if (ctx->memory_knee)
+        process_memory_knee(config_map, system_info, ctx->memory_knee);
+    process_memory_bandwidth(config_map, system_info);
+    /* Last, whatever set a parameter the server has to accept it */
+    process_server_version(config_map, system_info);
+}
+
+static PGAT_STATUS
+check_bounds(pgat_context *ctx)
+{
+    PGMapProfileDetails *profile = &ctx->profile;
+    char error[PGAT_MAX_ERROR_LEN];
+
+    if (profile->max_cpu < profile->min_cpu)
+        fprintf(stderr, "WARNING: Invalid CPU bounds for profile. max_cpu (%ld) is less than min_cpu(%ld) count, ignoring CPU bounds\n",
+                profile->max_cpu, profile->min_cpu);
+    if (profile->max_memory < profile->min_memory)
+        fprintf(stderr, "WARNING: Invalid memory bounds for profile. max_memory (%ld) is less than min_memory(%ld) bytes, ignoring memory bounds\n",
+                profile->max_memory, profile->min_memory);
+    if (!check_profile_bounds(profile, &ctx->system_info, error, sizeof error))
+    {
+        if (!ctx->force_profile)
+            return set_error(ctx, PGAT_ERROR_BOUNDS, "Invalid bounds for profile: %s", error);
+        fprintf(stderr, "ERROR: Invalid bounds for profile: %s\n", error);
+        fprintf(stderr, "Ignoring bounds because of force option ....\n");
+    }
+    return PGAT_OK;
+}
+
+/* Installed memory, or the memory limit of our cgroup when that is lower */
+static long long
+get_ram_size(void)
+{
+    struct sysinfo info;
+    long long total_ram;
+    long long limit;
+
+    if (sysinfo(&info) != 0)
+    {
+        fprintf(stderr, "Failed to retrieve system information %s:\n", strerror(errno));
+        return -1;
+    }
+    total_ram = (long long)info.totalram * info.mem_unit;
+    limit = cgroup_memory_limit();
+    if (limit > 0 && limit < total_ram)
+        total_ram = limit;
+    return total_ram;
+}
+
+/* Online CPUs, or the CPU quota of our cgroup rounded up when that is lower */
+static int
+get_CPU_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    double limit;
+
+    if (count < 1)
+    {
+        fprintf(stderr, "Failed to retrieve CPU core count %s:\n", strerror(errno));
+        return -1;
+    }
+    limit = cgroup_cpu_limit();
+    if (limit > 0 && ceil(limit) < count)
+        count = (long)ceil(limit);
+
+    return count;
+}
+
+static double
+probe_disk_speed(const char *data_dir)
+{
+    char file_path[MAX_FILE_PATH_SIZE];
+    double residency;
+    double speed;
+
+    snprintf(file_path, MAX_FILE_PATH_SIZE, "%s/%s", data_dir, SPEED_TEST_FILE);
+    residency = file_cache_residency(file_path);
+    speed = get_disk_speed(file_path);
+    if (speed <= 0)
+        fprintf(stderr, "WARNING: Failed to get disk read speed of %s\n", data_dir);
+    else if (residency >= 0.5)
+        fprintf(stderr, "WARNING: %.0f%% of %s is in the page cache, the disk read speed is mostly that of the cache\n",
+                residency * 100, file_path);
+    return speed;
+}
+
+static double
+get_disk_speed(const char *filePath)
+{
+    int fd;
+    struct timeval start, end;
+    long long bytes_read = 0;
+    ssize_t len;
+
+#define BUFFER_SIZE (1024 * 8)
+    char buffer[BUFFER_SIZE];
+
+    fd = open(filePath, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to open file %s:\n", strerror(errno));
+        return -1.0;
+    }
+
+    gettimeofday(&start, NULL);
+
+    while ((len = read(fd, buffer, BUFFER_SIZE)) > 0)
+        bytes_read += len;
+
+    gettimeofday(&end, NULL);
+
+    close(fd);
+
+    double duration = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+    double speed = duration > 0 ? (double)bytes_read / (1024.0 * 1024.0 * duration) : -1.0;
+
+    return speed;
+}
+
+/* pg_wal of the data directory, pg_xlog before PostgreSQL 10 */
+static void
+get_wal_dir(pgat_context *ctx, char *path, size_t len)
+{
+    snprintf(path, len, "%s/%s", ctx->data_dir,
+             ctx->system_info.server_version > 0 && ctx->system_info.server_version < 100000 ? WAL_DIR_PRE_10 : WAL_DIR);
+}
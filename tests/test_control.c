@@ -0,0 +1,387 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_control.c
+ *		pg_control is read at the offsets of every server version, a
+ *		damaged one is refused, and the WAL sizes of a profile are
+ *		rounded to the WAL segments of the data directory.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "pgautotune.h"
+#include "pg_control.h"
+
+#define MB (1024 * 1024)
+
+/*
+ * A ControlFileData of the server as laid out on x86-64: where the
+ * checkpoint copy starts, where floatFormat falls after it, and where the
+ * CRC follows floatFormat.
+ */
+typedef struct control_layout
+{
+    const char *pg_version;     /* contents of PG_VERSION */
+    int server_version;
+    size_t checkpoint;          /* checkPointCopy */
+    size_t float_format;        /* floatFormat */
+    size_t crc;                 /* crc, from floatFormat */
+    uint32_t wal_segment_size;
+} ControlLayout;
+
+static const ControlLayout layouts[] = {
+    {"9.6\n", 90600, 48, 208, 48, 16 * MB},
+    {"10\n", 100000, 48, 208, 80, 16 * MB},      /* mock_authentication_nonce */
+    {"11\n", 110000, 40, 200, 80, 32 * MB},      /* prevCheckPoint is gone */
+    {"16\n", 160000, 40, 208, 80, 64 * MB},      /* 64 bit nextXid, max_wal_senders */
+    {"18\n", 180000, 40, 208, 84, 1 * MB},       /* default_char_signedness */
+    {NULL}
+};
+
+#define SYSTEM_IDENTIFIER 7301234567890123456ULL
+#define NEXT_XID_EPOCH 5
+#define NEXT_XID 1000000
+#define OLDEST_XID 400000
+#define NEXT_MULTI 3000
+#define OLDEST_MULTI 20
+#define CHECKPOINT_TIME 1700000000
+#define DB_IN_PRODUCTION 6
+
+/* A profile asking for WAL sizes that are no multiple of the segments */
+static const char *profile_json =
+    "{\n"
+    "    \"name\" : \"WAL segments test\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"min_wal_size\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : \"20MB\", \"oltp_factor\" : \"20MB\", \"mixed_factor\" : \"20MB\"},\n"
+    "        {\"parameter\" : \"max_wal_size\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : \"1000MB\", \"oltp_factor\" : \"1000MB\", \"mixed_factor\" : \"1000MB\"},\n"
+    "        {\"parameter\" : \"wal_keep_segments\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : 10, \"oltp_factor\" : 10, \"mixed_factor\" : 10}\n"
+    "    ]\n"
+    "}\n";
+
+typedef struct wal_case
+{
+    int layout;                 /* of layouts[] */
+    const char *lines[4];       /* expected in the emitted configuration */
+} WalCase;
+
+static const WalCase wal_cases[] = {
+    /* wal_keep_segments still exists, nothing to convert */
+    {0, {"min_wal_size = 32768kB", "max_wal_size = 1032192kB", "wal_keep_segments = 10", NULL}},
+    /* two segments at least, and up to whole segments of 32MB */
+    {2, {"min_wal_size = 65536kB", "max_wal_size = 1048576kB", "wal_keep_segments = 10", NULL}},
+    /* segments of 64MB for wal_keep_size too */
+    {3, {"min_wal_size = 131072kB", "max_wal_size = 1048576kB", "wal_keep_size = 655360kB", NULL}},
+    /* whole segments of 1MB already, the sizes are left as the profile writes them */
+    {4, {"min_wal_size = 20MB", "max_wal_size = 1000MB", "wal_keep_size = 10240kB", NULL}},
+    {-1}
+};
+
+static bool write_file(const char *path, const void *data, size_t len);
+static bool write_data_dir(const char *dir, const ControlLayout *layout);
+static int check_layout(const char *dir, const ControlLayout *layout);
+static int check_damaged(const char *dir);
+static int check_wal_segments(const char *dir, const WalCase *wal_case);
+static char *process_and_emit(pgat_context *ctx);
+static void remove_data_dir(const char *dir);
+
+int
+main(void)
+{
+    char dir[] = "/tmp/pgat_test_XXXXXX";
+    char path[512];
+    const WalCase *wal_case;
+    const ControlLayout *layout;
+    int failed = 0;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Not possible to create the test directory");
+        return 1;
+    }
+    for (layout = layouts; layout->pg_version; layout++)
+        failed |= check_layout(dir, layout);
+    failed |= check_damaged(dir);
+    for (wal_case = wal_cases; wal_case->layout >= 0; wal_case++)
+        failed |= check_wal_segments(dir, wal_case);
+
+    remove_data_dir(dir);
+    snprintf(path, sizeof path, "%s/profile.json", dir);
+    unlink(path);
+    rmdir(dir);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static bool
+write_file(const char *path, const void *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return false;
+    }
+    if (fwrite(data, 1, len, fp) != len)
+    {
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+static void
+put32(unsigned char *data, size_t offset, uint32_t value)
+{
+    memcpy(data + offset, &value, sizeof value);
+}
+
+static void
+put64(unsigned char *data, size_t offset, uint64_t value)
+{
+    memcpy(data + offset, &value, sizeof value);
+}
+
+/* PG_VERSION, an empty postgresql.conf and a pg_control of the layout */
+static bool
+write_data_dir(const char *dir, const ControlLayout *layout)
+{
+    unsigned char data[PG_CONTROL_FILE_SIZE];
+    const double float_format = 1234567.0;
+    size_t cp = layout->checkpoint;
+    size_t f = layout->float_format;
+    char path[512];
+
+    memset(data, 0, sizeof data);
+    put64(data, 0, SYSTEM_IDENTIFIER);
+    put32(data, 8, 1300);
+    put32(data, 12, 202307071);
+    put32(data, 16, DB_IN_PRODUCTION);
+    if (layout->server_version >= 120000)
+    {
+        put64(data, cp + 24, (uint64_t)NEXT_XID_EPOCH << 32 | NEXT_XID);
+        put32(data, cp + 36, NEXT_MULTI);
+        put32(data, cp + 44, OLDEST_XID);
+        put32(data, cp + 52, OLDEST_MULTI);
+        put64(data, cp + 64, CHECKPOINT_TIME);
+    }
+    else
+    {
+        put32(data, cp + 20, NEXT_XID_EPOCH);
+        put32(data, cp + 24, NEXT_XID);
+        put32(data, cp + 32, NEXT_MULTI);
+        put32(data, cp + 40, OLDEST_XID);
+        put32(data, cp + 48, OLDEST_MULTI);
+        put64(data, cp + 56, CHECKPOINT_TIME);
+    }
+    put32(data, f - 4, 8);                              /* maxAlign */
+    memcpy(data + f, &float_format, sizeof float_format);
+    put32(data, f + 8, 8192);                           /* blcksz */
+    put32(data, f + 12, 131072);                        /* relseg_size */
+    put32(data, f + 16, 8192);                          /* xlog_blcksz */
+    put32(data, f + 20, layout->wal_segment_size);
+    put32(data, f + 24, 64);                            /* nameDataLen */
+    put32(data, f + 28, 32);                            /* indexMaxKeys */
+    put32(data, f + 44, 1);                             /* data_checksum_version */
+    put32(data, f + layout->crc, FIN_CRC32C(comp_crc32c(INIT_CRC32C, data, f + layout->crc)));
+
+    snprintf(path, sizeof path, "%s/global", dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof path, "%s/%s", dir, PG_CONTROL_FILE);
+    if (!write_file(path, data, sizeof data))
+        return false;
+    snprintf(path, sizeof path, "%s/%s", dir, PG_VERSION_FILE);
+    if (!write_file(path, layout->pg_version, strlen(layout->pg_version)))
+        return false;
+    snprintf(path, sizeof path, "%s/postgresql.conf", dir);
+    return write_file(path, "", 0);
+}
+
+static void
+remove_data_dir(const char *dir)
+{
+    char path[512];
+
+    snprintf(path, sizeof path, "%s/%s", dir, PG_CONTROL_FILE);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/global", dir);
+    rmdir(path);
+    snprintf(path, sizeof path, "%s/%s", dir, PG_VERSION_FILE);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/postgresql.conf", dir);
+    unlink(path);
+}
+
+static int
+check_layout(const char *dir, const ControlLayout *layout)
+{
+    ControlInfo info;
+
+    if (!write_data_dir(dir, layout))
+        return 1;
+    if (!read_control_info(dir, &info) || !info.has_control)
+    {
+        fprintf(stderr, "ERROR: pg_control of version %d is not read\n", layout->server_version);
+        return 1;
+    }
+    if (info.server_version != layout->server_version || info.system_identifier != SYSTEM_IDENTIFIER ||
+        info.state != DB_IN_PRODUCTION || info.block_size != 8192 || info.segment_blocks != 131072 ||
+        info.wal_block_size != 8192 || info.wal_segment_size != layout->wal_segment_size ||
+        info.data_checksum_version != 1)
+    {
+        fprintf(stderr, "ERROR: pg_control of version %d: version %d, block size %u, WAL segment size %u\n",
+                layout->server_version, info.server_version, info.block_size, info.wal_segment_size);
+        return 1;
+    }
+    if (info.next_xid != ((uint64_t)NEXT_XID_EPOCH << 32 | NEXT_XID) || info.oldest_xid != OLDEST_XID ||
+        info.next_multi != NEXT_MULTI || info.oldest_multi != OLDEST_MULTI || info.checkpoint_time != CHECKPOINT_TIME)
+    {
+        fprintf(stderr, "ERROR: checkpoint of version %d: next xid %u:%u, oldest xid %u, next multi %u, oldest multi %u, time %lld\n",
+                layout->server_version, (uint32_t)(info.next_xid >> 32), (uint32_t)info.next_xid, info.oldest_xid,
+                info.next_multi, info.oldest_multi, (long long)info.checkpoint_time);
+        return 1;
+    }
+    return 0;
+}
+
+/* A flipped byte fails the CRC, no pg_control at all only leaves the version */
+static int
+check_damaged(const char *dir)
+{
+    ControlInfo info;
+    unsigned char data[PG_CONTROL_FILE_SIZE];
+    char path[512];
+    FILE *fp;
+    int saved_fd;
+    int null_fd;
+    bool read;
+    int failed = 0;
+
+    if (!write_data_dir(dir, &layouts[3]))
+        return 1;
+    snprintf(path, sizeof path, "%s/%s", dir, PG_CONTROL_FILE);
+    fp = fopen(path, "rb");
+    if (fp == NULL || fread(data, 1, sizeof data, fp) != sizeof data)
+    {
+        if (fp)
+            fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    data[layouts[3].checkpoint + 44] ^= 0x01;
+    if (!write_file(path, data, sizeof data))
+        return 1;
+
+    /* the refusal is reported on stderr, which is not what we test */
+    fflush(stderr);
+    saved_fd = dup(STDERR_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    if (saved_fd >= 0 && null_fd >= 0)
+        dup2(null_fd, STDERR_FILENO);
+    if (null_fd >= 0)
+        close(null_fd);
+    read = read_control_info(dir, &info);
+    fflush(stderr);
+    if (saved_fd >= 0)
+    {
+        dup2(saved_fd, STDERR_FILENO);
+        close(saved_fd);
+    }
+    if (read)
+    {
+        fprintf(stderr, "ERROR: pg_control with a byte changed is read\n");
+        failed = 1;
+    }
+
+    unlink(path);
+    if (!read_control_info(dir, &info) || info.has_control || info.server_version != 160000)
+    {
+        fprintf(stderr, "ERROR: data directory without pg_control is not read for its version only\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+static int
+check_wal_segments(const char *dir, const WalCase *wal_case)
+{
+    const ControlLayout *layout = &layouts[wal_case->layout];
+    pgat_context *ctx;
+    char path[512];
+    char *text;
+    int failed = 0;
+    int i;
+
+    snprintf(path, sizeof path, "%s/profile.json", dir);
+    if (!write_data_dir(dir, layout) || !write_file(path, profile_json, strlen(profile_json)))
+        return 1;
+
+    ctx = pgat_create();
+    pgat_set_resources(ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    if (pgat_probe(ctx, dir) != PGAT_OK || pgat_load_profile(ctx, path) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        pgat_destroy(ctx);
+        return 1;
+    }
+    text = process_and_emit(ctx);
+    pgat_destroy(ctx);
+    if (text == NULL)
+        return 1;
+    for (i = 0; wal_case->lines[i]; i++)
+    {
+        if (strstr(text, wal_case->lines[i]) == NULL)
+        {
+            fprintf(stderr, "ERROR: \"%s\" expected for version %d with WAL segments of %u bytes, got:\n%s",
+                    wal_case->lines[i], layout->server_version, layout->wal_segment_size, text);
+            failed = 1;
+        }
+    }
+    free(text);
+    return failed;
+}
+
+/* The emitted configuration of a pgat_process(), NULL on failure */
+static char *
+process_and_emit(pgat_context *ctx)
+{
+    char *text = NULL;
+    size_t len = 0;
+    FILE *fp;
+
+    if (pgat_process(ctx) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        return NULL;
+    }
+    fp = open_memstream(&text, &len);
+    if (fp == NULL)
+        return NULL;
+    if (pgat_emit_stream(ctx, fp) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        fclose(fp);
+        free(text);
+        return NULL;
+    }
+    fclose(fp);
+    return text;
+}
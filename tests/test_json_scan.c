@@ -0,0 +1,365 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_json_scan.c
+ *		The fast path parser gives the same values as json_parse_ex(),
+ *		wherever the escapes fall in the 64 byte blocks of the scanner,
+ *		and rejects the documents json_parse_ex() rejects with the same
+ *		error. A cursor walk of the tape finds the same values at the same
+ *		positions, also for what only json_parse_ex() takes.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "json_scan.h"
+
+/* Past two blocks of the scanner */
+#define MAX_PADDING 130
+
+static const char *valid_documents[] = {
+    "{\"a\" : 1, \"b\" : [true, false, null], \"c\" : {}, \"d\" : []}",
+    "[0, -0, 1, -1, 9223372036854775807, -9223372036854775808, 1.5, -2.25e3, 1E-2, 6.02e+23]",
+    "{\"escapes\" : \"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"}",
+    "{\"unicode\" : \"\\u0041\\u00e9\\u20ac\\ud83d\\ude00 raw \xc3\xa9\"}",
+    "{\"backslashes\" : [\"\\\\\", \"\\\\\\\\\", \"\\\\\\\"\", \"a\\\\\\\\\\\\\\\"b\"]}",
+    "{\"\\\"key\\\"\" : \"\\\"value\\\"\", \"k\\\\\" : \"v\\\\\"}",
+    "\"a lone string\"",
+    "[[[[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]]]]",
+    "{\n  \"lines\" : [\n    1,\n    \"two\",\n\t{\"three\" : 3.0}\n  ]\r\n}\n",
+    "[1.00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000000000000000000000000001]",
+    NULL
+};
+
+/* Too loose for the fast path, the tape gets them from json_parse_ex() */
+static const char *lenient_documents[] = {
+    "{\"a\" : 1,}",
+    "[\"\\x\"]",
+    "[\"tab\tinside\"]",
+    NULL
+};
+
+static const char *invalid_documents[] = {
+    "[1 2]",
+    "\"unterminated",
+    "{\"a\" 1}",
+    "[tru]",
+    "[01]",
+    "[1.]",
+    "[\"\\ud800\"]",
+    "{\"a\" : 1} 2",
+    "[1, 2",
+    NULL
+};
+
+static int check_valid(const char *json, size_t length, bool fast_path);
+static int check_too_deep(void);
+static int check_invalid(const char *json);
+static int compare_values(json_value *fast, json_value *slow, const char *json);
+static int compare_cursor(const json_cursor *cursor, json_value *slow, const char *json);
+
+int
+main(void)
+{
+    char document[4096];
+    int failed = 0;
+    int i, padding;
+
+    for (i = 0; valid_documents[i]; i++)
+    {
+        /* move every escape across the block boundaries of the scanner */
+        for (padding = 0; padding <= MAX_PADDING; padding++)
+        {
+            memset(document, ' ', padding);
+            strcpy(document + padding, valid_documents[i]);
+            failed |= check_valid(document, strlen(document), true);
+        }
+    }
+    for (i = 0; lenient_documents[i]; i++)
+        failed |= check_valid(lenient_documents[i], strlen(lenient_documents[i]), false);
+    for (i = 0; invalid_documents[i]; i++)
+        failed |= check_invalid(invalid_documents[i]);
+    failed |= check_too_deep();
+
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+/* fast_path tells whether the document is one the scanner has to take itself */
+static int
+check_valid(const char *json, size_t length, bool fast_path)
+{
+    json_settings settings;
+    char error[json_error_max];
+    json_value *fast;
+    json_value *slow;
+    json_tape tape;
+    json_cursor root;
+    int failed = 0;
+
+    memset(&settings, 0x00, sizeof settings);
+    slow = json_parse_ex(&settings, json, length, error);
+    if (slow == NULL)
+    {
+        fprintf(stderr, "ERROR: json_parse_ex() rejects %s: %s\n", json, error);
+        return 1;
+    }
+
+    /* a fallback would compare the scalar parser with itself */
+    if ((json_tape_parse(&tape, json, length) == 0) != fast_path)
+    {
+        fprintf(stderr, "ERROR: the fast path %s %s\n", fast_path ? "rejects" : "takes", json);
+        json_tape_free(&tape);
+        json_value_free(slow);
+        return 1;
+    }
+    json_tape_free(&tape);
+    if (json_tape_parse_ex(&tape, json, length, error) != 0 || json_tape_index_lines(&tape, json, length) != 0)
+    {
+        fprintf(stderr, "ERROR: the tape rejects %s: %s\n", json, error);
+        json_value_free(slow);
+        return 1;
+    }
+    json_tape_root(&tape, &root);
+    failed |= compare_cursor(&root, slow, json);
+    json_tape_free(&tape);
+
+    fast = json_parse_fast(&settings, json, length, error);
+    if (fast == NULL)
+    {
+        fprintf(stderr, "ERROR: json_parse_fast() rejects %s: %s\n", json, error);
+        failed = 1;
+    }
+    else
+    {
+        failed |= compare_values(fast, slow, json);
+        json_value_free(fast);
+    }
+    json_value_free(slow);
+    return failed;
+}
+
+static int
+check_invalid(const char *json)
+{
+    json_settings settings;
+    char fast_error[json_error_max];
+    char slow_error[json_error_max];
+    char tape_error[json_error_max];
+    json_value *value;
+    json_tape tape;
+    int failed = 0;
+
+    memset(&settings, 0x00, sizeof settings);
+    value = json_parse_ex(&settings, json, strlen(json), slow_error);
+    if (value)
+    {
+        fprintf(stderr, "ERROR: json_parse_ex() takes %s\n", json);
+        json_value_free(value);
+        return 1;
+    }
+    value = json_parse_fast(&settings, json, strlen(json), fast_error);
+    if (value)
+    {
+        fprintf(stderr, "ERROR: json_parse_fast() takes %s\n", json);
+        json_value_free(value);
+        failed = 1;
+    }
+    else if (strcmp(fast_error, slow_error) != 0)
+    {
+        fprintf(stderr, "ERROR: %s is rejected with \"%s\", expected \"%s\"\n", json, fast_error, slow_error);
+        failed = 1;
+    }
+    if (json_tape_parse_ex(&tape, json, strlen(json), tape_error) == 0)
+    {
+        fprintf(stderr, "ERROR: the tape takes %s\n", json);
+        json_tape_free(&tape);
+        failed = 1;
+    }
+    else if (strcmp(tape_error, slow_error) != 0)
+    {
+        fprintf(stderr, "ERROR: the tape rejects %s with \"%s\", expected \"%s\"\n", json, tape_error, slow_error);
+        failed = 1;
+    }
+    return failed;
+}
+
+/* Deeper than the tape goes, json_parse_ex() takes it but the tape refuses it */
+static int
+check_too_deep(void)
+{
+    char error[json_error_max];
+    json_tape tape;
+    char *json;
+    int depth = JSON_TAPE_MAX_DEPTH + 2;
+
+    json = malloc(2 * depth + 1);
+    if (json == NULL)
+        return 1;
+    memset(json, '[', depth);
+    memset(json + depth, ']', depth);
+    json[2 * depth] = '\0';
+    if (json_tape_parse_ex(&tape, json, 2 * depth, error) == 0)
+    {
+        fprintf(stderr, "ERROR: the tape takes %d nested arrays\n", depth);
+        json_tape_free(&tape);
+        free(json);
+        return 1;
+    }
+    free(json);
+    if (strstr(error, "nested deeper") == NULL)
+    {
+        fprintf(stderr, "ERROR: %d nested arrays are refused with \"%s\"\n", depth, error);
+        return 1;
+    }
+    return 0;
+}
+
+static int
+compare_values(json_value *fast, json_value *slow, const char *json)
+{
+    unsigned int i;
+
+    if (fast->type != slow->type || fast->line != slow->line || fast->col != slow->col)
+    {
+        fprintf(stderr, "ERROR: type %d at %u:%u, expected type %d at %u:%u in %s\n", fast->type,
+                fast->line, fast->col, slow->type, slow->line, slow->col, json);
+        return 1;
+    }
+    switch (slow->type)
+    {
+    case json_object:
+        if (fast->u.object.length != slow->u.object.length)
+            break;
+        for (i = 0; i < slow->u.object.length; i++)
+        {
+            if (fast->u.object.values[i].name_length != slow->u.object.values[i].name_length ||
+                memcmp(fast->u.object.values[i].name, slow->u.object.values[i].name,
+                       slow->u.object.values[i].name_length + 1) != 0 ||
+                compare_values(fast->u.object.values[i].value, slow->u.object.values[i].value, json))
+                return 1;
+        }
+        return 0;
+    case json_array:
+        if (fast->u.array.length != slow->u.array.length)
+            break;
+        for (i = 0; i < slow->u.array.length; i++)
+        {
+            if (compare_values(fast->u.array.values[i], slow->u.array.values[i], json))
+                return 1;
+        }
+        return 0;
+    case json_string:
+        if (fast->u.string.length == slow->u.string.length &&
+            memcmp(fast->u.string.ptr, slow->u.string.ptr, slow->u.string.length + 1) == 0)
+            return 0;
+        break;
+    case json_integer:
+        if (fast->u.integer == slow->u.integer)
+            return 0;
+        break;
+    case json_double:
+        if (fast->u.dbl == slow->u.dbl)
+            return 0;
+        break;
+    case json_boolean:
+        if (fast->u.boolean == slow->u.boolean)
+            return 0;
+        break;
+    default:
+        return 0;
+    }
+    fprintf(stderr, "ERROR: value at %u:%u differs from json_parse_ex() in %s\n", slow->line, slow->col, json);
+    return 1;
+}
+
+static int
+compare_cursor(const json_cursor *cursor, json_value *slow, const char *json)
+{
+    const json_tape_node *node = json_cursor_node(cursor);
+    json_cursor child;
+    json_cursor found;
+    json_value *first;
+    unsigned int line = 0, col = 0;
+    double number;
+    unsigned int i;
+
+    json_cursor_position(cursor, &line, &col);
+    if (node->type != slow->type || line != slow->line || col != slow->col)
+    {
+        fprintf(stderr, "ERROR: cursor on type %d at %u:%u, expected type %d at %u:%u in %s\n", node->type,
+                line, col, slow->type, slow->line, slow->col, json);
+        return 1;
+    }
+    switch (slow->type)
+    {
+    case json_object:
+        if (node->length != slow->u.object.length || (node->length > 0 && !json_cursor_child(cursor, &child)))
+            break;
+        for (i = 0; i < slow->u.object.length; i++)
+        {
+            json_object_entry *entry = &slow->u.object.values[i];
+
+            if (strcmp(json_cursor_string(&child), entry->name) != 0)
+                break;
+            json_cursor_next(&child);
+            if (compare_cursor(&child, entry->value, json))
+                return 1;
+            /* a key given twice is found at its first definition, like json_get_value_for_key() */
+            first = json_get_value_for_key(slow, entry->name);
+            if (!json_cursor_get(cursor, entry->name, &found) || !json_cursor_position(&found, &line, &col) ||
+                line != first->line || col != first->col)
+            {
+                fprintf(stderr, "ERROR: json_cursor_get() does not find \"%s\" in %s\n", entry->name, json);
+                return 1;
+            }
+            json_cursor_next(&child);
+        }
+        if (i < slow->u.object.length)
+            break;
+        return 0;
+    case json_array:
+        if (node->length != slow->u.array.length || (node->length > 0 && !json_cursor_child(cursor, &child)))
+            break;
+        for (i = 0; i < slow->u.array.length; i++, json_cursor_next(&child))
+        {
+            if (compare_cursor(&child, slow->u.array.values[i], json))
+                return 1;
+        }
+        return 0;
+    case json_string:
+        if (node->length == slow->u.string.length &&
+            memcmp(json_cursor_string(cursor), slow->u.string.ptr, slow->u.string.length + 1) == 0)
+            return 0;
+        break;
+    case json_integer:
+        if (node->u.integer == slow->u.integer && json_cursor_number(cursor, &number) &&
+            number == (double)slow->u.integer)
+            return 0;
+        break;
+    case json_double:
+        if (node->u.dbl == slow->u.dbl && json_cursor_number(cursor, &number) && number == slow->u.dbl)
+            return 0;
+        break;
+    case json_boolean:
+        if (node->u.boolean == slow->u.boolean)
+            return 0;
+        break;
+    default:
+        return 0;
+    }
+    fprintf(stderr, "ERROR: cursor value at %u:%u differs from json_parse_ex() in %s\n", slow->line, slow->col, json);
+    return 1;
+}
@@ -0,0 +1,284 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_profile_image.c
+ *		A profile compiled into an image loads back to the same map, and
+ *		an image changed after it was written is refused.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "pgautotune.h"
+#include "pg_profile_image.h"
+
+static const char *profile_json =
+    "{\n"
+    "    \"name\" : \"Image test\",\n"
+    "    \"author\" : \"tests\",\n"
+    "    \"description\" : \"every kind of value an entry can hold\",\n"
+    "    \"min_memory\" : 1024,\n"
+    "    \"max_cpu\" : 64,\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"shared_buffers\", \"resource\" : \"memory\", \"formula\" : \"percentage\",\n"
+    "         \"olap_factor\" : 25, \"oltp_factor\" : 20.5, \"mixed_factor\" : \"22\",\n"
+    "         \"min\" : \"128MB\", \"max\" : \"8GB\", \"blend\" : \"geometric\"},\n"
+    "        {\"parameter\" : \"work_mem\", \"resource\" : \"memory\", \"formula\" : \"percentage\",\n"
+    "         \"olap_factor\" : 1, \"oltp_factor\" : 0.5, \"mixed_factor\" : 1, \"trigger\" : 4096},\n"
+    "        {\"parameter\" : \"max_connections\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : 50, \"oltp_factor\" : 500, \"mixed_factor\" : 200, \"max\" : 1000}\n"
+    "    ]\n"
+    "}\n";
+
+static bool write_file(const char *path, const char *text);
+static int compare_maps(PGConfigMap *json_map, PGConfigMap *image_map);
+static int compare_profiles(PGMapProfileDetails *json_profile, PGMapProfileDetails *image_profile);
+static int check_corruption(const char *image_path, const char *corrupt_path, long offset);
+static bool same_text(const char *a, const char *b);
+
+int
+main(void)
+{
+    char dir[] = "/tmp/pgat_test_XXXXXX";
+    char json_path[512];
+    char image_path[512];
+    char corrupt_path[512];
+    pgat_context *json_ctx;
+    pgat_context *image_ctx;
+    int failed = 0;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Not possible to create the test directory");
+        return 1;
+    }
+    snprintf(json_path, sizeof json_path, "%s/profile.json", dir);
+    snprintf(image_path, sizeof image_path, "%s/profile.img", dir);
+    snprintf(corrupt_path, sizeof corrupt_path, "%s/corrupt.img", dir);
+    if (!write_file(json_path, profile_json))
+        return 1;
+
+    json_ctx = pgat_create();
+    image_ctx = pgat_create();
+    pgat_set_resources(json_ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    pgat_set_resources(image_ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    if (pgat_load_profile(json_ctx, json_path) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(json_ctx));
+        return 1;
+    }
+    if (compile_profile_image(pgat_get_config_map(json_ctx), pgat_get_profile(json_ctx), image_path) < 0)
+    {
+        fprintf(stderr, "ERROR: profile image %s not written\n", image_path);
+        return 1;
+    }
+
+    if (!is_profile_image(image_path) || is_profile_image(json_path))
+    {
+        fprintf(stderr, "ERROR: the image and the json profile are not told apart\n");
+        failed = 1;
+    }
+    if (pgat_load_profile(image_ctx, image_path) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(image_ctx));
+        failed = 1;
+    }
+    else
+    {
+        failed |= compare_profiles(pgat_get_profile(json_ctx), pgat_get_profile(image_ctx));
+        failed |= compare_maps(pgat_get_config_map(json_ctx), pgat_get_config_map(image_ctx));
+    }
+
+    /* a byte of the first entry, and a character of the last string */
+    failed |= check_corruption(image_path, corrupt_path, (long)sizeof(ProfileImageHeader) + 1);
+    failed |= check_corruption(image_path, corrupt_path, -2);
+
+    pgat_destroy(json_ctx);
+    pgat_destroy(image_ctx);
+    unlink(json_path);
+    unlink(image_path);
+    unlink(corrupt_path);
+    rmdir(dir);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static bool
+write_file(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return false;
+    }
+    fputs(text, fp);
+    fclose(fp);
+    return true;
+}
+
+static bool
+same_text(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return strcmp(a, b) == 0;
+}
+
+static int
+compare_profiles(PGMapProfileDetails *json_profile, PGMapProfileDetails *image_profile)
+{
+    if (!same_text(json_profile->name, image_profile->name) ||
+        !same_text(json_profile->author, image_profile->author) ||
+        !same_text(json_profile->description, image_profile->description) ||
+        !same_text(json_profile->version, image_profile->version) ||
+        !same_text(json_profile->engine, image_profile->engine) ||
+        !same_text(json_profile->date_created, image_profile->date_created) ||
+        json_profile->min_memory != image_profile->min_memory ||
+        json_profile->min_cpu != image_profile->min_cpu ||
+        json_profile->max_memory != image_profile->max_memory ||
+        json_profile->max_cpu != image_profile->max_cpu)
+    {
+        fprintf(stderr, "ERROR: profile details of the image differ from those of the json profile\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int
+compare_maps(PGConfigMap *json_map, PGConfigMap *image_map)
+{
+    PGConfigMapEntry *expected;
+    PGConfigMapEntry *entry;
+    int failed = 0;
+    int w;
+
+    if (json_map->num_entries != image_map->num_entries)
+    {
+        fprintf(stderr, "ERROR: %d entries in the image, %d in the json profile\n",
+                image_map->num_entries, json_map->num_entries);
+        failed = 1;
+    }
+    for (expected = json_map->list; expected; expected = expected->next)
+    {
+        for (entry = image_map->list; entry; entry = entry->next)
+        {
+            if (strcasecmp(entry->param, expected->param) == 0)
+                break;
+        }
+        if (entry == NULL)
+        {
+            fprintf(stderr, "ERROR: parameter \"%s\" is missing from the image\n", expected->param);
+            failed = 1;
+            continue;
+        }
+        for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+        {
+            if (!same_text(entry->workload_values[w], expected->workload_values[w]))
+            {
+                fprintf(stderr, "ERROR: parameter \"%s\" workload %d is %s in the image, %s in the json profile\n",
+                        expected->param, w, entry->workload_values[w], expected->workload_values[w]);
+                failed = 1;
+            }
+        }
+        if (entry->resource != expected->resource || entry->formula != expected->formula ||
+            entry->type != expected->type || entry->blend != expected->blend ||
+            !same_text(entry->value, expected->value) || entry->factor_value != expected->factor_value ||
+            entry->trigger_value != expected->trigger_value ||
+            entry->has_min != expected->has_min || entry->min_value != expected->min_value ||
+            entry->has_max != expected->has_max || entry->max_value != expected->max_value)
+        {
+            fprintf(stderr, "ERROR: parameter \"%s\" of the image differs from the json profile\n", expected->param);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+/*
+ * Copy the image with one byte flipped, at offset from the start or from
+ * the end when negative, and expect the copy to be refused for its checksum.
+ */
+static int
+check_corruption(const char *image_path, const char *corrupt_path, long offset)
+{
+    pgat_context *ctx;
+    PGAT_STATUS status;
+    char output[1024];
+    char *image;
+    long size;
+    FILE *fp;
+    FILE *capture;
+    size_t len;
+    int saved_fd;
+
+    fp = fopen(image_path, "rb");
+    if (fp == NULL)
+        return 1;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    image = malloc(size);
+    if (image == NULL || fread(image, 1, size, fp) != (size_t)size)
+    {
+        fclose(fp);
+        free(image);
+        return 1;
+    }
+    fclose(fp);
+    image[offset < 0 ? size + offset : offset] ^= 0x20;
+    fp = fopen(corrupt_path, "wb");
+    if (fp == NULL || fwrite(image, 1, size, fp) != (size_t)size)
+    {
+        if (fp)
+            fclose(fp);
+        free(image);
+        return 1;
+    }
+    fclose(fp);
+    free(image);
+
+    /* the refusal goes to stderr, keep it to check the reason */
+    capture = tmpfile();
+    if (capture == NULL)
+        return 1;
+    fflush(stderr);
+    saved_fd = dup(STDERR_FILENO);
+    dup2(fileno(capture), STDERR_FILENO);
+    ctx = pgat_create();
+    pgat_set_resources(ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    status = pgat_load_profile(ctx, corrupt_path);
+    pgat_destroy(ctx);
+    fflush(stderr);
+    dup2(saved_fd, STDERR_FILENO);
+    close(saved_fd);
+    rewind(capture);
+    len = fread(output, 1, sizeof output - 1, capture);
+    output[len] = '\0';
+    fclose(capture);
+
+    if (status == PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: image with byte %ld changed is loaded\n", offset);
+        return 1;
+    }
+    if (strstr(output, "checksum mismatch") == NULL)
+    {
+        fprintf(stderr, "ERROR: image with byte %ld changed is refused for another reason:\n%s", offset, output);
+        return 1;
+    }
+    return 0;
+}
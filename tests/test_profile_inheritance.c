@@ -0,0 +1,266 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_profile_inheritance.c
+ *		A profile extending others takes every key from the top-most
+ *		profile of the chain that defines it, and a chain longer than the
+ *		depth limit is refused.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "pgautotune.h"
+
+/* MAX_PROFILE_DEPTH of pg_json_config_map.c */
+#define PROFILE_DEPTH_LIMIT 16
+
+static const char *base_json =
+    "{\n"
+    "    \"name\" : \"base\",\n"
+    "    \"author\" : \"base author\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"work_mem\", \"resource\" : \"memory\", \"formula\" : \"percentage\",\n"
+    "         \"olap_factor\" : 1, \"oltp_factor\" : 2, \"mixed_factor\" : 3},\n"
+    "        {\"parameter\" : \"maintenance_work_mem\", \"resource\" : \"memory\", \"formula\" : \"percentage\",\n"
+    "         \"olap_factor\" : 4, \"oltp_factor\" : 5, \"mixed_factor\" : 6},\n"
+    "        {\"parameter\" : \"max_connections\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : 50, \"oltp_factor\" : 500, \"mixed_factor\" : 200}\n"
+    "    ]\n"
+    "}\n";
+
+/* overrides a factor, drops a parameter and adds one */
+static const char *middle_json =
+    "{\n"
+    "    \"name\" : \"middle\",\n"
+    "    \"extends\" : \"base.json\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"work_mem\", \"oltp_factor\" : 20, \"mixed_factor\" : 30},\n"
+    "        {\"parameter\" : \"max_connections\", \"remove\" : true},\n"
+    "        {\"parameter\" : \"effective_io_concurrency\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : 7, \"oltp_factor\" : 8, \"mixed_factor\" : 9}\n"
+    "    ]\n"
+    "}\n";
+
+/* wins over both for what it sets, brings back the dropped parameter from scratch */
+static const char *top_json =
+    "{\n"
+    "    \"name\" : \"top\",\n"
+    "    \"extends\" : \"middle.json\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"WORK_MEM\", \"mixed_factor\" : 35},\n"
+    "        {\"parameter\" : \"max_connections\", \"resource\" : \"custom\", \"formula\" : \"custom\",\n"
+    "         \"olap_factor\" : 10, \"oltp_factor\" : 100, \"mixed_factor\" : 40}\n"
+    "    ]\n"
+    "}\n";
+
+typedef struct expected_entry
+{
+    const char *param;
+    const char *values[NUM_WORKLOAD_FACTORS];
+} ExpectedEntry;
+
+static const ExpectedEntry expected_entries[] = {
+    {"work_mem", {[OLAP] = "1", [OLTP] = "20", [MIXED] = "35"}},
+    {"maintenance_work_mem", {[OLAP] = "4", [OLTP] = "5", [MIXED] = "6"}},
+    {"effective_io_concurrency", {[OLAP] = "7", [OLTP] = "8", [MIXED] = "9"}},
+    {"max_connections", {[OLAP] = "10", [OLTP] = "100", [MIXED] = "40"}},
+    {NULL}
+};
+
+static bool write_file(const char *dir, const char *name, const char *text);
+static int check_merge_order(const char *dir);
+static int check_depth_limit(const char *dir);
+static PGAT_STATUS load_quietly(pgat_context *ctx, const char *path);
+
+int
+main(void)
+{
+    char dir[] = "/tmp/pgat_test_XXXXXX";
+    char path[512];
+    int failed = 0;
+    int i;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Not possible to create the test directory");
+        return 1;
+    }
+    if (!write_file(dir, "base.json", base_json) || !write_file(dir, "middle.json", middle_json) ||
+        !write_file(dir, "top.json", top_json))
+        return 1;
+
+    failed |= check_merge_order(dir);
+    failed |= check_depth_limit(dir);
+
+    snprintf(path, sizeof path, "%s/base.json", dir);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/middle.json", dir);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/top.json", dir);
+    unlink(path);
+    for (i = 0; i <= PROFILE_DEPTH_LIMIT; i++)
+    {
+        snprintf(path, sizeof path, "%s/level%d.json", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static bool
+write_file(const char *dir, const char *name, const char *text)
+{
+    char path[512];
+    FILE *fp;
+
+    snprintf(path, sizeof path, "%s/%s", dir, name);
+    fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return false;
+    }
+    fputs(text, fp);
+    fclose(fp);
+    return true;
+}
+
+static int
+check_merge_order(const char *dir)
+{
+    const ExpectedEntry *expected;
+    PGConfigMapEntry *entry;
+    pgat_context *ctx;
+    char path[512];
+    int failed = 0;
+    int w;
+
+    snprintf(path, sizeof path, "%s/top.json", dir);
+    ctx = pgat_create();
+    pgat_set_resources(ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    if (pgat_load_profile(ctx, path) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        pgat_destroy(ctx);
+        return 1;
+    }
+
+    /* profile details come from the top-most profile that has them */
+    if (strcmp(pgat_get_profile(ctx)->name, "top") != 0 ||
+        strcmp(pgat_get_profile(ctx)->author, "base author") != 0)
+    {
+        fprintf(stderr, "ERROR: profile \"%s\" by \"%s\", expected \"top\" by \"base author\"\n",
+                pgat_get_profile(ctx)->name, pgat_get_profile(ctx)->author);
+        failed = 1;
+    }
+
+    if (pgat_get_config_map(ctx)->num_entries != 4)
+    {
+        fprintf(stderr, "ERROR: %d entries merged, expected 4\n", pgat_get_config_map(ctx)->num_entries);
+        failed = 1;
+    }
+    for (expected = expected_entries; expected->param; expected++)
+    {
+        for (entry = pgat_get_config_map(ctx)->list; entry; entry = entry->next)
+        {
+            if (strcasecmp(entry->param, expected->param) == 0)
+                break;
+        }
+        if (entry == NULL)
+        {
+            fprintf(stderr, "ERROR: parameter \"%s\" is missing from the merged map\n", expected->param);
+            failed = 1;
+            continue;
+        }
+        for (w = 0; w < NUM_WORKLOAD_FACTORS; w++)
+        {
+            if (strcmp(entry->workload_values[w], expected->values[w]) != 0)
+            {
+                fprintf(stderr, "ERROR: parameter \"%s\" workload %d is %s, expected %s\n",
+                        expected->param, w, entry->workload_values[w], expected->values[w]);
+                failed = 1;
+            }
+        }
+    }
+    pgat_destroy(ctx);
+    return failed;
+}
+
+/* level0 is a base, every other level extends the one before */
+static int
+check_depth_limit(const char *dir)
+{
+    pgat_context *ctx;
+    char name[64];
+    char text[256];
+    char path[512];
+    int failed = 0;
+    int i;
+
+    if (!write_file(dir, "level0.json", base_json))
+        return 1;
+    for (i = 1; i <= PROFILE_DEPTH_LIMIT; i++)
+    {
+        snprintf(name, sizeof name, "level%d.json", i);
+        snprintf(text, sizeof text, "{\"name\" : \"level %d\", \"extends\" : \"level%d.json\"}\n", i, i - 1);
+        if (!write_file(dir, name, text))
+            return 1;
+    }
+
+    ctx = pgat_create();
+    pgat_set_resources(ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    snprintf(path, sizeof path, "%s/level%d.json", dir, PROFILE_DEPTH_LIMIT - 1);
+    if (pgat_load_profile(ctx, path) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: a chain of %d profiles is refused: %s\n", PROFILE_DEPTH_LIMIT, pgat_error_message(ctx));
+        failed = 1;
+    }
+    snprintf(path, sizeof path, "%s/level%d.json", dir, PROFILE_DEPTH_LIMIT);
+    if (load_quietly(ctx, path) == PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: a chain of %d profiles is loaded\n", PROFILE_DEPTH_LIMIT + 1);
+        failed = 1;
+    }
+    pgat_destroy(ctx);
+    return failed;
+}
+
+/* The refusal is reported on stderr, which is not what we test */
+static PGAT_STATUS
+load_quietly(pgat_context *ctx, const char *path)
+{
+    PGAT_STATUS status;
+    int saved_fd;
+    int null_fd;
+
+    fflush(stderr);
+    saved_fd = dup(STDERR_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    if (saved_fd >= 0 && null_fd >= 0)
+        dup2(null_fd, STDERR_FILENO);
+    if (null_fd >= 0)
+        close(null_fd);
+    status = pgat_load_profile(ctx, path);
+    fflush(stderr);
+    if (saved_fd >= 0)
+    {
+        dup2(saved_fd, STDERR_FILENO);
+        close(saved_fd);
+    }
+    return status;
+}
@@ -0,0 +1,218 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_profile_schema.c
+ *		Every problem of a profile is reported with the file, line and
+ *		column of the value at fault, also when the profile extends
+ *		another, and the profile is refused.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pgautotune.h"
+
+/* wrong in the document itself, caught before any entry is built */
+static const char *schema_json =
+    "{\n"
+    "    \"name\" : \"schema test\",\n"
+    "    \"autor\" : \"typo\",\n"
+    "    \"min_memory\" : -5,\n"
+    "    \"NAME\" : \"again\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"work_mem\", \"resource\" : \"memory\", \"formula\" : \"percentage\", \"olap_factor\" : 1, \"oltp_factor\" : 1, \"mixed_factor\" : 1},\n"
+    "        {\"parameter\" : \"work_mem\", \"resource\" : \"ram\", \"formula\" : \"percentage\", \"olap_factor\" : 1, \"oltp_factor\" : 1, \"mixed_factor\" : 1},\n"
+    "        [1],\n"
+    "        {\"resource\" : \"memory\"}\n"
+    "    ]\n"
+    "}\n";
+
+static const char *base_json =
+    "{\n"
+    "    \"name\" : \"base\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"work_mem\", \"resource\" : \"memory\", \"formula\" : \"percentage\", \"olap_factor\" : 1, \"oltp_factor\" : 1, \"mixed_factor\" : 1}\n"
+    "    ]\n"
+    "}\n";
+
+/* well formed, but the entries it makes of base.json are not */
+static const char *overlay_json =
+    "{\n"
+    "    \"extends\" : \"base.json\",\n"
+    "    \"config_map\" : [\n"
+    "        {\"parameter\" : \"work_mem\", \"oltp_factor\" : 150},\n"
+    "        {\"parameter\" : \"max_connections\", \"resource\" : \"custom\", \"formula\" : \"percentage\", \"olap_factor\" : 1, \"oltp_factor\" : 1, \"mixed_factor\" : 1},\n"
+    "        {\"parameter\" : \"effective_cache_size\", \"resource\" : \"memory\", \"formula\" : \"percentage\"}\n"
+    "    ]\n"
+    "}\n";
+
+typedef struct expected_error
+{
+    const char *file;
+    const char *message;        /* after the file name */
+} ExpectedError;
+
+static const ExpectedError schema_errors[] = {
+    {"schema.json", ":3:15: unknown key \"autor\""},
+    {"schema.json", ":4:20: \"min_memory\" must be a non negative integer"},
+    {"schema.json", ":5:14: duplicate key \"NAME\", first defined at 2:14"},
+    {"schema.json", ":8:49: invalid resource \"ram\""},
+    {"schema.json", ":9:9: \"config_map\" entries must be objects"},
+    {"schema.json", ":10:9: required key \"parameter\" is missing"},
+    {"schema.json", ":8:24: duplicate parameter \"work_mem\", first defined at 7:24"},
+    {"schema.json", ": 7 error(s) found"},
+    {NULL}
+};
+
+static const ExpectedError overlay_errors[] = {
+    {"overlay.json", ":4:52: parameter \"work_mem\": oltp_factor 150 is out of range"},
+    {"overlay.json", ":5:78: parameter \"max_connections\": formula"},
+    {"overlay.json", ":6:9: parameter \"effective_cache_size\" has no \"olap_factor\""},
+    {"overlay.json", ":6:9: parameter \"effective_cache_size\" has no \"oltp_factor\""},
+    {"overlay.json", ":6:9: parameter \"effective_cache_size\" has no \"mixed_factor\""},
+    {"overlay.json", ": 5 error(s) found"},
+    {NULL}
+};
+
+static bool write_file(const char *dir, const char *name, const char *text);
+static int check_errors(const char *dir, const char *name, const ExpectedError *expected);
+static char *load_capturing(const char *path, PGAT_STATUS *status);
+
+int
+main(void)
+{
+    char dir[] = "/tmp/pgat_test_XXXXXX";
+    char path[512];
+    int failed = 0;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Not possible to create the test directory");
+        return 1;
+    }
+    if (!write_file(dir, "schema.json", schema_json) || !write_file(dir, "base.json", base_json) ||
+        !write_file(dir, "overlay.json", overlay_json))
+        return 1;
+
+    failed |= check_errors(dir, "schema.json", schema_errors);
+    failed |= check_errors(dir, "overlay.json", overlay_errors);
+    failed |= check_errors(dir, "base.json", NULL);
+
+    snprintf(path, sizeof path, "%s/schema.json", dir);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/base.json", dir);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/overlay.json", dir);
+    unlink(path);
+    rmdir(dir);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static bool
+write_file(const char *dir, const char *name, const char *text)
+{
+    char path[512];
+    FILE *fp;
+
+    snprintf(path, sizeof path, "%s/%s", dir, name);
+    fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return false;
+    }
+    fputs(text, fp);
+    fclose(fp);
+    return true;
+}
+
+/* Load the profile, a NULL expected means it has to load without a word on stderr */
+static int
+check_errors(const char *dir, const char *name, const ExpectedError *expected)
+{
+    PGAT_STATUS status;
+    char path[512];
+    char wanted[1024];
+    char *output;
+    int failed = 0;
+
+    snprintf(path, sizeof path, "%s/%s", dir, name);
+    output = load_capturing(path, &status);
+    if (output == NULL)
+        return 1;
+
+    if (expected == NULL)
+    {
+        if (status != PGAT_OK || *output != '\0')
+        {
+            fprintf(stderr, "ERROR: valid profile %s is refused:\n%s", name, output);
+            failed = 1;
+        }
+        free(output);
+        return failed;
+    }
+
+    if (status == PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: invalid profile %s is loaded\n", name);
+        failed = 1;
+    }
+    for (; expected->file; expected++)
+    {
+        snprintf(wanted, sizeof wanted, "%s/%s%s", dir, expected->file, expected->message);
+        if (strstr(output, wanted) == NULL)
+        {
+            fprintf(stderr, "ERROR: \"%s\" is not reported for %s\n", wanted, name);
+            failed = 1;
+        }
+    }
+    if (failed)
+        fprintf(stderr, "%s", output);
+    free(output);
+    return failed;
+}
+
+/* The errors go to stderr, return what was written there */
+static char *
+load_capturing(const char *path, PGAT_STATUS *status)
+{
+    pgat_context *ctx;
+    FILE *capture;
+    char *output;
+    long size;
+    int saved_fd;
+
+    capture = tmpfile();
+    if (capture == NULL)
+        return NULL;
+    fflush(stderr);
+    saved_fd = dup(STDERR_FILENO);
+    dup2(fileno(capture), STDERR_FILENO);
+    ctx = pgat_create();
+    pgat_set_resources(ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    *status = pgat_load_profile(ctx, path);
+    pgat_destroy(ctx);
+    fflush(stderr);
+    dup2(saved_fd, STDERR_FILENO);
+    close(saved_fd);
+
+    size = ftell(capture);
+    rewind(capture);
+    output = malloc(size + 1);
+    if (output != NULL)
+        output[fread(output, 1, size, capture)] = '\0';
+    fclose(capture);
+    return output;
+}
@@ -0,0 +1,148 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_reprocess.c
+ *		The same context processed and emitted twice writes the same
+ *		configuration, with the parameters renamed for the server version
+ *		of the data directory both times.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pgautotune.h"
+
+/* 10 segments of 16MB, written as wal_keep_size for PostgreSQL 13 */
+#define EXPECTED_LINE "wal_keep_size = 163840kB"
+
+static const char *profile_json =
+    "{\n"
+    "    \"name\" : \"Reprocess test\",\n"
+    "    \"config_map\" : [\n"
+    "        {\n"
+    "            \"parameter\"     : \"wal_keep_segments\",\n"
+    "            \"resource\"      : \"custom\",\n"
+    "            \"Formula\"       : \"custom\",\n"
+    "            \"OLAP_Factor\"   : 10,\n"
+    "            \"OLTP_Factor\"   : 10,\n"
+    "            \"MIXED_Factor\"  : 10\n"
+    "        }\n"
+    "    ]\n"
+    "}\n";
+
+static bool write_file(const char *path, const char *text);
+static char *process_and_emit(pgat_context *ctx);
+
+int
+main(void)
+{
+    char data_dir[] = "/tmp/pgat_test_XXXXXX";
+    char path[512];
+    char *first;
+    char *second;
+    pgat_context *ctx;
+    int failed = 0;
+
+    if (mkdtemp(data_dir) == NULL)
+    {
+        perror("Not possible to create the test data directory");
+        return 1;
+    }
+    snprintf(path, sizeof path, "%s/PG_VERSION", data_dir);
+    if (!write_file(path, "13\n"))
+        return 1;
+    snprintf(path, sizeof path, "%s/postgresql.conf", data_dir);
+    if (!write_file(path, ""))
+        return 1;
+    snprintf(path, sizeof path, "%s/profile.json", data_dir);
+    if (!write_file(path, profile_json))
+        return 1;
+
+    ctx = pgat_create();
+    pgat_set_resources(ctx, 8LL * 1024 * 1024 * 1024, 4, 500);
+    if (pgat_probe(ctx, data_dir) != PGAT_OK || pgat_load_profile(ctx, path) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        return 1;
+    }
+
+    first = process_and_emit(ctx);
+    second = process_and_emit(ctx);
+    if (first == NULL || second == NULL)
+        failed = 1;
+    else if (strstr(first, EXPECTED_LINE) == NULL || strstr(second, EXPECTED_LINE) == NULL)
+    {
+        fprintf(stderr, "ERROR: \"%s\" expected in both runs, got:\n%s---\n%s", EXPECTED_LINE, first, second);
+        failed = 1;
+    }
+    else if (strcmp(first, second) != 0)
+    {
+        fprintf(stderr, "ERROR: the second run differs from the first:\n%s---\n%s", first, second);
+        failed = 1;
+    }
+
+    free(first);
+    free(second);
+    pgat_destroy(ctx);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/PG_VERSION", data_dir);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/postgresql.conf", data_dir);
+    unlink(path);
+    rmdir(data_dir);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static bool
+write_file(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return false;
+    }
+    fputs(text, fp);
+    fclose(fp);
+    return true;
+}
+
+/* The emitted configuration of a pgat_process(), NULL on failure */
+static char *
+process_and_emit(pgat_context *ctx)
+{
+    char *text = NULL;
+    size_t len = 0;
+    FILE *fp;
+
+    if (pgat_process(ctx) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        return NULL;
+    }
+    fp = open_memstream(&text, &len);
+    if (fp == NULL)
+        return NULL;
+    if (pgat_emit_stream(ctx, fp) != PGAT_OK)
+    {
+        fprintf(stderr, "ERROR: %s\n", pgat_error_message(ctx));
+        fclose(fp);
+        free(text);
+        return NULL;
+    }
+    fclose(fp);
+    return text;
+}
@@ -0,0 +1,451 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_wal_stream.c
+ *		Records written into two WAL segments the way the server lays
+ *		them out, over page and segment boundaries, are decoded into the
+ *		counts and rates they add up to, and the WAL ends at a record
+ *		that fails its CRC.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "pg_wal_stream.h"
+#include "pg_control.h"
+
+#define SEGMENT_SIZE (1024 * 1024)
+#define BLOCK_SIZE 8192
+#define NUM_SEGMENTS 2
+#define FIRST_SEGNO 1
+#define WAL_MAGIC 0xD113
+#define MAXALIGN(len) (((len) + 7) & ~((size_t)7))
+
+/* Resource managers and operations of the records written */
+#define RM_XLOG 0
+#define RM_XACT 1
+#define RM_HEAP2 9
+#define RM_HEAP 10
+#define RM_GENERIC 20
+#define CHECKPOINT_ONLINE 0x10
+#define XACT_COMMIT 0x00
+#define XACT_ABORT 0x20
+#define HEAP_INSERT 0x00
+#define HEAP_DELETE 0x10
+#define HEAP_UPDATE 0x20
+#define HEAP_HOT_UPDATE 0x40
+#define HEAP2_MULTI_INSERT 0x50
+
+#define FILLER_DATA_LEN 1000
+#define LARGE_RECORD_DATA 30000
+#define MULTI_INSERT_TUPLES 7
+#define COMMIT_SECONDS 10
+#define POSTGRES_EPOCH_UNIX 946684800LL
+
+/* The WAL of both segments, with the page headers put in as it is written */
+typedef struct wal_writer
+{
+    unsigned char *data;
+    size_t pos;
+    uint64_t start_lsn;
+} WalWriter;
+
+typedef struct record_block
+{
+    uint16_t data_len;
+    uint16_t image_len;         /* no image when 0 */
+    bool hole;
+    bool compressed;
+} RecordBlock;
+
+/* What the records written add up to */
+typedef struct wal_expected
+{
+    long long num_records;
+    long long record_bytes;
+    long long rmgr_records[WAL_NUM_RMGRS];
+    long long fpi_bytes;
+    long long num_fpi;
+    long long num_compressed_fpi;
+    uint64_t first_commit_lsn;
+    uint64_t last_commit_lsn;
+} WalExpected;
+
+static unsigned char record[65536];
+
+static uint32_t build_record(uint8_t rmid, uint8_t info, const RecordBlock *blocks, int num_blocks,
+                             const unsigned char *main_data, uint32_t main_len);
+static uint64_t write_record(WalWriter *writer, WalExpected *expected, uint32_t len);
+static void begin_page(WalWriter *writer, uint32_t rem_len);
+static bool write_segments(const char *wal_dir, WalWriter *writer);
+static void write_stream(WalWriter *writer, WalExpected *expected);
+static int check_stream(const char *wal_dir, const WalExpected *expected);
+static int check_damaged(const char *wal_dir, WalWriter *writer, const WalExpected *expected);
+static void put16(unsigned char *p, uint16_t value);
+static void put32(unsigned char *p, uint32_t value);
+static void put64(unsigned char *p, uint64_t value);
+
+int
+main(void)
+{
+    char dir[] = "/tmp/pgat_test_XXXXXX";
+    char path[512];
+    WalWriter writer;
+    WalExpected expected;
+    int failed = 0;
+    int i;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Not possible to create the test directory");
+        return 1;
+    }
+    writer.data = calloc(NUM_SEGMENTS, SEGMENT_SIZE);
+    if (writer.data == NULL)
+        return 1;
+    writer.pos = 0;
+    writer.start_lsn = (uint64_t)FIRST_SEGNO * SEGMENT_SIZE;
+    memset(&expected, 0, sizeof expected);
+
+    write_stream(&writer, &expected);
+    if (!write_segments(dir, &writer))
+        return 1;
+    failed |= check_stream(dir, &expected);
+    failed |= check_damaged(dir, &writer, &expected);
+
+    for (i = 0; i < NUM_SEGMENTS; i++)
+    {
+        snprintf(path, sizeof path, "%s/%08X%08X%08X", dir, 1, 0, FIRST_SEGNO + i);
+        unlink(path);
+    }
+    rmdir(dir);
+    free(writer.data);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static void
+put16(unsigned char *p, uint16_t value)
+{
+    memcpy(p, &value, sizeof value);
+}
+
+static void
+put32(unsigned char *p, uint32_t value)
+{
+    memcpy(p, &value, sizeof value);
+}
+
+static void
+put64(unsigned char *p, uint64_t value)
+{
+    memcpy(p, &value, sizeof value);
+}
+
+/*
+ * An XLogRecord into record: the header, the block headers, the main data
+ * header, the images and data of the blocks and the main data. Returns
+ * xl_tot_len.
+ */
+static uint32_t
+build_record(uint8_t rmid, uint8_t info, const RecordBlock *blocks, int num_blocks,
+             const unsigned char *main_data, uint32_t main_len)
+{
+    unsigned char *p = record + 24;
+    uint32_t tot_len;
+    uint32_t crc;
+    int i;
+
+    for (i = 0; i < num_blocks; i++)
+    {
+        *p++ = (unsigned char)i;
+        *p++ = (blocks[i].image_len ? 0x10 : 0) | (i > 0 ? 0x80 : 0);
+        put16(p, blocks[i].data_len);
+        p += 2;
+        if (blocks[i].image_len)
+        {
+            put16(p, blocks[i].image_len);
+            put16(p + 2, blocks[i].hole ? 512 : 0);
+            p[4] = (blocks[i].hole ? 0x01 : 0) | (blocks[i].compressed ? 0x04 : 0);
+            p += 5;
+            if (blocks[i].hole && blocks[i].compressed)
+            {
+                put16(p, 1024);
+                p += 2;
+            }
+        }
+        if (i == 0)
+        {
+            put32(p, 1663);
+            put32(p + 4, 5);
+            put32(p + 8, 16384);
+            p += 12;
+        }
+        put32(p, 42 + i);
+        p += 4;
+    }
+    if (main_len > 0 && main_len < 256)
+    {
+        *p++ = 255;
+        *p++ = (unsigned char)main_len;
+    }
+    else if (main_len > 0)
+    {
+        *p++ = 254;
+        put32(p, main_len);
+        p += 4;
+    }
+    for (i = 0; i < num_blocks; i++)
+    {
+        memset(p, 0xAB, blocks[i].image_len);
+        p += blocks[i].image_len;
+        memset(p, 0xCD, blocks[i].data_len);
+        p += blocks[i].data_len;
+    }
+    if (main_data)
+        memcpy(p, main_data, main_len);
+    else
+        memset(p, 0xEF, main_len);
+    p += main_len;
+
+    tot_len = (uint32_t)(p - record);
+    put32(record, tot_len);
+    put32(record + 4, 1000);
+    put64(record + 8, 0);
+    record[16] = info;
+    record[17] = rmid;
+    put16(record + 18, 0);
+    crc = FIN_CRC32C(comp_crc32c(comp_crc32c(INIT_CRC32C, record + 24, tot_len - 24), record, 20));
+    put32(record + 20, crc);
+    return tot_len;
+}
+
+/* XLogPageHeaderData, long at the start of a segment */
+static void
+begin_page(WalWriter *writer, uint32_t rem_len)
+{
+    unsigned char *page = writer->data + writer->pos;
+    bool long_header = writer->pos % SEGMENT_SIZE == 0;
+
+    put16(page, WAL_MAGIC);
+    put16(page + 2, (long_header ? 0x0002 : 0) | (rem_len ? 0x0001 : 0));
+    put32(page + 4, 1);
+    put64(page + 8, writer->start_lsn + writer->pos);
+    put32(page + 16, rem_len);
+    if (long_header)
+    {
+        put64(page + 24, 7301234567890123456ULL);
+        put32(page + 32, SEGMENT_SIZE);
+        put32(page + 36, BLOCK_SIZE);
+    }
+    writer->pos += long_header ? 40 : 24;
+}
+
+/* Append the record built last, splitting it over the pages it reaches. Returns its LSN. */
+static uint64_t
+write_record(WalWriter *writer, WalExpected *expected, uint32_t len)
+{
+    uint64_t lsn;
+    uint32_t written = 0;
+
+    if (writer->pos % BLOCK_SIZE == 0)
+        begin_page(writer, 0);
+    lsn = writer->start_lsn + writer->pos;
+    while (written < len)
+    {
+        uint32_t n;
+
+        if (writer->pos % BLOCK_SIZE == 0)
+            begin_page(writer, len - written);
+        n = BLOCK_SIZE - writer->pos % BLOCK_SIZE;
+        if (n > len - written)
+            n = len - written;
+        memcpy(writer->data + writer->pos, record + written, n);
+        writer->pos += n;
+        written += n;
+    }
+    writer->pos = MAXALIGN(writer->pos);
+
+    expected->num_records++;
+    expected->record_bytes += len;
+    expected->rmgr_records[record[17]]++;
+    return lsn;
+}
+
+/*
+ * Heap changes with and without full page images, a multi insert, a
+ * checkpoint, a commit and an abort, then inserts up to near the end of
+ * the first segment, a record that goes on into the second one, and a
+ * last commit.
+ */
+static void
+write_stream(WalWriter *writer, WalExpected *expected)
+{
+    RecordBlock blocks[2];
+    unsigned char main_data[88];
+    int64_t commit_time = (1700000000LL - POSTGRES_EPOCH_UNIX) * 1000000;
+    uint32_t len;
+
+    memset(blocks, 0, sizeof blocks);
+    memset(main_data, 0, sizeof main_data);
+
+    blocks[0].data_len = 60;
+    write_record(writer, expected, build_record(RM_HEAP, HEAP_INSERT, blocks, 1, NULL, 3));
+
+    /* an image with a hole, and a compressed image with a hole on a second block */
+    blocks[0].image_len = BLOCK_SIZE - 1024;
+    blocks[0].hole = true;
+    blocks[1].data_len = 20;
+    blocks[1].image_len = 3000;
+    blocks[1].hole = true;
+    blocks[1].compressed = true;
+    write_record(writer, expected, build_record(RM_HEAP, HEAP_UPDATE, blocks, 2, NULL, 14));
+    expected->fpi_bytes += blocks[0].image_len + blocks[1].image_len;
+    expected->num_fpi += 2;
+    expected->num_compressed_fpi++;
+    memset(blocks, 0, sizeof blocks);
+
+    blocks[0].data_len = 30;
+    write_record(writer, expected, build_record(RM_HEAP, HEAP_HOT_UPDATE, blocks, 1, NULL, 14));
+    write_record(writer, expected, build_record(RM_HEAP, HEAP_DELETE, blocks, 1, NULL, 8));
+
+    put16(main_data + 2, MULTI_INSERT_TUPLES);
+    write_record(writer, expected, build_record(RM_HEAP2, HEAP2_MULTI_INSERT, blocks, 1, main_data, 4));
+    memset(main_data, 0, sizeof main_data);
+    write_record(writer, expected, build_record(RM_XLOG, CHECKPOINT_ONLINE, NULL, 0, main_data, sizeof main_data));
+
+    put64(main_data, (uint64_t)commit_time);
+    expected->first_commit_lsn = write_record(writer, expected, build_record(RM_XACT, XACT_COMMIT, NULL, 0, main_data, 8));
+    write_record(writer, expected, build_record(RM_XACT, XACT_ABORT, NULL, 0, main_data, 8));
+
+    blocks[0].data_len = FILLER_DATA_LEN;
+    while (writer->pos < SEGMENT_SIZE - 10000)
+        write_record(writer, expected, build_record(RM_HEAP, HEAP_INSERT, blocks, 1, NULL, 3));
+    write_record(writer, expected, build_record(RM_GENERIC, 0, NULL, 0, NULL, LARGE_RECORD_DATA));
+
+    put64(main_data, (uint64_t)(commit_time + COMMIT_SECONDS * 1000000LL));
+    len = build_record(RM_XACT, XACT_COMMIT, NULL, 0, main_data, 8);
+    expected->last_commit_lsn = write_record(writer, expected, len);
+}
+
+static bool
+write_segments(const char *wal_dir, WalWriter *writer)
+{
+    char path[512];
+    FILE *fp;
+    int i;
+
+    for (i = 0; i < NUM_SEGMENTS; i++)
+    {
+        snprintf(path, sizeof path, "%s/%08X%08X%08X", wal_dir, 1, 0, FIRST_SEGNO + i);
+        fp = fopen(path, "wb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Failed to open file %s\n", path);
+            return false;
+        }
+        if (fwrite(writer->data + (size_t)i * SEGMENT_SIZE, 1, SEGMENT_SIZE, fp) != SEGMENT_SIZE)
+        {
+            fclose(fp);
+            return false;
+        }
+        fclose(fp);
+    }
+    return true;
+}
+
+static int
+check_stream(const char *wal_dir, const WalExpected *expected)
+{
+    WalStream stream;
+    long long heap_records = expected->rmgr_records[RM_HEAP];
+    int failed = 0;
+    int i;
+
+    if (!analyze_wal_stream(wal_dir, 160000, &stream))
+        return 1;
+    if (stream.num_segments != NUM_SEGMENTS || stream.num_skipped != 0 || stream.segment_size != SEGMENT_SIZE ||
+        stream.block_size != BLOCK_SIZE)
+    {
+        fprintf(stderr, "ERROR: %d segments of %u bytes decoded, %d skipped\n", stream.num_segments,
+                stream.segment_size, stream.num_skipped);
+        failed = 1;
+    }
+    if (stream.num_records != expected->num_records || stream.record_bytes != expected->record_bytes)
+    {
+        fprintf(stderr, "ERROR: %lld records of %lld bytes decoded, %lld of %lld written\n", stream.num_records,
+                stream.record_bytes, expected->num_records, expected->record_bytes);
+        failed = 1;
+    }
+    for (i = 0; i < WAL_NUM_RMGRS; i++)
+    {
+        if (stream.rmgr_records[i] != expected->rmgr_records[i])
+        {
+            fprintf(stderr, "ERROR: %lld records of resource manager %d decoded, %lld written\n",
+                    stream.rmgr_records[i], i, expected->rmgr_records[i]);
+            failed = 1;
+        }
+    }
+    if (stream.num_fpi != expected->num_fpi || stream.num_compressed_fpi != expected->num_compressed_fpi ||
+        stream.fpi_bytes != expected->fpi_bytes ||
+        fabs(stream.fpi_share - (double)expected->fpi_bytes / expected->record_bytes) > 1e-9)
+    {
+        fprintf(stderr, "ERROR: %lld full page images of %lld bytes, %lld compressed, decoded\n", stream.num_fpi,
+                stream.fpi_bytes, stream.num_compressed_fpi);
+        failed = 1;
+    }
+    /* the heap records are inserts but for an update, a HOT update and a delete */
+    if (stream.inserts != heap_records - 3 + MULTI_INSERT_TUPLES || stream.updates != 2 ||
+        stream.hot_updates != 1 || stream.deletes != 1)
+    {
+        fprintf(stderr, "ERROR: %lld inserts, %lld updates, %lld HOT, %lld deletes decoded\n", stream.inserts,
+                stream.updates, stream.hot_updates, stream.deletes);
+        failed = 1;
+    }
+    if (stream.commits != 2 || stream.aborts != 1 || stream.checkpoints != 1)
+    {
+        fprintf(stderr, "ERROR: %lld commits, %lld aborts, %lld checkpoints decoded\n", stream.commits,
+                stream.aborts, stream.checkpoints);
+        failed = 1;
+    }
+    if (stream.rate_from_files || fabs(stream.span - COMMIT_SECONDS) > 1e-6 ||
+        fabs(stream.bytes_per_second - (double)(expected->last_commit_lsn - expected->first_commit_lsn) / COMMIT_SECONDS) > 1e-6 ||
+        fabs(stream.commit_rate - 1.0 / COMMIT_SECONDS) > 1e-9)
+    {
+        fprintf(stderr, "ERROR: %.3f bytes a second over %.3f seconds, %.3f commits a second, decoded\n",
+                stream.bytes_per_second, stream.span, stream.commit_rate);
+        failed = 1;
+    }
+    return failed;
+}
+
+/* A byte of the last commit changed, the WAL ends before it */
+static int
+check_damaged(const char *wal_dir, WalWriter *writer, const WalExpected *expected)
+{
+    WalStream stream;
+    size_t offset = expected->last_commit_lsn - writer->start_lsn;
+
+    writer->data[offset + 24 + 2] ^= 0x01;
+    if (!write_segments(wal_dir, writer) || !analyze_wal_stream(wal_dir, 160000, &stream))
+        return 1;
+    if (stream.num_records != expected->num_records - 1 || stream.commits != 1 || stream.num_segments != NUM_SEGMENTS)
+    {
+        fprintf(stderr, "ERROR: %lld records and %lld commits decoded past a record that fails its CRC\n",
+                stream.num_records, stream.commits);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,312 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_xid_rate.c
+ *		The transaction id rate is the least squares slope of the
+ *		checkpoints of the history, across the wraparound of the 32 bit
+ *		counters, and only since the cluster was last reset.
+ *
+ * Copyright © Percona LLC and/or its affiliates
+ *
+ * Hackathon Team one
+ *  Abdul Sayeed
+ *  Agustin Gallego
+ *  Charly Batista
+ *  Jobin Augustine
+ *  Muhammad Usama
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pg_xid_rate.h"
+
+#define SYSTEM_IDENTIFIER 7301234567890123456ULL
+#define OTHER_SYSTEM_IDENTIFIER 123ULL
+#define LAST_CHECKPOINT 1700000000LL
+#define HOUR 3600
+
+/* next transaction id of the wraparound history, the 32 bit counter wraps after the second checkpoint */
+#define WRAP_XID_START (0xFFFFFFFFULL - 2000000)
+#define WRAP_XID_RATE 500
+#define WRAP_MULTI_START 0xFFFFFF00U
+#define WRAP_MULTI_RATE 10
+#define WRAP_CHECKPOINTS 11
+
+/* before the reset the cluster ran faster from higher ids */
+#define RESET_XID_BEFORE 50000000ULL
+#define RESET_XID_AFTER 10000000ULL
+#define RESET_RATE_BEFORE 1000
+#define RESET_RATE_AFTER 200
+#define RESET_CHECKPOINTS_BEFORE 6
+#define RESET_CHECKPOINTS 21
+
+static bool write_file(const char *path, const void *data, size_t len);
+static bool write_control(const char *dir, const XidSample *sample);
+static bool write_history_line(FILE *fp, uint64_t system_identifier, const XidSample *sample);
+static int check_wraparound(const char *dir, const char *history_path);
+static int check_reset(const char *dir, const char *history_path);
+static int check_recorded(const char *dir, const char *history_path);
+static bool measure(const char *dir, const char *history_path, XidRate *rate);
+static bool close_to(double value, double expected);
+
+int
+main(void)
+{
+    char dir[] = "/tmp/pgat_test_XXXXXX";
+    char history_path[512];
+    char path[512];
+    int failed = 0;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Not possible to create the test directory");
+        return 1;
+    }
+    snprintf(history_path, sizeof history_path, "%s/xid_history", dir);
+
+    failed |= check_wraparound(dir, history_path);
+    failed |= check_recorded(dir, history_path);
+    failed |= check_reset(dir, history_path);
+
+    unlink(history_path);
+    snprintf(path, sizeof path, "%s/%s", dir, PG_CONTROL_FILE);
+    unlink(path);
+    snprintf(path, sizeof path, "%s/global", dir);
+    rmdir(path);
+    snprintf(path, sizeof path, "%s/%s", dir, PG_VERSION_FILE);
+    unlink(path);
+    rmdir(dir);
+    printf("%s: %s\n", __FILE__, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static bool
+write_file(const char *path, const void *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return false;
+    }
+    if (fwrite(data, 1, len, fp) != len)
+    {
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+/* A pg_control of version 16 with the latest checkpoint at sample */
+static bool
+write_control(const char *dir, const XidSample *sample)
+{
+    unsigned char data[PG_CONTROL_FILE_SIZE];
+    const double float_format = 1234567.0;
+    const size_t checkpoint = 40;
+    const size_t f = 208;
+    uint64_t system_identifier = SYSTEM_IDENTIFIER;
+    uint32_t crc;
+    char path[512];
+
+    memset(data, 0, sizeof data);
+    memcpy(data, &system_identifier, sizeof system_identifier);
+    memcpy(data + checkpoint + 24, &sample->next_xid, sizeof sample->next_xid);
+    memcpy(data + checkpoint + 36, &sample->next_multi, sizeof sample->next_multi);
+    memcpy(data + checkpoint + 44, &sample->oldest_xid, sizeof sample->oldest_xid);
+    memcpy(data + checkpoint + 52, &sample->oldest_multi, sizeof sample->oldest_multi);
+    memcpy(data + checkpoint + 64, &sample->time, sizeof sample->time);
+    memcpy(data + f, &float_format, sizeof float_format);
+    crc = FIN_CRC32C(comp_crc32c(INIT_CRC32C, data, f + 80));
+    memcpy(data + f + 80, &crc, sizeof crc);
+
+    snprintf(path, sizeof path, "%s/global", dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof path, "%s/%s", dir, PG_CONTROL_FILE);
+    if (!write_file(path, data, sizeof data))
+        return false;
+    snprintf(path, sizeof path, "%s/%s", dir, PG_VERSION_FILE);
+    return write_file(path, "16\n", 3);
+}
+
+static bool
+write_history_line(FILE *fp, uint64_t system_identifier, const XidSample *sample)
+{
+    return fprintf(fp, "%llu %lld %llu %u %u %u\n", (unsigned long long)system_identifier, (long long)sample->time,
+                   (unsigned long long)sample->next_xid, sample->oldest_xid, sample->next_multi, sample->oldest_multi) > 0;
+}
+
+static bool
+measure(const char *dir, const char *history_path, XidRate *rate)
+{
+    ControlInfo control;
+
+    if (!read_control_info(dir, &control) || !measure_xid_rate(dir, &control, history_path, 0, rate))
+    {
+        fprintf(stderr, "ERROR: the transaction id rate of %s is not measured\n", dir);
+        return false;
+    }
+    return true;
+}
+
+static bool
+close_to(double value, double expected)
+{
+    return fabs(value - expected) <= 1e-6 * (fabs(expected) > 1 ? fabs(expected) : 1);
+}
+
+/*
+ * An hourly history whose next transaction id and next multixact id pass
+ * 2^32, with samples of another cluster and samples too old to count that
+ * would change the slope if they were used. The last checkpoint is the
+ * one of pg_control.
+ */
+static int
+check_wraparound(const char *dir, const char *history_path)
+{
+    XidSample sample;
+    XidRate rate;
+    FILE *fp;
+    int failed = 0;
+    int k;
+
+    unlink(history_path);
+    fp = fopen(history_path, "w");
+    if (fp == NULL)
+        return 1;
+    fputs("# transaction id history\n\n", fp);
+    for (k = 0; k < 5; k++)
+    {
+        sample.time = LAST_CHECKPOINT - 40 * 86400LL + k * HOUR;
+        sample.next_xid = WRAP_XID_START - 10000000 + k * 10 * HOUR;
+        sample.oldest_xid = 3;
+        sample.next_multi = 1;
+        sample.oldest_multi = 1;
+        write_history_line(fp, SYSTEM_IDENTIFIER, &sample);
+    }
+    for (k = 0; k < WRAP_CHECKPOINTS; k++)
+    {
+        sample.time = LAST_CHECKPOINT - (WRAP_CHECKPOINTS - 1 - k) * (int64_t)HOUR;
+        sample.next_xid = WRAP_XID_START + (uint64_t)k * WRAP_XID_RATE * HOUR;
+        sample.oldest_xid = (uint32_t)(0xFFFFFFFFULL - 100000000);
+        sample.next_multi = WRAP_MULTI_START + (uint32_t)k * WRAP_MULTI_RATE * HOUR;
+        sample.oldest_multi = 0xFFFF0000U;
+        if (k == WRAP_CHECKPOINTS - 1)
+            break;
+        write_history_line(fp, SYSTEM_IDENTIFIER, &sample);
+        if (k == 3)
+        {
+            XidSample other = sample;
+
+            other.time += HOUR / 2;
+            other.next_xid = 999999999999ULL;
+            write_history_line(fp, OTHER_SYSTEM_IDENTIFIER, &other);
+        }
+    }
+    fclose(fp);
+    if (!write_control(dir, &sample) || !measure(dir, history_path, &rate))
+        return 1;
+
+    if (rate.num_samples != WRAP_CHECKPOINTS + 5)
+    {
+        fprintf(stderr, "ERROR: %d samples in the wraparound history, expected %d\n", rate.num_samples, WRAP_CHECKPOINTS + 5);
+        failed = 1;
+    }
+    if (!close_to(rate.xid_rate, WRAP_XID_RATE) || !close_to(rate.span, (WRAP_CHECKPOINTS - 1) * HOUR))
+    {
+        fprintf(stderr, "ERROR: %.3f transaction ids a second over %.0f seconds across the wraparound, expected %d over %d\n",
+                rate.xid_rate, rate.span, WRAP_XID_RATE, (WRAP_CHECKPOINTS - 1) * HOUR);
+        failed = 1;
+    }
+    if (!close_to(rate.multi_rate, WRAP_MULTI_RATE))
+    {
+        fprintf(stderr, "ERROR: %.3f multixact ids a second across the wraparound, expected %d\n", rate.multi_rate, WRAP_MULTI_RATE);
+        failed = 1;
+    }
+    /* ages count from the oldest ids before the wraparound to the next ids after it */
+    if (!close_to(rate.xid_age, 100000000.0 + 16000000) || !close_to(rate.multi_age, 0xFF00 + 360000.0))
+    {
+        fprintf(stderr, "ERROR: age of datfrozenxid %.0f and of datminmxid %.0f across the wraparound\n",
+                rate.xid_age, rate.multi_age);
+        failed = 1;
+    }
+    free_xid_rate(&rate);
+    return failed;
+}
+
+/* The checkpoint of pg_control is added to the history once */
+static int
+check_recorded(const char *dir, const char *history_path)
+{
+    XidRate rate;
+    int failed = 0;
+
+    if (!measure(dir, history_path, &rate))
+        return 1;
+    if (rate.num_recorded != 0 || rate.num_samples != WRAP_CHECKPOINTS + 5)
+    {
+        fprintf(stderr, "ERROR: %d samples recorded again, %d samples in the history\n", rate.num_recorded, rate.num_samples);
+        failed = 1;
+    }
+    free_xid_rate(&rate);
+    return failed;
+}
+
+/*
+ * A cluster restored from a backup goes back to lower transaction ids, the
+ * samples before that are of another workload.
+ */
+static int
+check_reset(const char *dir, const char *history_path)
+{
+    XidSample sample;
+    XidRate rate;
+    FILE *fp;
+    int failed = 0;
+    int k;
+
+    unlink(history_path);
+    fp = fopen(history_path, "w");
+    if (fp == NULL)
+        return 1;
+    memset(&sample, 0, sizeof sample);
+    for (k = 0; k < RESET_CHECKPOINTS; k++)
+    {
+        sample.time = LAST_CHECKPOINT - (RESET_CHECKPOINTS - 1 - k) * (int64_t)HOUR;
+        if (k < RESET_CHECKPOINTS_BEFORE)
+            sample.next_xid = RESET_XID_BEFORE + (uint64_t)k * RESET_RATE_BEFORE * HOUR;
+        else
+            sample.next_xid = RESET_XID_AFTER + (uint64_t)(k - RESET_CHECKPOINTS_BEFORE) * RESET_RATE_AFTER * HOUR;
+        sample.oldest_xid = 3;
+        sample.next_multi = 1;
+        sample.oldest_multi = 1;
+        if (k == RESET_CHECKPOINTS - 1)
+            break;
+        write_history_line(fp, SYSTEM_IDENTIFIER, &sample);
+    }
+    fclose(fp);
+    if (!write_control(dir, &sample) || !measure(dir, history_path, &rate))
+        return 1;
+
+    if (rate.num_recorded != 1)
+    {
+        fprintf(stderr, "ERROR: %d samples recorded, expected the checkpoint of pg_control\n", rate.num_recorded);
+        failed = 1;
+    }
+    if (!close_to(rate.xid_rate, RESET_RATE_AFTER) ||
+        !close_to(rate.span, (RESET_CHECKPOINTS - 1 - RESET_CHECKPOINTS_BEFORE) * HOUR))
+    {
+        fprintf(stderr, "ERROR: %.3f transaction ids a second over %.0f seconds after the reset, expected %d over %d\n",
+                rate.xid_rate, rate.span, RESET_RATE_AFTER, (RESET_CHECKPOINTS - 1 - RESET_CHECKPOINTS_BEFORE) * HOUR);
+        failed = 1;
+    }
+    free_xid_rate(&rate);
+    return failed;
+}